@@ -0,0 +1,485 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapsBench.cpp
+ * @brief   Microbenchmarks of the plugin's per-event and per-nap functions,
+ *          written with Google Benchmark.
+ *
+ * @note    Representative entries are taken from a real trace file, whose
+ *          path is read from the `NAPS_BENCH_TRACE` environment variable
+ *          (`trace.dat` by default). Synthetic traces from `naps-tracegen`
+ *          work well.
+ * @note    No OpenGL context is created, so drawing benchmarks measure
+ *          only the CPU side of drawing.
+*/
+
+// C
+#include <cstdlib>
+#include <cstring>
+
+// C++
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+// Google Benchmark
+#include <benchmark/benchmark.h>
+
+// KernelShark
+#include "libkshark.h"
+#include "libkshark-model.h"
+#include "KsPlotTools.hpp"
+
+// Plugin headers
+#include "naps.h"
+#include "NapRectangle.hpp"
+#include "NapSession.hpp"
+#include "NapTable.hpp"
+#include "NapView.hpp"
+
+// Constants
+
+///
+/// @brief Number of representative entries of each kind.
+constexpr size_t N_SAMPLES = 4096;
+
+///
+/// @brief Number of bins of the benchmark's histogram.
+constexpr int N_BINS = 1024;
+
+///
+/// @brief Size of collected events after which the container is reset.
+constexpr ssize_t CONTAINER_RESET = 1 << 22;
+
+// Fonts (the benchmark doesn't link the plugin's GUI part)
+
+/// @brief Font which is never loaded, there's no OpenGL context anyway.
+static struct ksplot_font bench_font;
+
+/// @cond Doxygen_Suppress
+extern "C" struct ksplot_font* get_font_ptr() { return &bench_font; }
+extern "C" struct ksplot_font* get_bold_font_ptr() { return &bench_font; }
+// No glyph atlas either, labels fall back to text boxes
+extern "C" const char* get_bold_font_path() { return nullptr; }
+/// @endcond
+
+// Fixture
+
+///
+/// @brief Size of raw data of sample records, enough for sched events.
+constexpr size_t RECORD_SIZE = 128;
+
+/**
+ * @brief Writes a value into a raw record at the location of a field.
+ *
+ * @param data: Raw data of a record
+ * @param reader: Location of the field
+ * @param val: Value to write, truncated to the field's size
+*/
+static void _put_field(std::vector<unsigned char>& data,
+    const naps_field_reader& reader, int64_t val)
+{
+    if (reader.offset < 0 || size_t(reader.offset + reader.size) > data.size()) {
+        return;
+    }
+
+    unsigned char* field = data.data() + reader.offset;
+    switch (reader.size) {
+    case 1: { int8_t v = int8_t(val); std::memcpy(field, &v, sizeof(v)); break; }
+    case 2: { int16_t v = int16_t(val); std::memcpy(field, &v, sizeof(v)); break; }
+    case 4: { int32_t v = int32_t(val); std::memcpy(field, &v, sizeof(v)); break; }
+    case 8: std::memcpy(field, &val, sizeof(val)); break;
+    }
+}
+
+/**
+ * @brief Loaded trace and representative data shared by all benchmarks.
+*/
+struct BenchData {
+    ///
+    /// @brief Loaded trace with the plugin's core attached.
+    NapSession session;
+    ///
+    /// @brief Copies of sched_switch entries.
+    std::vector<kshark_entry> switches;
+    ///
+    /// @brief Copies of sched_waking entries.
+    std::vector<kshark_entry> wakings;
+    ///
+    /// @brief Raw sched_switch data, one buffer per switch entry.
+    std::vector<std::vector<unsigned char>> switch_data;
+    ///
+    /// @brief Raw sched_waking data, one buffer per waking entry.
+    std::vector<std::vector<unsigned char>> waking_data;
+    ///
+    /// @brief Histogram spanning the whole trace.
+    kshark_trace_histo histo;
+    ///
+    /// @brief Graph of a task plot over the histogram.
+    KsPlot::Graph* graph = nullptr;
+    ///
+    /// @brief Color tables needed by the graph.
+    KsPlot::ColorTable pid_colors, cpu_colors;
+    ///
+    /// @brief Whether loading succeeded.
+    bool ok = false;
+
+    BenchData();
+    ~BenchData();
+};
+
+/**
+ * @brief Loads the trace and picks representative entries.
+*/
+BenchData::BenchData() {
+    const char* file = std::getenv("NAPS_BENCH_TRACE");
+    if (!session.open(file ? file : "trace.dat")) return;
+
+    plugin_naps_context* ctx = session.context();
+    if (ctx->waking_pid.offset < 0 || ctx->switch_prev_state.offset < 0
+        || ctx->switch_next_pid.offset < 0) return;
+
+    for (ssize_t i = 0; i < session.n_entries(); ++i) {
+        const kshark_entry* entry = session.entries()[i];
+
+        if (entry->event_id == ctx->sswitch_event_id
+            && switches.size() < N_SAMPLES) {
+            switches.push_back(*entry);
+            std::vector<unsigned char> data(RECORD_SIZE);
+            _put_field(data, ctx->switch_prev_state, 1);
+            _put_field(data, ctx->switch_next_pid, entry->pid);
+            switch_data.push_back(std::move(data));
+        } else if (entry->event_id == ctx->waking_event_id
+            && wakings.size() < N_SAMPLES) {
+            wakings.push_back(*entry);
+            // Wakee's PID was moved into the entry during loading
+            std::vector<unsigned char> data(RECORD_SIZE);
+            _put_field(data, ctx->waking_pid, entry->pid);
+            waking_data.push_back(std::move(data));
+        }
+    }
+
+    ksmodel_init(&histo);
+    ksmodel_set_bining(&histo, N_BINS, session.entries()[0]->ts,
+        session.entries()[session.n_entries() - 1]->ts);
+    graph = new KsPlot::Graph(&histo, &pid_colors, &cpu_colors);
+    graph->setBase(100);
+
+    ok = !switches.empty() && !wakings.empty();
+}
+
+/**
+ * @brief Frees the graph and the histogram, session closes itself.
+*/
+BenchData::~BenchData() {
+    delete graph;
+    ksmodel_clear(&histo);
+}
+
+/**
+ * @brief Gets the shared benchmark data, loading them on first use.
+*/
+static BenchData& bench_data() {
+    static BenchData data;
+    return data;
+}
+
+/**
+ * @brief Skips the benchmark if the trace couldn't be loaded.
+ *
+ * @returns True if the benchmark can continue.
+*/
+static bool _check_data(benchmark::State& state) {
+    if (!bench_data().ok) {
+        state.SkipWithError("Trace not loaded, set NAPS_BENCH_TRACE.");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Creates a rectangle like the drawing function does.
+*/
+static KsPlot::Rectangle _sample_rect() {
+    KsPlot::Rectangle rect;
+    rect.setFill(true);
+    rect._color = {0, 0, 255};
+    rect.setPoint(0, 11, 82);
+    rect.setPoint(1, 11, 90);
+    rect.setPoint(2, 509, 90);
+    rect.setPoint(3, 509, 82);
+    return rect;
+}
+
+// Benchmarks
+
+/**
+ * @brief Benchmarks getting prev_state of sched_switch entries.
+*/
+static void BM_get_switch_prev_state(benchmark::State& state) {
+    if (!_check_data(state)) return;
+    const auto& switches = bench_data().switches;
+    size_t i = 0;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(get_switch_prev_state(&switches[i]));
+        i = (i + 1) % switches.size();
+    }
+}
+BENCHMARK(BM_get_switch_prev_state);
+
+/**
+ * @brief Benchmarks creation of nap rectangles from bins, including
+ * allocation and the rectangle's constructor.
+*/
+static void BM_make_nap_rect(benchmark::State& state) {
+    if (!_check_data(state)) return;
+    const BenchData& data = bench_data();
+    int start_bin = 10;
+
+    for (auto _ : state) {
+        NapRectangle* rect = make_nap_rect(data.graph, start_bin,
+            start_bin + 500, &data.switches[0], &data.wakings[0], 'S');
+        benchmark::DoNotOptimize(rect);
+        delete rect;
+        start_bin = (start_bin + 1) % (N_BINS - 500);
+    }
+}
+BENCHMARK(BM_make_nap_rect);
+
+/**
+ * @brief Benchmarks the nap rectangle's constructor alone.
+*/
+static void BM_NapRectangle_ctor(benchmark::State& state) {
+    if (!_check_data(state)) return;
+    const BenchData& data = bench_data();
+    const KsPlot::Rectangle rect = _sample_rect();
+
+    for (auto _ : state) {
+        NapRectangle nap_rect{&data.switches[0], &data.wakings[0], 'D',
+            rect, {0, 0, 255}, {0xFF, 0xFF, 0xFF}};
+        benchmark::DoNotOptimize(&nap_rect);
+    }
+}
+BENCHMARK(BM_NapRectangle_ctor);
+
+/**
+ * @brief Benchmarks drawing of a nap rectangle wide enough for its text.
+*/
+static void BM_NapRectangle_draw(benchmark::State& state) {
+    if (!_check_data(state)) return;
+    const BenchData& data = bench_data();
+    const NapRectangle nap_rect{&data.switches[0], &data.wakings[0], 'S',
+        _sample_rect(), {0, 0, 255}, {0xFF, 0xFF, 0xFF}};
+
+    for (auto _ : state) {
+        nap_rect.draw();
+    }
+}
+BENCHMARK(BM_NapRectangle_draw);
+
+/**
+ * @brief Benchmarks computing geometry of all naps of the task with the
+ * most naps, in views spanning a range of bin counts.
+*/
+static void BM_naps_geometry(benchmark::State& state) {
+    if (!_check_data(state)) return;
+    const NapTable* table = bench_data().session.table();
+
+    const NapTaskTable* busiest = nullptr;
+    for (const auto& [pid, task] : table->tasks()) {
+        if (!busiest || task.size() > busiest->size()) busiest = &task;
+    }
+    if (!busiest || !busiest->size()) {
+        state.SkipWithError("No naps in the trace.");
+        return;
+    }
+
+    const int n_bins = int(state.range(0));
+    const int64_t min = busiest->start.front(), max = busiest->end.back();
+    const NapView view{min, max, std::max<int64_t>((max - min) / n_bins, 1),
+        n_bins};
+    NapGeometry geometry;
+
+    for (auto _ : state) {
+        naps_geometry(*busiest, view, 0, 1, geometry);
+        benchmark::DoNotOptimize(geometry.size());
+    }
+    state.SetItemsProcessed(state.iterations() * busiest->size());
+}
+BENCHMARK(BM_naps_geometry)->Arg(1024)->Arg(1 << 16)->Arg(1 << 24);
+
+/**
+ * @brief Benchmarks drawing of a batch of nap rectangles, a quarter of them
+ * wide enough for their text.
+*/
+static void BM_NapRectangleBatch_draw(benchmark::State& state) {
+    if (!_check_data(state)) return;
+    NapRectangleBatch batch;
+    const int n_rects = int(state.range(0));
+    batch.reserve(n_rects);
+    for (int i = 0; i < n_rects; ++i) {
+        const int width = (i % 4) ? 4 : 200;
+        batch.add(i % N_BINS, i % N_BINS + width, 100, (i & 1) ? 'S' : 'D',
+            uint32_t(i));
+    }
+
+    for (auto _ : state) {
+        batch.draw();
+    }
+    state.SetItemsProcessed(state.iterations() * n_rects);
+}
+BENCHMARK(BM_NapRectangleBatch_draw)->Arg(64)->Arg(4096);
+
+/**
+ * @brief State of a plugin context which ingestion handlers modify: the
+ * collected events, tracking of their runs and records seen per CPU.
+*/
+struct IngestionState {
+    ///
+    /// @brief Collected events.
+    kshark_data_container* collected_events;
+    ///
+    /// @brief Positions of merged events in the order of ingestion.
+    uint32_t* ingest_order;
+    ///
+    /// @brief Indices where runs of time-ordered events start.
+    ssize_t* run_starts;
+    ///
+    /// @brief Number of runs in `run_starts`.
+    size_t n_runs;
+    ///
+    /// @brief Allocated capacity of `run_starts`.
+    size_t runs_capacity;
+    ///
+    /// @brief Timestamp of the last collected event.
+    int64_t last_collected_ts;
+    ///
+    /// @brief Whether runs couldn't be tracked.
+    bool runs_lost;
+    ///
+    /// @brief Records loaded and seen per CPU.
+    std::vector<naps_cpu_records> cpu_records;
+};
+
+/**
+ * @brief Creates ingestion state of a context which hasn't loaded anything.
+ *
+ * @param ctx: Plugin context, gives the number of CPUs
+ *
+ * @returns Empty ingestion state.
+*/
+static IngestionState _fresh_ingestion(const plugin_naps_context* ctx) {
+    return IngestionState{kshark_init_data_container(), nullptr, nullptr, 0, 0,
+        INT64_MAX, false,
+        std::vector<naps_cpu_records>(size_t(ctx->n_cpu_records))};
+}
+
+/**
+ * @brief Exchanges the ingestion state of a context with a kept one.
+ *
+ * @param ctx: Plugin context
+ * @param kept: Ingestion state exchanged with the context's
+*/
+static void _swap_ingestion(plugin_naps_context* ctx, IngestionState& kept) {
+    std::swap(ctx->collected_events, kept.collected_events);
+    std::swap(ctx->ingest_order, kept.ingest_order);
+    std::swap(ctx->run_starts, kept.run_starts);
+    std::swap(ctx->n_runs, kept.n_runs);
+    std::swap(ctx->runs_capacity, kept.runs_capacity);
+    std::swap(ctx->last_collected_ts, kept.last_collected_ts);
+    std::swap(ctx->runs_lost, kept.runs_lost);
+    std::swap_ranges(kept.cpu_records.begin(), kept.cpu_records.end(),
+        ctx->cpu_records);
+}
+
+/**
+ * @brief Frees ingestion state which isn't in any context.
+ *
+ * @param state: Ingestion state to free
+*/
+static void _free_ingestion(IngestionState& state) {
+    kshark_free_data_container(state.collected_events);
+    std::free(state.ingest_order);
+    std::free(state.run_starts);
+}
+
+/**
+ * @brief Runs an ingestion handler over sample records in a loop, resetting
+ * the ingestion state once in a while, so that memory doesn't run out.
+ *
+ * The context's state from loading the trace file is put aside and restored
+ * afterwards, so that measured ingestion starts from an empty context - its
+ * records already seen per CPU would otherwise make the handlers skip the
+ * samples as reloaded ones.
+ *
+ * @param state: State of the benchmark
+ * @param handler: Event handler to benchmark, or null to alternate between
+ * sched_switch and sched_waking handlers
+*/
+static void _run_ingestion(benchmark::State& state,
+    void (*handler)(kshark_data_stream*, void*, kshark_entry*))
+{
+    if (!_check_data(state)) return;
+    BenchData& data = bench_data();
+    plugin_naps_context* ctx = data.session.context();
+    kshark_data_stream* stream = data.session.stream();
+
+    IngestionState loaded = _fresh_ingestion(ctx);
+    _swap_ingestion(ctx, loaded);
+    tep_record record{};
+    record.size = RECORD_SIZE;
+    size_t i = 0;
+
+    for (auto _ : state) {
+        bool is_waking = handler ? (handler == naps_waking_handler) : (i & 1);
+        if (is_waking) {
+            size_t idx = i % data.wakings.size();
+            record.data = data.waking_data[idx].data();
+            naps_waking_handler(stream, &record, &data.wakings[idx]);
+        } else {
+            size_t idx = i % data.switches.size();
+            record.data = data.switch_data[idx].data();
+            naps_switch_handler(stream, &record, &data.switches[idx]);
+        }
+        ++i;
+
+        if (ctx->collected_events->size >= CONTAINER_RESET) {
+            state.PauseTiming();
+            IngestionState full = _fresh_ingestion(ctx);
+            _swap_ingestion(ctx, full);
+            _free_ingestion(full);
+            state.ResumeTiming();
+        }
+    }
+
+    _swap_ingestion(ctx, loaded);
+    _free_ingestion(loaded);
+}
+
+/**
+ * @brief Benchmarks ingestion during loading, alternating
+ * sched_switch and sched_waking records.
+*/
+static void BM_ingest_events(benchmark::State& state) {
+    _run_ingestion(state, nullptr);
+}
+BENCHMARK(BM_ingest_events);
+
+/**
+ * @brief Benchmarks processing of sched_switch records during loading.
+*/
+static void BM_switch_handler(benchmark::State& state) {
+    _run_ingestion(state, naps_switch_handler);
+}
+BENCHMARK(BM_switch_handler);
+
+/**
+ * @brief Benchmarks processing of sched_waking records during loading.
+*/
+static void BM_waking_handler(benchmark::State& state) {
+    _run_ingestion(state, naps_waking_handler);
+}
+BENCHMARK(BM_waking_handler);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,378 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapAggregate.cpp
+ * @brief   Definitions of aggregates of naps of task groups.
+*/
+
+// C
+#include <cstdlib>
+
+// C++
+#include <algorithm>
+#include <future>
+#include <iterator>
+
+// Plugin headers
+#include "NapAggregate.hpp"
+#include "NapThreadPool.hpp"
+
+// Static functions
+
+/**
+ * @brief Adds changes of counts of napping threads caused by naps of tasks
+ * visible in a view. A nap adds one at the bin it starts in and takes it
+ * away right after the bin it ends in. Bins already counted for the same
+ * task and state are skipped, as are bins before the first computed one.
+ *
+ * @param table: Nap table of the stream
+ * @param pids: PIDs of the tasks
+ * @param view: View of the drawn plot
+ * @param from_bin: First computed bin
+ * @param deltas: Changes of counts, `NAP_N_STATES` values per bin plus one
+ * more bin for naps ending in the last one
+*/
+static void _add_deltas(const NapTable& table,
+    const std::vector<int32_t>& pids, const NapView& view, int from_bin,
+    std::vector<int32_t>& deltas)
+{
+    const int64_t from_ts = view.min + from_bin * view.bin_size;
+
+    for (int32_t pid : pids) {
+        const NapTaskTable* task = table.task(pid);
+        if (!task) continue;
+
+        // Last bin counted per state, so a task counts once per bin
+        int counted[NAP_N_STATES];
+        std::fill(std::begin(counted), std::end(counted), -1);
+
+        auto [first, last] = task->in_range(from_ts, view.max);
+        for (size_t i = first; i < last; ++i) {
+            const int state = naps_state_index(task->state[i]);
+            if (state < 0) continue;
+
+            const int start_bin = std::max({view.bin(task->start[i]),
+                                            counted[state] + 1, from_bin});
+            const int end_bin = view.bin(task->end[i]);
+            if (start_bin > end_bin) continue;
+            counted[state] = end_bin;
+
+            ++deltas[size_t(start_bin) * NAP_N_STATES + size_t(state)];
+            --deltas[size_t(end_bin + 1) * NAP_N_STATES + size_t(state)];
+        }
+    }
+}
+
+// Global functions
+
+/**
+ * @brief Computes a band of a group of tasks. Tasks are split into chunks
+ * with similar numbers of naps, whose changes of counts are found in
+ * parallel and then summed up in one sweep over the bins. Bins before the
+ * first computed one are kept as they are, if the band is of the same view.
+ *
+ * @param table: Nap table of the stream
+ * @param pids: PIDs of the group's tasks
+ * @param view: View of the drawn plot
+ * @param band: Computed band
+ * @param from_bin: First computed bin
+*/
+void naps_comm_band(const NapTable& table, const std::vector<int32_t>& pids,
+    const NapView& view, NapBand& band, int from_bin)
+{
+    const size_t n_counts = size_t(std::max(view.n_bins, 0)) * NAP_N_STATES;
+    if (from_bin <= 0 || band.counts.size() != n_counts) from_bin = 0;
+    from_bin = std::min(from_bin, std::max(view.n_bins, 0));
+
+    band.view = view;
+    band.counts.resize(n_counts);
+    std::fill(band.counts.begin() + size_t(from_bin) * NAP_N_STATES,
+              band.counts.end(), 0);
+    if (view.n_bins <= 0 || pids.empty()) {
+        band.max_total = 0;
+        return;
+    }
+
+    std::vector<std::pair<size_t, int32_t>> by_size;
+    by_size.reserve(pids.size());
+    for (int32_t pid : pids) {
+        const NapTaskTable* task = table.task(pid);
+        if (task) by_size.emplace_back(task->size(), pid);
+    }
+    const std::vector<std::vector<int32_t>> chunks = naps_balance_chunks(
+        std::move(by_size));
+
+    const size_t n_deltas = (size_t(view.n_bins) + 1) * NAP_N_STATES;
+    std::vector<std::vector<int32_t>> deltas(chunks.size(),
+        std::vector<int32_t>(n_deltas, 0));
+    naps_run_chunks(chunks.size(), [&](size_t c) {
+        _add_deltas(table, chunks[c], view, from_bin, deltas[c]);
+    });
+
+    // Sweep over the bins, summing up changes of all chunks
+    int32_t running[NAP_N_STATES] = {};
+    for (int bin = from_bin; bin < view.n_bins; ++bin) {
+        for (size_t s = 0; s < NAP_N_STATES; ++s) {
+            const size_t at = size_t(bin) * NAP_N_STATES + s;
+            for (const std::vector<int32_t>& chunk_deltas : deltas) {
+                running[s] += chunk_deltas[at];
+            }
+            band.counts[at] = uint32_t(running[s]);
+        }
+    }
+
+    band.max_total = 0;
+    for (int bin = 0; bin < view.n_bins; ++bin) {
+        uint32_t total = 0;
+        for (size_t s = 0; s < NAP_N_STATES; ++s) total += band.count(bin, s);
+        band.max_total = std::max(band.max_total, total);
+    }
+}
+
+/**
+ * @brief Gets the largest number of chunks work of an aggregate is split
+ * into - one for each worker of the thread pool and one for the calling
+ * thread.
+ *
+ * @returns Number of chunks.
+*/
+size_t naps_max_chunks() {
+    return NapThreadPool::get_instance().size() + 1;
+}
+
+/**
+ * @brief Runs a job for each chunk of work, all but the first one on the
+ * thread pool, the first one on the calling thread. Returns once all jobs
+ * are done.
+ *
+ * @param n_chunks: Number of chunks
+ * @param job: Job to run, given the index of its chunk
+*/
+void naps_run_chunks(size_t n_chunks, const std::function<void(size_t)>& job) {
+    if (!n_chunks) return;
+
+    NapThreadPool& pool = NapThreadPool::get_instance();
+    std::vector<std::future<void>> jobs;
+    jobs.reserve(n_chunks - 1);
+    for (size_t c = 1; c < n_chunks; ++c) {
+        jobs.push_back(pool.submit([&job, c]() { job(c); }));
+    }
+    job(0);
+    for (std::future<void>& done : jobs) pool.wait(done);
+}
+
+/**
+ * @brief Gets the first bin of a band of a view which naps starting at or
+ * after a time can change. Bands are recomputed from it when the nap table
+ * is extended.
+ *
+ * @param view: View of the band
+ * @param from_ts: Earliest start of the naps
+ *
+ * @returns Index of the bin or -1 if the naps start after the view.
+*/
+int naps_first_changed_bin(const NapView& view, int64_t from_ts) {
+    if (from_ts > view.max) return -1;
+    return (from_ts <= view.min) ? 0 : view.bin(from_ts);
+}
+
+// Member functions
+
+/**
+ * @brief Gets aggregates of a plugin context, creating them first if
+ * this hasn't happened yet.
+ *
+ * @param ctx: Pointer to the plugin's context
+ *
+ * @returns Pointer to the aggregates or null if there's no context.
+*/
+NapCommAggregate* NapCommAggregate::from_context(plugin_naps_context* ctx) {
+    if (!ctx) return nullptr;
+
+    if (!ctx->comm_aggregate) {
+        ctx->comm_aggregate = new NapCommAggregate{};
+    }
+
+    return ctx->comm_aggregate;
+}
+
+/**
+ * @brief Gets all groups of tasks of a nap table.
+ *
+ * @param table: Nap table of the stream
+ * @param sd: Stream identifier number
+ *
+ * @returns PIDs of tasks of each group, sorted, keyed by comm.
+*/
+const std::unordered_map<std::string, std::vector<int32_t>>&
+NapCommAggregate::groups(const NapTable& table, int sd) {
+    _sync(table, sd);
+    return _groups;
+}
+
+/**
+ * @brief Gets the group of a task, i.e. all tasks with the same comm.
+ *
+ * @param table: Nap table of the stream
+ * @param sd: Stream identifier number
+ * @param pid: PID of a task
+ *
+ * @returns PIDs of the group's tasks, sorted, or null if the task has no naps
+ * or its comm is unknown.
+*/
+const std::vector<int32_t>* NapCommAggregate::group(const NapTable& table,
+    int sd, int32_t pid)
+{
+    _sync(table, sd);
+
+    auto comm = _comm_of.find(pid);
+    if (comm == _comm_of.end()) return nullptr;
+    return &_groups.find(comm->second)->second;
+}
+
+/**
+ * @brief Gets the band of the group of a task in a view, computing it if
+ * it isn't kept from before.
+ *
+ * @param table: Nap table of the stream
+ * @param sd: Stream identifier number
+ * @param pid: PID of a task of the group
+ * @param view: View of the drawn plot
+ *
+ * @returns Pointer to the band, valid until the next call, or null if the
+ * task has no group.
+*/
+const NapBand* NapCommAggregate::band(const NapTable& table, int sd,
+    int32_t pid, const NapView& view)
+{
+    const std::vector<int32_t>* pids = group(table, sd, pid);
+    if (!pids) return nullptr;
+
+    return naps_kept_band(_bands[_comm_of.find(pid)->second], ZOOM_LEVELS,
+        view, [&](NapBand& band) {
+            naps_comm_band(table, *pids, view, band);
+        });
+}
+
+/**
+ * @brief Gets bytes of memory used by the groups and kept bands.
+ *
+ * @returns Number of bytes used, including the object itself.
+*/
+size_t NapCommAggregate::mem_usage() const {
+    size_t bytes = sizeof(*this);
+    for (const auto& [pid, comm] : _comm_of) {
+        bytes += sizeof(pid) + sizeof(comm) + comm.capacity();
+    }
+    for (const auto& [comm, pids] : _groups) {
+        bytes += sizeof(comm) + sizeof(pids) + pids.capacity() * sizeof(int32_t);
+    }
+    for (const auto& [comm, bands] : _bands) {
+        for (const NapBand& band : bands) bytes += band.mem_usage();
+    }
+    return bytes;
+}
+
+/**
+ * @brief Brings groups and bands up to date with a nap table, finding them
+ * anew for another table or extending them, if the table was extended.
+ *
+ * @param table: Nap table of the stream
+ * @param sd: Stream identifier number
+*/
+void NapCommAggregate::_sync(const NapTable& table, int sd) {
+    if (_table != &table) {
+        _find_groups(table, sd);
+    } else if (_generation != table.generation()) {
+        _extend(table, sd);
+    }
+}
+
+/**
+ * @brief Groups tasks of a nap table by their comms. Forgets groups and
+ * bands of the previous table.
+ *
+ * @param table: Nap table of the stream
+ * @param sd: Stream identifier number
+*/
+void NapCommAggregate::_find_groups(const NapTable& table, int sd) {
+    _table = &table;
+    _generation = table.generation();
+    _comm_of.clear();
+    _groups.clear();
+    _bands.clear();
+
+    for (const auto& [pid, task] : table.tasks()) {
+        char* comm = kshark_comm_from_pid(sd, pid);
+        if (!comm) continue;
+
+        _groups[comm].push_back(pid);
+        _comm_of.emplace(pid, comm);
+        free(comm);
+    }
+
+    for (auto& [comm, pids] : _groups) {
+        std::sort(pids.begin(), pids.end());
+    }
+}
+
+/**
+ * @brief Catches up with an extended nap table. Tasks which got their first
+ * naps join their groups and kept bands are updated in place from the bin
+ * of the earliest start of the new naps, as earlier bins can't change. If
+ * the table was extended more than once since, the bands are dropped.
+ *
+ * @param table: Extended nap table of the stream
+ * @param sd: Stream identifier number
+*/
+void NapCommAggregate::_extend(const NapTable& table, int sd) {
+    const bool one_extension = (table.generation() == _generation + 1);
+    _generation = table.generation();
+
+    for (const auto& [pid, task] : table.tasks()) {
+        if (_comm_of.count(pid)) continue;
+
+        char* comm = kshark_comm_from_pid(sd, pid);
+        if (!comm) continue;
+
+        std::vector<int32_t>& pids = _groups[comm];
+        pids.insert(std::lower_bound(pids.begin(), pids.end(), pid), pid);
+        _comm_of.emplace(pid, comm);
+        free(comm);
+    }
+
+    if (!one_extension) {
+        _bands.clear();
+        return;
+    }
+
+    for (auto& [comm, bands] : _bands) {
+        const std::vector<int32_t>& pids = _groups.find(comm)->second;
+        naps_update_bands(bands, table.extended_from(),
+            [&](NapBand& band, int from_bin) {
+                naps_comm_band(table, pids, band.view, band, from_bin);
+            });
+    }
+}
+
+// Functions defined in C header
+
+/**
+ * @brief Frees aggregates of a context.
+ *
+ * @param aggregate: Pointer to the aggregates (may be null)
+*/
+void naps_free_comm_aggregate(struct NapCommAggregate* aggregate) {
+    delete aggregate;
+}
+
+/**
+ * @brief Gets bytes of memory used by aggregates of a context.
+ *
+ * @param aggregate: Pointer to the aggregates (may be null)
+ *
+ * @returns Number of bytes used by the aggregates, zero if there are none.
+*/
+size_t naps_comm_aggregate_mem_usage(const struct NapCommAggregate* aggregate) {
+    return aggregate ? aggregate->mem_usage() : 0;
+}
@@ -0,0 +1,194 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapAggregate.hpp
+ * @brief   Declarations of aggregates of naps of task groups - numbers of
+ *          threads with the same comm napping in each state over time.
+ *          Part of the Qt-free core of the plugin.
+ *
+ * @note    Definitions in `NapAggregate.cpp`.
+*/
+
+#ifndef _NR_NAP_AGGREGATE_HPP
+#define _NR_NAP_AGGREGATE_HPP
+
+// C++
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Plugin
+#include "naps_core.h"
+#include "NapTable.hpp"
+#include "NapView.hpp"
+
+///
+/// @brief Abbreviations of prev_states in the order of bands' layers, the
+/// same as of all tables of prev_states (see `naps_state_index`).
+static constexpr char NAP_STATES[] = NAPS_STATE_LETTERS;
+
+///
+/// @brief Number of prev_states, i.e. layers of a band.
+static constexpr size_t NAP_N_STATES = NAPS_N_STATES;
+
+/**
+ * @brief Numbers of napping threads of a group in each bin of a view, per
+ * prev_state. A thread counts once in a bin's layer if any of its naps in
+ * that prev_state overlaps the bin.
+*/
+struct NapBand {
+    ///
+    /// @brief View the band was computed for.
+    NapView view{};
+    ///
+    /// @brief Numbers of napping threads, `NAP_N_STATES` values per bin,
+    /// in the order of `NAP_STATES`.
+    std::vector<uint32_t> counts;
+    ///
+    /// @brief Largest number of napping threads in a single bin.
+    uint32_t max_total{0};
+public:
+    /// @brief Returns the number of threads napping in a state in a bin.
+    uint32_t count(int bin, size_t state) const
+    { return counts[size_t(bin) * NAP_N_STATES + state]; }
+    /// @brief Returns bytes of memory used by the band.
+    size_t mem_usage() const
+    { return sizeof(*this) + counts.capacity() * sizeof(uint32_t); }
+};
+
+/**
+ * @brief Aggregates of naps of a stream's tasks grouped by comm, so that a
+ * pool of worker threads can be looked at as a whole.
+ *
+ * Groups are found once per nap table. A band is computed by sweeping over
+ * the bins - naps of the group's tasks are turned into changes of counts
+ * at the bins where they start and end, in parallel by the plugin's thread
+ * pool, and the changes are then summed up. Bands of a few most recent
+ * views of each group are kept, so going back to a zoom level is free.
+ * When the table is extended, new tasks join their groups and kept bands
+ * are recomputed only from the earliest bin the new naps reach.
+*/
+class NapCommAggregate {
+private: // Data members
+    ///
+    /// @brief Nap table the groups were found in.
+    const NapTable* _table = nullptr;
+    ///
+    /// @brief Generation of the nap table the groups and bands are up to.
+    uint64_t _generation{0};
+    ///
+    /// @brief Comm of each task of the table, keyed by PID.
+    std::unordered_map<int32_t, std::string> _comm_of;
+    ///
+    /// @brief PIDs of tasks of each group, keyed by comm.
+    std::unordered_map<std::string, std::vector<int32_t>> _groups;
+    ///
+    /// @brief Bands of recent views of each group, most recent last.
+    std::unordered_map<std::string, std::deque<NapBand>> _bands;
+public: // Data members
+    ///
+    /// @brief Number of views whose bands are kept per group.
+    static constexpr size_t ZOOM_LEVELS = 4;
+public: // Functions
+    static NapCommAggregate* from_context(plugin_naps_context* ctx);
+
+    const std::unordered_map<std::string, std::vector<int32_t>>& groups(
+        const NapTable& table, int sd);
+    const std::vector<int32_t>* group(const NapTable& table, int sd,
+        int32_t pid);
+    const NapBand* band(const NapTable& table, int sd, int32_t pid,
+        const NapView& view);
+    size_t mem_usage() const;
+private: // Functions
+    void _sync(const NapTable& table, int sd);
+    void _find_groups(const NapTable& table, int sd);
+    void _extend(const NapTable& table, int sd);
+};
+
+void naps_comm_band(const NapTable& table, const std::vector<int32_t>& pids,
+    const NapView& view, NapBand& band, int from_bin = 0);
+
+// Shared by aggregates
+
+void naps_run_chunks(size_t n_chunks, const std::function<void(size_t)>& job);
+size_t naps_max_chunks();
+int naps_first_changed_bin(const NapView& view, int64_t from_ts);
+
+/**
+ * @brief Splits items into chunks with similar total sizes, so that the
+ * thread pool's workers get similar amounts of work - largest items first,
+ * each to the least loaded chunk.
+ *
+ * @param by_size: Items with their sizes
+ *
+ * @returns Items of each chunk, at most `naps_max_chunks` chunks and none
+ * if there are no items.
+*/
+template<typename T>
+std::vector<std::vector<T>> naps_balance_chunks(
+    std::vector<std::pair<size_t, T>> by_size)
+{
+    const size_t n_chunks = std::min(naps_max_chunks(), by_size.size());
+    std::vector<std::vector<T>> chunks(n_chunks);
+    std::vector<size_t> load(n_chunks, 0);
+
+    std::sort(by_size.rbegin(), by_size.rend());
+    for (const auto& [size, item] : by_size) {
+        size_t least = std::min_element(load.begin(), load.end()) - load.begin();
+        chunks[least].push_back(item);
+        load[least] += size;
+    }
+    return chunks;
+}
+
+/**
+ * @brief Gets a kept band of a view, computing and keeping it if there's
+ * none. The least recent band is dropped, if too many are kept.
+ *
+ * @param bands: Kept bands, most recent last
+ * @param max_bands: Maximum number of kept bands
+ * @param view: View of the drawn plot
+ * @param compute: Computes a band of the view into the given band
+ *
+ * @returns Pointer to the band, valid until bands are changed.
+*/
+template<typename Band, typename Compute>
+const Band* naps_kept_band(std::deque<Band>& bands, size_t max_bands,
+    const NapView& view, Compute compute)
+{
+    for (const Band& band : bands) {
+        if (band.view.min == view.min && band.view.max == view.max
+            && band.view.n_bins == view.n_bins) {
+            return &band;
+        }
+    }
+
+    if (bands.size() >= max_bands) bands.pop_front();
+    compute(bands.emplace_back());
+    return &bands.back();
+}
+
+/**
+ * @brief Updates kept bands in place after naps were added to the table,
+ * recomputing only bins from the first one the added naps reach.
+ *
+ * @param bands: Kept bands
+ * @param from_ts: Earliest start of the added naps
+ * @param compute: Recomputes a band from a bin, given the band and the bin
+*/
+template<typename Band, typename Compute>
+void naps_update_bands(std::deque<Band>& bands, int64_t from_ts,
+    Compute compute)
+{
+    for (Band& band : bands) {
+        const int from_bin = naps_first_changed_bin(band.view, from_ts);
+        if (from_bin >= 0) compute(band, from_bin);
+    }
+}
+
+#endif // _NR_NAP_AGGREGATE_HPP
@@ -0,0 +1,309 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapBlockIo.cpp
+ * @brief   Definitions of block I/O requests and their joins with naps.
+*/
+
+// C
+#include <cstdlib>
+
+// C++
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+
+// Plugin headers
+#include "NapBlockIo.hpp"
+
+// Static functions
+
+/**
+ * @brief Gets the key of a block event's request - its device and first
+ * sector, which identify it from the issue to the completion.
+ *
+ * @param event: Issue or completion of the request
+ *
+ * @returns Pair of the device and the sector.
+*/
+static std::pair<uint32_t, uint64_t> _request_key(const naps_block_event& event)
+{
+    return {event.dev, event.sector};
+}
+
+// Member functions
+
+/**
+ * @brief Gets block I/O of a plugin context, creating it first if this
+ * hasn't happened yet, brought up to date with the context's nap table
+ * and collected block events.
+ *
+ * @param ctx: Pointer to the plugin's context
+ *
+ * @returns Pointer to the block I/O or null if there's no context or it
+ * has no nap table.
+*/
+NapBlockIo* NapBlockIo::from_context(plugin_naps_context* ctx) {
+    const NapTable* table = NapTable::from_context(ctx);
+    if (!table) return nullptr;
+
+    if (!ctx->block_io) {
+        ctx->block_io = new NapBlockIo{};
+    }
+
+    ctx->block_io->_sync(*table, ctx->block_events, ctx->n_block_events);
+    return ctx->block_io;
+}
+
+/**
+ * @brief Gets joins of a nap with requests of all devices.
+ *
+ * @param pid: PID of the napping task
+ * @param nap: Index of the nap in the task's table
+ *
+ * @returns Range of indices of the nap's joins, empty if it has no I/O.
+*/
+std::pair<size_t, size_t> NapBlockIo::of_nap(int32_t pid, uint32_t nap) const
+{
+    auto first = std::lower_bound(_joins.begin(), _joins.end(),
+        std::make_pair(pid, nap), [](const NapIoJoin& join, const auto& key) {
+            return std::tie(join.pid, join.nap) < std::tie(key.first, key.second);
+        });
+    // A nap has a join per device, only a few
+    auto last = first;
+    while (last != _joins.end() && last->pid == pid && last->nap == nap) ++last;
+    return {size_t(first - _joins.begin()), size_t(last - _joins.begin())};
+}
+
+/**
+ * @brief Gets the number of sectors of a join's requests.
+ *
+ * @param join: The join
+ *
+ * @returns Sum of sectors of the joined requests.
+*/
+uint64_t NapBlockIo::sectors(const NapIoJoin& join) const {
+    return _sectors_before[join.last] - _sectors_before[join.first];
+}
+
+/**
+ * @brief Sums up joins of a task's naps.
+ *
+ * @param pid: PID of the task
+ *
+ * @returns Totals of the task's joins, zero if it has none.
+*/
+NapIoSummary NapBlockIo::summary(int32_t pid) const {
+    NapIoSummary total;
+    auto it = std::lower_bound(_joins.begin(), _joins.end(), pid,
+        [](const NapIoJoin& join, int32_t p) { return join.pid < p; });
+
+    for (; it != _joins.end() && it->pid == pid; ++it) {
+        if (it == _joins.begin() || std::prev(it)->pid != pid
+            || std::prev(it)->nap != it->nap) {
+            ++total.n_naps;
+        }
+        total.n_requests += it->size();
+        total.sectors += sectors(*it);
+        total.devices.insert(it->dev);
+    }
+    return total;
+}
+
+/**
+ * @brief Gets bytes of memory used by the requests and joins.
+ *
+ * @returns Number of bytes used, including the object itself.
+*/
+size_t NapBlockIo::mem_usage() const {
+    return sizeof(*this) + _requests.capacity() * sizeof(NapBlockRequest)
+        + _sectors_before.capacity() * sizeof(uint64_t)
+        + _devices.size() * (sizeof(uint32_t) + 2 * sizeof(size_t)
+            + 4 * sizeof(void*))
+        + _joins.capacity() * sizeof(NapIoJoin);
+}
+
+/**
+ * @brief Pairs requests and joins them with naps anew, unless they're up
+ * to date with the nap table and the collected block events already.
+ *
+ * @param table: Nap table of the stream
+ * @param events: Collected block events
+ * @param n_events: Number of collected block events
+*/
+void NapBlockIo::_sync(const NapTable& table, const naps_block_event* events,
+    size_t n_events)
+{
+    const bool has_requests = (_n_events == n_events);
+    if (has_requests && _table == &table
+        && _generation == table.generation()) return;
+
+    if (!has_requests) {
+        _n_events = n_events;
+        _pair(events, n_events);
+    }
+    _table = &table;
+    _generation = table.generation();
+    _join(table);
+}
+
+/**
+ * @brief Pairs issues of requests with their completions and indexes the
+ * requests per device and time. An issue is paired with the next
+ * completion of the same device and sector. Completions without a traced
+ * issue are kept as requests issued before the trace started, issues
+ * without a completion are dropped.
+ *
+ * @param events: Collected block events, in the order of loading
+ * @param n_events: Number of collected block events
+*/
+void NapBlockIo::_pair(const naps_block_event* events, size_t n_events) {
+    _requests.clear();
+    _sectors_before.clear();
+    _devices.clear();
+
+    // Events are loaded per CPU, pairing needs them ordered by time
+    std::vector<uint32_t> order(n_events);
+    std::iota(order.begin(), order.end(), uint32_t(0));
+    std::stable_sort(order.begin(), order.end(),
+        [events](uint32_t a, uint32_t b) { return events[a].ts < events[b].ts; });
+
+    std::map<std::pair<uint32_t, uint64_t>, const naps_block_event*> issued;
+    for (uint32_t i : order) {
+        const naps_block_event& event = events[i];
+        if (!event.is_complete) {
+            issued[_request_key(event)] = &event;
+            continue;
+        }
+
+        NapBlockRequest request{INT64_MIN, event.ts, event.sector, event.dev,
+            event.nr_sector, -1};
+        auto issue = issued.find(_request_key(event));
+        if (issue != issued.end()) {
+            request.issue_ts = issue->second->ts;
+            request.issue_pid = issue->second->pid;
+            issued.erase(issue);
+        }
+        _requests.push_back(request);
+    }
+
+    std::stable_sort(_requests.begin(), _requests.end(),
+        [](const NapBlockRequest& a, const NapBlockRequest& b) {
+            return std::tie(a.dev, a.complete_ts)
+                < std::tie(b.dev, b.complete_ts);
+        });
+    _requests.shrink_to_fit();
+
+    // Sums run across devices, joins never span two of them
+    _sectors_before.reserve(_requests.size() + 1);
+    _sectors_before.push_back(0);
+    for (size_t i = 0; i < _requests.size(); ++i) {
+        const NapBlockRequest& request = _requests[i];
+        _sectors_before.push_back(_sectors_before.back() + request.nr_sector);
+
+        _devices.try_emplace(request.dev, i, i).first->second.second = i + 1;
+    }
+}
+
+/**
+ * @brief Joins naps of the nap table in the `D` state with requests of
+ * each device. Naps are swept in the order of their starts, together with
+ * the first request completed at or after the start, so that each device's
+ * requests are passed only once.
+ *
+ * @param table: Nap table of the stream
+*/
+void NapBlockIo::_join(const NapTable& table) {
+    _joins.clear();
+    if (_requests.empty()) return;
+
+    struct DNap { int64_t start, end; int32_t pid; uint32_t nap; };
+    std::vector<DNap> naps;
+    for (const auto& [pid, task] : table.tasks()) {
+        for (size_t i = 0; i < task.size(); ++i) {
+            if (task.state[i] != 'D') continue;
+            naps.push_back({task.start[i], task.end[i], pid, uint32_t(i)});
+        }
+    }
+    std::sort(naps.begin(), naps.end(), [](const DNap& a, const DNap& b) {
+        return a.start < b.start;
+    });
+
+    const auto by_completion = [](const NapBlockRequest& request, int64_t ts) {
+        return request.complete_ts < ts;
+    };
+    for (const auto& [dev, range] : _devices) {
+        const auto begin = _requests.begin() + ptrdiff_t(range.first);
+        const auto end = _requests.begin() + ptrdiff_t(range.second);
+
+        auto lo = begin;
+        for (const DNap& nap : naps) {
+            while (lo != end && lo->complete_ts < nap.start) ++lo;
+            if (lo == end) break;
+
+            const auto hi = std::upper_bound(lo, end, nap.end + WAKEUP_WINDOW,
+                [](int64_t ts, const NapBlockRequest& request) {
+                    return ts < request.complete_ts;
+                });
+            if (lo == hi) continue;
+
+            // Closest completion to the wakeup is at or right before it
+            uint32_t wakeup = NapIoJoin::NO_REQUEST;
+            int64_t best = WAKEUP_WINDOW + 1;
+            const auto at = std::lower_bound(lo, hi, nap.end, by_completion);
+            for (auto it = (at == lo ? at : std::prev(at)); it != hi
+                && it <= at; ++it) {
+                const int64_t distance = std::abs(it->complete_ts - nap.end);
+                if (distance < best) {
+                    best = distance;
+                    wakeup = uint32_t(it - _requests.begin());
+                }
+            }
+
+            _joins.push_back({nap.pid, nap.nap, dev,
+                uint32_t(lo - _requests.begin()),
+                uint32_t(hi - _requests.begin()), wakeup});
+        }
+    }
+
+    std::sort(_joins.begin(), _joins.end(),
+        [](const NapIoJoin& a, const NapIoJoin& b) {
+            return std::tie(a.pid, a.nap, a.dev) < std::tie(b.pid, b.nap, b.dev);
+        });
+    _joins.shrink_to_fit();
+}
+
+// Global functions
+
+/**
+ * @brief Formats a kernel's device number the way the kernel prints it.
+ *
+ * @param dev: Device number, 12 bits of major and 20 bits of minor
+ *
+ * @returns Major and minor number separated by a colon, e.g. "8:16".
+*/
+std::string naps_device_name(uint32_t dev) {
+    return std::to_string(dev >> 20) + ":" + std::to_string(dev & 0xFFFFF);
+}
+
+// Functions defined in C header
+
+/**
+ * @brief Frees block I/O of a context.
+ *
+ * @param block_io: Pointer to the block I/O (may be null)
+*/
+void naps_free_block_io(struct NapBlockIo* block_io) {
+    delete block_io;
+}
+
+/**
+ * @brief Gets bytes of memory used by block I/O of a context.
+ *
+ * @param block_io: Pointer to the block I/O (may be null)
+ *
+ * @returns Number of bytes used by the block I/O, zero if there's none.
+*/
+size_t naps_block_io_mem_usage(const struct NapBlockIo* block_io) {
+    return block_io ? block_io->mem_usage() : 0;
+}
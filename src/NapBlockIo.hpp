@@ -0,0 +1,176 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapBlockIo.hpp
+ * @brief   Declarations of block I/O requests paired from collected issues
+ *          and completions, indexed per device and time and joined with
+ *          naps in the `D` state. Part of the Qt-free core of the plugin.
+ *
+ * @note    Definitions in `NapBlockIo.cpp`.
+*/
+
+#ifndef _NR_NAP_BLOCK_IO_HPP
+#define _NR_NAP_BLOCK_IO_HPP
+
+// C++
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Plugin
+#include "naps_core.h"
+#include "NapTable.hpp"
+
+/**
+ * @brief Block I/O request, from its issue to its completion.
+*/
+struct NapBlockRequest {
+    ///
+    /// @brief Timestamp of the issue, minimal value if the request was
+    /// issued before the trace started.
+    int64_t issue_ts;
+    ///
+    /// @brief Timestamp of the completion.
+    int64_t complete_ts;
+    ///
+    /// @brief First sector of the request.
+    uint64_t sector;
+    ///
+    /// @brief Kernel's device number of the request's device.
+    uint32_t dev;
+    ///
+    /// @brief Number of sectors of the request.
+    uint32_t nr_sector;
+    ///
+    /// @brief PID of the task which issued the request, -1 if unknown.
+    int32_t issue_pid;
+public:
+    /// @brief Returns whether the request's issue was traced.
+    bool is_issued() const { return issue_ts != INT64_MIN; }
+};
+
+/**
+ * @brief Block I/O of one device joined with a nap in the `D` state -
+ * completions of the device's requests during the nap or coinciding with
+ * its wakeup. Requests of a device are ordered by completion, so the
+ * joined ones are a range of them.
+*/
+struct NapIoJoin {
+    ///
+    /// @brief PID of the napping task.
+    int32_t pid;
+    ///
+    /// @brief Index of the nap in the task's table.
+    uint32_t nap;
+    ///
+    /// @brief Kernel's device number of the joined requests' device.
+    uint32_t dev;
+    ///
+    /// @brief Index of the first joined request.
+    uint32_t first;
+    ///
+    /// @brief Index past the last joined request.
+    uint32_t last;
+    ///
+    /// @brief Index of the request completed closest to the nap's wakeup,
+    /// `NO_REQUEST` if none completed close enough to have woken it.
+    uint32_t wakeup;
+public:
+    ///
+    /// @brief Value of `wakeup` without a request.
+    static constexpr uint32_t NO_REQUEST = UINT32_MAX;
+    /// @brief Returns the number of joined requests.
+    size_t size() const { return last - first; }
+};
+
+/**
+ * @brief Block I/O joined with naps of a task in the `D` state, in total.
+*/
+struct NapIoSummary {
+    ///
+    /// @brief Number of naps with any joined I/O.
+    uint64_t n_naps{0};
+    ///
+    /// @brief Number of joined requests, a request joined with several
+    /// naps is counted for each.
+    uint64_t n_requests{0};
+    ///
+    /// @brief Number of sectors of the joined requests.
+    uint64_t sectors{0};
+    ///
+    /// @brief Devices of the joined requests.
+    std::set<uint32_t> devices;
+};
+
+/**
+ * @brief Block I/O requests of a stream and their joins with naps in the
+ * `D` state, answering which I/O a task in uninterruptible sleep waited on.
+ *
+ * Issues and completions collected during loading are paired by device
+ * and sector into requests, which are indexed per device and ordered by
+ * completion. Naps in the `D` state, ordered by start, are then joined
+ * with each device's requests by a merge-sweep - the first completion at
+ * or after a nap's start only moves forward with the naps, the end of the
+ * joined range is found by a binary search. Joins are kept ordered by nap,
+ * so those of a nap are found by a binary search too. Extending the nap
+ * table or collecting more events redoes everything.
+*/
+class NapBlockIo {
+private: // Data members
+    ///
+    /// @brief Nap table the naps were joined from.
+    const NapTable* _table = nullptr;
+    ///
+    /// @brief Generation of the nap table the joins are up to.
+    uint64_t _generation{0};
+    ///
+    /// @brief Number of collected block events the requests are up to.
+    size_t _n_events{0};
+    ///
+    /// @brief Requests grouped by device, ordered by completion in each.
+    std::vector<NapBlockRequest> _requests;
+    ///
+    /// @brief Sums of sectors of requests before each one, with one more
+    /// value for the end.
+    std::vector<uint64_t> _sectors_before;
+    ///
+    /// @brief Ranges of requests of each device.
+    std::map<uint32_t, std::pair<size_t, size_t>> _devices;
+    ///
+    /// @brief Joins ordered by PID, nap and device.
+    std::vector<NapIoJoin> _joins;
+public: // Data members
+    ///
+    /// @brief Largest distance of a completion from the wakeup of a nap for
+    /// the completion to coincide with it, in nanoseconds. Completions
+    /// shortly after the wakeup are joined too, as tracing of completions
+    /// and wakeups interleaves across CPUs.
+    static constexpr int64_t WAKEUP_WINDOW = 50'000;
+public: // Functions
+    static NapBlockIo* from_context(plugin_naps_context* ctx);
+
+    /// @brief Returns the requests, grouped by device.
+    const std::vector<NapBlockRequest>& requests() const { return _requests; }
+    /// @brief Returns ranges of requests of each device.
+    const std::map<uint32_t, std::pair<size_t, size_t>>& devices() const
+    { return _devices; }
+    /// @brief Returns all joins, ordered by PID, nap and device.
+    const std::vector<NapIoJoin>& joins() const { return _joins; }
+
+    std::pair<size_t, size_t> of_nap(int32_t pid, uint32_t nap) const;
+    uint64_t sectors(const NapIoJoin& join) const;
+    NapIoSummary summary(int32_t pid) const;
+    size_t mem_usage() const;
+private: // Functions
+    void _sync(const NapTable& table, const naps_block_event* events,
+        size_t n_events);
+    void _pair(const naps_block_event* events, size_t n_events);
+    void _join(const NapTable& table);
+};
+
+std::string naps_device_name(uint32_t dev);
+
+#endif // _NR_NAP_BLOCK_IO_HPP
@@ -0,0 +1,166 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapBuildScheduler.cpp
+ * @brief   Definitions of the scheduler of builds of nap tables.
+*/
+
+// C
+#include <cstdlib>
+
+// C++
+#include <chrono>
+#include <vector>
+
+// KernelShark
+#include "libkshark.h"
+
+// Plugin headers
+#include "NapBuildScheduler.hpp"
+#include "NapThreadPool.hpp"
+
+// Member functions
+
+/**
+ * @brief Gets the scheduler. Utilizes Meyers singleton creation (static
+ * local variable).
+ *
+ * @returns Reference to the scheduler.
+*/
+NapBuildScheduler& NapBuildScheduler::get_instance() {
+    static NapBuildScheduler instance;
+    return instance;
+}
+
+/**
+ * @brief Schedules a build of a stream's nap table, if the table isn't up
+ * to date with the collected events and no build is pending already.
+ * A finished build is forgotten first.
+ *
+ * @param ctx: Plugin's context of the stream
+ * @param sd: Stream identifier number
+ *
+ * @returns True if a build of the stream is pending, false if there's
+ * nothing to build.
+*/
+bool NapBuildScheduler::schedule(plugin_naps_context* ctx, int sd) {
+    if (!ctx) return false;
+
+    if (ctx->build) {
+        const bool running = (ctx->build->done.wait_for(std::chrono::seconds(0))
+            != std::future_status::ready);
+        if (running) return true;
+        wait(ctx);
+    }
+
+    const bool is_stale = ctx->collected_events && (!ctx->nap_table
+        || ctx->collected_events->size > ctx->nap_table->n_events());
+    if (!is_stale) return false;
+
+    NapBuild* build = new NapBuild{sd, {}};
+    ctx->build = build;
+    build->done = NapThreadPool::get_instance().submit([this, ctx, sd]() {
+        const auto start = std::chrono::steady_clock::now();
+        const NapTable* table = NapTable::update_context(ctx);
+        const int64_t build_ns = std::chrono::duration_cast<
+            std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+            .count();
+        _notify(sd, table, build_ns);
+    });
+    return true;
+}
+
+/**
+ * @brief Schedules builds of nap tables of all streams with the plugin's
+ * context, which need them.
+ *
+ * @returns Number of streams with a pending build.
+*/
+size_t NapBuildScheduler::schedule_all() {
+    kshark_context* kshark_ctx = nullptr;
+    if (!kshark_instance(&kshark_ctx)) return 0;
+
+    int* stream_ids = kshark_all_streams(kshark_ctx);
+    const int n_streams = stream_ids ? kshark_ctx->n_streams : 0;
+    size_t n_pending = 0;
+    for (int i = 0; i < n_streams; ++i) {
+        n_pending += schedule(__get_context(stream_ids[i]), stream_ids[i]);
+    }
+    free(stream_ids);
+    return n_pending;
+}
+
+/**
+ * @brief Waits for a pending build of a stream's nap table, if there is
+ * one, and forgets it. The waiting thread runs other queued jobs, e.g.
+ * builds of other streams, meanwhile.
+ *
+ * @param ctx: Plugin's context of the stream
+*/
+void NapBuildScheduler::wait(plugin_naps_context* ctx) {
+    if (!ctx || !ctx->build) return;
+
+    NapThreadPool::get_instance().wait(ctx->build->done);
+    delete ctx->build;
+    ctx->build = nullptr;
+}
+
+/**
+ * @brief Adds a listener of finished builds.
+ *
+ * @param listener: The listener, called on worker threads
+ *
+ * @returns Identifier of the listener, for its removal.
+*/
+int NapBuildScheduler::add_listener(listener_t listener) {
+    std::lock_guard lock{_mutex};
+    _listeners.emplace(_next_listener, std::move(listener));
+    return _next_listener++;
+}
+
+/**
+ * @brief Removes a listener of finished builds. It may still be running
+ * for a build which finished before the removal.
+ *
+ * @param id: Identifier of the listener
+*/
+void NapBuildScheduler::remove_listener(int id) {
+    std::lock_guard lock{_mutex};
+    _listeners.erase(id);
+}
+
+/**
+ * @brief Notifies all listeners of a finished build. Listeners are copied
+ * first, so that they may add or remove listeners.
+ *
+ * @param sd: Stream identifier number
+ * @param table: Built nap table
+ * @param build_ns: Time the build took, in nanoseconds
+*/
+void NapBuildScheduler::_notify(int sd, const NapTable* table,
+    int64_t build_ns)
+{
+    std::vector<listener_t> listeners;
+    {
+        std::lock_guard lock{_mutex};
+        for (const auto& [id, listener] : _listeners) {
+            listeners.push_back(listener);
+        }
+    }
+
+    for (const listener_t& listener : listeners) {
+        listener(sd, table, build_ns);
+    }
+}
+
+// Functions defined in C header
+
+/**
+ * @brief Waits for a pending build of a context's nap table, so that
+ * the context can be changed or freed.
+ *
+ * @param ctx: Plugin's context (may be null)
+*/
+void naps_wait_build(struct plugin_naps_context* ctx) {
+    NapBuildScheduler::get_instance().wait(ctx);
+}
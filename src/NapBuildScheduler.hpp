@@ -0,0 +1,87 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapBuildScheduler.hpp
+ * @brief   Declaration of the scheduler of builds of nap tables of all
+ *          loaded streams on the plugin's thread pool. Part of the Qt-free
+ *          core of the plugin.
+ *
+ * @note    Definitions in `NapBuildScheduler.cpp`.
+*/
+
+#ifndef _NR_NAP_BUILD_SCHEDULER_HPP
+#define _NR_NAP_BUILD_SCHEDULER_HPP
+
+// C++
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+
+// Plugin
+#include "naps_core.h"
+#include "NapTable.hpp"
+
+/**
+ * @brief Build of a stream's nap table running on the thread pool.
+*/
+struct NapBuild {
+    ///
+    /// @brief Stream identifier number.
+    int sd;
+    ///
+    /// @brief Becomes ready once the build has finished.
+    std::future<void> done;
+};
+
+/**
+ * @brief Singleton scheduling builds of nap tables of streams on the
+ * plugin's thread pool, so that when several streams are loaded (e.g. a
+ * host and its guests), their tables are built at once and the session is
+ * usable as soon as the largest stream is done, not after all of them.
+ *
+ * A scheduled build is kept in its stream's context until it's waited for.
+ * `NapTable::from_context` waits for a pending build of its context, so
+ * nothing else needs to know about the scheduling. Listeners are notified
+ * of every finished build, on the worker thread which ran it.
+ *
+ * @note Builds are scheduled and waited for by one thread, KernelShark's
+ * GUI thread or a tool's main thread, same as contexts are used otherwise.
+*/
+class NapBuildScheduler {
+public: // Types
+    ///
+    /// @brief Listener of finished builds - gets the stream identifier,
+    /// the built table (null if the stream has no events) and the time
+    /// the build took, in nanoseconds.
+    using listener_t = std::function<void(int, const NapTable*, int64_t)>;
+private: // Data members
+    ///
+    /// @brief Guards the listeners.
+    std::mutex _mutex;
+    ///
+    /// @brief Listeners of finished builds, keyed by their identifiers.
+    std::map<int, listener_t> _listeners;
+    ///
+    /// @brief Identifier of the next added listener.
+    int _next_listener{0};
+public: // Functions
+    static NapBuildScheduler& get_instance();
+
+    bool schedule(plugin_naps_context* ctx, int sd);
+    size_t schedule_all();
+    void wait(plugin_naps_context* ctx);
+
+    int add_listener(listener_t listener);
+    void remove_listener(int id);
+
+    NapBuildScheduler(const NapBuildScheduler&) = delete;
+    NapBuildScheduler& operator=(const NapBuildScheduler&) = delete;
+private: // Functions
+    /// @brief Default constructor, hidden to enforce singleton pattern.
+    NapBuildScheduler() = default;
+    void _notify(int sd, const NapTable* table, int64_t build_ns);
+};
+
+#endif // _NR_NAP_BUILD_SCHEDULER_HPP
@@ -8,8 +8,10 @@
 
 // C
 #include <stdint.h>
+#include <stdlib.h>
 
 // C++
+#include <iterator>
 #include <limits>
 
 // KernelShark
@@ -17,8 +19,29 @@
 #include "KsPlotTools.hpp"
 
 // Plugin
+#include "naps_core.h"
 #include "NapConfig.hpp"
 
+// Static functions
+
+/**
+ * @brief Formats a number of bytes in a human-readable way.
+ * 
+ * @param bytes: Number of bytes
+ * 
+ * @returns Bytes as a string with a binary unit, e.g. "1.50 MiB".
+ */
+static QString _format_bytes(size_t bytes) {
+    static const char* units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    double value = double(bytes);
+    size_t unit = 0;
+    while (value >= 1024.0 && unit < std::size(units) - 1) {
+        value /= 1024.0;
+        ++unit;
+    }
+    return QString::number(value, 'f', unit ? 2 : 0) + " " + units[unit];
+}
+
 // Configuration object functions
 
 /**
@@ -39,13 +62,55 @@ NapConfig& NapConfig::get_instance() {
 }
 
 /**
- * @brief Gets the current limit of entries in the histogram.
+ * @brief Gets the current limit of naps in view of a task plot, above
+ * which the plot is dense and only its longest naps are drawn.
  * 
- * @returns Limit of entries in the histogram.
+ * @returns Limit of naps in view of a task plot.
  */
 int32_t NapConfig::get_histo_limit() const
 { return _histo_entries_limit; }
 
+/**
+ * @brief Gets abbreviations of prev_states excluded while loading data.
+ * 
+ * @returns Abbreviations of excluded prev_states, e.g. "R".
+ */
+const std::string& NapConfig::get_excluded_states() const
+{ return _excluded_states; }
+
+/**
+ * @brief Gets the minimum number of threads with the same comm for their
+ * task plots to show the group's aggregate band.
+ * 
+ * @returns Minimum size of a group, zero if aggregates are disabled.
+ */
+int32_t NapConfig::get_aggregate_min_threads() const
+{ return _aggregate_min_threads; }
+
+/**
+ * @brief Gets the maximum number of naps drawn in a task plot.
+ * 
+ * @returns Maximum number of naps, zero if there's no budget.
+ */
+int32_t NapConfig::get_nap_budget() const
+{ return _nap_budget; }
+
+/**
+ * @brief Gets whether CPU plots show bands of NUMA nodes.
+ * 
+ * @returns True if the first CPU plot of each node shows its band.
+ */
+bool NapConfig::get_numa_bands() const
+{ return _numa_bands; }
+
+/**
+ * @brief Gets the path to the file with the traced machine's NUMA topology.
+ * 
+ * @returns Path to the file, empty if this machine's topology is used.
+ */
+const std::string& NapConfig::get_numa_topology() const
+{ return _numa_topology; }
+
 // Window
 
 // Member functons
@@ -53,13 +118,25 @@ int32_t NapConfig::get_histo_limit() const
 /**
  * @brief Constructor for the configuration window.
  * 
+ * @param parent: Owner of the window, KernelShark's main window
+ * 
  * @note Due to its nature and setup functions, this function
  * is also dependent on the configuration 'NapConfig' singleton.
 */
-NapConfigWindow::NapConfigWindow()
-    : QWidget(NapConfig::main_w_ptr),
-    _histo_label("Entries on histogram until nap rectangles appear: "),
+NapConfigWindow::NapConfigWindow(QWidget* parent)
+    : QWidget(parent),
+    _histo_label("Naps in a task plot until only the longest are drawn: "),
     _histo_limit(this),
+    _exclude_label("Previous states dropped on next load (e.g. R): "),
+    _exclude_states(this),
+    _aggregate_label("Threads with the same comm shown as a band (0 = off): "),
+    _aggregate_min(this),
+    _budget_label("Naps drawn per plot, longest first (0 = all): "),
+    _nap_budget(this),
+    _numa_label("NUMA node bands in CPU plots, topology file: "),
+    _numa_bands(this),
+    _numa_topology(this),
+    _mem_label(this),
     _close_button("Close", this),
     _apply_button("Apply", this)
 {
@@ -70,6 +147,16 @@ NapConfigWindow::NapConfigWindow()
     setMaximumHeight(300);
 
     setup_histo_section();
+
+    setup_exclude_section();
+
+    setup_aggregate_section();
+
+    setup_budget_section();
+
+    setup_numa_section();
+
+    setup_mem_section();
     
     // Connect endstage buttons to actions
     setup_endstage();
@@ -91,6 +178,72 @@ void NapConfigWindow::load_cfg_values() {
     NapConfig& cfg = NapConfig::get_instance();
 
     _histo_limit.setValue(cfg._histo_entries_limit);
+    _exclude_states.setText(QString::fromStdString(cfg._excluded_states));
+    _aggregate_min.setValue(cfg._aggregate_min_threads);
+    _nap_budget.setValue(cfg._nap_budget);
+    _numa_bands.setChecked(cfg._numa_bands);
+    _numa_topology.setText(QString::fromStdString(cfg._numa_topology));
+
+    load_mem_usage();
+}
+
+/**
+ * @brief Loads the plugin's current memory usage in every data stream
+ * with the plugin's context and of the cache of nap tables into the memory
+ * usage label, along with times activation of the plugin took.
+*/
+void NapConfigWindow::load_mem_usage() {
+    QString text = "Memory used by the plugin:";
+    size_t total = 0;
+
+    kshark_context* kshark_ctx = nullptr;
+    int* stream_ids = nullptr;
+    int n_streams = 0;
+    if (kshark_instance(&kshark_ctx)) {
+        stream_ids = kshark_all_streams(kshark_ctx);
+        n_streams = stream_ids ? kshark_ctx->n_streams : 0;
+    }
+
+    for (int i = 0; i < n_streams; ++i) {
+        naps_mem_usage usage;
+        if (!naps_get_mem_usage(stream_ids[i], &usage)) continue;
+
+        size_t stream_total = naps_mem_usage_total(&usage);
+        total += stream_total;
+        text += QString("\nStream %1: %2 (collected events %3, ingest order"
+            " %4, CPU records %5, nap table %6, geometry %7, aggregates %8,"
+            " block I/O %9, drawn rectangles %10, context %11)")
+            .arg(stream_ids[i])
+            .arg(_format_bytes(stream_total))
+            .arg(_format_bytes(usage.collected_events))
+            .arg(_format_bytes(usage.ingest_order))
+            .arg(_format_bytes(usage.cpu_records))
+            .arg(_format_bytes(usage.nap_table))
+            .arg(_format_bytes(usage.geometry))
+            .arg(_format_bytes(usage.aggregates))
+            .arg(_format_bytes(usage.block_io))
+            .arg(_format_bytes(usage.drawn_shapes))
+            .arg(_format_bytes(usage.context));
+    }
+
+    // Cached tables belong to no stream, they are shown once
+    const size_t cached = naps_cache_mem_usage();
+    total += cached;
+    text += "\nCached nap tables: " + _format_bytes(cached);
+
+    text += "\nTotal: " + _format_bytes(total);
+
+    text += QString("\nActivation: menu %1 us").arg(
+        double(NapConfig::menu_activation_ns) / 1e3, 0, 'f', 1);
+    for (int i = 0; i < n_streams; ++i) {
+        plugin_naps_context* ctx = __get_context(stream_ids[i]);
+        if (!ctx) continue;
+        text += QString(", stream %1 %2 us").arg(stream_ids[i])
+            .arg(double(ctx->activation_ns) / 1e3, 0, 'f', 1);
+    }
+    free(stream_ids);
+
+    _mem_label.setText(text);
 }
 
 /**
@@ -105,6 +258,16 @@ void NapConfigWindow::update_cfg() {
     NapConfig& cfg = NapConfig::get_instance();
 
     cfg._histo_entries_limit = _histo_limit.value();
+    cfg._aggregate_min_threads = _aggregate_min.value();
+    cfg._nap_budget = _nap_budget.value();
+    cfg._numa_bands = _numa_bands.isChecked();
+    cfg._numa_topology = _numa_topology.text().trimmed().toStdString();
+
+    // Core keeps only states it knows, read them back normalized
+    naps_set_excluded_states(_exclude_states.text().toStdString().c_str());
+    char states[16];
+    naps_get_excluded_states(states, sizeof(states));
+    cfg._excluded_states = states;
 
     // Display a successful change dialog
     // We'll see if unique ptr is of any use here
@@ -136,6 +299,97 @@ void NapConfigWindow::setup_histo_section() {
     _histo_layout.addWidget(&_histo_limit);
 }
 
+/**
+ * @brief Sets up line edit for excluded prev_states and explanation label.
+ * 
+ * @note Function is also dependent on the configuration
+ * 'NapConfig' singleton.
+ */
+void NapConfigWindow::setup_exclude_section() {
+    // Configuration access here
+    NapConfig& cfg = NapConfig::get_instance();
+
+    _exclude_states.setPlaceholderText("none");
+    _exclude_states.setText(QString::fromStdString(cfg._excluded_states));
+
+    _exclude_label.setFixedHeight(32);
+    _exclude_layout.addWidget(&_exclude_label);
+    _exclude_layout.addStretch();
+    _exclude_layout.addWidget(&_exclude_states);
+}
+
+/**
+ * @brief Sets up spinbox for the minimum size of aggregated comm groups
+ * and explanation label.
+ * 
+ * @note Function is also dependent on the configuration
+ * 'NapConfig' singleton.
+ */
+void NapConfigWindow::setup_aggregate_section() {
+    // Configuration access here
+    NapConfig& cfg = NapConfig::get_instance();
+
+    _aggregate_min.setMinimum(0);
+    _aggregate_min.setMaximum(std::numeric_limits<int>::max());
+    _aggregate_min.setValue(cfg._aggregate_min_threads);
+
+    _aggregate_label.setFixedHeight(32);
+    _aggregate_layout.addWidget(&_aggregate_label);
+    _aggregate_layout.addStretch();
+    _aggregate_layout.addWidget(&_aggregate_min);
+}
+
+/**
+ * @brief Sets up spinbox for the maximum number of naps drawn in a task
+ * plot and explanation label.
+ * 
+ * @note Function is also dependent on the configuration
+ * 'NapConfig' singleton.
+ */
+void NapConfigWindow::setup_budget_section() {
+    // Configuration access here
+    NapConfig& cfg = NapConfig::get_instance();
+
+    _nap_budget.setMinimum(0);
+    _nap_budget.setMaximum(std::numeric_limits<int>::max());
+    _nap_budget.setValue(cfg._nap_budget);
+
+    _budget_label.setFixedHeight(32);
+    _budget_layout.addWidget(&_budget_label);
+    _budget_layout.addStretch();
+    _budget_layout.addWidget(&_nap_budget);
+}
+
+/**
+ * @brief Sets up checkbox enabling bands of NUMA nodes, line edit for
+ * the topology file and explanation label.
+ * 
+ * @note Function is also dependent on the configuration
+ * 'NapConfig' singleton.
+ */
+void NapConfigWindow::setup_numa_section() {
+    // Configuration access here
+    NapConfig& cfg = NapConfig::get_instance();
+
+    _numa_bands.setChecked(cfg._numa_bands);
+    _numa_topology.setPlaceholderText("this machine");
+    _numa_topology.setText(QString::fromStdString(cfg._numa_topology));
+
+    _numa_label.setFixedHeight(32);
+    _numa_layout.addWidget(&_numa_label);
+    _numa_layout.addStretch();
+    _numa_layout.addWidget(&_numa_bands);
+    _numa_layout.addWidget(&_numa_topology);
+}
+
+/**
+ * @brief Sets up the label with the plugin's memory usage.
+ */
+void NapConfigWindow::setup_mem_section() {
+    _mem_label.setWordWrap(true);
+    load_mem_usage();
+}
+
 /**
  * @brief Sets up the Apply and Close buttons by putting
  * them into a layout and assigning actions on pressing them.
@@ -159,6 +413,11 @@ void NapConfigWindow::setup_layout() {
 
     // Add all control elements
     _layout.addLayout(&_histo_layout);
+    _layout.addLayout(&_exclude_layout);
+    _layout.addLayout(&_aggregate_layout);
+    _layout.addLayout(&_budget_layout);
+    _layout.addLayout(&_numa_layout);
+    _layout.addWidget(&_mem_label);
     _layout.addStretch();
     _layout.addLayout(&_endstage_btns_layout);
 
@@ -14,6 +14,7 @@
 //C++
 #include <stdint.h>
 #include <map>
+#include <string>
 
 // Qt
 #include <QtWidgets>
@@ -28,7 +29,7 @@ class NapConfigWindow;
 
 /**
  * @brief Singleton class for the config object of the plugin.
- * Holds the histogram limit until nap rectangles activate and
+ * Holds the limit of naps in a task plot until it falls back to the longest and
  * a pointer to the main window of KernelShark for GUI manipulation.
  * 
  * It's preinitialised to some sane defaults and is NOT persistent,
@@ -41,13 +42,36 @@ public: // Class data members
     ///
     /// @brief Pointer to the main window used for window hierarchies.
     inline static KsMainWindow* main_w_ptr = nullptr;
+    ///
+    /// @brief Time creation of the plugin's menu took, in nanoseconds.
+    inline static int64_t menu_activation_ns = 0;
 private: // Data members
-    /// @brief Limit value of how many entries may be visible in a
-    /// histogram for the plugin to take effect.
+    /// @brief Limit value of how many naps of a task may be visible in
+    /// its plot for all of them to be drawn.
     int32_t _histo_entries_limit{10000};
+    /// @brief Abbreviations of prev_states whose sched_switch events are
+    /// dropped while loading data, applies to the next load.
+    std::string _excluded_states{};
+    /// @brief Minimum number of threads with the same comm for their
+    /// task plots to show the group's aggregate band, zero disables it.
+    int32_t _aggregate_min_threads{0};
+    /// @brief Maximum number of naps drawn in a task plot, the longest are
+    /// drawn and the rest summarized. Zero disables the budget.
+    int32_t _nap_budget{500};
+    /// @brief Whether the first CPU plot of each NUMA node shows the
+    /// node's aggregate band.
+    bool _numa_bands{false};
+    /// @brief Path to a file with the traced machine's NUMA topology,
+    /// empty for the topology of this machine.
+    std::string _numa_topology{};
 public: // Functions
     static NapConfig& get_instance();
     int32_t get_histo_limit() const;
+    const std::string& get_excluded_states() const;
+    int32_t get_aggregate_min_threads() const;
+    int32_t get_nap_budget() const;
+    bool get_numa_bands() const;
+    const std::string& get_numa_topology() const;
 private: // Constructor
     /// @brief Default constructor, hidden to enforce singleton pattern.
     NapConfig() = default;
@@ -66,8 +90,9 @@ private: // Constructor
 class NapConfigWindow : public QWidget {
 // Non-Qt portion
 public: // Functions
-    NapConfigWindow();
+    explicit NapConfigWindow(QWidget* parent);
     void load_cfg_values();
+    void load_mem_usage();
 private:
     void update_cfg();
 // Qt portion
@@ -93,6 +118,70 @@ private: // Qt data members
     /// before nap rectangles show up.
     QSpinBox        _histo_limit;
 
+    // Excluded states
+
+    /// @brief Layout used for the line edit and explanation
+    /// of what it does in the label.
+    QHBoxLayout     _exclude_layout;
+
+    ///
+    /// @brief Explanation of what the line edit next to it does.
+    QLabel          _exclude_label;
+
+    /// @brief Line edit with abbreviations of prev_states excluded
+    /// while loading data.
+    QLineEdit       _exclude_states;
+
+    // Aggregates
+
+    /// @brief Layout used for the spinbox and explanation
+    /// of what it does in the label.
+    QHBoxLayout     _aggregate_layout;
+
+    ///
+    /// @brief Explanation of what the spinbox next to it does.
+    QLabel          _aggregate_label;
+
+    /// @brief Spinbox used to change the minimum size of a comm group
+    /// whose task plots show the group's aggregate band.
+    QSpinBox        _aggregate_min;
+
+    // Nap budget
+
+    /// @brief Layout used for the spinbox and explanation
+    /// of what it does in the label.
+    QHBoxLayout     _budget_layout;
+
+    ///
+    /// @brief Explanation of what the spinbox next to it does.
+    QLabel          _budget_label;
+
+    /// @brief Spinbox used to change the maximum number of naps
+    /// drawn in a task plot.
+    QSpinBox        _nap_budget;
+
+    // NUMA nodes
+
+    /// @brief Layout used for the checkbox, line edit and explanation
+    /// of what they do in the label.
+    QHBoxLayout     _numa_layout;
+
+    ///
+    /// @brief Explanation of what the controls next to it do.
+    QLabel          _numa_label;
+
+    /// @brief Checkbox enabling bands of NUMA nodes in CPU plots.
+    QCheckBox       _numa_bands;
+
+    /// @brief Line edit with the path to a NUMA topology file.
+    QLineEdit       _numa_topology;
+
+    // Memory usage
+
+    /// @brief Label with the plugin's memory usage per stream,
+    /// broken down by structure, and activation times.
+    QLabel          _mem_label;
+
 public: // Qt data members
     ///
     /// @brief Close button for the widget.
@@ -103,6 +192,11 @@ public: // Qt data members
     QPushButton     _apply_button;
 private: // "Only Qt"-relevant functions
     void setup_histo_section();
+    void setup_exclude_section();
+    void setup_aggregate_section();
+    void setup_budget_section();
+    void setup_numa_section();
+    void setup_mem_section();
     void setup_endstage();
     void setup_layout();
 };
@@ -0,0 +1,114 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapCriticalPath.cpp
+ * @brief   Definitions of the wake-chain analysis.
+*/
+
+// C++
+#include <algorithm>
+
+// Plugin headers
+#include "NapCriticalPath.hpp"
+
+// Static functions
+
+/**
+ * @brief Ends the critical path with the last known nap of the chain. The
+ * nap takes the rest of the analyzed nap, if the nap started after it, the
+ * task was running in between.
+ *
+ * @param path: Critical path being built
+ * @param pid: PID of the napping task
+ * @param start: Start of the nap
+ * @param end: End of the nap
+ * @param state: Abbreviated prev_state of the nap
+ * @param window_start: Start of the analyzed nap
+*/
+static void _end_with_nap(NapCriticalPath& path, int32_t pid, int64_t start,
+    int64_t end, char state, int64_t window_start)
+{
+    path.segments.push_back({pid, std::max(start, window_start), end, state});
+    if (start > window_start) {
+        path.segments.push_back({pid, window_start, start, 0});
+    }
+}
+
+// Global functions
+
+/**
+ * @brief Walks the wake chain of a nap backwards and finds its critical path.
+ *
+ * The nap's waker was running when it woke the task up, so it was last woken
+ * up itself before that - the waker's last nap ending before the wakeup is
+ * the next link. It's found by a binary search over the waker's sorted ends
+ * of naps, so a step costs a hash lookup and a binary search, regardless of
+ * the number of naps. The chain ends when a waker is unknown, didn't nap
+ * before, or was running during the whole analyzed nap. Ends of links
+ * strictly decrease, so the chain can't loop.
+ *
+ * @param table: Nap table of the stream
+ * @param pid: PID of the task of the analyzed nap
+ * @param nap: Index of the analyzed nap in the task's table
+ * @param max_depth: Maximum number of links
+ *
+ * @returns Wake chain and critical path, both empty if there's no such nap.
+*/
+NapCriticalPath naps_critical_path(const NapTable& table, int32_t pid,
+    size_t nap, size_t max_depth)
+{
+    NapCriticalPath path;
+    const NapTaskTable* task = table.task(pid);
+    if (!task || nap >= task->size() || !max_depth) return path;
+
+    const int64_t window_start = task->start[nap];
+    path.links.push_back({pid, nap, task->start[nap], task->end[nap],
+        task->state[nap], task->waker[nap]});
+
+    while (true) {
+        const NapChainLink& last = path.links.back();
+
+        // PID 0 is the idle task, i.e. the wakeup came from an interrupt
+        if (last.waker <= 0) {
+            path.end = NapChainEnd::NO_WAKER;
+            break;
+        }
+
+        const NapTaskTable* waker = table.task(last.waker);
+        const size_t prev = waker ? waker->last_ending_before(last.end) : 0;
+        if (!waker || prev == waker->size()) {
+            path.end = NapChainEnd::WAKER_NOT_NAPPING;
+            path.segments.push_back({last.waker, window_start, last.end, 0});
+            break;
+        }
+
+        const int64_t woken = waker->end[prev];
+        if (woken <= window_start) {
+            path.end = NapChainEnd::WAKER_RUNNING;
+            path.segments.push_back({last.waker, window_start, last.end, 0});
+            break;
+        }
+
+        // Waker ran from its own wakeup until waking the last link's task up
+        path.segments.push_back({last.waker, woken, last.end, 0});
+
+        if (path.links.size() >= max_depth) {
+            path.end = NapChainEnd::DEPTH_LIMIT;
+            _end_with_nap(path, last.waker, waker->start[prev], woken,
+                waker->state[prev], window_start);
+            break;
+        }
+
+        path.links.push_back({last.waker, prev, waker->start[prev], woken,
+            waker->state[prev], waker->waker[prev]});
+    }
+
+    // Chain ended by an unknown waker, its last nap takes the rest
+    if (path.end == NapChainEnd::NO_WAKER) {
+        const NapChainLink& last = path.links.back();
+        _end_with_nap(path, last.pid, last.start, last.end, last.state,
+            window_start);
+    }
+
+    return path;
+}
@@ -0,0 +1,111 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapCriticalPath.hpp
+ * @brief   Declarations of the wake-chain analysis - for a nap, who woke the
+ *          task up, what that waker was waiting on, and so on, turned into
+ *          the critical path of the nap. Part of the Qt-free core.
+ *
+ * @note    Definitions in `NapCriticalPath.cpp`.
+*/
+
+#ifndef _NR_NAP_CRITICAL_PATH_HPP
+#define _NR_NAP_CRITICAL_PATH_HPP
+
+// C++
+#include <cstdint>
+#include <vector>
+
+// Plugin
+#include "NapTable.hpp"
+
+/**
+ * @brief A nap in a wake chain.
+*/
+struct NapChainLink {
+    ///
+    /// @brief PID of the napping task.
+    int32_t pid{-1};
+    ///
+    /// @brief Index of the nap in the task's table.
+    size_t nap{0};
+    ///
+    /// @brief Start of the nap.
+    int64_t start{0};
+    ///
+    /// @brief End of the nap, i.e. when the waker woke the task up.
+    int64_t end{0};
+    ///
+    /// @brief Abbreviated prev_state of the nap.
+    char state{0};
+    ///
+    /// @brief PID of the task which ended the nap, negative if unknown.
+    int32_t waker{-1};
+};
+
+/**
+ * @brief Part of the critical path of a nap - a time interval during which
+ * a task was either running towards waking the next task of the chain up,
+ * or napping itself.
+*/
+struct NapPathSegment {
+    ///
+    /// @brief PID of the task.
+    int32_t pid{-1};
+    ///
+    /// @brief Start of the interval.
+    int64_t start{0};
+    ///
+    /// @brief End of the interval.
+    int64_t end{0};
+    ///
+    /// @brief Abbreviated prev_state if the task was napping, zero if it
+    /// was running (or its state is unknown).
+    char state{0};
+};
+
+/**
+ * @brief Reason why a wake chain ended.
+*/
+enum class NapChainEnd {
+    ///
+    /// @brief Waker of the last nap isn't known (or is the idle task).
+    NO_WAKER,
+    ///
+    /// @brief Waker of the last nap had no nap before waking it up.
+    WAKER_NOT_NAPPING,
+    ///
+    /// @brief Waker's last nap ended before the analyzed nap started,
+    /// so the waker was running during all of it.
+    WAKER_RUNNING,
+    ///
+    /// @brief Chain reached the maximum depth.
+    DEPTH_LIMIT
+};
+
+/**
+ * @brief Wake chain of a nap and its critical path.
+*/
+struct NapCriticalPath {
+    ///
+    /// @brief Naps of the chain, the analyzed nap first, then the last nap
+    /// of its waker before the wakeup, and so on backwards in time.
+    std::vector<NapChainLink> links;
+    ///
+    /// @brief Partition of the analyzed nap into intervals, latest first.
+    /// Each link's waker was running from its own last wakeup until it woke
+    /// the link's task up, the earliest part is attributed to the last link.
+    std::vector<NapPathSegment> segments;
+    ///
+    /// @brief Why the chain ended.
+    NapChainEnd end{NapChainEnd::NO_WAKER};
+};
+
+///
+/// @brief Default maximum number of links of a wake chain.
+static constexpr size_t NAPS_CHAIN_MAX_DEPTH = 256;
+
+NapCriticalPath naps_critical_path(const NapTable& table, int32_t pid,
+    size_t nap, size_t max_depth = NAPS_CHAIN_MAX_DEPTH);
+
+#endif // _NR_NAP_CRITICAL_PATH_HPP
@@ -0,0 +1,105 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapDiff.cpp
+ * @brief   Definitions of nap profiles of data streams and of their
+ *          comparison.
+*/
+
+// C++
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+// Plugin headers
+#include "NapAggregate.hpp"
+#include "NapDiff.hpp"
+
+// Global functions
+
+/**
+ * @brief Gets the nap profile of a stream - statistics of naps of the
+ * stream's tasks summed up per comm group and prev_state.
+ *
+ * @param ctx: Plugin's context of the stream
+ * @param sd: Stream identifier number
+ *
+ * @returns Profile entries sorted by comm and prev_state, empty if the
+ * stream has no naps.
+*/
+std::vector<NapProfileEntry> naps_comm_profile(plugin_naps_context* ctx,
+    int sd)
+{
+    std::vector<NapProfileEntry> profile;
+    const NapTable* table = NapTable::from_context(ctx);
+    if (!table) return profile;
+
+    NapCommAggregate* aggregate = NapCommAggregate::from_context(ctx);
+    for (const auto& [comm, pids] : aggregate->groups(*table, sd)) {
+        std::map<char, NapStateStats> group_stats;
+        for (int32_t pid : pids) {
+            for (const auto& [state, stats] : table->task(pid)->stats) {
+                group_stats[state].count += stats.count;
+                group_stats[state].total_ns += stats.total_ns;
+            }
+        }
+
+        for (const auto& [state, stats] : group_stats) {
+            profile.push_back({comm, state, stats.count, stats.total_ns});
+        }
+    }
+
+    std::sort(profile.begin(), profile.end(),
+        [](const NapProfileEntry& a, const NapProfileEntry& b) {
+            return std::tie(a.comm, a.state) < std::tie(b.comm, b.state);
+        });
+    return profile;
+}
+
+/**
+ * @brief Compares nap profiles of two streams with a merge-join over their
+ * sorted entries. Comms or prev_states missing in one of the streams count
+ * as zero there.
+ *
+ * @param base: Profile of the baseline stream (e.g. before a change)
+ * @param other: Profile of the compared stream (e.g. after a change)
+ *
+ * @returns Compared entries, largest growth of nap time (regression) first,
+ * ties broken by growth of number of naps.
+*/
+std::vector<NapDiffEntry> naps_diff(const std::vector<NapProfileEntry>& base,
+    const std::vector<NapProfileEntry>& other)
+{
+    std::vector<NapDiffEntry> diff;
+    diff.reserve(std::max(base.size(), other.size()));
+
+    auto key = [](const NapProfileEntry& e) { return std::tie(e.comm, e.state); };
+
+    size_t b = 0, o = 0;
+    while (b < base.size() || o < other.size()) {
+        const bool take_base = (b < base.size())
+            && (o == other.size() || key(base[b]) <= key(other[o]));
+        const bool take_other = (o < other.size())
+            && (b == base.size() || key(other[o]) <= key(base[b]));
+
+        const NapProfileEntry& first = take_base ? base[b] : other[o];
+        NapDiffEntry& entry = diff.emplace_back();
+        entry.comm = first.comm;
+        entry.state = first.state;
+        if (take_base) {
+            entry.count[0] = base[b].count;
+            entry.total_ns[0] = base[b++].total_ns;
+        }
+        if (take_other) {
+            entry.count[1] = other[o].count;
+            entry.total_ns[1] = other[o++].total_ns;
+        }
+    }
+
+    std::stable_sort(diff.begin(), diff.end(),
+        [](const NapDiffEntry& a, const NapDiffEntry& b) {
+            if (a.delta_ns() != b.delta_ns()) return a.delta_ns() > b.delta_ns();
+            return a.delta_count() > b.delta_count();
+        });
+    return diff;
+}
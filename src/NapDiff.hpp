@@ -0,0 +1,72 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapDiff.hpp
+ * @brief   Declarations of nap profiles of data streams - nap time and
+ *          count per comm and prev_state - and of their comparison.
+ *          Part of the Qt-free core of the plugin.
+ *
+ * @note    Definitions in `NapDiff.cpp`.
+*/
+
+#ifndef _NR_NAP_DIFF_HPP
+#define _NR_NAP_DIFF_HPP
+
+// C++
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Plugin
+#include "naps_core.h"
+#include "NapTable.hpp"
+
+/**
+ * @brief Naps of all tasks with the same comm in one prev_state.
+*/
+struct NapProfileEntry {
+    ///
+    /// @brief Comm of the tasks.
+    std::string comm;
+    ///
+    /// @brief Abbreviated prev_state.
+    char state{0};
+    ///
+    /// @brief Number of naps.
+    uint64_t count{0};
+    ///
+    /// @brief Sum of durations of the naps, in nanoseconds.
+    int64_t total_ns{0};
+};
+
+/**
+ * @brief Comparison of naps of one comm and prev_state in two streams,
+ * the first one being the baseline.
+*/
+struct NapDiffEntry {
+    ///
+    /// @brief Comm of the tasks.
+    std::string comm;
+    ///
+    /// @brief Abbreviated prev_state.
+    char state{0};
+    ///
+    /// @brief Number of naps in the baseline and in the compared stream.
+    uint64_t count[2]{0, 0};
+    ///
+    /// @brief Nap time in the baseline and in the compared stream,
+    /// in nanoseconds.
+    int64_t total_ns[2]{0, 0};
+public:
+    /// @brief Returns the change of nap time, positive if it grew.
+    int64_t delta_ns() const { return total_ns[1] - total_ns[0]; }
+    /// @brief Returns the change of number of naps, positive if it grew.
+    int64_t delta_count() const { return int64_t(count[1]) - int64_t(count[0]); }
+};
+
+std::vector<NapProfileEntry> naps_comm_profile(plugin_naps_context* ctx,
+    int sd);
+std::vector<NapDiffEntry> naps_diff(const std::vector<NapProfileEntry>& base,
+    const std::vector<NapProfileEntry>& other);
+
+#endif // _NR_NAP_DIFF_HPP
@@ -0,0 +1,188 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapDiffWindow.cpp
+ * @brief   Definitions of the window comparing nap profiles of two
+ *          loaded data streams.
+*/
+
+// C
+#include <stdlib.h>
+
+// C++
+#include <cmath>
+
+// KernelShark
+#include "libkshark.h"
+
+// Plugin
+#include "naps_core.h"
+#include "NapBuildScheduler.hpp"
+#include "NapConfig.hpp"
+#include "NapDiff.hpp"
+#include "NapDiffWindow.hpp"
+
+// Static functions
+
+/**
+ * @brief Creates a table item with a number, which sorts numerically.
+ * 
+ * @param value: Shown number
+ * 
+ * @returns Pointer to the heap-created item, owned by the table it's put in.
+ */
+static QTableWidgetItem* _number_item(double value) {
+    auto item = new QTableWidgetItem();
+    item->setData(Qt::DisplayRole, value);
+    return item;
+}
+
+/**
+ * @brief Converts nanoseconds to milliseconds rounded to microseconds.
+ * 
+ * @param ns: Time in nanoseconds
+ * 
+ * @returns Time in milliseconds.
+ */
+static double _ns_to_ms(int64_t ns) {
+    return std::round(double(ns) / 1e3) / 1e3;
+}
+
+// Member functions
+
+/**
+ * @brief Constructor for the comparison window.
+ * 
+ * @param parent: Owner of the window, KernelShark's main window
+*/
+NapDiffWindow::NapDiffWindow(QWidget* parent)
+    : QWidget(parent),
+    _base_stream(this),
+    _other_stream(this),
+    _table(this),
+    _compare_button("Compare", this),
+    _close_button("Close", this)
+{
+    setWindowTitle("Naps Stream Comparison");
+    setWindowFlags(Qt::Dialog | Qt::WindowMinimizeButtonHint
+                   | Qt::WindowCloseButtonHint);
+    resize(900, 500);
+
+    setup_table();
+
+    connect(&_compare_button, &QPushButton::pressed,
+            this, [this]() { this->compare(); });
+    connect(&_close_button, &QPushButton::pressed,
+            this, &QWidget::close);
+
+    setup_layout();
+}
+
+/**
+ * @brief Loads currently loaded streams into the stream choices. The first
+ * stream is preselected as the baseline, the second as the compared one.
+*/
+void NapDiffWindow::load_streams() {
+    _base_stream.clear();
+    _other_stream.clear();
+    _stream_ids.clear();
+
+    kshark_context* kshark_ctx = nullptr;
+    if (!kshark_instance(&kshark_ctx)) return;
+
+    int* stream_ids = kshark_all_streams(kshark_ctx);
+    const int n_streams = stream_ids ? kshark_ctx->n_streams : 0;
+    for (int i = 0; i < n_streams; ++i) {
+        kshark_data_stream* stream =
+            kshark_get_data_stream(kshark_ctx, stream_ids[i]);
+        QString name = QString("Stream %1: %2").arg(stream_ids[i])
+            .arg(stream && stream->file ? stream->file : "");
+
+        _stream_ids.push_back(stream_ids[i]);
+        _base_stream.addItem(name);
+        _other_stream.addItem(name);
+    }
+    free(stream_ids);
+
+    _other_stream.setCurrentIndex(n_streams > 1 ? 1 : 0);
+}
+
+/**
+ * @brief Compares the chosen streams and shows the result in the table.
+ * Streams without the plugin's context can't be compared.
+*/
+void NapDiffWindow::compare() {
+    const int base_idx = _base_stream.currentIndex();
+    const int other_idx = _other_stream.currentIndex();
+    if (base_idx < 0 || other_idx < 0 || size_t(base_idx) >= _stream_ids.size()
+        || size_t(other_idx) >= _stream_ids.size()) {
+        return;
+    }
+
+    const int base_sd = _stream_ids[base_idx];
+    const int other_sd = _stream_ids[other_idx];
+    plugin_naps_context* base_ctx = __get_context(base_sd);
+    plugin_naps_context* other_ctx = __get_context(other_sd);
+    if (!base_ctx || !other_ctx) {
+        QMessageBox::warning(this, "Naps Stream Comparison",
+            "The plugin isn't enabled for both streams.");
+        return;
+    }
+
+    // Both tables are built at once, if they aren't yet
+    NapBuildScheduler& builds = NapBuildScheduler::get_instance();
+    builds.schedule(base_ctx, base_sd);
+    builds.schedule(other_ctx, other_sd);
+
+    const std::vector<NapDiffEntry> diff = naps_diff(
+        naps_comm_profile(base_ctx, base_sd),
+        naps_comm_profile(other_ctx, other_sd));
+
+    // Keep the order of the comparison, sorting is up to the user
+    _table.setSortingEnabled(false);
+    _table.clearContents();
+    _table.setRowCount(int(diff.size()));
+    for (int row = 0; row < int(diff.size()); ++row) {
+        const NapDiffEntry& entry = diff[row];
+        _table.setItem(row, 0, new QTableWidgetItem(
+            QString::fromStdString(entry.comm)));
+        _table.setItem(row, 1, new QTableWidgetItem(
+            QString(QChar(entry.state))));
+        _table.setItem(row, 2, _number_item(double(entry.count[0])));
+        _table.setItem(row, 3, _number_item(double(entry.count[1])));
+        _table.setItem(row, 4, _number_item(double(entry.delta_count())));
+        _table.setItem(row, 5, _number_item(_ns_to_ms(entry.total_ns[0])));
+        _table.setItem(row, 6, _number_item(_ns_to_ms(entry.total_ns[1])));
+        _table.setItem(row, 7, _number_item(_ns_to_ms(entry.delta_ns())));
+    }
+    _table.resizeColumnsToContents();
+    _table.setSortingEnabled(true);
+}
+
+/**
+ * @brief Sets up columns of the comparison table.
+*/
+void NapDiffWindow::setup_table() {
+    _table.setColumnCount(8);
+    _table.setHorizontalHeaderLabels({"Comm", "State", "Count A", "Count B",
+        "Count diff", "Time A [ms]", "Time B [ms]", "Time diff [ms]"});
+    _table.setEditTriggers(QAbstractItemView::NoEditTriggers);
+}
+
+/**
+ * @brief Sets up the main layout of the comparison window.
+*/
+void NapDiffWindow::setup_layout() {
+    _choice_layout.addWidget(new QLabel("A (baseline):", this));
+    _choice_layout.addWidget(&_base_stream);
+    _choice_layout.addWidget(new QLabel("B:", this));
+    _choice_layout.addWidget(&_other_stream);
+    _choice_layout.addStretch();
+    _choice_layout.addWidget(&_compare_button);
+
+    _layout.addLayout(&_choice_layout);
+    _layout.addWidget(&_table);
+    _layout.addWidget(&_close_button);
+
+    setLayout(&_layout);
+}
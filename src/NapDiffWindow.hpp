@@ -0,0 +1,70 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapDiffWindow.hpp
+ * @brief   Declaration of the window comparing nap profiles of two
+ *          loaded data streams.
+ *
+ * @note    Definitions in `NapDiffWindow.cpp`.
+*/
+
+#ifndef _NR_NAP_DIFF_WINDOW_HPP
+#define _NR_NAP_DIFF_WINDOW_HPP
+
+// C++
+#include <vector>
+
+// Qt
+#include <QtWidgets>
+
+/**
+ * @brief QtWidget's child class showing a comparison of nap time and count
+ * per comm and prev_state of two loaded streams, largest regression first.
+ * Streams are chosen from those loaded when the window is shown.
+*/
+class NapDiffWindow : public QWidget {
+// Non-Qt portion
+public: // Functions
+    explicit NapDiffWindow(QWidget* parent);
+    void load_streams();
+private:
+    void compare();
+private: // Data members
+    ///
+    /// @brief Identifiers of streams in the order of the combo boxes' items.
+    std::vector<int> _stream_ids;
+// Qt portion
+private: // Qt data members
+    ///
+    /// @brief Layout for the widget's control elements.
+    QVBoxLayout     _layout;
+
+    /// @brief Layout for the stream choices and the Compare button.
+    QHBoxLayout     _choice_layout;
+
+    ///
+    /// @brief Baseline stream of the comparison.
+    QComboBox       _base_stream;
+
+    ///
+    /// @brief Compared stream.
+    QComboBox       _other_stream;
+
+    ///
+    /// @brief Table with the comparison.
+    QTableWidget    _table;
+
+public: // Qt data members
+    ///
+    /// @brief Button comparing the chosen streams.
+    QPushButton     _compare_button;
+
+    ///
+    /// @brief Close button for the widget.
+    QPushButton     _close_button;
+private: // "Only Qt"-relevant functions
+    void setup_table();
+    void setup_layout();
+};
+
+#endif // _NR_NAP_DIFF_WINDOW_HPP
@@ -0,0 +1,116 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapDrawPlan.cpp
+ * @brief   Definitions of the choice of what a drawn plot shows.
+*/
+
+// C++
+#include <algorithm>
+#include <vector>
+
+// KernelShark
+#include "libkshark-plugin.h"
+
+// Plugin headers
+#include "NapAggregate.hpp"
+#include "NapDrawPlan.hpp"
+
+// Global functions
+
+/**
+ * @brief Checks whether plots drawn with an action may show anything, before
+ * the nap table is needed, so that plots which never do don't build it.
+ *
+ * @param draw_action: Draw action (task or CPU plot)
+ * @param settings: Configuration at the time of drawing
+ *
+ * @returns True if the plot may show something, false if it never does.
+*/
+bool naps_draws_plot(int draw_action, const NapDrawSettings& settings) {
+    return draw_action == KSHARK_TASK_DRAW
+        || (draw_action == KSHARK_CPU_DRAW && settings.numa_bands);
+}
+
+/**
+ * @brief Picks what a drawn plot shows:
+ *
+ * - a CPU plot shows the band of its NUMA node, if bands are configured
+ * and the CPU is the node's first,
+ *
+ * - a task plot of a large enough comm group shows the group's band,
+ * unless the task's own naps in view are too dense,
+ *
+ * - a dense task plot, or one with more naps than the budget, shows only
+ * its longest naps and a strip summarizing the rest,
+ *
+ * - any other task plot shows all of its visible naps.
+ *
+ * Plots are gated by the task's own naps in view, not by all entries of
+ * the histogram, so quiet tasks are drawn whatever their neighbours do.
+ *
+ * @param ctx: Plugin's context of the drawn stream
+ * @param table: Nap table of the drawn stream
+ * @param topology: Mapping of CPUs to nodes, may be null if bands of nodes
+ * aren't configured
+ * @param sd: Stream identifier number
+ * @param val: Process ID or CPU ID value (depends on `draw_action`)
+ * @param draw_action: Draw action (task or CPU plot)
+ * @param view: View of the drawn plot
+ * @param settings: Configuration at the time of drawing
+ *
+ * @returns Contents of the plot.
+*/
+NapDrawPlan naps_plan_draw(plugin_naps_context* ctx, const NapTable& table,
+    const NapTopology* topology, int sd, int val, int draw_action,
+    const NapView& view, const NapDrawSettings& settings)
+{
+    NapDrawPlan plan;
+    if (!naps_draws_plot(draw_action, settings)) return plan;
+
+    // CPU plots show only bands of NUMA nodes, at any zoom
+    if (draw_action == KSHARK_CPU_DRAW) {
+        const int node = topology ? topology->node_of(val) : -1;
+        if (node >= 0 && topology->first_cpu(node) == val) {
+            plan.path = NapDrawPath::NODE_BAND;
+            plan.node = node;
+        }
+        return plan;
+    }
+
+    const NapTaskTable* task = table.task(val);
+    size_t n_naps = 0;
+    if (task) {
+        auto [first, last] = task->in_range(view.min, view.max);
+        n_naps = last - first;
+    }
+    const bool is_dense = (n_naps > size_t(std::max(settings.limit, 0)));
+
+    // Large groups of threads are shown as a whole
+    if (settings.min_threads && !is_dense) {
+        const std::vector<int32_t>* group =
+            NapCommAggregate::from_context(ctx)->group(table, sd, val);
+        if (group && group->size() >= size_t(settings.min_threads)) {
+            plan.path = NapDrawPath::COMM_BAND;
+            return plan;
+        }
+    }
+
+    if (!task) return plan;
+    plan.task = task;
+
+    // Dense plots fall back to the longest naps, within the budget if any
+    const bool is_over_budget = (settings.budget
+        && n_naps > size_t(settings.budget));
+    if (is_dense) {
+        plan.path = NapDrawPath::TOP_NAPS;
+        plan.budget = settings.budget
+            ? std::min(settings.budget, settings.limit) : settings.limit;
+    } else if (is_over_budget) {
+        plan.path = NapDrawPath::TOP_NAPS;
+        plan.budget = settings.budget;
+    } else {
+        plan.path = NapDrawPath::ALL_NAPS;
+    }
+    return plan;
+}
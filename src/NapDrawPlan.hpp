@@ -0,0 +1,97 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapDrawPlan.hpp
+ * @brief   Declarations of what a drawn plot shows - a band of a NUMA node,
+ *          a band of a comm group, the longest naps or all naps - picked
+ *          the same way by the plugin's drawing function and by headless
+ *          replays of recorded draw requests. Part of the Qt-free core.
+ *
+ * @note    Definitions in `NapDrawPlan.cpp`.
+*/
+
+#ifndef _NR_NAP_DRAW_PLAN_HPP
+#define _NR_NAP_DRAW_PLAN_HPP
+
+// C++
+#include <cstdint>
+#include <string>
+
+// Plugin
+#include "naps_core.h"
+#include "NapTable.hpp"
+#include "NapTopology.hpp"
+#include "NapView.hpp"
+
+/**
+ * @brief Configuration the choice of a drawn plot's contents depends on,
+ * as it was when the plot was drawn.
+*/
+struct NapDrawSettings {
+    ///
+    /// @brief Limit of naps in view of a task plot, denser plots show only
+    /// their longest naps.
+    int32_t limit;
+    ///
+    /// @brief Maximum number of naps drawn into a task plot, zero if any
+    /// number is drawn.
+    int32_t budget;
+    ///
+    /// @brief Minimum size of a comm group shown as a band, zero if groups
+    /// aren't shown as bands.
+    int32_t min_threads;
+    ///
+    /// @brief Whether CPU plots show bands of NUMA nodes.
+    bool numa_bands;
+    ///
+    /// @brief Path of the NUMA topology file, empty for the topology of
+    /// the machine the plot is drawn on.
+    std::string numa_topology;
+};
+
+/**
+ * @brief Contents of a drawn plot.
+*/
+enum class NapDrawPath {
+    ///
+    /// @brief Nothing is drawn.
+    NOTHING,
+    ///
+    /// @brief Band of the NUMA node the plot's CPU is first of.
+    NODE_BAND,
+    ///
+    /// @brief Band of the comm group of the plot's task.
+    COMM_BAND,
+    ///
+    /// @brief Longest naps of the plot's task and a strip summarizing the rest.
+    TOP_NAPS,
+    ///
+    /// @brief All visible naps of the plot's task.
+    ALL_NAPS
+};
+
+/**
+ * @brief Contents of a drawn plot along with what drawing them needs.
+*/
+struct NapDrawPlan {
+    ///
+    /// @brief Contents of the plot.
+    NapDrawPath path{NapDrawPath::NOTHING};
+    ///
+    /// @brief Naps of the plot's task, null for other paths than those
+    /// drawing naps.
+    const NapTaskTable* task{nullptr};
+    ///
+    /// @brief Node of the plot's CPU, only for `NODE_BAND`.
+    int node{-1};
+    ///
+    /// @brief Maximum number of drawn naps, only for `TOP_NAPS`.
+    int32_t budget{0};
+};
+
+bool naps_draws_plot(int draw_action, const NapDrawSettings& settings);
+NapDrawPlan naps_plan_draw(plugin_naps_context* ctx, const NapTable& table,
+    const NapTopology* topology, int sd, int val, int draw_action,
+    const NapView& view, const NapDrawSettings& settings);
+
+#endif // _NR_NAP_DRAW_PLAN_HPP
@@ -0,0 +1,167 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapDrawRecord.cpp
+ * @brief   Definitions of the draw-request recorder and of reading records.
+ *
+ * @note    Record format is line-based text. First line is a header, then
+ *          `stream <sd> <file>` lines appear before first draw of a stream
+ *          and whenever its trace file changes, as KernelShark reuses
+ *          identifiers of closed streams, and `draw <sd> <val> <action> <min> <max> <bin size> <bins>
+ *          <total count> <limit> <x origin> <bin width> <budget>
+ *          <min threads> <numa bands> <topology>` lines describe each draw
+ *          request, the topology's path is the rest of the line.
+*/
+
+// C
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+
+// C++
+#include <map>
+#include <memory>
+#include <string>
+
+// Plugin headers
+#include "NapDrawRecord.hpp"
+
+///
+/// @brief First line of every record file.
+static const char RECORD_HEADER[] = "# naps draw record 2";
+
+// Static functions
+
+/**
+ * @brief Gets the rest of a read line, without its line break.
+ *
+ * @param rest: Rest of the line
+ *
+ * @returns The rest as a string.
+*/
+static std::string _rest_of_line(const char* rest) {
+    std::string text{rest};
+    while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) {
+        text.pop_back();
+    }
+    return text;
+}
+
+// Recorder
+
+/**
+ * @brief Constructor, takes ownership of the opened file.
+ *
+ * @param file: Opened record file
+*/
+NapDrawRecorder::NapDrawRecorder(std::FILE* file)
+    : _file(file)
+{
+    // Line-buffered, a crashing session is often the most interesting one
+    std::setvbuf(_file, nullptr, _IOLBF, 0);
+    std::fprintf(_file, "%s\n", RECORD_HEADER);
+}
+
+/**
+ * @brief Destructor, closes the record file.
+*/
+NapDrawRecorder::~NapDrawRecorder() {
+    std::fclose(_file);
+}
+
+/**
+ * @brief Gets the recorder, opening the record file on first call.
+ *
+ * @returns Pointer to the recorder or null if recording isn't enabled
+ * or the file couldn't be opened.
+*/
+NapDrawRecorder* NapDrawRecorder::get_instance() {
+    static std::unique_ptr<NapDrawRecorder> instance{[]() -> NapDrawRecorder* {
+        const char* path = std::getenv(NAPS_DRAW_RECORD_ENV);
+        if (!path || !*path) return nullptr;
+
+        std::FILE* file = std::fopen(path, "w");
+        return file ? new NapDrawRecorder{file} : nullptr;
+    }()};
+
+    return instance.get();
+}
+
+/**
+ * @brief Writes a draw request into the record file, preceded by the
+ * stream's trace file if the stream wasn't seen yet or its file changed.
+ *
+ * @param request: Draw request to record, with its stream's trace file
+*/
+void NapDrawRecorder::record(const NapDrawRequest& request) {
+    auto written = _files.find(request.sd);
+    if (written == _files.end() || written->second != request.file) {
+        std::fprintf(_file, "stream %d %s\n", request.sd,
+            request.file.c_str());
+        _files[request.sd] = request.file;
+    }
+
+    const NapDrawSettings& settings = request.settings;
+    std::fprintf(_file, "draw %d %d %d %" PRId64 " %" PRId64 " %" PRId64
+        " %d %" PRIu64 " %" PRId32 " %d %d %" PRId32 " %" PRId32 " %d %s\n",
+        request.sd, request.val, request.draw_action,
+        request.view.min, request.view.max, request.view.bin_size,
+        request.view.n_bins, request.tot_count, settings.limit,
+        request.x_origin, request.bin_width, settings.budget,
+        settings.min_threads, int(settings.numa_bands),
+        settings.numa_topology.c_str());
+}
+
+// Record
+
+/**
+ * @brief Reads a record file written by the recorder. Each request gets
+ * the trace file its stream had when the request was recorded.
+ *
+ * @param path: Path of the record file
+ *
+ * @returns True if the whole file was read, false if it couldn't be opened
+ * or has a malformed line.
+*/
+bool NapDrawRecord::read(const char* path) {
+    std::FILE* file = std::fopen(path, "r");
+    if (!file) return false;
+
+    // Current trace file of each stream identifier
+    std::map<int, std::string> files;
+    char line[4096];
+    bool ok = (std::fgets(line, sizeof(line), file) != nullptr)
+        && std::strncmp(line, RECORD_HEADER, sizeof(RECORD_HEADER) - 1) == 0;
+
+    while (ok && std::fgets(line, sizeof(line), file)) {
+        NapDrawRequest req{};
+        int consumed = 0;
+        int numa_bands = 0;
+
+        if (std::sscanf(line, "stream %d %n", &req.sd, &consumed) == 1
+            && consumed > 0) {
+            files[req.sd] = _rest_of_line(line + consumed);
+        } else if (std::sscanf(line, "draw %d %d %d %" SCNd64 " %" SCNd64
+                " %" SCNd64 " %d %" SCNu64 " %" SCNd32 " %d %d %" SCNd32
+                " %" SCNd32 " %d%n",
+                &req.sd, &req.val, &req.draw_action,
+                &req.view.min, &req.view.max, &req.view.bin_size,
+                &req.view.n_bins, &req.tot_count, &req.settings.limit,
+                &req.x_origin, &req.bin_width, &req.settings.budget,
+                &req.settings.min_threads, &numa_bands, &consumed) == 14
+            && consumed > 0) {
+            req.settings.numa_bands = (numa_bands != 0);
+            // A single space separates the path, which may be empty
+            const char* path = line + consumed;
+            req.settings.numa_topology = _rest_of_line(
+                (*path == ' ') ? path + 1 : path);
+            req.file = files[req.sd];
+            requests.push_back(req);
+        } else if (line[0] != '#' && line[0] != '\n') {
+            ok = false;
+        }
+    }
+
+    std::fclose(file);
+    return ok;
+}
@@ -0,0 +1,100 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapDrawRecord.hpp
+ * @brief   Declarations of the draw-request recorder, used in a debug mode
+ *          to save every request to draw naps during a GUI session, and of
+ *          reading such records back for headless replays. Part of the
+ *          Qt-free core.
+ *
+ * @note    Definitions in `NapDrawRecord.cpp`.
+*/
+
+#ifndef _NR_NAP_DRAW_RECORD_HPP
+#define _NR_NAP_DRAW_RECORD_HPP
+
+// C
+#include <cstdio>
+
+// C++
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Plugin
+#include "NapDrawPlan.hpp"
+#include "NapView.hpp"
+
+///
+/// @brief Environment variable with the path of the record file.
+#define NAPS_DRAW_RECORD_ENV "NAPS_DRAW_RECORD"
+
+/**
+ * @brief One invocation of the plugin's drawing function.
+*/
+struct NapDrawRequest {
+    ///
+    /// @brief Stream identifier.
+    int sd;
+    ///
+    /// @brief Process ID or CPU ID value.
+    int val;
+    ///
+    /// @brief Draw action (task or CPU plot).
+    int draw_action;
+    ///
+    /// @brief View of the drawn plot.
+    NapView view;
+    ///
+    /// @brief Total number of entries in the histogram.
+    uint64_t tot_count;
+    ///
+    /// @brief Horizontal position of the plot's first bin, in pixels.
+    int x_origin;
+    ///
+    /// @brief Horizontal distance of the plot's bins, in pixels.
+    int bin_width;
+    ///
+    /// @brief Configuration the plot's contents depended on at the time.
+    NapDrawSettings settings;
+    ///
+    /// @brief Trace file of the stream at the time. KernelShark reuses
+    /// identifiers of closed streams, so it can differ between requests.
+    std::string file;
+};
+
+/**
+ * @brief Recorded GUI session - draw requests in order.
+*/
+struct NapDrawRecord {
+    ///
+    /// @brief Draw requests in the order they came, with their streams'
+    /// trace files.
+    std::vector<NapDrawRequest> requests;
+public:
+    bool read(const char* path);
+};
+
+/**
+ * @brief Singleton writing draw requests into a text file, one line per
+ * request. Active only if the `NAPS_DRAW_RECORD` environment variable
+ * holds the path of the file when drawing first happens.
+*/
+class NapDrawRecorder {
+private: // Data members
+    ///
+    /// @brief Record file.
+    std::FILE* _file = nullptr;
+    ///
+    /// @brief Last written trace file of each stream.
+    std::map<int, std::string> _files;
+public: // Functions
+    static NapDrawRecorder* get_instance();
+    void record(const NapDrawRequest& request);
+    ~NapDrawRecorder();
+private: // Constructor
+    explicit NapDrawRecorder(std::FILE* file);
+};
+
+#endif // _NR_NAP_DRAW_RECORD_HPP
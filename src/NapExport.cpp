@@ -0,0 +1,258 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapExport.cpp
+ * @brief   Definitions of the export of naps into Chrome trace event JSON.
+*/
+
+// C
+#include <cstdlib>
+
+// C++
+#include <algorithm>
+#include <charconv>
+
+// KernelShark
+#include "libkshark.h"
+
+// Plugin headers
+#include "NapExport.hpp"
+
+// Member functions
+
+/**
+ * @brief Constructor of the export, starts the JSON document.
+ *
+ * @param out: File to write into, must stay open until the export finishes
+ * @param flows: Whether to export wakeups as flow arrows
+*/
+NapChromeExport::NapChromeExport(std::FILE* out, bool flows)
+    : _out(out), _flows(flows)
+{
+    _buffer.reserve(BUFFER_SIZE);
+    _put("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+}
+
+/**
+ * @brief Destructor of the export, finishes the JSON document if it wasn't
+ * finished yet.
+*/
+NapChromeExport::~NapChromeExport() {
+    finish();
+}
+
+/**
+ * @brief Exports naps of a stream. The stream becomes a process named by
+ * the given name, tasks become its threads named by their comms. Tasks are
+ * exported in the order of PIDs and naps of each task in the order of time.
+ *
+ * A flow arrow needs a slice on both of its ends, so every wakeup with
+ * a known waker adds a tiny slice to the waker's track, from which the
+ * arrow starts, and to the woken task's track, right after the nap. PID 0
+ * is the idle task, i.e. the wakeup came from an interrupt, and gets none.
+ *
+ * @param table: Nap table of the stream
+ * @param sd: Stream identifier number, used as the process ID
+ * @param name: Name of the process, e.g. the trace file
+*/
+void NapChromeExport::add_stream(const NapTable& table, int sd,
+    std::string_view name)
+{
+    if (_finished) return;
+
+    _begin_event("M", sd, -1);
+    _put(",\"name\":\"process_name\",\"args\":{\"name\":");
+    _put_string(name);
+    _put("}");
+    _end_event();
+
+    std::vector<int32_t> pids;
+    pids.reserve(table.tasks().size());
+    for (const auto& [pid, task] : table.tasks()) pids.push_back(pid);
+    std::sort(pids.begin(), pids.end());
+
+    for (int32_t pid : pids) {
+        const NapTaskTable& task = *table.task(pid);
+
+        char* comm = kshark_comm_from_pid(sd, pid);
+        if (comm) {
+            _begin_event("M", sd, pid);
+            _put(",\"name\":\"thread_name\",\"args\":{\"name\":");
+            _put_string(comm);
+            _put("}");
+            _end_event();
+            free(comm);
+        }
+
+        for (size_t i = 0; i < task.size(); ++i) {
+            const char state[] = {task.state[i], '\0'};
+            _begin_event("X", sd, pid);
+            _put(",\"cat\":\"nap\",\"name\":");
+            _put_string(state);
+            _put(",\"ts\":");
+            _put_us(task.start[i]);
+            _put(",\"dur\":");
+            _put_us(task.end[i] - task.start[i]);
+            _put(",\"args\":{\"waker\":");
+            _put_int(task.waker[i]);
+            _put("}");
+            _end_event();
+            ++_n_naps;
+
+            if (!_flows || task.waker[i] <= 0) continue;
+
+            // Slices the arrow binds to, shortest Chrome JSON can describe
+            const int32_t tids[] = {task.waker[i], pid};
+            const char* const names[] = {"\"wakeup\"", "\"woken\""};
+            for (int side = 0; side < 2; ++side) {
+                _begin_event("X", sd, tids[side]);
+                _put(",\"cat\":\"wakeup\",\"name\":");
+                _put(names[side]);
+                _put(",\"ts\":");
+                _put_us(task.end[i]);
+                _put(",\"dur\":0.001");
+                _end_event();
+
+                // Start binds to the enclosing slice, end to the next one
+                _begin_event(side ? "f" : "s", sd, tids[side]);
+                _put(",\"cat\":\"wakeup\",\"name\":\"wakeup\",\"id\":");
+                _put_int(int64_t(_n_flows));
+                _put(",\"ts\":");
+                _put_us(task.end[i]);
+                _end_event();
+            }
+            ++_n_flows;
+        }
+    }
+}
+
+/**
+ * @brief Finishes the JSON document and writes out everything buffered.
+ * Further streams are ignored afterwards, the file may then be closed.
+ *
+ * @returns True if the whole document was written, false if writing into
+ * the file failed.
+*/
+bool NapChromeExport::finish() {
+    if (!_finished) {
+        _put("\n]}\n");
+        _flush();
+        _failed = (std::fflush(_out) != 0 || std::ferror(_out));
+        _finished = true;
+    }
+    return !_failed;
+}
+
+/**
+ * @brief Starts an event object with its phase, process and thread.
+ *
+ * @param phase: Phase of the event, e.g. "X" for a complete slice
+ * @param sd: Stream identifier number, i.e. the process ID
+ * @param tid: Thread ID, negative to leave it out
+*/
+void NapChromeExport::_begin_event(std::string_view phase, int sd,
+    int32_t tid)
+{
+    _put(_first_event ? "{\"ph\":\"" : ",\n{\"ph\":\"");
+    _first_event = false;
+    _put(phase);
+    _put("\",\"pid\":");
+    _put_int(sd);
+    if (tid >= 0) {
+        _put(",\"tid\":");
+        _put_int(tid);
+    }
+}
+
+/**
+ * @brief Ends an event object.
+*/
+void NapChromeExport::_end_event() {
+    _put("}");
+}
+
+/**
+ * @brief Appends text to the output, writing the buffer out when full.
+ *
+ * @param text: Text to append
+*/
+void NapChromeExport::_put(std::string_view text) {
+    if (_buffer.size() + text.size() > BUFFER_SIZE) _flush();
+
+    if (text.size() > BUFFER_SIZE) {
+        std::fwrite(text.data(), 1, text.size(), _out);
+        return;
+    }
+    _buffer.insert(_buffer.end(), text.begin(), text.end());
+}
+
+/**
+ * @brief Appends an integer to the output.
+ *
+ * @param value: The integer
+*/
+void NapChromeExport::_put_int(int64_t value) {
+    char digits[24];
+    const char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    _put(std::string_view(digits, size_t(end - digits)));
+}
+
+/**
+ * @brief Appends a time in microseconds, the unit of Chrome trace events,
+ * keeping nanosecond precision as three decimal places.
+ *
+ * @param ns: Time in nanoseconds
+*/
+void NapChromeExport::_put_us(int64_t ns) {
+    if (ns < 0) {
+        _put("-");
+        // Negating the smallest value would overflow, its precision is lost
+        ns = (ns == INT64_MIN) ? INT64_MAX : -ns;
+    }
+
+    _put_int(ns / 1000);
+    const int64_t fraction = ns % 1000;
+    const char decimals[] = {'.', char('0' + fraction / 100),
+                             char('0' + fraction / 10 % 10),
+                             char('0' + fraction % 10)};
+    _put(std::string_view(decimals, sizeof(decimals)));
+}
+
+/**
+ * @brief Appends a quoted JSON string, escaping quotes, backslashes and
+ * control characters.
+ *
+ * @param text: Unescaped text
+*/
+void NapChromeExport::_put_string(std::string_view text) {
+    static constexpr char HEX[] = "0123456789abcdef";
+
+    _put("\"");
+    size_t plain = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        const unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+        _put(text.substr(plain, i - plain));
+        if (c == '"' || c == '\\') {
+            const char escaped[] = {'\\', char(c)};
+            _put(std::string_view(escaped, sizeof(escaped)));
+        } else {
+            const char escaped[] = {'\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 0xf]};
+            _put(std::string_view(escaped, sizeof(escaped)));
+        }
+        plain = i + 1;
+    }
+    _put(text.substr(plain));
+    _put("\"");
+}
+
+/**
+ * @brief Writes buffered output into the file.
+*/
+void NapChromeExport::_flush() {
+    if (!_buffer.empty()) {
+        std::fwrite(_buffer.data(), 1, _buffer.size(), _out);
+        _buffer.clear();
+    }
+}
@@ -0,0 +1,90 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapExport.hpp
+ * @brief   Declaration of the export of naps into the Chrome trace event
+ *          JSON format, which Perfetto UI and chrome://tracing open.
+ *          Part of the Qt-free core of the plugin.
+ *
+ * @note    Definitions in `NapExport.cpp`.
+*/
+
+#ifndef _NR_NAP_EXPORT_HPP
+#define _NR_NAP_EXPORT_HPP
+
+// C
+#include <cstdint>
+#include <cstdio>
+
+// C++
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Plugin
+#include "NapTable.hpp"
+
+/**
+ * @brief Writer of naps of one or more streams as a Chrome trace event JSON
+ * file. Each stream is a process and each task a thread, with a duration
+ * slice per nap named by its prev_state. Wakeups with a known waker are
+ * drawn as flow arrows from the waker's track to the woken task's track.
+ *
+ * Events are streamed straight from nap tables through a fixed buffer, so
+ * memory used doesn't depend on the number of naps.
+*/
+class NapChromeExport {
+private: // Data members
+    ///
+    /// @brief Output file, not owned.
+    std::FILE* _out;
+    ///
+    /// @brief Buffer of not yet written output.
+    std::vector<char> _buffer;
+    ///
+    /// @brief Whether wakeups are exported as flow arrows.
+    bool _flows;
+    ///
+    /// @brief Whether no event was written yet, so no separator is needed.
+    bool _first_event{true};
+    ///
+    /// @brief Whether the closing of the JSON document was written.
+    bool _finished{false};
+    ///
+    /// @brief Whether writing into the file failed, known once finished.
+    bool _failed{false};
+    ///
+    /// @brief Number of exported naps.
+    uint64_t _n_naps{0};
+    ///
+    /// @brief Number of exported flow arrows, also the next flow's id.
+    uint64_t _n_flows{0};
+public: // Data members
+    ///
+    /// @brief Size of the output buffer, in bytes.
+    static constexpr size_t BUFFER_SIZE = size_t(1) << 16;
+public: // Functions
+    explicit NapChromeExport(std::FILE* out, bool flows = true);
+    ~NapChromeExport();
+    // Writes into a file, copying makes no sense
+    NapChromeExport(const NapChromeExport&) = delete;
+    NapChromeExport& operator=(const NapChromeExport&) = delete;
+
+    void add_stream(const NapTable& table, int sd, std::string_view name);
+    bool finish();
+
+    /// @brief Returns the number of exported naps.
+    uint64_t n_naps() const { return _n_naps; }
+    /// @brief Returns the number of exported flow arrows.
+    uint64_t n_flows() const { return _n_flows; }
+private: // Functions
+    void _begin_event(std::string_view phase, int sd, int32_t tid);
+    void _end_event();
+    void _put(std::string_view text);
+    void _put_int(int64_t value);
+    void _put_us(int64_t ns);
+    void _put_string(std::string_view text);
+    void _flush();
+};
+
+#endif // _NR_NAP_EXPORT_HPP
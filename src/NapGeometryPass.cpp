@@ -0,0 +1,234 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapGeometryPass.cpp
+ * @brief   Definitions of the parallel precomputation of nap geometry.
+*/
+
+// C++
+#include <algorithm>
+
+// Plugin headers
+#include "NapGeometryPass.hpp"
+#include "NapThreadPool.hpp"
+
+// Static variables
+
+///
+/// @brief Number of chunks per worker, more chunks balance the load better.
+static constexpr size_t CHUNKS_PER_WORKER = 4;
+
+// Member functions
+
+/**
+ * @brief Gets the geometry pass of a plugin context, creating it first
+ * if it doesn't exist yet.
+ *
+ * @param ctx: Pointer to the plugin's context
+ *
+ * @returns Pointer to the geometry pass or null if there's no context.
+*/
+NapGeometryPass* NapGeometryPass::from_context(plugin_naps_context* ctx) {
+    if (!ctx) return nullptr;
+
+    if (!ctx->geometry_pass) {
+        ctx->geometry_pass = new NapGeometryPass{};
+    }
+
+    return ctx->geometry_pass;
+}
+
+/**
+ * @brief Destructor of the pass, waits for jobs still using its data.
+*/
+NapGeometryPass::~NapGeometryPass() {
+    _wait_all();
+}
+
+/**
+ * @brief Gets geometry of naps of a task plot. Starts a new pass, if the
+ * view changed since the last call.
+ *
+ * @param table: Nap table of the drawn stream
+ * @param view: View of the drawn plot
+ * @param x_origin: Horizontal position of the first bin, in pixels
+ * @param bin_width: Width of a bin, in pixels
+ * @param pid: PID of the task of the drawn plot
+ *
+ * @returns Pointer to the geometry, valid until the next call, or null
+ * if the task has no naps.
+*/
+const NapGeometry* NapGeometryPass::get(const NapTable& table,
+    const NapView& view, int x_origin, int bin_width, int32_t pid)
+{
+    if (!_is_same_pass(table, view, x_origin, bin_width)) {
+        _start_pass(table, view, x_origin, bin_width);
+    }
+    _drawn.insert(pid);
+
+    const NapTaskTable* task = table.task(pid);
+    if (!task) return nullptr;
+
+    auto chunk_idx = _chunk_of.find(pid);
+    if (chunk_idx == _chunk_of.end()) {
+        naps_geometry(*task, view, x_origin, bin_width, _on_demand);
+        return &_on_demand;
+    }
+
+    // Help instead of waiting, if no worker got to the chunk yet
+    Chunk& chunk = *_chunks[chunk_idx->second];
+    if (!chunk.claimed.exchange(true)) {
+        _compute(chunk);
+    } else {
+        chunk.ready.wait();
+    }
+
+    return &_results.find(pid)->second;
+}
+
+/**
+ * @brief Gets bytes of memory used by precomputed geometry.
+ *
+ * @returns Number of bytes used by the pass, including the object itself.
+*/
+size_t NapGeometryPass::mem_usage() const {
+    auto geometry_bytes = [](const NapGeometry& geometry) {
+        return geometry.idx.capacity() * sizeof(uint32_t)
+            + (geometry.start_bin.capacity() + geometry.end_bin.capacity()
+               + geometry.x_start.capacity() + geometry.x_end.capacity())
+              * sizeof(int32_t);
+    };
+
+    size_t bytes = sizeof(*this) + geometry_bytes(_on_demand)
+        + _chunks.size() * sizeof(Chunk)
+        + _drawn.size() * 2 * sizeof(void*)
+        + _chunk_of.size() * 4 * sizeof(void*);
+    for (const auto& [pid, geometry] : _results) {
+        bytes += sizeof(geometry) + 2 * sizeof(void*) + geometry_bytes(geometry);
+    }
+    return bytes;
+}
+
+/**
+ * @brief Checks whether a request belongs to the current pass.
+ *
+ * @returns True if the table (and its generation), the view and the pixel
+ * mapping are the same.
+*/
+bool NapGeometryPass::_is_same_pass(const NapTable& table,
+    const NapView& view, int x_origin, int bin_width) const
+{
+    return _table == &table && _generation == table.generation()
+        && _view.min == view.min && _view.max == view.max
+        && _view.bin_size == view.bin_size && _view.n_bins == view.n_bins
+        && _x_origin == x_origin && _bin_width == bin_width;
+}
+
+/**
+ * @brief Starts a new pass, submitting jobs which compute geometry of all
+ * task plots drawn during the previous pass. Tasks with most naps are dealt
+ * into chunks first, so that chunks have similar amounts of work.
+ *
+ * @param table: Nap table of the drawn stream
+ * @param view: View of the new pass
+ * @param x_origin: Horizontal position of the first bin, in pixels
+ * @param bin_width: Width of a bin, in pixels
+*/
+void NapGeometryPass::_start_pass(const NapTable& table, const NapView& view,
+    int x_origin, int bin_width)
+{
+    _wait_all();
+    _chunks.clear();
+    _chunk_of.clear();
+    _results.clear();
+
+    std::vector<int32_t> pids;
+    pids.reserve(_drawn.size());
+    for (int32_t pid : _drawn) {
+        const NapTaskTable* task = table.task(pid);
+        if (task && task->size()) pids.push_back(pid);
+    }
+    _drawn.clear();
+
+    _table = &table;
+    _generation = table.generation();
+    _view = view;
+    _x_origin = x_origin;
+    _bin_width = bin_width;
+
+    NapThreadPool& pool = NapThreadPool::get_instance();
+    if (pids.size() < 2 || !pool.size()) return;
+
+    std::sort(pids.begin(), pids.end(), [&](int32_t a, int32_t b) {
+        return table.task(a)->size() > table.task(b)->size();
+    });
+
+    const size_t n_chunks = std::min(pids.size(),
+        (pool.size() + 1) * CHUNKS_PER_WORKER);
+    _chunks.reserve(n_chunks);
+    for (size_t i = 0; i < n_chunks; ++i) {
+        _chunks.push_back(std::make_unique<Chunk>());
+    }
+
+    for (size_t i = 0; i < pids.size(); ++i) {
+        _chunks[i % n_chunks]->pids.push_back(pids[i]);
+        _chunk_of[pids[i]] = i % n_chunks;
+        _results[pids[i]];
+    }
+
+    for (auto& chunk : _chunks) {
+        Chunk* job_chunk = chunk.get();
+        chunk->done = pool.submit([this, job_chunk]() {
+            if (!job_chunk->claimed.exchange(true)) _compute(*job_chunk);
+        });
+    }
+}
+
+/**
+ * @brief Computes geometry of all task plots of a chunk and announces
+ * that it's ready.
+ *
+ * @param chunk: The chunk, already claimed by the calling thread
+*/
+void NapGeometryPass::_compute(Chunk& chunk) {
+    for (int32_t pid : chunk.pids) {
+        naps_geometry(*_table->task(pid), _view, _x_origin, _bin_width,
+            _results.find(pid)->second);
+    }
+    chunk.computed.set_value();
+}
+
+/**
+ * @brief Waits for all submitted jobs of the pass, running queued jobs
+ * meanwhile, as the pass's jobs may be queued behind builds of nap tables.
+ *
+ * @note A chunk claimed by the GUI thread is done once its job returns.
+*/
+void NapGeometryPass::_wait_all() {
+    NapThreadPool& pool = NapThreadPool::get_instance();
+    for (auto& chunk : _chunks) {
+        if (chunk->done.valid()) pool.wait(chunk->done);
+    }
+}
+
+// Functions defined in C header
+
+/**
+ * @brief Frees a geometry pass, used when the plugin's context is freed.
+ *
+ * @param pass: Pointer to the geometry pass to free (may be null)
+*/
+void naps_free_geometry_pass(struct NapGeometryPass* pass) {
+    delete pass;
+}
+
+/**
+ * @brief Gets bytes of memory used by a geometry pass.
+ *
+ * @param pass: Pointer to the geometry pass (may be null)
+ *
+ * @returns Number of bytes used by the pass, zero if there is none.
+*/
+size_t naps_geometry_pass_mem_usage(const struct NapGeometryPass* pass) {
+    return pass ? pass->mem_usage() : 0;
+}
@@ -0,0 +1,113 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapGeometryPass.hpp
+ * @brief   Declaration of the precomputation of nap geometry for all task
+ *          plots of a redraw, in parallel. Part of the Qt-free core.
+ *
+ * @note    Definitions in `NapGeometryPass.cpp`.
+*/
+
+#ifndef _NR_NAP_GEOMETRY_PASS_HPP
+#define _NR_NAP_GEOMETRY_PASS_HPP
+
+// C++
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Plugin
+#include "naps_core.h"
+#include "NapTable.hpp"
+#include "NapView.hpp"
+
+/**
+ * @brief Geometry of naps of all task plots drawn with the same view,
+ * i.e. during one or more redraws of a stream's plots.
+ *
+ * KernelShark asks for task plots one after another on the GUI thread.
+ * The first request with a new view starts a new pass - geometry for every
+ * task plot drawn during the previous pass is computed in parallel by the
+ * plugin's thread pool. Later requests just pick up ready results, waiting
+ * only if their plot is still being worked on. Plots not drawn before are
+ * computed right away and remembered for the next pass.
+*/
+class NapGeometryPass {
+private: // Types
+    /**
+     * @brief Task plots computed together by one job.
+    */
+    struct Chunk {
+        ///
+        /// @brief PIDs of the chunk's tasks.
+        std::vector<int32_t> pids;
+        ///
+        /// @brief Whether the chunk was already taken by a thread.
+        std::atomic<bool> claimed{false};
+        ///
+        /// @brief Fulfilled by the thread which computed the chunk.
+        std::promise<void> computed;
+        ///
+        /// @brief Becomes ready once the chunk's geometry is computed.
+        std::shared_future<void> ready{computed.get_future().share()};
+        ///
+        /// @brief Becomes ready once the chunk's job has finished.
+        std::future<void> done;
+    };
+private: // Data members
+    ///
+    /// @brief Nap table the pass computes geometry from.
+    const NapTable* _table = nullptr;
+    ///
+    /// @brief Generation of the nap table, changes when it's extended.
+    uint64_t _generation{0};
+    ///
+    /// @brief View of the pass.
+    NapView _view{};
+    ///
+    /// @brief Horizontal position of the first bin, in pixels.
+    int _x_origin{0};
+    ///
+    /// @brief Width of a bin, in pixels.
+    int _bin_width{0};
+    ///
+    /// @brief Chunks of task plots computed in parallel.
+    std::vector<std::unique_ptr<Chunk>> _chunks;
+    ///
+    /// @brief Index of the chunk of each precomputed task, keyed by PID.
+    std::unordered_map<int32_t, size_t> _chunk_of;
+    ///
+    /// @brief Precomputed geometry, keyed by PID. Created before jobs start,
+    /// so that jobs only ever write into their own entries.
+    std::unordered_map<int32_t, NapGeometry> _results;
+    ///
+    /// @brief Geometry of a plot which wasn't precomputed.
+    NapGeometry _on_demand;
+    ///
+    /// @brief PIDs of task plots drawn during the pass.
+    std::unordered_set<int32_t> _drawn;
+public: // Functions
+    static NapGeometryPass* from_context(plugin_naps_context* ctx);
+
+    const NapGeometry* get(const NapTable& table, const NapView& view,
+        int x_origin, int bin_width, int32_t pid);
+    size_t mem_usage() const;
+
+    NapGeometryPass() = default;
+    NapGeometryPass(const NapGeometryPass&) = delete;
+    NapGeometryPass& operator=(const NapGeometryPass&) = delete;
+    ~NapGeometryPass();
+private: // Functions
+    bool _is_same_pass(const NapTable& table, const NapView& view,
+        int x_origin, int bin_width) const;
+    void _start_pass(const NapTable& table, const NapView& view,
+        int x_origin, int bin_width);
+    void _compute(Chunk& chunk);
+    void _wait_all();
+};
+
+#endif // _NR_NAP_GEOMETRY_PASS_HPP
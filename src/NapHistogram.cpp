@@ -0,0 +1,136 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapHistogram.cpp
+ * @brief   Definitions of the plugin's streaming histogram of nap durations.
+*/
+
+// C++
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+// Plugin headers
+#include "NapHistogram.hpp"
+
+// Static variables
+
+///
+/// @brief Number of buckets with exact values, also buckets per power of two
+/// times two.
+static constexpr uint32_t SUB_BUCKETS = 1u << NapHistogram::SUB_BUCKET_BITS;
+
+///
+/// @brief Number of buckets per power of two above the exact ones.
+static constexpr uint32_t HALF_SUB_BUCKETS = SUB_BUCKETS / 2;
+
+// Member functions
+
+/**
+ * @brief Gets the bucket of a value. Negative values count as zero.
+ *
+ * @param value: The value
+ *
+ * @returns Index of the bucket.
+*/
+uint32_t NapHistogram::bucket_of(int64_t value) {
+    const uint64_t v = uint64_t(std::max<int64_t>(value, 0));
+    if (v < SUB_BUCKETS) return uint32_t(v);
+
+    // Keep SUB_BUCKET_BITS most significant bits, the top one is always set
+    const int shift = std::bit_width(v) - NapHistogram::SUB_BUCKET_BITS;
+    return uint32_t(shift) * HALF_SUB_BUCKETS + uint32_t(v >> shift);
+}
+
+/**
+ * @brief Gets the largest value of a bucket.
+ *
+ * @param bucket: Index of the bucket
+ *
+ * @returns The largest value which falls into the bucket.
+*/
+int64_t NapHistogram::bucket_max(uint32_t bucket) {
+    if (bucket < SUB_BUCKETS) return int64_t(bucket);
+
+    const uint32_t shift = bucket / HALF_SUB_BUCKETS - 1;
+    const uint64_t mantissa = bucket % HALF_SUB_BUCKETS + HALF_SUB_BUCKETS;
+    return int64_t(((mantissa + 1) << shift) - 1);
+}
+
+/**
+ * @brief Records a value.
+ *
+ * @param value: The value, e.g. duration of a nap in nanoseconds
+*/
+void NapHistogram::record(int64_t value) {
+    _min = _total ? std::min(_min, value) : value;
+    _max = _total ? std::max(_max, value) : value;
+    ++_total;
+    _add(bucket_of(value), 1);
+}
+
+/**
+ * @brief Adds all values of another histogram to this one.
+ *
+ * @param other: The other histogram
+*/
+void NapHistogram::merge(const NapHistogram& other) {
+    if (!other._total) return;
+
+    _min = _total ? std::min(_min, other._min) : other._min;
+    _max = _total ? std::max(_max, other._max) : other._max;
+    _total += other._total;
+    for (size_t i = 0; i < other._counts.size(); ++i) {
+        if (other._counts[i]) {
+            _add(other._first_bucket + uint32_t(i), other._counts[i]);
+        }
+    }
+}
+
+/**
+ * @brief Gets the value at a percentile, i.e. the largest value of the
+ * bucket which holds the value at the percentile, but never more than
+ * the largest recorded value.
+ *
+ * @param percent: The percentile, between 0 and 100
+ *
+ * @returns Value at the percentile, zero if no value was recorded.
+*/
+int64_t NapHistogram::percentile(double percent) const {
+    if (!_total) return 0;
+
+    const double clamped = std::clamp(percent, 0.0, 100.0);
+    const uint64_t rank = std::max<uint64_t>(1,
+        uint64_t(std::ceil(clamped / 100.0 * double(_total))));
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < _counts.size(); ++i) {
+        seen += _counts[i];
+        if (seen >= rank) {
+            return std::clamp(bucket_max(_first_bucket + uint32_t(i)),
+                _min, _max);
+        }
+    }
+    return _max;
+}
+
+/**
+ * @brief Adds to the count of a bucket, extending the allocated range
+ * of buckets if needed.
+ *
+ * @param bucket: Index of the bucket
+ * @param count: Number of values to add
+*/
+void NapHistogram::_add(uint32_t bucket, uint32_t count) {
+    if (_counts.empty()) {
+        _first_bucket = bucket;
+        _counts.push_back(0);
+    } else if (bucket < _first_bucket) {
+        _counts.insert(_counts.begin(), _first_bucket - bucket, 0);
+        _first_bucket = bucket;
+    } else if (bucket >= _first_bucket + _counts.size()) {
+        _counts.resize(bucket - _first_bucket + 1, 0);
+    }
+
+    _counts[bucket - _first_bucket] += count;
+}
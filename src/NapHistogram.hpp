@@ -0,0 +1,71 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapHistogram.hpp
+ * @brief   Declaration of the plugin's streaming histogram of nap durations
+ *          with log-linear buckets, in the style of HDR histograms. Part of
+ *          the Qt-free core of the plugin.
+ *
+ * @note    Definitions in `NapHistogram.cpp`.
+*/
+
+#ifndef _NR_NAP_HISTOGRAM_HPP
+#define _NR_NAP_HISTOGRAM_HPP
+
+// C++
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Histogram of durations, maintained as values are recorded, which
+ * answers percentile queries without keeping the values.
+ *
+ * Buckets are log-linear - values below `2^SUB_BUCKET_BITS` have a bucket
+ * each, every further power of two is split into `2^(SUB_BUCKET_BITS - 1)`
+ * equally wide buckets. A bucket is thus at most 1/16 of its values wide and
+ * percentiles are accurate to that, regardless of the magnitude. Only the
+ * range of buckets between the smallest and the largest value is allocated.
+*/
+class NapHistogram {
+private: // Data members
+    ///
+    /// @brief Counts of values in the allocated buckets.
+    std::vector<uint32_t> _counts;
+    ///
+    /// @brief Bucket of the first allocated count.
+    uint32_t _first_bucket{0};
+    ///
+    /// @brief Number of recorded values.
+    uint64_t _total{0};
+    ///
+    /// @brief Smallest recorded value.
+    int64_t _min{0};
+    ///
+    /// @brief Largest recorded value.
+    int64_t _max{0};
+public: // Data members
+    ///
+    /// @brief Bits of precision of a bucket within its power of two.
+    static constexpr int SUB_BUCKET_BITS = 5;
+public: // Functions
+    void record(int64_t value);
+    void merge(const NapHistogram& other);
+    int64_t percentile(double percent) const;
+
+    /// @brief Returns the number of recorded values.
+    uint64_t count() const { return _total; }
+    /// @brief Returns the smallest recorded value, zero if there's none.
+    int64_t min() const { return _min; }
+    /// @brief Returns the largest recorded value, zero if there's none.
+    int64_t max() const { return _max; }
+    /// @brief Returns bytes of heap memory used by the buckets.
+    size_t mem_usage() const { return _counts.capacity() * sizeof(uint32_t); }
+
+    static uint32_t bucket_of(int64_t value);
+    static int64_t bucket_max(uint32_t bucket);
+private: // Functions
+    void _add(uint32_t bucket, uint32_t count);
+};
+
+#endif // _NR_NAP_HISTOGRAM_HPP
@@ -0,0 +1,209 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapLabelAtlas.cpp
+ * @brief   Definitions of the glyph atlas of the plugin's bold font.
+*/
+
+// C
+#include <cmath>
+#include <cstdio>
+
+// C++
+#include <vector>
+
+// OpenGL
+#include <GL/gl.h>
+
+// KernelShark's copy of stb_truetype, compiled privately for this file, as
+// KernelShark doesn't export its own. Its static functions this file doesn't
+// use would warn.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#define STB_TRUETYPE_IMPLEMENTATION
+#define STBTT_STATIC
+#include "stb_truetype.h"
+#pragma GCC diagnostic pop
+
+// Plugin headers
+#include "naps.h"
+#include "NapLabelAtlas.hpp"
+
+// Static functions
+
+/**
+ * @brief Reads a whole file into memory.
+ *
+ * @param path: Path to the file
+ * @param data: Filled contents of the file
+ *
+ * @returns True on success, false if the file couldn't be read.
+*/
+static bool _read_file(const char* path, std::vector<unsigned char>& data) {
+    std::FILE* file = std::fopen(path, "rb");
+    if (!file) return false;
+
+    unsigned char chunk[1 << 16];
+    size_t n_read;
+    while ((n_read = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + n_read);
+    }
+    const bool is_ok = !std::ferror(file) && !data.empty();
+    std::fclose(file);
+    return is_ok;
+}
+
+// Member functions
+
+/**
+ * @brief Gets the atlas. Utilizes Meyers singleton creation (static
+ * local variable).
+ *
+ * @returns Reference to the atlas.
+*/
+NapLabelAtlas& NapLabelAtlas::get_instance() {
+    static NapLabelAtlas instance;
+    return instance;
+}
+
+/**
+ * @brief Rasterizes glyphs of the bold font into the atlas texture, only
+ * once. Must be called with KernelShark's OpenGL context current.
+ *
+ * @returns True if the atlas can be drawn, false if the font couldn't be
+ * found or rasterized.
+*/
+bool NapLabelAtlas::load() {
+    if (_tried) return _texture != 0;
+    _tried = true;
+
+    const char* path = get_bold_font_path();
+    std::vector<unsigned char> font;
+    if (!path || !_read_file(path, font)) return false;
+
+    // Same size as KernelShark's text boxes of the bold font
+    std::vector<unsigned char> bitmap(ATLAS_SIZE * ATLAS_SIZE);
+    stbtt_bakedchar baked[N_CHARS];
+    if (stbtt_BakeFontBitmap(font.data(), 0, BOLD_FONT_SIZE, bitmap.data(),
+        ATLAS_SIZE, ATLAS_SIZE, FIRST_CHAR, N_CHARS, baked) <= 0) {
+        return false;
+    }
+
+    for (int i = 0; i < N_CHARS; ++i) {
+        const stbtt_bakedchar& b = baked[i];
+        _glyphs[i] = Glyph{b.xoff, b.yoff, float(b.x1 - b.x0),
+            float(b.y1 - b.y0), b.x0 / float(ATLAS_SIZE),
+            b.y0 / float(ATLAS_SIZE), b.x1 / float(ATLAS_SIZE),
+            b.y1 / float(ATLAS_SIZE), b.xadvance};
+    }
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    if (!texture) return false;
+
+    // Rows of the bitmap are tightly packed, other uploads are left as is
+    GLint alignment = 4;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, ATLAS_SIZE, ATLAS_SIZE, 0,
+        GL_ALPHA, GL_UNSIGNED_BYTE, bitmap.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+
+    _texture = texture;
+    return true;
+}
+
+/**
+ * @brief Deletes the atlas texture, so that the next drawn label rasterizes
+ * it again. Must be called with the OpenGL context the atlas was loaded in
+ * current.
+*/
+void NapLabelAtlas::unload() {
+    if (_texture) glDeleteTextures(1, &_texture);
+    _texture = 0;
+    _tried = false;
+}
+
+/**
+ * @brief Gets the width of a text drawn from the atlas.
+ *
+ * @param text: Drawn text, characters outside printable ASCII are skipped
+ *
+ * @returns Sum of advances of the text's glyphs, in pixels.
+*/
+float NapLabelAtlas::text_width(const char* text) const {
+    float width = 0.f;
+    for (; *text; ++text) {
+        const int idx = int(*text) - FIRST_CHAR;
+        if (idx < 0 || idx >= N_CHARS) continue;
+        width += _glyphs[idx].advance;
+    }
+    return width;
+}
+
+/**
+ * @brief Appends quads of a text's glyphs to vertices drawn at once later.
+ * Quads are snapped to whole pixels, the same way KernelShark's text boxes
+ * place them.
+ *
+ * @param text: Drawn text, characters outside printable ASCII are skipped
+ * @param x: Horizontal position of the text's start
+ * @param y: Vertical position of the text's baseline
+ * @param red: Red component of the text's color
+ * @param green: Green component of the text's color
+ * @param blue: Blue component of the text's color
+ * @param vertices: Vertices to append to, four per glyph
+*/
+void NapLabelAtlas::append(const char* text, float x, float y, uint8_t red,
+    uint8_t green, uint8_t blue, std::vector<NapGlyphVertex>& vertices) const
+{
+    for (; *text; ++text) {
+        const int idx = int(*text) - FIRST_CHAR;
+        if (idx < 0 || idx >= N_CHARS) continue;
+
+        const Glyph& g = _glyphs[idx];
+        const float x0 = std::floor(x + g.x_off + 0.5f);
+        const float y0 = std::floor(y + g.y_off + 0.5f);
+        const float x1 = x0 + g.width, y1 = y0 + g.height;
+        vertices.push_back({x0, y0, g.s0, g.t0, {red, green, blue, 255}});
+        vertices.push_back({x1, y0, g.s1, g.t0, {red, green, blue, 255}});
+        vertices.push_back({x1, y1, g.s1, g.t1, {red, green, blue, 255}});
+        vertices.push_back({x0, y1, g.s0, g.t1, {red, green, blue, 255}});
+        x += g.advance;
+    }
+}
+
+/**
+ * @brief Draws quads of appended texts in a single draw call, with the same
+ * blending KernelShark's text boxes use.
+ *
+ * @param vertices: Vertices of the quads, four per glyph
+*/
+void NapLabelAtlas::draw(const std::vector<NapGlyphVertex>& vertices) const {
+    if (!_texture || vertices.empty()) return;
+
+    glEnable(GL_TEXTURE_2D);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBindTexture(GL_TEXTURE_2D, _texture);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    const GLsizei stride = sizeof(NapGlyphVertex);
+    glVertexPointer(2, GL_FLOAT, stride, &vertices[0].x);
+    glTexCoordPointer(2, GL_FLOAT, stride, &vertices[0].s);
+    glColorPointer(4, GL_UNSIGNED_BYTE, stride, vertices[0].rgba);
+
+    glDrawArrays(GL_QUADS, 0, GLsizei(vertices.size()));
+
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
+}
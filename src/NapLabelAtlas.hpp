@@ -0,0 +1,110 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapLabelAtlas.hpp
+ * @brief   Declaration of the glyph atlas of the plugin's bold font, which
+ *          draws labels of many nap rectangles in a single draw call.
+ *
+ * @note    Definitions in `NapLabelAtlas.cpp`.
+*/
+
+#ifndef _NR_NAP_LABEL_ATLAS_HPP
+#define _NR_NAP_LABEL_ATLAS_HPP
+
+// C++
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Corner of a glyph's quad - its position on the screen, position
+ * in the atlas and color of the text.
+*/
+struct NapGlyphVertex {
+    ///
+    /// @brief Horizontal position on the screen.
+    float x;
+    ///
+    /// @brief Vertical position on the screen.
+    float y;
+    ///
+    /// @brief Horizontal position in the atlas, from 0 to 1.
+    float s;
+    ///
+    /// @brief Vertical position in the atlas, from 0 to 1.
+    float t;
+    ///
+    /// @brief Color of the text, RGBA.
+    uint8_t rgba[4];
+};
+
+/**
+ * @brief Singleton texture holding pre-rasterized glyphs of printable ASCII
+ * characters of the bold font, the same font and size KernelShark's text
+ * boxes of nap rectangles use.
+ *
+ * Drawing a text box binds the font's texture and draws its glyphs on its
+ * own, so labels of a busy task plot cost a round of OpenGL state changes
+ * each. With the atlas, quads of all labels of a plot are appended into one
+ * array of vertices and drawn at once.
+ *
+ * The atlas is rasterized when the first label is drawn, i.e. with
+ * KernelShark's OpenGL context current, and kept until the plot plugin is
+ * deinitialized or KernelShark's OpenGL context is destroyed, whichever
+ * comes first.
+*/
+class NapLabelAtlas {
+private: // Types
+    /**
+     * @brief Placement of a rasterized glyph.
+    */
+    struct Glyph {
+        ///
+        /// @brief Offset of the glyph's quad from the pen, in pixels.
+        float x_off, y_off;
+        ///
+        /// @brief Size of the glyph's quad, in pixels.
+        float width, height;
+        ///
+        /// @brief Corners of the glyph in the atlas, from 0 to 1.
+        float s0, t0, s1, t1;
+        ///
+        /// @brief Horizontal advance of the pen after the glyph, in pixels.
+        float advance;
+    };
+private: // Data members
+    ///
+    /// @brief First rasterized character.
+    static constexpr int FIRST_CHAR = 32;
+    ///
+    /// @brief Number of rasterized characters, i.e. printable ASCII.
+    static constexpr int N_CHARS = 95;
+    ///
+    /// @brief Side of the square atlas, in pixels.
+    static constexpr int ATLAS_SIZE = 256;
+    ///
+    /// @brief Placements of the rasterized glyphs.
+    Glyph _glyphs[N_CHARS]{};
+    ///
+    /// @brief OpenGL name of the atlas texture, zero if there's none.
+    unsigned int _texture{0};
+    ///
+    /// @brief Whether rasterization was already attempted.
+    bool _tried{false};
+public: // Functions
+    static NapLabelAtlas& get_instance();
+    bool load();
+    void unload();
+    float text_width(const char* text) const;
+    void append(const char* text, float x, float y, uint8_t red,
+        uint8_t green, uint8_t blue,
+        std::vector<NapGlyphVertex>& vertices) const;
+    void draw(const std::vector<NapGlyphVertex>& vertices) const;
+
+    NapLabelAtlas(const NapLabelAtlas&) = delete;
+    NapLabelAtlas& operator=(const NapLabelAtlas&) = delete;
+private: // Functions
+    /// @brief Default constructor, hidden to enforce singleton pattern.
+    NapLabelAtlas() = default;
+};
+
+#endif // _NR_NAP_LABEL_ATLAS_HPP
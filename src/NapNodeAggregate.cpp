@@ -0,0 +1,382 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapNodeAggregate.cpp
+ * @brief   Definitions of aggregates of naps per NUMA node.
+*/
+
+// C++
+#include <algorithm>
+#include <numeric>
+
+// Plugin headers
+#include "NapNodeAggregate.hpp"
+
+// Static functions
+
+/**
+ * @brief Adds loads of naps of CPUs visible in a view. The part of a nap
+ * in its first and last bin is added to those bins directly, bins it
+ * covers whole are counted by changes at their ends, summed up later.
+ * Parts of naps before the first computed bin are left out.
+ *
+ * @param cpus: Naps per CPU
+ * @param cpu_ids: CPUs whose naps are added
+ * @param view: View of the drawn plot
+ * @param from_bin: First computed bin
+ * @param partial: Parts of bins covered, `NAP_N_STATES` values per bin
+ * @param deltas: Changes of counts of whole covered bins, `NAP_N_STATES`
+ * values per bin
+*/
+static void _add_loads(const std::vector<NapCpuNaps>& cpus,
+    const std::vector<int>& cpu_ids, const NapView& view, int from_bin,
+    std::vector<double>& partial, std::vector<int32_t>& deltas)
+{
+    const double bin_size = double(view.bin_size);
+    const int64_t from_ts = view.min + from_bin * view.bin_size;
+
+    for (int cpu : cpu_ids) {
+        const NapCpuNaps& naps = cpus[size_t(cpu)];
+
+        auto [first, last] = naps.in_range(from_ts, view.max);
+        for (size_t i = first; i < last; ++i) {
+            const int state = naps_state_index(naps.state[i]);
+            const int64_t from = std::max(naps.start[i], from_ts);
+            const int64_t to = std::min(naps.end[i], view.max);
+            if (state < 0 || to <= from) continue;
+
+            const int start_bin = view.bin(from);
+            const int end_bin = view.bin(to);
+            const size_t at = size_t(start_bin) * NAP_N_STATES + size_t(state);
+            if (start_bin == end_bin) {
+                partial[at] += double(to - from) / bin_size;
+                continue;
+            }
+
+            const int64_t start_bin_end = view.min
+                + (start_bin + 1) * view.bin_size;
+            const int64_t end_bin_start = view.min + end_bin * view.bin_size;
+            partial[at] += double(start_bin_end - from) / bin_size;
+            partial[size_t(end_bin) * NAP_N_STATES + size_t(state)]
+                += double(to - end_bin_start) / bin_size;
+
+            ++deltas[size_t(start_bin + 1) * NAP_N_STATES + size_t(state)];
+            --deltas[size_t(end_bin) * NAP_N_STATES + size_t(state)];
+        }
+    }
+}
+
+// Global functions
+
+/**
+ * @brief Computes a band of a NUMA node. The node's CPUs are split into
+ * chunks with similar numbers of naps, whose loads are found in parallel
+ * and then summed up in one sweep over the bins. Bins before the first
+ * computed one are kept as they are, if the band is of the same view.
+ *
+ * @param cpus: Naps per CPU
+ * @param topology: Mapping of CPUs to nodes
+ * @param node: Number of the node
+ * @param view: View of the drawn plot
+ * @param band: Computed band
+ * @param from_bin: First computed bin
+*/
+void naps_node_band(const std::vector<NapCpuNaps>& cpus,
+    const NapTopology& topology, int node, const NapView& view,
+    NapNodeBand& band, int from_bin)
+{
+    const size_t n_bins = size_t(std::max(view.n_bins, 0));
+    if (from_bin <= 0 || band.loads.size() != n_bins * NAP_N_STATES) {
+        from_bin = 0;
+    }
+    from_bin = std::min(from_bin, int(n_bins));
+
+    band.view = view;
+    band.loads.resize(n_bins * NAP_N_STATES);
+    std::fill(band.loads.begin() + size_t(from_bin) * NAP_N_STATES,
+              band.loads.end(), 0.0f);
+
+    std::vector<std::pair<size_t, int>> by_size;
+    for (size_t cpu = 0; cpu < cpus.size(); ++cpu) {
+        if (topology.node_of(int(cpu)) == node && cpus[cpu].size()) {
+            by_size.emplace_back(cpus[cpu].size(), int(cpu));
+        }
+    }
+    if (!n_bins || view.bin_size <= 0 || by_size.empty()) {
+        band.max_total = 0;
+        return;
+    }
+
+    const std::vector<std::vector<int>> chunks = naps_balance_chunks(
+        std::move(by_size));
+    std::vector<std::vector<double>> partial(chunks.size(),
+        std::vector<double>(n_bins * NAP_N_STATES, 0.0));
+    std::vector<std::vector<int32_t>> deltas(chunks.size(),
+        std::vector<int32_t>(n_bins * NAP_N_STATES, 0));
+    naps_run_chunks(chunks.size(), [&](size_t c) {
+        _add_loads(cpus, chunks[c], view, from_bin, partial[c], deltas[c]);
+    });
+
+    // Sweep over the bins, summing up loads of all chunks
+    int32_t running[NAP_N_STATES] = {};
+    for (size_t bin = size_t(from_bin); bin < n_bins; ++bin) {
+        for (size_t s = 0; s < NAP_N_STATES; ++s) {
+            const size_t at = bin * NAP_N_STATES + s;
+            double value = 0;
+            for (size_t c = 0; c < chunks.size(); ++c) {
+                running[s] += deltas[c][at];
+                value += partial[c][at];
+            }
+            band.loads[at] = float(value + running[s]);
+        }
+    }
+
+    band.max_total = 0;
+    for (size_t bin = 0; bin < n_bins; ++bin) {
+        float total = 0;
+        for (size_t s = 0; s < NAP_N_STATES; ++s) total += band.load(int(bin), s);
+        band.max_total = std::max(band.max_total, total);
+    }
+}
+
+// Member functions
+
+/**
+ * @brief Finds naps of the CPU which reach into a time range.
+ *
+ * @param min_ts: Start of the range
+ * @param max_ts: End of the range
+ *
+ * @returns Indices of the first nap ending after the range's start, or of
+ * a nap before it, and one past the last nap starting before its end.
+*/
+std::pair<size_t, size_t> NapCpuNaps::in_range(int64_t min_ts,
+    int64_t max_ts) const
+{
+    const size_t first = size_t(std::upper_bound(reach.begin(), reach.end(),
+        min_ts) - reach.begin());
+    const size_t last = size_t(std::lower_bound(start.begin(), start.end(),
+        max_ts) - start.begin());
+    return {first, std::max(first, last)};
+}
+
+/**
+ * @brief Merges naps into the CPU's naps, keeping them ordered by start.
+ * Added naps usually start late, so only naps starting after the earliest
+ * added one are moved and their running maxima of ends recomputed.
+ *
+ * @param added: Naps to add, in any order, without running maxima
+*/
+void NapCpuNaps::merge(const NapCpuNaps& added) {
+    if (!added.size()) return;
+
+    std::vector<size_t> order(added.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&added](size_t a, size_t b) {
+        return added.start[a] < added.start[b];
+    });
+
+    // Naps from here on are merged with the added ones
+    const size_t from = size_t(std::upper_bound(start.begin(), start.end(),
+        added.start[order.front()]) - start.begin());
+    NapCpuNaps tail;
+    tail.start.assign(start.begin() + from, start.end());
+    tail.end.assign(end.begin() + from, end.end());
+    tail.state.assign(state.begin() + from, state.end());
+    start.resize(from);
+    end.resize(from);
+    state.resize(from);
+    reach.resize(from);
+
+    const auto push = [this](int64_t nap_start, int64_t nap_end, char nap_state) {
+        start.push_back(nap_start);
+        end.push_back(nap_end);
+        state.push_back(nap_state);
+        reach.push_back(reach.empty() ? nap_end : std::max(reach.back(), nap_end));
+    };
+
+    size_t i = 0, j = 0;
+    while (i < tail.size() || j < order.size()) {
+        // Naps already indexed go first on ties
+        if (j == order.size()
+            || (i < tail.size() && tail.start[i] <= added.start[order[j]])) {
+            push(tail.start[i], tail.end[i], tail.state[i]);
+            ++i;
+        } else {
+            push(added.start[order[j]], added.end[order[j]], added.state[order[j]]);
+            ++j;
+        }
+    }
+}
+
+/**
+ * @brief Gets bytes of memory used by the CPU's naps.
+ *
+ * @returns Number of bytes of the arrays, without the object itself.
+*/
+size_t NapCpuNaps::mem_usage() const {
+    return (start.capacity() + end.capacity() + reach.capacity())
+        * sizeof(int64_t) + state.capacity();
+}
+
+/**
+ * @brief Gets node aggregates of a plugin context, creating them first if
+ * this hasn't happened yet.
+ *
+ * @param ctx: Pointer to the plugin's context
+ *
+ * @returns Pointer to the aggregates or null if there's no context.
+*/
+NapNodeAggregate* NapNodeAggregate::from_context(plugin_naps_context* ctx) {
+    if (!ctx) return nullptr;
+
+    if (!ctx->node_aggregate) {
+        ctx->node_aggregate = new NapNodeAggregate{};
+    }
+
+    return ctx->node_aggregate;
+}
+
+/**
+ * @brief Gets naps of a nap table indexed per CPU.
+ *
+ * @param table: Nap table of the stream
+ *
+ * @returns Naps per CPU, indexed by CPU number.
+*/
+const std::vector<NapCpuNaps>& NapNodeAggregate::cpus(const NapTable& table) {
+    _sync(table);
+    return _cpus;
+}
+
+/**
+ * @brief Gets the band of a node in a view, computing it if it isn't kept
+ * from before.
+ *
+ * @param table: Nap table of the stream
+ * @param topology: Mapping of CPUs to nodes
+ * @param node: Number of the node
+ * @param view: View of the drawn plot
+ *
+ * @returns Pointer to the band, valid until the next call.
+*/
+const NapNodeBand* NapNodeAggregate::band(const NapTable& table,
+    const NapTopology& topology, int node, const NapView& view)
+{
+    if (_topology != topology) {
+        _topology = topology;
+        _bands.clear();
+    }
+    _sync(table);
+
+    return naps_kept_band(_bands[node], ZOOM_LEVELS, view,
+        [&](NapNodeBand& band) {
+            naps_node_band(_cpus, _topology, node, view, band);
+        });
+}
+
+/**
+ * @brief Gets bytes of memory used by the indices and kept bands.
+ *
+ * @returns Number of bytes used, including the object itself.
+*/
+size_t NapNodeAggregate::mem_usage() const {
+    size_t bytes = sizeof(*this) + _cpus.capacity() * sizeof(NapCpuNaps);
+    for (const NapCpuNaps& naps : _cpus) bytes += naps.mem_usage();
+    bytes += _n_indexed.bucket_count() * sizeof(void*) + _n_indexed.size()
+        * (2 * sizeof(void*) + sizeof(std::pair<const int32_t, size_t>));
+    for (const auto& [node, bands] : _bands) {
+        for (const NapNodeBand& band : bands) bytes += band.mem_usage();
+    }
+    return bytes;
+}
+
+/**
+ * @brief Brings the indices and kept bands up to date with a nap table.
+ * Naps of another table are indexed anew and bands are forgotten. Naps
+ * added by extending the table are merged into the indices, kept bands are
+ * updated in place from the bin of the earliest start of the new naps, or
+ * forgotten if the table was extended more than once since.
+ *
+ * @param table: Nap table of the stream
+*/
+void NapNodeAggregate::_sync(const NapTable& table) {
+    if (_table == &table && _generation == table.generation()) return;
+
+    const bool is_extended = (_table == &table);
+    const bool one_extension = is_extended
+        && table.generation() == _generation + 1;
+    if (!is_extended) {
+        _cpus.clear();
+        _n_indexed.clear();
+    }
+    _table = &table;
+    _generation = table.generation();
+    _index(table);
+
+    if (!one_extension) {
+        _bands.clear();
+        return;
+    }
+
+    for (auto& [node, bands] : _bands) {
+        naps_update_bands(bands, table.extended_from(),
+            [&](NapNodeBand& band, int from_bin) {
+                naps_node_band(_cpus, _topology, node, band.view, band,
+                    from_bin);
+            });
+    }
+}
+
+/**
+ * @brief Indexes naps of a nap table per CPU which aren't indexed yet, i.e.
+ * those after the already indexed naps of each task.
+ *
+ * @param table: Nap table of the stream
+*/
+void NapNodeAggregate::_index(const NapTable& table) {
+    std::vector<NapCpuNaps> added;
+    for (const auto& [pid, task] : table.tasks()) {
+        size_t& n_indexed = _n_indexed[pid];
+        for (size_t i = n_indexed; i < task.size(); ++i) {
+            const kshark_entry* entry = task.switch_entry[i];
+            if (!entry || entry->cpu < 0) continue;
+
+            if (size_t(entry->cpu) >= added.size()) {
+                added.resize(size_t(entry->cpu) + 1);
+            }
+            NapCpuNaps& naps = added[size_t(entry->cpu)];
+            naps.start.push_back(task.start[i]);
+            naps.end.push_back(task.end[i]);
+            naps.state.push_back(task.state[i]);
+        }
+        n_indexed = task.size();
+    }
+
+    if (added.size() > _cpus.size()) _cpus.resize(added.size());
+    for (size_t cpu = 0; cpu < added.size(); ++cpu) {
+        _cpus[cpu].merge(added[cpu]);
+    }
+}
+
+// Functions defined in C header
+
+/**
+ * @brief Frees node aggregates of a context.
+ *
+ * @param aggregate: Pointer to the aggregates (may be null)
+*/
+void naps_free_node_aggregate(struct NapNodeAggregate* aggregate) {
+    delete aggregate;
+}
+
+/**
+ * @brief Gets bytes of memory used by node aggregates of a context.
+ *
+ * @param aggregate: Pointer to the aggregates (may be null)
+ *
+ * @returns Number of bytes used by the aggregates, zero if there are none.
+*/
+size_t naps_node_aggregate_mem_usage(const struct NapNodeAggregate* aggregate) {
+    return aggregate ? aggregate->mem_usage() : 0;
+}
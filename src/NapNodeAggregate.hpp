@@ -0,0 +1,135 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapNodeAggregate.hpp
+ * @brief   Declarations of aggregates of naps per NUMA node - how many
+ *          threads nap in each state over time on the CPUs of a node.
+ *          Part of the Qt-free core of the plugin.
+ *
+ * @note    Definitions in `NapNodeAggregate.cpp`.
+*/
+
+#ifndef _NR_NAP_NODE_AGGREGATE_HPP
+#define _NR_NAP_NODE_AGGREGATE_HPP
+
+// C++
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Plugin
+#include "naps_core.h"
+#include "NapAggregate.hpp"
+#include "NapTable.hpp"
+#include "NapTopology.hpp"
+#include "NapView.hpp"
+
+/**
+ * @brief Naps which started on one CPU, i.e. whose tasks went to sleep
+ * from it, as a structure of arrays ordered by start. Naps of different
+ * tasks overlap, so the ends aren't sorted - the largest end of each
+ * prefix of naps is kept instead, which is sorted and tells where naps
+ * reaching into a time range begin.
+*/
+struct NapCpuNaps {
+    ///
+    /// @brief Timestamps of the sched_switch events starting the naps.
+    std::vector<int64_t> start;
+    ///
+    /// @brief Timestamps of the sched_waking events ending the naps.
+    std::vector<int64_t> end;
+    ///
+    /// @brief Abbreviated prev_states of the naps.
+    std::vector<char> state;
+    ///
+    /// @brief Largest end of the naps up to and including each one.
+    std::vector<int64_t> reach;
+public:
+    /// @brief Returns the number of naps of the CPU.
+    size_t size() const { return start.size(); }
+    std::pair<size_t, size_t> in_range(int64_t min_ts, int64_t max_ts) const;
+    void merge(const NapCpuNaps& added);
+    size_t mem_usage() const;
+};
+
+/**
+ * @brief Average numbers of threads napping on a node in each bin of
+ * a view, per prev_state. Each nap adds the part of the bin it covers,
+ * so a thread napping through half of a bin adds a half.
+*/
+struct NapNodeBand {
+    ///
+    /// @brief View the band was computed for.
+    NapView view{};
+    ///
+    /// @brief Average numbers of napping threads, `NAP_N_STATES` values
+    /// per bin, in the order of `NAP_STATES`.
+    std::vector<float> loads;
+    ///
+    /// @brief Largest total of a single bin.
+    float max_total{0};
+public:
+    /// @brief Returns the average number of threads napping in a state
+    /// in a bin.
+    float load(int bin, size_t state) const
+    { return loads[size_t(bin) * NAP_N_STATES + state]; }
+    /// @brief Returns bytes of memory used by the band.
+    size_t mem_usage() const
+    { return sizeof(*this) + loads.capacity() * sizeof(float); }
+};
+
+/**
+ * @brief Aggregates of naps of a stream per NUMA node, to show whether
+ * naps in some state cluster on one memory node.
+ *
+ * Naps are indexed once per nap table by the CPU of their sched_switch.
+ * A node's band is computed from the indices of the node's CPUs only,
+ * in parallel by the plugin's thread pool, and bands of a few most recent
+ * views of each node are kept. When the table is extended, only the new
+ * naps are merged into the indices and kept bands are recomputed from the
+ * earliest bin the new naps reach, as `NapCommAggregate` does. Changing
+ * the topology drops the bands.
+*/
+class NapNodeAggregate {
+private: // Data members
+    ///
+    /// @brief Nap table the naps were indexed from.
+    const NapTable* _table = nullptr;
+    ///
+    /// @brief Generation of the nap table the indices are up to.
+    uint64_t _generation{0};
+    ///
+    /// @brief Topology the bands were computed with.
+    NapTopology _topology;
+    ///
+    /// @brief Naps per CPU, indexed by CPU number.
+    std::vector<NapCpuNaps> _cpus;
+    ///
+    /// @brief Numbers of naps of each task already indexed, keyed by PID.
+    std::unordered_map<int32_t, size_t> _n_indexed;
+    ///
+    /// @brief Bands of recent views of each node, most recent last.
+    std::unordered_map<int, std::deque<NapNodeBand>> _bands;
+public: // Data members
+    ///
+    /// @brief Number of views whose bands are kept per node.
+    static constexpr size_t ZOOM_LEVELS = 4;
+public: // Functions
+    static NapNodeAggregate* from_context(plugin_naps_context* ctx);
+
+    const std::vector<NapCpuNaps>& cpus(const NapTable& table);
+    const NapNodeBand* band(const NapTable& table,
+        const NapTopology& topology, int node, const NapView& view);
+    size_t mem_usage() const;
+private: // Functions
+    void _sync(const NapTable& table);
+    void _index(const NapTable& table);
+};
+
+void naps_node_band(const std::vector<NapCpuNaps>& cpus,
+    const NapTopology& topology, int node, const NapView& view,
+    NapNodeBand& band, int from_bin = 0);
+
+#endif // _NR_NAP_NODE_AGGREGATE_HPP
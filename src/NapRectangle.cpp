@@ -2,40 +2,128 @@
 
 /**
  * @file    NapRectangle.cpp
- * @brief   Definitions of plugin's drawable nap rectangle class and global
- *          functions.
+ * @brief   Definitions of plugin's drawable nap rectangle class and of the
+ *          batch of nap rectangles.
  * 
  * @note    Nap := space in the histogram between a sched_switch and
  *          the closest next sched_waking event in the task plot.
 */
 
+// C
+#include <cmath>
+
 // C++
+#include <algorithm>
+#include <limits>
 #include <map>
 #include <string>
+#include <string_view>
+#include <vector>
 
 // KernelShark
 #include "libkshark.h"
 
 // Plugin headers
+#include "NapLabelAtlas.hpp"
 #include "NapRectangle.hpp"
-#include "NapConfig.hpp"
+
+// Static variables
+
+///
+/// @brief Height of nap rectangles, in pixels.
+static constexpr int HEIGHT = 8;
+
+///
+/// @brief Vertical offset of tops of nap rectangles from the plot's base.
+static constexpr int HEIGHT_OFFSET = -10;
+
+/**
+ * @brief Type to be used by the PREV_STATE_TO_COLOR constant.
+*/
+using prev_state_colors_t = std::map<const char, KsPlot::Color>;
+
+/**
+ * @brief Constant map of assigned colors to prev_state abbreviations,
+ * made from the core's palette (`naps_state_color`).
+*/
+static const prev_state_colors_t PREV_STATE_TO_COLOR = []() {
+    prev_state_colors_t colors;
+    for (const char state : std::string_view{NAPS_STATE_LETTERS}) {
+        const uint32_t rgb = naps_state_color(state);
+        colors.emplace(state, KsPlot::Color{uint8_t(rgb >> 16),
+            uint8_t(rgb >> 8), uint8_t(rgb)});
+    }
+    return colors;
+}();
 
 // Static functions
 
 /**
- * @brief Map of abbreviations of prev_states to their full names.
- */
-static const std::map<const char, const char*> LETTER_TO_NAME {{
-    {'D', "uninterruptible (disk) sleep"},
-    {'I', "idle"},
-    {'P', "parked"},
-    {'R', "running"},
-    {'S', "sleeping"},
-    {'T', "stopped"},
-    {'t', "tracing stop"},
-    {'X', "dead"},
-    {'Z', "zombie"}
-}};
+ * @brief Returns either black if the background color's intensity is too great,
+ * otherwise returns white. Limit to intensity is `128.0`.
+ * 
+ * @param bg_color_intensity: Computed intensity from an RGB color
+ * 
+ * @returns Black on high intensity, white otheriwse.
+*/
+static KsPlot::Color _black_or_white_text(float bg_color_intensity) {
+    const static KsPlot::Color WHITE {0xFF, 0xFF, 0xFF};
+    const static KsPlot::Color BLACK {0, 0, 0};
+    constexpr float INTENSITY_LIMIT = 128.f;
+
+    return (bg_color_intensity > INTENSITY_LIMIT) ? BLACK : WHITE;
+}
+
+/**
+ * @brief Gets the color intensity using the formula
+ * `(red * 0.299) + (green * 0.587) + (blue * 0.114)`.
+ * 
+ * @param c: RGB color value whose components will be checked
+ * 
+ * @returns Color intensity as floating-point value.
+*/
+static float _get_color_intensity(const KsPlot::Color& c) {
+    // Color multipliers are chosen the way they are based on human
+    // eye's receptiveness to each color (green being the color human
+    // eyes focus on the most).
+    return (c.b() * 0.114f) + (c.g() * 0.587f) + (c.r() * 0.299f);
+}
+
+/**
+ * @brief Gets the full name of a prev_state in capitals, as displayed
+ * in nap rectangles.
+ * 
+ * @param prev_state: Abbreviated prev_state
+ * 
+ * @returns Capitalized full name of the prev_state.
+*/
+static std::string _state_label(char prev_state) {
+    std::string raw_text{naps_state_name(prev_state)};
+    // Capitalize to be more readable (and slightly cooler)
+    for(auto& character : raw_text) {
+        character = std::toupper(character);
+    }
+    return raw_text;
+}
+
+/**
+ * @brief Gets the label of a prev_state, as displayed in nap rectangles,
+ * without building it anew for every drawn label.
+ * 
+ * @param prev_state: Abbreviated prev_state
+ * 
+ * @returns Capitalized full name of the prev_state.
+*/
+static const std::string& _cached_state_label(char prev_state) {
+    static const std::map<const char, std::string> LABELS = []() {
+        std::map<const char, std::string> labels;
+        for (const char state : std::string_view{NAPS_STATE_LETTERS}) {
+            labels.emplace(state, _state_label(state));
+        }
+        return labels;
+    }();
+    return LABELS.at(prev_state);
+}
 
 // Member functions
 
@@ -61,7 +149,8 @@ void NapRectangle::_draw(const KsPlot::Color&, float) const {
         // Make sure the text fits in the rectangle and draw it if so.
         int nap_rect_width = (_rect.pointX(3) - _rect.pointX(0));
         int minimal_width = _raw_text.size() * FONT_SIZE;
-        if (nap_rect_width > minimal_width) {
+        // No text without a font, e.g. if it couldn't be found
+        if (nap_rect_width > minimal_width && get_bold_font_ptr()) {
             _text.draw();
         }
     }
@@ -73,6 +162,8 @@ void NapRectangle::_draw(const KsPlot::Color&, float) const {
  * @param start: Pointer to the event entry from which to start the
  * nap
  * @param end: Pointer to the event entry at which to end the nap
+ * @param prev_state: Abbreviated prev_state of the sched_switch starting
+ * the nap
  * @param rect: KernelShark rectangle to display as basis for the
  * nap rectangle
  * @param outline_col: Color of the outlines of the nap rectangle
@@ -80,6 +171,7 @@ void NapRectangle::_draw(const KsPlot::Color&, float) const {
 */
 NapRectangle::NapRectangle(const kshark_entry* start,
     const kshark_entry* end,
+    char prev_state,
     const KsPlot::Rectangle& rect,
     const KsPlot::Color& outline_col,
     const KsPlot::Color& text_col)
@@ -99,13 +191,7 @@ NapRectangle::NapRectangle(const kshark_entry* start,
     _outline_down.setB(lower_point_b.x, lower_point_b.y);
 
     // Text
-    const char start_ps = get_switch_prev_state(start);
-    std::string raw_text{LETTER_TO_NAME.at(start_ps)};
-    // Capitalize to be more readable (and slightly cooler)
-    for(auto& character : raw_text) {
-        character = std::toupper(character);
-    }
-    _raw_text = raw_text;
+    _raw_text = _state_label(prev_state);
 
     const int base_x_1 = _rect.pointX(0);
     const int base_x_2 = _rect.pointX(3);
@@ -135,20 +221,280 @@ NapRectangle::~NapRectangle() {
     // Other objects are deleted by C++ like default behaviour.
 }
 
+// Batch
+
+/**
+ * @brief Draws all nap rectangles of the batch, reusing one rectangle
+ * and two outline lines, which are only repositioned and recolored for
+ * each nap. Text is drawn with the same rules as for a single nap rectangle,
+ * but labels of all naps are drawn at once from the glyph atlas after the
+ * rectangles, if the atlas could be loaded.
+ * 
+ * @note Despite the signature, the other parameters are ignored and are included
+ * only to satisfy the inherited function.
+*/
+void NapRectangleBatch::_draw(const KsPlot::Color&, float) const {
+    KsPlot::Rectangle rect;
+    rect.setFill(true);
+    KsPlot::Line outline_up, outline_down;
+
+    // No text without a font, e.g. if it couldn't be found
+    ksplot_font* font = get_bold_font_ptr();
+    NapLabelAtlas& atlas = NapLabelAtlas::get_instance();
+    const bool use_atlas = font && atlas.load();
+    std::vector<NapGlyphVertex> glyphs;
+
+    for (size_t i = 0; i < _state.size(); ++i) {
+        const int x_start = _x_start[i], x_end = _x_end[i];
+        const int y_top = _y_base[i] - HEIGHT_OFFSET - HEIGHT;
+        const int y_bottom = _y_base[i] - HEIGHT_OFFSET;
+        const KsPlot::Color& color = PREV_STATE_TO_COLOR.at(_state[i]);
+
+        rect._color = color;
+        rect.setPoint(0, x_start, y_top);
+        rect.setPoint(1, x_start, y_bottom);
+        rect.setPoint(2, x_end, y_bottom);
+        rect.setPoint(3, x_end, y_top);
+        rect.draw();
+
+        // Outlines have the same color as the rectangle
+        outline_up._color = outline_down._color = color;
+        outline_up.setA(x_start, y_top);
+        outline_up.setB(x_end, y_top);
+        outline_down.setA(x_start, y_bottom);
+        outline_down.setB(x_end, y_bottom);
+        outline_up.draw();
+        outline_down.draw();
+
+        // Make sure the text fits in the rectangle and draw it if so.
+        if (!font) continue;
+        const std::string& label = _cached_state_label(_state[i]);
+
+        if (use_atlas) {
+            // Glyphs have known widths, so the label is fitted and centered
+            // exactly
+            const float text_width = atlas.text_width(label.c_str());
+            if (x_end - x_start <= text_width) continue;
+
+            const KsPlot::Color text_col =
+                _black_or_white_text(_get_color_intensity(color));
+            const float text_x = x_start
+                + ((x_end - x_start) - text_width) / 2;
+            atlas.append(label.c_str(), text_x, float(y_bottom + 1),
+                text_col.r(), text_col.g(), text_col.b(), glyphs);
+            continue;
+        }
+
+        const int label_size = int(label.size());
+        if (x_end - x_start <= label_size * FONT_SIZE) continue;
+
+        const KsPlot::Color text_col =
+            _black_or_white_text(_get_color_intensity(color));
+        // This is a rough estimate for centering, but it works.
+        const int text_x = x_start + (x_end - x_start) / 2
+            - label_size * FONT_SIZE / 3;
+        KsPlot::TextBox text{font, label, text_col,
+            KsPlot::Point{text_x, y_bottom + 1}};
+        text.draw();
+    }
+
+    atlas.draw(glyphs);
+}
+
+/**
+ * @brief Reserves space for nap rectangles in the batch.
+ * 
+ * @param n: Expected number of nap rectangles
+*/
+void NapRectangleBatch::reserve(size_t n) {
+    _x_start.reserve(n);
+    _x_end.reserve(n);
+    _y_base.reserve(n);
+    _state.reserve(n);
+    _nap.reserve(n);
+}
+
+/**
+ * @brief Adds a nap rectangle to the batch.
+ * 
+ * @param x_start: Left edge of the nap rectangle
+ * @param x_end: Right edge of the nap rectangle
+ * @param y_base: Vertical position of the base of the task plot
+ * @param prev_state: Abbreviated prev_state of the nap
+ * @param nap: Index of the nap in its task's table
+*/
+void NapRectangleBatch::add(int x_start, int x_end, int y_base,
+    char prev_state, uint32_t nap)
+{
+    _x_start.push_back(x_start);
+    _x_end.push_back(x_end);
+    _y_base.push_back(y_base);
+    _state.push_back(prev_state);
+    _nap.push_back(nap);
+}
+
+/**
+ * @brief Gets the distance of a point from the closest nap rectangle of
+ * the batch and remembers that rectangle for a double click. KernelShark
+ * asks for distances of all plot objects before a double click and picks
+ * the closest object.
+ * 
+ * @param x: Horizontal position of the point
+ * @param y: Vertical position of the point
+ * 
+ * @returns Distance from the closest nap rectangle, zero if the point is
+ * inside of one.
+*/
+double NapRectangleBatch::distance(int x, int y) const {
+    double best = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < _state.size(); ++i) {
+        const int y_top = _y_base[i] - HEIGHT_OFFSET - HEIGHT;
+        const int y_bottom = _y_base[i] - HEIGHT_OFFSET;
+        const int dx = std::max({_x_start[i] - x, 0, x - _x_end[i]});
+        const int dy = std::max({y_top - y, 0, y - y_bottom});
+        const double dist = std::hypot(double(dx), double(dy));
+        if (dist < best) {
+            best = dist;
+            _picked = i;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Passes the nap rectangle closest to the cursor to the callback
+ * of a double click, if there's any.
+*/
+void NapRectangleBatch::_doubleClick() const {
+    if (_on_double_click && _picked < _nap.size()) {
+        _on_double_click(_nap[_picked]);
+    }
+}
+
+/**
+ * @brief Gets bytes of memory used by the batch.
+ * 
+ * @returns Number of bytes of the batch, including the object itself.
+*/
+size_t NapRectangleBatch::mem_usage() const {
+    return sizeof(*this) + (_x_start.capacity() + _x_end.capacity()
+        + _y_base.capacity()) * sizeof(int32_t) + _state.capacity()
+        + _nap.capacity() * sizeof(uint32_t);
+}
+
+// Band
+
+/**
+ * @brief Draws all layers of the band with one reused rectangle.
+*/
+void NapStateBand::_draw(const KsPlot::Color&, float) const {
+    KsPlot::Rectangle rect;
+    rect.setFill(true);
+
+    for (size_t i = 0; i < _state.size(); ++i) {
+        const int x_start = _x[i], x_end = _x[i] + _width[i];
+
+        rect._color = PREV_STATE_TO_COLOR.at(_state[i]);
+        rect.setPoint(0, x_start, _y_top[i]);
+        rect.setPoint(1, x_start, _y_bottom[i]);
+        rect.setPoint(2, x_end, _y_bottom[i]);
+        rect.setPoint(3, x_end, _y_top[i]);
+        rect.draw();
+    }
+}
+
+/**
+ * @brief Adds a layer to the band.
+ * 
+ * @param x: Left edge of the layer
+ * @param width: Width of the layer, i.e. of a bin
+ * @param y_top: Top edge of the layer
+ * @param y_bottom: Bottom edge of the layer
+ * @param prev_state: Abbreviated prev_state of the layer's naps
+*/
+void NapStateBand::add(int x, int width, int y_top, int y_bottom,
+    char prev_state)
+{
+    _x.push_back(x);
+    _width.push_back(width);
+    _y_top.push_back(y_top);
+    _y_bottom.push_back(y_bottom);
+    _state.push_back(prev_state);
+}
+
+/**
+ * @brief Gets bytes of memory used by the band.
+ * 
+ * @returns Number of bytes of the band, including the object itself.
+*/
+size_t NapStateBand::mem_usage() const {
+    return sizeof(*this) + (_x.capacity() + _width.capacity()
+        + _y_top.capacity() + _y_bottom.capacity()) * sizeof(int32_t)
+        + _state.capacity();
+}
+
 // Global functions
 
 /**
- * @brief Gets the abbreviated name of a prev_state from the info field of a
- * KernelShark entry, leveraging the specific format of information strings
- * of entries in KernelShark.
+ * @brief Creates a nap rectangle to be displayed on the plot via
+ * KernelShark's plot objects API.
+ * 
+ * @param graph: KernelShark graph of the task plot
+ * @param start_bin: Bin in which the nap starts
+ * @param end_bin: Bin in which the nap ends
+ * @param switch_entry: Entry of the sched_switch starting the nap
+ * @param waking_entry: Entry of the sched_waking ending the nap
+ * @param prev_state: Abbreviated prev_state of the sched_switch
  * 
- * @param entry: `sched/sched_switch` event entry whose prev_state we wish to get
- *  
- * @returns Char representing the abbreviated previous state of the task.
+ * @returns Pointer to the heap-created nap rectangle.
+ * 
+ * @note  Function also depends on the file-global variable
+ * `PREV_STATE_TO_COLOR`.
  */
-char get_switch_prev_state(const kshark_entry* entry) {
-    auto info_as_str = std::string(kshark_get_info(entry));
-    std::size_t start = info_as_str.find(" ==>");
-    char prev_state = info_as_str.substr(start - 1, 1)[0];
-    return prev_state;
+NapRectangle* make_nap_rect(const KsPlot::Graph* graph,
+    int start_bin, int end_bin,
+    const kshark_entry* switch_entry, const kshark_entry* waking_entry,
+    char prev_state)
+{
+    KsPlot::Point start_base_point = graph->bin(start_bin)._val;
+    KsPlot::Point end_base_point = graph->bin(end_bin)._val;
+
+    /* Rectangle:
+        0----------3
+        |          |
+        |          |
+        1----------2
+    */
+
+    auto point_0 = KsPlot::Point{start_base_point.x() + 1,
+        start_base_point.y() - HEIGHT_OFFSET - HEIGHT};
+    auto point_1 = KsPlot::Point{start_base_point.x() + 1,
+        start_base_point.y() - HEIGHT_OFFSET};
+    auto point_3 = KsPlot::Point{end_base_point.x() - 1,
+        end_base_point.y() - HEIGHT_OFFSET - HEIGHT};
+    auto point_2 = KsPlot::Point{end_base_point.x() - 1,
+        end_base_point.y() - HEIGHT_OFFSET};
+
+    // Create the rectangle and color it
+    KsPlot::Rectangle rect;
+    rect.setFill(true);
+    // Access to global variable here.
+    rect._color = PREV_STATE_TO_COLOR.at(prev_state);
+
+    rect.setPoint(0, point_0);
+    rect.setPoint(1, point_1);
+    rect.setPoint(2, point_2);
+    rect.setPoint(3, point_3);
+
+    // Prepare outline color
+    KsPlot::Color outline_col = rect._color;
+
+    // Prepare text color
+    float bg_intensity = _get_color_intensity(rect._color);
+    const KsPlot::Color text_color = _black_or_white_text(bg_intensity);
+
+    // Create the final nap rectangle and return it
+    NapRectangle* nap_rect = new NapRectangle{switch_entry, waking_entry,
+        prev_state, rect, outline_col, text_color};
+    return nap_rect;
 }
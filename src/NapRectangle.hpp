@@ -13,8 +13,11 @@
 #define _NR_NAP_RECTANGLE_HPP
 
 // C++
+#include <cstdint>
 #include <cstring>
+#include <functional>
 #include <string>
+#include <vector>
 
 // KernelShark
 #include "libkshark.h"
@@ -71,6 +74,7 @@ private:
 public:
     explicit NapRectangle(const kshark_entry* start,
         const kshark_entry* end,
+        char prev_state,
         const KsPlot::Rectangle& rect,
         const KsPlot::Color& outline_col,
         const KsPlot::Color& text_col);
@@ -80,6 +84,94 @@ public:
     ~NapRectangle();
 };
 
-char get_switch_prev_state(const kshark_entry* entry);
+/**
+ * @brief Nap rectangles of a whole task plot, drawn in one go as a single
+ * plot object. Looks the same as separate nap rectangles, but stores only
+ * the geometry and prev_state of each nap in arrays and reuses the same
+ * basic plot objects while drawing, so nothing is allocated per nap.
+ * 
+ * Unlike a single nap rectangle, the batch can be double clicked - it
+ * tells KernelShark its distance from the cursor as that of the closest
+ * nap rectangle and passes the index of that nap to a callback.
+ */
+class NapRectangleBatch: public KsPlot::PlotObject {
+public:
+    ///
+    /// @brief Callback of a double click, gets the nap's index in its task.
+    using double_click_t = std::function<void(uint32_t)>;
+private:
+    ///
+    /// @brief Left edges of the nap rectangles.
+    std::vector<int32_t> _x_start;
+    ///
+    /// @brief Right edges of the nap rectangles.
+    std::vector<int32_t> _x_end;
+    ///
+    /// @brief Vertical positions of bases of the nap rectangles.
+    std::vector<int32_t> _y_base;
+    ///
+    /// @brief Abbreviated prev_states of the naps.
+    std::vector<char> _state;
+    ///
+    /// @brief Indices of the naps in their task's table.
+    std::vector<uint32_t> _nap;
+    ///
+    /// @brief Position of the nap rectangle closest to the cursor, as found
+    /// by the last distance query.
+    mutable size_t _picked{0};
+    ///
+    /// @brief Callback of a double click, may be empty.
+    double_click_t _on_double_click;
+private:
+    void _draw(const KsPlot::Color&, float) const override;
+    void _doubleClick() const override;
+public:
+    void reserve(size_t n);
+    void add(int x_start, int x_end, int y_base, char prev_state,
+        uint32_t nap);
+    /// @brief Sets the callback of a double click on a nap rectangle.
+    void set_double_click(double_click_t callback)
+    { _on_double_click = std::move(callback); }
+    double distance(int x, int y) const override;
+    /// @brief Returns the number of nap rectangles in the batch.
+    size_t size() const { return _state.size(); }
+    size_t mem_usage() const;
+};
+
+/**
+ * @brief Stacked band of numbers of napping threads of a task group, drawn
+ * over a task plot as a single plot object. Each bin is a column of layers,
+ * one per prev_state, colored the same as nap rectangles.
+ */
+class NapStateBand: public KsPlot::PlotObject {
+private:
+    ///
+    /// @brief Left edges of the layers.
+    std::vector<int32_t> _x;
+    ///
+    /// @brief Widths of the layers.
+    std::vector<int32_t> _width;
+    ///
+    /// @brief Top edges of the layers.
+    std::vector<int32_t> _y_top;
+    ///
+    /// @brief Bottom edges of the layers.
+    std::vector<int32_t> _y_bottom;
+    ///
+    /// @brief Abbreviated prev_states of the layers.
+    std::vector<char> _state;
+private:
+    void _draw(const KsPlot::Color&, float) const override;
+public:
+    void add(int x, int width, int y_top, int y_bottom, char prev_state);
+    /// @brief Returns the number of layers in the band.
+    size_t size() const { return _state.size(); }
+    size_t mem_usage() const;
+};
+
+NapRectangle* make_nap_rect(const KsPlot::Graph* graph,
+    int start_bin, int end_bin,
+    const kshark_entry* switch_entry, const kshark_entry* waking_entry,
+    char prev_state);
 
 #endif // _NAP_RECTANGLE_HPP
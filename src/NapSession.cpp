@@ -0,0 +1,216 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapSession.cpp
+ * @brief   Definitions of the headless session of the plugin's core.
+*/
+
+// C
+#include <stdint.h>
+#include <stdlib.h>
+
+// C++
+#include <algorithm>
+#include <vector>
+
+// KernelShark
+#include "libkshark.h"
+
+// Plugin headers
+#include "NapSession.hpp"
+
+/**
+ * @brief Destructor of the session, closes the stream if still open.
+*/
+NapSession::~NapSession() {
+    close();
+}
+
+/**
+ * @brief Opens a trace file, initializes the plugin's core for its stream
+ * and loads all of its entries, which runs the core's event handlers.
+ *
+ * @param file: Path to the trace file
+ * @param follow: Whether the file will be followed while it grows (see
+ * `tail`), so that naps are paired only from events which records appended
+ * later can't precede
+ *
+ * @returns True if the file was loaded, false otherwise.
+*/
+bool NapSession::open(const char* file, bool follow) {
+    close();
+
+    if (!kshark_instance(&_kshark_ctx)) return false;
+    _file = file;
+
+    int sd = kshark_open(_kshark_ctx, file);
+    if (sd < 0) return false;
+
+    _stream = kshark_get_data_stream(_kshark_ctx, sd);
+    if (!_stream || !naps_core_init(_stream)) {
+        kshark_close(_kshark_ctx, sd);
+        _stream = nullptr;
+        return false;
+    }
+    context()->follows_file = follow;
+
+    _n_entries = kshark_load_entries(_kshark_ctx, sd, &_entries);
+    if (_n_entries < 0) {
+        _n_entries = 0;
+        close();
+        return false;
+    }
+
+    for (ssize_t i = 0; i < _n_entries; ++i) {
+        _count_entry(_entries[i]);
+    }
+
+    // Loading is done, so runs of collected events can be merged right away,
+    // unless a cached nap table has to be reattached to them first
+    plugin_naps_context* ctx = context();
+    if (ctx && !ctx->cached_table) {
+        naps_merge_collected_events(ctx);
+    }
+    return true;
+}
+
+/**
+ * @brief Loads records appended to the trace file since it was loaded last,
+ * i.e. follows a growing file. The file is opened again, as KernelShark
+ * reads its layout only when opening it, and its entries are loaded, but
+ * only the new ones are kept and handled by the plugin's core. Buffers of
+ * CPUs grow independently, so entries are told apart per CPU - the first
+ * ones of each CPU were loaded before. KernelShark can't load only a part
+ * of a file, so the whole file is still read, but old entries are dropped
+ * right away. The nap table is then extended with the new events instead
+ * of being rebuilt - the session should be opened with `follow`, else the
+ * first extension can find new events older than paired ones and rebuild.
+ *
+ * @returns Number of new entries, negative if the file couldn't be loaded
+ * again, in which case the session is closed.
+*/
+ssize_t NapSession::tail() {
+    if (!_stream) return -1;
+
+    // Events loaded so far must be paired, new events extend the table
+    table();
+    std::vector<ssize_t> old_per_cpu = _cpu_entries;
+
+    const int old_sd = _stream->stream_id;
+    naps_core_detach(_stream);
+    kshark_close(_kshark_ctx, old_sd);
+    _stream = nullptr;
+
+    // Stream identifiers are reused, so the context is found again
+    const int sd = kshark_open(_kshark_ctx, _file.c_str());
+    kshark_data_stream* stream = (sd == old_sd)
+        ? kshark_get_data_stream(_kshark_ctx, sd) : nullptr;
+    if (!stream || !naps_core_reattach(stream)) {
+        if (sd >= 0) kshark_close(_kshark_ctx, sd);
+        // Only the detached context and the entries are left
+        __close(old_sd);
+        close();
+        return -1;
+    }
+    _stream = stream;
+
+    kshark_entry** loaded = nullptr;
+    ssize_t n_loaded = kshark_load_entries(_kshark_ctx, sd, &loaded);
+    if (n_loaded < 0) {
+        close();
+        return -1;
+    }
+
+    // Entries of a CPU keep their order, the old ones come first and are
+    // dropped, new ones are moved to the front keeping their order too
+    ssize_t n_new = 0;
+    for (ssize_t i = 0; i < n_loaded; ++i) {
+        const int16_t cpu = loaded[i]->cpu;
+        if (cpu >= 0 && size_t(cpu) < old_per_cpu.size() && old_per_cpu[cpu]) {
+            --old_per_cpu[cpu];
+            free(loaded[i]);
+        } else {
+            _count_entry(loaded[i]);
+            loaded[n_new++] = loaded[i];
+        }
+    }
+
+    if (n_new) {
+        auto grown = static_cast<kshark_entry**>(realloc(_entries,
+            (_n_entries + n_new) * sizeof(*_entries)));
+        if (!grown) {
+            for (ssize_t i = 0; i < n_new; ++i) free(loaded[i]);
+            free(loaded);
+            close();
+            return -1;
+        }
+        std::copy(loaded, loaded + n_new, grown + _n_entries);
+        _entries = grown;
+
+        // New entries of a lagging CPU can be older than old ones of others
+        std::inplace_merge(_entries, _entries + _n_entries,
+            _entries + _n_entries + n_new,
+            [](const kshark_entry* a, const kshark_entry* b) {
+                return a->ts < b->ts;
+            });
+        _n_entries += n_new;
+    }
+    free(loaded);
+
+    naps_merge_collected_events(context());
+    return n_new;
+}
+
+/**
+ * @brief Deinitializes the plugin's core for the stream, frees loaded
+ * entries and closes the stream. Frees what is left, if no stream is open.
+*/
+void NapSession::close() {
+    if (_stream) {
+        int sd = _stream->stream_id;
+        // Sessions don't reinitialize the plugin, caching would only hold memory
+        naps_core_deinit(_stream, false);
+        kshark_close(_kshark_ctx, sd);
+        _stream = nullptr;
+    }
+
+    for (ssize_t i = 0; i < _n_entries; ++i) {
+        free(_entries[i]);
+    }
+    free(_entries);
+    _entries = nullptr;
+    _n_entries = 0;
+    _cpu_entries.clear();
+}
+
+/**
+ * @brief Gets the plugin's context of the session's stream.
+ *
+ * @returns Pointer to the context or null if no stream is open.
+*/
+plugin_naps_context* NapSession::context() const {
+    return _stream ? __get_context(_stream->stream_id) : nullptr;
+}
+
+/**
+ * @brief Gets the nap table of the session's stream, building it if
+ * this hasn't happened yet.
+ *
+ * @returns Pointer to the nap table or null if no stream is open.
+*/
+NapTable* NapSession::table() const {
+    return NapTable::from_context(context());
+}
+
+/**
+ * @brief Counts a loaded entry in the numbers of entries of its CPU.
+ *
+ * @param entry: The loaded entry
+*/
+void NapSession::_count_entry(const kshark_entry* entry) {
+    if (entry->cpu < 0) return;
+    if (size_t(entry->cpu) >= _cpu_entries.size()) {
+        _cpu_entries.resize(entry->cpu + 1, 0);
+    }
+    ++_cpu_entries[entry->cpu];
+}
@@ -0,0 +1,83 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapSession.hpp
+ * @brief   Declaration of a headless session, which loads a trace file
+ *          with the plugin's core attached, without any GUI. Used by the
+ *          plugin's tools and benchmarks. Part of the Qt-free core.
+ *
+ * @note    Definitions in `NapSession.cpp`.
+*/
+
+#ifndef _NR_NAP_SESSION_HPP
+#define _NR_NAP_SESSION_HPP
+
+// C
+#include <sys/types.h>
+
+// C++
+#include <string>
+#include <vector>
+
+// KernelShark
+#include "libkshark.h"
+
+// Plugin
+#include "naps_core.h"
+#include "NapTable.hpp"
+
+/**
+ * @brief Trace file loaded into KernelShark's data structures with the
+ * plugin's core initialized for its stream, i.e. the same state the
+ * plugin has in the GUI after the file is loaded.
+ *
+ * Session owns the loaded entries and closes the stream on destruction.
+ *
+ * @note KernelShark's loading isn't thread-safe, sessions should be
+ * opened one at a time.
+*/
+class NapSession {
+private: // Data members
+    ///
+    /// @brief KernelShark's context holding the stream.
+    kshark_context* _kshark_ctx = nullptr;
+    ///
+    /// @brief Observer of the loaded data stream.
+    kshark_data_stream* _stream = nullptr;
+    ///
+    /// @brief Loaded entries, owned by the session.
+    kshark_entry** _entries = nullptr;
+    ///
+    /// @brief Number of loaded entries.
+    ssize_t _n_entries = 0;
+    ///
+    /// @brief Path to the loaded trace file.
+    std::string _file;
+    ///
+    /// @brief Numbers of loaded entries of each CPU, kept for tailing.
+    std::vector<ssize_t> _cpu_entries;
+public: // Functions
+    NapSession() = default;
+    ~NapSession();
+    // Owns the stream, copying makes no sense
+    NapSession(const NapSession&) = delete;
+    NapSession& operator=(const NapSession&) = delete;
+
+    bool open(const char* file, bool follow = false);
+    ssize_t tail();
+    void close();
+
+    plugin_naps_context* context() const;
+    NapTable* table() const;
+
+    /// @brief Returns the loaded data stream (null if not open).
+    kshark_data_stream* stream() const { return _stream; }
+    /// @brief Returns the loaded entries.
+    kshark_entry** entries() const { return _entries; }
+    /// @brief Returns the number of loaded entries.
+    ssize_t n_entries() const { return _n_entries; }
+private: // Functions
+    void _count_entry(const kshark_entry* entry);
+};
+
+#endif // _NR_NAP_SESSION_HPP
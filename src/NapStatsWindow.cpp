@@ -0,0 +1,209 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapStatsWindow.cpp
+ * @brief   Definitions of the window with statistics of naps of a loaded
+ *          data stream.
+*/
+
+// C
+#include <stdlib.h>
+
+// C++
+#include <algorithm>
+#include <cmath>
+
+// KernelShark
+#include "libkshark.h"
+
+// Plugin
+#include "naps_core.h"
+#include "NapBlockIo.hpp"
+#include "NapConfig.hpp"
+#include "NapStatsWindow.hpp"
+#include "NapTable.hpp"
+
+// Static variables
+
+///
+/// @brief Percentiles of nap durations shown in the table.
+static constexpr double PERCENTILES[] = {50.0, 90.0, 99.0, 99.9};
+
+// Static functions
+
+/**
+ * @brief Creates a table item with a number, which sorts numerically.
+ * 
+ * @param value: Shown number
+ * 
+ * @returns Pointer to the heap-created item, owned by the table it's put in.
+ */
+static QTableWidgetItem* _number_item(double value) {
+    auto item = new QTableWidgetItem();
+    item->setData(Qt::DisplayRole, value);
+    return item;
+}
+
+/**
+ * @brief Converts nanoseconds to microseconds rounded to nanoseconds.
+ * 
+ * @param ns: Time in nanoseconds
+ * 
+ * @returns Time in microseconds.
+ */
+static double _ns_to_us(double ns) {
+    return std::round(ns) / 1e3;
+}
+
+// Member functions
+
+/**
+ * @brief Constructor for the statistics window.
+ * 
+ * @param parent: Owner of the window, KernelShark's main window
+*/
+NapStatsWindow::NapStatsWindow(QWidget* parent)
+    : QWidget(parent),
+    _stream(this),
+    _table(this),
+    _show_button("Show", this),
+    _close_button("Close", this)
+{
+    setWindowTitle("Naps Statistics");
+    setWindowFlags(Qt::Dialog | Qt::WindowMinimizeButtonHint
+                   | Qt::WindowCloseButtonHint);
+    resize(1000, 600);
+
+    setup_table();
+
+    connect(&_show_button, &QPushButton::pressed,
+            this, [this]() { this->load_stats(); });
+    connect(&_close_button, &QPushButton::pressed,
+            this, &QWidget::close);
+
+    setup_layout();
+}
+
+/**
+ * @brief Loads currently loaded streams into the stream choice and shows
+ * statistics of the first one.
+*/
+void NapStatsWindow::load_streams() {
+    _stream.clear();
+    _stream_ids.clear();
+
+    kshark_context* kshark_ctx = nullptr;
+    if (!kshark_instance(&kshark_ctx)) return;
+
+    int* stream_ids = kshark_all_streams(kshark_ctx);
+    const int n_streams = stream_ids ? kshark_ctx->n_streams : 0;
+    for (int i = 0; i < n_streams; ++i) {
+        kshark_data_stream* stream =
+            kshark_get_data_stream(kshark_ctx, stream_ids[i]);
+        _stream_ids.push_back(stream_ids[i]);
+        _stream.addItem(QString("Stream %1: %2").arg(stream_ids[i])
+            .arg(stream && stream->file ? stream->file : ""));
+    }
+    free(stream_ids);
+
+    load_stats();
+}
+
+/**
+ * @brief Shows statistics of the chosen stream in the table, one row per
+ * task and prev_state. Durations are in microseconds. Rows of naps in the
+ * `D` state also show block I/O joined with them, if the trace has any.
+*/
+void NapStatsWindow::load_stats() {
+    _table.setSortingEnabled(false);
+    _table.clearContents();
+    _table.setRowCount(0);
+
+    const int idx = _stream.currentIndex();
+    if (idx < 0 || size_t(idx) >= _stream_ids.size()) return;
+
+    const int sd = _stream_ids[idx];
+    plugin_naps_context* ctx = __get_context(sd);
+    const NapTable* table = NapTable::from_context(ctx);
+    if (!table) return;
+    const NapBlockIo* block_io = ctx->n_block_events
+        ? NapBlockIo::from_context(ctx) : nullptr;
+
+    int n_rows = 0;
+    for (const auto& [pid, task] : table->tasks()) {
+        n_rows += int(task.stats.size());
+    }
+    _table.setRowCount(n_rows);
+
+    int row = 0;
+    for (const auto& [pid, task] : table->tasks()) {
+        char* comm = kshark_comm_from_pid(sd, pid);
+        const QString task_name = comm ? comm : "";
+        free(comm);
+
+        for (const auto& [prev_state, stats] : task.stats) {
+            int col = 0;
+            _table.setItem(row, col++, _number_item(pid));
+            _table.setItem(row, col++, new QTableWidgetItem(task_name));
+            _table.setItem(row, col++, new QTableWidgetItem(
+                QString(QChar(prev_state))));
+            _table.setItem(row, col++, _number_item(double(stats.count)));
+            _table.setItem(row, col++,
+                _number_item(_ns_to_us(double(stats.total_ns))));
+            _table.setItem(row, col++, _number_item(_ns_to_us(
+                double(stats.total_ns) / double(std::max<uint64_t>(stats.count, 1)))));
+            for (double percent : PERCENTILES) {
+                _table.setItem(row, col++, _number_item(_ns_to_us(
+                    double(stats.durations.percentile(percent)))));
+            }
+            _table.setItem(row, col++,
+                _number_item(_ns_to_us(double(stats.durations.max()))));
+
+            if (block_io && prev_state == 'D') {
+                const NapIoSummary io = block_io->summary(pid);
+                _table.setItem(row, col++, _number_item(double(io.n_naps)));
+                _table.setItem(row, col++, _number_item(double(io.n_requests)));
+                // Sectors are always 512 bytes in block events
+                _table.setItem(row, col++,
+                    _number_item(double(io.sectors) / 2));
+                QStringList devices;
+                for (uint32_t dev : io.devices) {
+                    devices << QString::fromStdString(naps_device_name(dev));
+                }
+                _table.setItem(row, col++,
+                    new QTableWidgetItem(devices.join(", ")));
+            }
+            ++row;
+        }
+    }
+    _table.resizeColumnsToContents();
+    _table.setSortingEnabled(true);
+}
+
+/**
+ * @brief Sets up columns of the statistics table.
+*/
+void NapStatsWindow::setup_table() {
+    const QStringList headers{"PID", "Comm", "State", "Count", "Total [us]",
+        "Mean [us]", "p50 [us]", "p90 [us]", "p99 [us]", "p99.9 [us]",
+        "Max [us]", "With I/O", "I/Os", "I/O [KiB]", "Devices"};
+    _table.setColumnCount(int(headers.size()));
+    _table.setHorizontalHeaderLabels(headers);
+    _table.setEditTriggers(QAbstractItemView::NoEditTriggers);
+}
+
+/**
+ * @brief Sets up the main layout of the statistics window.
+*/
+void NapStatsWindow::setup_layout() {
+    _choice_layout.addWidget(new QLabel("Stream:", this));
+    _choice_layout.addWidget(&_stream);
+    _choice_layout.addStretch();
+    _choice_layout.addWidget(&_show_button);
+
+    _layout.addLayout(&_choice_layout);
+    _layout.addWidget(&_table);
+    _layout.addWidget(&_close_button);
+
+    setLayout(&_layout);
+}
@@ -0,0 +1,67 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapStatsWindow.hpp
+ * @brief   Declaration of the window with statistics of naps of a loaded
+ *          data stream per task and prev_state, including percentiles of
+ *          nap durations.
+ *
+ * @note    Definitions in `NapStatsWindow.cpp`.
+*/
+
+#ifndef _NR_NAP_STATS_WINDOW_HPP
+#define _NR_NAP_STATS_WINDOW_HPP
+
+// C++
+#include <vector>
+
+// Qt
+#include <QtWidgets>
+
+/**
+ * @brief QtWidget's child class showing nap count, total and mean duration
+ * and percentiles of durations of every task and prev_state of a stream.
+ * Sorting by a percentile column finds tasks with long tails.
+*/
+class NapStatsWindow : public QWidget {
+// Non-Qt portion
+public: // Functions
+    explicit NapStatsWindow(QWidget* parent);
+    void load_streams();
+private:
+    void load_stats();
+private: // Data members
+    ///
+    /// @brief Identifiers of streams in the order of the combo box's items.
+    std::vector<int> _stream_ids;
+// Qt portion
+private: // Qt data members
+    ///
+    /// @brief Layout for the widget's control elements.
+    QVBoxLayout     _layout;
+
+    /// @brief Layout for the stream choice and the Show button.
+    QHBoxLayout     _choice_layout;
+
+    ///
+    /// @brief Stream whose statistics are shown.
+    QComboBox       _stream;
+
+    ///
+    /// @brief Table with the statistics.
+    QTableWidget    _table;
+
+public: // Qt data members
+    ///
+    /// @brief Button showing statistics of the chosen stream.
+    QPushButton     _show_button;
+
+    ///
+    /// @brief Close button for the widget.
+    QPushButton     _close_button;
+private: // "Only Qt"-relevant functions
+    void setup_table();
+    void setup_layout();
+};
+
+#endif // _NR_NAP_STATS_WINDOW_HPP
@@ -0,0 +1,526 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapTable.cpp
+ * @brief   Definitions of the plugin's nap table and global functions
+ *          of the core which need C++.
+*/
+
+// C
+#include <stdlib.h>
+
+// C++
+#include <algorithm>
+#include <queue>
+#include <string>
+
+// KernelShark
+#include "libkshark.h"
+
+// Plugin headers
+#include "NapTable.hpp"
+
+// Static functions
+
+/**
+ * @brief Gets bytes allocated by a vector, i.e. of its whole capacity.
+ *
+ * @param vec: The vector
+ *
+ * @returns Number of bytes of the vector's heap storage.
+*/
+template<typename T>
+static size_t _vector_mem_usage(const std::vector<T>& vec)
+{ return vec.capacity() * sizeof(T); }
+
+// Task table
+
+/**
+ * @brief Gets bytes of memory used by the task's naps, i.e. of all arrays
+ * and statistics, including histograms of durations and the index of the
+ * longest naps. Tree nodes of statistics are estimated as three pointers
+ * and a color on top of the stored pair, as in common implementations.
+ *
+ * @returns Number of bytes used by the task's table, without the size of
+ * the table object itself.
+*/
+size_t NapTaskTable::mem_usage() const {
+    constexpr size_t STATS_NODE_SIZE = 4 * sizeof(void*)
+        + sizeof(std::pair<const char, NapStateStats>);
+
+    size_t histograms = 0;
+    for (const auto& [prev_state, state_stats] : stats) {
+        histograms += state_stats.durations.mem_usage();
+    }
+
+    return _vector_mem_usage(start) + _vector_mem_usage(end)
+        + _vector_mem_usage(state) + _vector_mem_usage(switch_entry)
+        + _vector_mem_usage(waking_entry) + _vector_mem_usage(waker)
+        + _vector_mem_usage(switch_pos) + _vector_mem_usage(waking_pos)
+        + stats.size() * STATS_NODE_SIZE + histograms
+        + top_index.mem_usage();
+}
+
+/**
+ * @brief Finds naps of the task which overlap the given time range, using
+ * binary searches over the sorted starts and ends of naps.
+ *
+ * @param min_ts: Start of the time range
+ * @param max_ts: End of the time range
+ *
+ * @returns Pair of indices, first of the first overlapping nap and second
+ * one past the last overlapping nap. Both are equal if no nap overlaps.
+*/
+std::pair<size_t, size_t> NapTaskTable::in_range(int64_t min_ts,
+    int64_t max_ts) const
+{
+    auto first = std::lower_bound(end.begin(), end.end(), min_ts);
+    auto last = std::upper_bound(start.begin(), start.end(), max_ts);
+
+    size_t first_idx = first - end.begin();
+    size_t last_idx = last - start.begin();
+    return {first_idx, std::max(first_idx, last_idx)};
+}
+
+/**
+ * @brief Finds the last nap of the task which ended strictly before a time,
+ * using a binary search over the sorted ends of naps.
+ *
+ * @param ts: The time
+ *
+ * @returns Index of the nap or `size()` if no nap ended before the time.
+*/
+size_t NapTaskTable::last_ending_before(int64_t ts) const {
+    auto after = std::lower_bound(end.begin(), end.end(), ts);
+    return (after == end.begin()) ? size() : size_t(after - end.begin()) - 1;
+}
+
+/**
+ * @brief Finds the nap of the task in progress at a time, i.e. the nap
+ * which started at or before the time and ends at or after it.
+ *
+ * @param ts: The time
+ *
+ * @returns Index of the nap or `size()` if the task wasn't napping.
+*/
+size_t NapTaskTable::at(int64_t ts) const {
+    auto first = std::lower_bound(end.begin(), end.end(), ts);
+    size_t idx = size_t(first - end.begin());
+    return (idx < size() && start[idx] <= ts) ? idx : size();
+}
+
+// Nap table
+
+/**
+ * @brief Constructor of the nap table, pairs collected events into naps.
+ * Events are sorted first, if they aren't yet.
+ *
+ * @param events: Container of collected sched_switch and sched_waking events
+ * @param switch_id: Numerical id of `sched/sched_switch` event
+ * @param waking_id: Numerical id of `sched/sched_waking` event
+ * @param ingest_order: Positions of the (sorted) events in the order of
+ * ingestion, may be null. Only tables which know them can be cached.
+ * @param until: Only events older than this are paired, the rest is left
+ * pending for `extend`
+*/
+NapTable::NapTable(kshark_data_container* events, int switch_id,
+    int waking_id, const uint32_t* ingest_order, int64_t until)
+    : _switch_id(switch_id), _waking_id(waking_id)
+{
+    if (!events->sorted) {
+        kshark_data_container_sort(events);
+        // Positions would no longer match
+        ingest_order = nullptr;
+    }
+    _has_positions = (ingest_order != nullptr);
+
+    _pair(events, ingest_order, until);
+}
+
+/**
+ * @brief Gets the nap table of a plugin context, building it first if
+ * this hasn't happened yet. Building is deferred until the naps are
+ * needed, as only then all events are surely loaded. If the build was
+ * scheduled on the thread pool (see `NapBuildScheduler`), it's waited for.
+ *
+ * @param ctx: Pointer to the plugin's context
+ *
+ * @returns Pointer to the nap table or null if the context has no
+ * collected events.
+*/
+NapTable* NapTable::from_context(plugin_naps_context* ctx) {
+    naps_wait_build(ctx);
+    return update_context(ctx);
+}
+
+/**
+ * @brief Brings the nap table of a plugin context up to date with the
+ * collected events, building it if there's none. A table cached from
+ * the previous activation on the same data is reused, if it matches the
+ * collected events. Events collected after the table was built, when the
+ * trace file is tailed, extend it.
+ *
+ * @param ctx: Pointer to the plugin's context, with no pending build
+ * other than the calling one
+ *
+ * @returns Pointer to the nap table or null if the context has no
+ * collected events.
+*/
+NapTable* NapTable::update_context(plugin_naps_context* ctx) {
+    if (!ctx || !ctx->collected_events) return nullptr;
+
+    // Events of a followed file wait until every CPU has caught up
+    const int64_t until = naps_pairing_limit(ctx);
+
+    if (!ctx->nap_table && ctx->cached_table) {
+        // Table from the previous activation, events were collected anew
+        NapTable* cached = ctx->cached_table;
+        ctx->cached_table = nullptr;
+
+        // Positions refer to the order of ingestion, rebind before merging
+        if (cached->rebind(ctx->collected_events)) {
+            ctx->nap_table = cached;
+        } else {
+            delete cached;
+        }
+        naps_merge_collected_events(ctx);
+    }
+
+    if (ctx->nap_table && ctx->collected_events->size > ctx->nap_table->n_events()) {
+        // Events were appended by tailing the trace file, pair only those
+        naps_merge_collected_events(ctx);
+        if (!ctx->nap_table->extend(ctx->collected_events, until)) {
+            // Derived structures point to the table, drop them with it
+            naps_free_geometry_pass(ctx->geometry_pass);
+            ctx->geometry_pass = nullptr;
+            naps_free_comm_aggregate(ctx->comm_aggregate);
+            ctx->comm_aggregate = nullptr;
+            naps_free_node_aggregate(ctx->node_aggregate);
+            ctx->node_aggregate = nullptr;
+            naps_free_block_io(ctx->block_io);
+            ctx->block_io = nullptr;
+            delete ctx->nap_table;
+            ctx->nap_table = nullptr;
+        }
+    }
+
+    if (!ctx->nap_table) {
+        naps_merge_collected_events(ctx);
+        ctx->nap_table = new NapTable{ctx->collected_events,
+            ctx->sswitch_event_id, ctx->waking_event_id, ctx->ingest_order,
+            until};
+    }
+
+    free(ctx->ingest_order);
+    ctx->ingest_order = nullptr;
+
+    return ctx->nap_table;
+}
+
+/**
+ * @brief Gets bytes of memory used by the nap table - its hash maps
+ * of tasks and open naps (buckets and nodes) and tables of all tasks.
+ *
+ * @returns Number of bytes used by the table, including the table object.
+*/
+size_t NapTable::mem_usage() const {
+    constexpr size_t TASK_NODE_SIZE = 2 * sizeof(void*)
+        + sizeof(std::pair<const int32_t, NapTaskTable>);
+
+    constexpr size_t OPEN_NODE_SIZE = 2 * sizeof(void*)
+        + sizeof(std::pair<const int32_t, OpenNap>);
+
+    size_t bytes = sizeof(*this) + _tasks.bucket_count() * sizeof(void*)
+        + _tasks.size() * TASK_NODE_SIZE
+        + _open_naps.bucket_count() * sizeof(void*)
+        + _open_naps.size() * OPEN_NODE_SIZE;
+    for (const auto& [pid, task] : _tasks) {
+        bytes += task.mem_usage();
+    }
+    return bytes;
+}
+
+/**
+ * @brief Detaches the table from loaded entries, so that it can outlive
+ * them in the cache. Only positions of the naps' events remain.
+ *
+ * @returns True if the table can be cached, i.e. it knows positions of
+ * its events, false otherwise.
+*/
+bool NapTable::unbind() {
+    if (!_has_positions) return false;
+
+    for (auto& [pid, task] : _tasks) {
+        std::fill(task.switch_entry.begin(), task.switch_entry.end(), nullptr);
+        std::fill(task.waking_entry.begin(), task.waking_entry.end(), nullptr);
+    }
+    for (auto& [pid, open] : _open_naps) open.entry = nullptr;
+    return true;
+}
+
+/**
+ * @brief Attaches a cached table to newly loaded entries using positions of
+ * the naps' events in the order of ingestion. Events must be collected from
+ * the same data as before and not sorted yet. Every rebound entry is checked
+ * against the nap's timestamp.
+ *
+ * @param events: Container of newly collected events, in ingestion order
+ *
+ * @returns True if the table matches the events and was attached,
+ * false otherwise, in which case the table is unusable.
+*/
+bool NapTable::rebind(kshark_data_container* events) {
+    if (!_has_positions || events->sorted || events->size != _n_events) {
+        return false;
+    }
+
+    for (auto& [pid, task] : _tasks) {
+        for (size_t i = 0; i < task.size(); ++i) {
+            const kshark_entry* switch_entry = events->data[task.switch_pos[i]]->entry;
+            const kshark_entry* waking_entry = events->data[task.waking_pos[i]]->entry;
+            if (switch_entry->ts != task.start[i] || waking_entry->ts != task.end[i]) {
+                return false;
+            }
+
+            task.switch_entry[i] = switch_entry;
+            task.waking_entry[i] = waking_entry;
+        }
+    }
+    for (auto& [pid, open] : _open_naps) {
+        open.entry = events->data[open.pos]->entry;
+    }
+    return true;
+}
+
+/**
+ * @brief Extends the table in place with events collected after it was
+ * built, e.g. records appended to a growing trace file, and with events
+ * left pending by the previous pairing limit. Only these are paired - they
+ * may close naps left open before. Events must be sorted and the unpaired
+ * ones must not be older than the last paired event, which holds if the
+ * limits come from `naps_pairing_limit`.
+ *
+ * @param events: Container of collected events, the paired ones first
+ * @param until: Only events older than this are paired, the rest stays
+ * pending
+ *
+ * @returns True if the table was extended (or there was nothing new to
+ * pair), false if the events don't continue the table, which is then
+ * unchanged.
+*/
+bool NapTable::extend(kshark_data_container* events, int64_t until) {
+    if (!events->sorted || events->size < _n_events) return false;
+    if (events->size == _n_events) return true;
+    if (_n_events && (events->data[_n_events - 1]->entry->ts != _last_ts
+                      || events->data[_n_events]->entry->ts < _last_ts)) {
+        return false;
+    }
+    // Pending events only, nothing changes
+    if (events->data[_n_events]->entry->ts >= until) return true;
+
+    // Positions of the new events aren't known, the table can't be cached
+    _has_positions = false;
+    ++_generation;
+    _extended_from = INT64_MAX;
+    _pair(events, nullptr, until);
+    return true;
+}
+
+/**
+ * @brief Gets naps of a task.
+ *
+ * @param pid: PID of the task
+ *
+ * @returns Pointer to the task's naps or null if the task has no naps.
+*/
+const NapTaskTable* NapTable::task(int32_t pid) const {
+    auto found = _tasks.find(pid);
+    return (found != _tasks.end()) ? &found->second : nullptr;
+}
+
+/**
+ * @brief Pairs collected events not paired yet into naps, continuing with
+ * naps left open by previously paired events. Pairing stops at the first
+ * event which isn't older than the limit.
+ *
+ * @param events: Container of sorted collected events
+ * @param ingest_order: Positions of the events in the order of ingestion,
+ * used only if the table has positions
+ * @param until: Only events older than this are paired
+*/
+void NapTable::_pair(kshark_data_container* events,
+    const uint32_t* ingest_order, int64_t until)
+{
+    ssize_t i = _n_events;
+    for (; i < events->size; ++i) {
+        const kshark_entry* entry = events->data[i]->entry;
+        const int64_t field = events->data[i]->field;
+        // Records appended later may still precede this one
+        if (entry->ts >= until) break;
+
+        if (entry->event_id == _switch_id) {
+            // Only the first switch opens a nap, see class description
+            _open_naps.try_emplace(entry->pid, OpenNap{entry, field,
+                _has_positions ? ingest_order[i] : 0});
+            continue;
+        }
+
+        int32_t wakee = NAPS_WAKING_WAKEE(field);
+        if (entry->event_id != _waking_id || wakee < 0) continue;
+
+        auto open = _open_naps.find(wakee);
+        if (open == _open_naps.end()) continue;
+
+        const OpenNap opened = open->second;
+        _open_naps.erase(open);
+
+        NapTaskTable& task = _tasks[wakee];
+        // Parsing the info string is only a fallback, if prev_state
+        // couldn't be read during loading
+        const char prev_state = (opened.field >= 0)
+            ? NAPS_SWITCH_PREV_STATE(opened.field)
+            : get_switch_prev_state(opened.entry);
+        task.start.push_back(opened.entry->ts);
+        task.end.push_back(entry->ts);
+        task.state.push_back(prev_state);
+        task.switch_entry.push_back(opened.entry);
+        task.waking_entry.push_back(entry);
+        task.waker.push_back(NAPS_WAKING_WAKER(field));
+        if (_has_positions) {
+            task.switch_pos.push_back(opened.pos);
+            task.waking_pos.push_back(ingest_order[i]);
+        }
+
+        NapStateStats& stats = task.stats[prev_state];
+        const int64_t duration = entry->ts - opened.entry->ts;
+        ++stats.count;
+        stats.total_ns += duration;
+        stats.durations.record(duration);
+
+        _extended_from = std::min(_extended_from, opened.entry->ts);
+        ++_n_naps;
+    }
+
+    if (i > _n_events) {
+        _last_ts = events->data[i - 1]->entry->ts;
+        _n_events = i;
+    }
+
+    // Only tasks with new naps have anything to index
+    for (auto& [pid, task] : _tasks) {
+        task.top_index.update(task.start, task.end);
+    }
+}
+
+// Global functions
+
+/**
+ * @brief Gets the abbreviated name of a prev_state from the info field of a
+ * KernelShark entry, leveraging the specific format of information strings
+ * of entries in KernelShark.
+ *
+ * @param entry: `sched/sched_switch` event entry whose prev_state we wish to get
+ *
+ * @returns Char representing the abbreviated previous state of the task.
+ */
+char get_switch_prev_state(const kshark_entry* entry) {
+    auto info_as_str = std::string(kshark_get_info(entry));
+    std::size_t start = info_as_str.find(" ==>");
+    char prev_state = info_as_str.substr(start - 1, 1)[0];
+    return prev_state;
+}
+
+// Functions defined in C header
+
+/**
+ * @brief Frees a nap table, used when the plugin's context is freed.
+ *
+ * @param table: Pointer to the nap table to free (may be null)
+*/
+void naps_free_nap_table(struct NapTable* table) {
+    delete table;
+}
+
+/**
+ * @brief Sorts collected events of a context by time with a k-way merge of
+ * the runs of time-ordered events noted during ingestion, which is cheaper
+ * than sorting them as a whole. Falls back to KernelShark's sort, if runs
+ * weren't tracked. Afterwards, the sorted events form a single run, so
+ * that events collected later are tracked correctly. Positions of merged
+ * events in the order of ingestion are kept in the context, until the nap
+ * table is built.
+ *
+ * @param ctx: Pointer to the plugin's context
+*/
+void naps_merge_collected_events(struct plugin_naps_context* ctx) {
+    kshark_data_container* events = ctx ? ctx->collected_events : nullptr;
+    if (!events || events->sorted) return;
+
+    free(ctx->ingest_order);
+    ctx->ingest_order = nullptr;
+
+    if (ctx->runs_lost || ctx->n_runs == 0) {
+        kshark_data_container_sort(events);
+        return;
+    }
+
+    // Positions are remembered only if they fit, else tables aren't cached
+    uint32_t* order = nullptr;
+    if (events->size <= ssize_t(UINT32_MAX)) {
+        order = static_cast<uint32_t*>(malloc(events->size * sizeof(uint32_t)));
+    }
+
+    // Cursors into the runs, as [position, end) pairs
+    std::vector<std::pair<ssize_t, ssize_t>> runs;
+    runs.reserve(ctx->n_runs);
+    for (size_t r = 0; r < ctx->n_runs; ++r) {
+        ssize_t end = (r + 1 < ctx->n_runs) ? ctx->run_starts[r + 1]
+                                            : events->size;
+        ssize_t begin = std::min(ctx->run_starts[r], events->size);
+        if (begin < end) runs.emplace_back(begin, std::min(end, events->size));
+    }
+
+    if (runs.size() > 1) {
+        auto head_ts = [&](size_t r) {
+            return events->data[runs[r].first]->entry->ts;
+        };
+        // Earlier run wins ties, which keeps the merge stable
+        auto is_later = [&](size_t a, size_t b) {
+            int64_t ts_a = head_ts(a), ts_b = head_ts(b);
+            return (ts_a != ts_b) ? ts_a > ts_b : a > b;
+        };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(is_later)>
+            heads{is_later};
+        for (size_t r = 0; r < runs.size(); ++r) heads.push(r);
+
+        std::vector<kshark_data_field_int64*> merged;
+        merged.reserve(events->size);
+        while (!heads.empty()) {
+            size_t r = heads.top();
+            heads.pop();
+            if (order) order[merged.size()] = uint32_t(runs[r].first);
+            merged.push_back(events->data[runs[r].first++]);
+            if (runs[r].first < runs[r].second) heads.push(r);
+        }
+
+        std::copy(merged.begin(), merged.end(), events->data);
+    } else if (order) {
+        for (ssize_t i = 0; i < events->size; ++i) order[i] = uint32_t(i);
+    }
+
+    ctx->ingest_order = order;
+    events->sorted = true;
+    ctx->run_starts[0] = 0;
+    ctx->n_runs = 1;
+}
+
+/**
+ * @brief Gets bytes of memory used by a nap table, see `NapTable::mem_usage`.
+ *
+ * @param table: Pointer to the nap table (may be null)
+ *
+ * @returns Number of bytes used by the table, zero if there is none.
+*/
+size_t naps_nap_table_mem_usage(const struct NapTable* table) {
+    return table ? table->mem_usage() : 0;
+}
@@ -0,0 +1,194 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapTable.hpp
+ * @brief   Declarations of the plugin's nap table - naps paired from
+ *          collected events, indexed per task and with basic statistics.
+ *          Part of the Qt-free core of the plugin.
+ *
+ * @note    Nap := space in the histogram between a sched_switch and
+ *          the closest next sched_waking event in the task plot.
+ * @note    Definitions in `NapTable.cpp`.
+*/
+
+#ifndef _NR_NAP_TABLE_HPP
+#define _NR_NAP_TABLE_HPP
+
+// C++
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// KernelShark
+#include "libkshark.h"
+
+// Plugin
+#include "naps_core.h"
+#include "NapHistogram.hpp"
+#include "NapTopIndex.hpp"
+
+/**
+ * @brief Statistics of naps of one task in one prev_state.
+*/
+struct NapStateStats {
+    ///
+    /// @brief Number of naps.
+    uint64_t count{0};
+    ///
+    /// @brief Sum of durations of the naps, in nanoseconds.
+    int64_t total_ns{0};
+    ///
+    /// @brief Histogram of durations of the naps, in nanoseconds.
+    NapHistogram durations;
+};
+
+/**
+ * @brief Naps of a single task, stored as a structure of arrays ordered
+ * by time. Naps of one task never overlap, so both the starts and the ends
+ * are sorted, which makes them directly usable as an index over time.
+*/
+struct NapTaskTable {
+    ///
+    /// @brief Timestamps of sched_switch events starting the naps.
+    std::vector<int64_t> start;
+    ///
+    /// @brief Timestamps of sched_waking events ending the naps.
+    std::vector<int64_t> end;
+    ///
+    /// @brief Abbreviated prev_states of the naps' sched_switch events.
+    std::vector<char> state;
+    ///
+    /// @brief Observers of the sched_switch entries starting the naps.
+    std::vector<const kshark_entry*> switch_entry;
+    ///
+    /// @brief Observers of the sched_waking entries ending the naps.
+    std::vector<const kshark_entry*> waking_entry;
+    ///
+    /// @brief PIDs of the tasks which woke the task up, negative if unknown.
+    std::vector<int32_t> waker;
+    ///
+    /// @brief Positions of the sched_switch events in the order of
+    /// ingestion, used to reattach a cached table to reloaded entries.
+    std::vector<uint32_t> switch_pos;
+    ///
+    /// @brief Positions of the sched_waking events in the order of
+    /// ingestion, used to reattach a cached table to reloaded entries.
+    std::vector<uint32_t> waking_pos;
+    ///
+    /// @brief Statistics of the task's naps per prev_state.
+    std::map<char, NapStateStats> stats;
+    ///
+    /// @brief Index of the longest naps of time ranges.
+    NapTopIndex top_index;
+public:
+    /// @brief Returns the number of naps of the task.
+    size_t size() const { return start.size(); }
+    size_t mem_usage() const;
+    std::pair<size_t, size_t> in_range(int64_t min_ts, int64_t max_ts) const;
+    size_t last_ending_before(int64_t ts) const;
+    size_t at(int64_t ts) const;
+};
+
+/**
+ * @brief Naps of all tasks of a data stream, paired from the collected
+ * sched_switch and sched_waking events.
+ *
+ * Pairing follows how KernelShark's interval plots pair events - a
+ * sched_switch opens a nap of its task (if none is open yet) and the first
+ * following sched_waking of that task closes it. No event is ever a part
+ * of two naps.
+ *
+ * Events of a followed trace file are paired only up to a limit (see
+ * `naps_pairing_limit`), so that records appended later never precede the
+ * paired ones - events from the limit on stay pending in the container and
+ * are paired by a later extension.
+ *
+ * Unlike interval plots, pairing ignores KernelShark's filters - the table
+ * is built once from all collected events, so that it doesn't depend on
+ * the filters at the time of the first draw. Filters only hide naps when
+ * drawing, a nap is drawn only if both its events are visible.
+*/
+class NapTable {
+private: // Types
+    /**
+     * @brief Sched_switch which opened a nap not closed by any event yet.
+    */
+    struct OpenNap {
+        ///
+        /// @brief Observer of the sched_switch entry.
+        const kshark_entry* entry;
+        ///
+        /// @brief Auxiliary field of the collected sched_switch.
+        int64_t field;
+        ///
+        /// @brief Position of the sched_switch in the order of ingestion.
+        uint32_t pos;
+    };
+private: // Data members
+    ///
+    /// @brief Naps of each task, keyed by PID.
+    std::unordered_map<int32_t, NapTaskTable> _tasks;
+    ///
+    /// @brief Naps opened by the last paired events, keyed by PID. Kept, so
+    /// that events collected later can close them.
+    std::unordered_map<int32_t, OpenNap> _open_naps;
+    ///
+    /// @brief Total number of naps in the table.
+    size_t _n_naps{0};
+    ///
+    /// @brief Number of collected events paired so far. Events after them
+    /// are pending, if they weren't older than the pairing limit.
+    ssize_t _n_events{0};
+    ///
+    /// @brief Numerical id of `sched/sched_switch` event.
+    int _switch_id;
+    ///
+    /// @brief Numerical id of `sched/sched_waking` event.
+    int _waking_id;
+    ///
+    /// @brief Whether positions of the naps' events are known.
+    bool _has_positions{false};
+    ///
+    /// @brief Timestamp of the last paired event.
+    int64_t _last_ts{INT64_MIN};
+    ///
+    /// @brief Number of times the table was extended.
+    uint64_t _generation{0};
+    ///
+    /// @brief Earliest start of naps added by the last extension.
+    int64_t _extended_from{INT64_MAX};
+public: // Functions
+    explicit NapTable(kshark_data_container* events, int switch_id,
+        int waking_id, const uint32_t* ingest_order = nullptr,
+        int64_t until = INT64_MAX);
+
+    static NapTable* from_context(plugin_naps_context* ctx);
+    static NapTable* update_context(plugin_naps_context* ctx);
+
+    const NapTaskTable* task(int32_t pid) const;
+    /// @brief Returns naps of all tasks, keyed by PID.
+    const std::unordered_map<int32_t, NapTaskTable>& tasks() const
+    { return _tasks; }
+    /// @brief Returns the total number of naps in the table.
+    size_t size() const { return _n_naps; }
+    /// @brief Returns the number of collected events paired so far.
+    ssize_t n_events() const { return _n_events; }
+    /// @brief Returns the number of times the table was extended.
+    uint64_t generation() const { return _generation; }
+    /// @brief Returns the earliest start of naps added by the last extension.
+    int64_t extended_from() const { return _extended_from; }
+    size_t mem_usage() const;
+
+    bool extend(kshark_data_container* events, int64_t until = INT64_MAX);
+    bool unbind();
+    bool rebind(kshark_data_container* events);
+private: // Functions
+    void _pair(kshark_data_container* events, const uint32_t* ingest_order,
+        int64_t until);
+};
+
+char get_switch_prev_state(const kshark_entry* entry);
+
+#endif // _NR_NAP_TABLE_HPP
@@ -0,0 +1,198 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapTableCache.cpp
+ * @brief   Definitions of the plugin's session cache of nap tables.
+*/
+
+// C
+#include <sys/stat.h>
+
+// C++
+#include <algorithm>
+
+// Plugin headers
+#include "NapTableCache.hpp"
+
+// Member functions
+
+/**
+ * @brief Gets identity of the data loaded in a stream.
+ *
+ * @param stream: KernelShark's data stream
+ * @param ctx: Plugin's context of the stream, with event ids already found
+ * @param identity: Filled identity
+ *
+ * @returns True if the stream's data can be identified, i.e. they are
+ * loaded from an existing file, false otherwise.
+*/
+bool NapStreamIdentity::of_stream(const kshark_data_stream* stream,
+    const plugin_naps_context* ctx, NapStreamIdentity& identity)
+{
+    struct stat file_stat;
+    if (!stream || !ctx || !stream->file || stat(stream->file, &file_stat)) {
+        return false;
+    }
+
+    identity.file = stream->file;
+    identity.device = file_stat.st_dev;
+    identity.inode = file_stat.st_ino;
+    identity.size = file_stat.st_size;
+    identity.mtime_ns = int64_t(file_stat.st_mtim.tv_sec) * 1000000000
+                        + file_stat.st_mtim.tv_nsec;
+    identity.excluded_states = ctx->excluded_states;
+    identity.switch_id = ctx->sswitch_event_id;
+    identity.waking_id = ctx->waking_event_id;
+    return true;
+}
+
+/**
+ * @brief Gets the cache. Utilizes Meyers singleton creation
+ * (static local variable).
+ *
+ * @returns Reference to the cache.
+*/
+NapTableCache& NapTableCache::get_instance() {
+    static NapTableCache instance;
+    return instance;
+}
+
+/**
+ * @brief Caches a table, replacing any older table of the same file and
+ * dropping the least recent ones, until both the number of tables and
+ * their bytes fit the capacities. A table which alone doesn't fit isn't
+ * cached at all.
+ *
+ * @param identity: Identity of the data the table was built from
+ * @param table: Nap table unbound from entries, ownership is taken
+*/
+void NapTableCache::put(const NapStreamIdentity& identity, NapTable* table) {
+    std::unique_ptr<NapTable> owned{table};
+    const size_t bytes = _entry_mem_usage(identity, *owned);
+    std::lock_guard lock{_mutex};
+
+    for (auto cached = _tables.begin(); cached != _tables.end();) {
+        if (cached->first.file == identity.file) {
+            _bytes -= _entry_mem_usage(cached->first, *cached->second);
+            cached = _tables.erase(cached);
+        } else {
+            ++cached;
+        }
+    }
+    if (bytes > CAPACITY_BYTES) return;
+
+    while (!_tables.empty() && (_tables.size() >= CAPACITY
+                                || _bytes + bytes > CAPACITY_BYTES)) {
+        _pop_front();
+    }
+    _tables.emplace_back(identity, std::move(owned));
+    _bytes += bytes;
+}
+
+/**
+ * @brief Removes a table of the same data from the cache.
+ *
+ * @param identity: Identity of the data loaded in a stream
+ *
+ * @returns Owning pointer to the cached table or null if there's none.
+*/
+NapTable* NapTableCache::take(const NapStreamIdentity& identity) {
+    std::lock_guard lock{_mutex};
+
+    auto cached = std::find_if(_tables.begin(), _tables.end(),
+        [&identity](const auto& c) { return c.first == identity; });
+    if (cached == _tables.end()) return nullptr;
+
+    _bytes -= _entry_mem_usage(cached->first, *cached->second);
+    NapTable* table = cached->second.release();
+    _tables.erase(cached);
+    return table;
+}
+
+/**
+ * @brief Gets bytes of memory used by all cached tables.
+ *
+ * @returns Number of bytes used by the cached tables.
+*/
+size_t NapTableCache::mem_usage() {
+    std::lock_guard lock{_mutex};
+    return _bytes;
+}
+
+/**
+ * @brief Gets bytes of memory used by a cached table with its identity.
+ * Cached tables are unbound and never change, so neither does the result.
+ *
+ * @param identity: Identity of the data the table was built from
+ * @param table: The table
+ *
+ * @returns Number of bytes used by the table and the identity's path.
+*/
+size_t NapTableCache::_entry_mem_usage(const NapStreamIdentity& identity,
+    const NapTable& table)
+{
+    return table.mem_usage() + identity.file.capacity();
+}
+
+/**
+ * @brief Drops the least recent cached table. The cache must be locked
+ * and not empty.
+*/
+void NapTableCache::_pop_front() {
+    _bytes -= _entry_mem_usage(_tables.front().first, *_tables.front().second);
+    _tables.pop_front();
+}
+
+// Functions defined in C header
+
+/**
+ * @brief Takes a table of the data loaded in a stream from the cache.
+ * Must be called once the context's event ids are set.
+ *
+ * @param stream: KernelShark's data stream being initialized
+ * @param ctx: Plugin's context of the stream
+ *
+ * @returns Owning pointer to the cached table, still unbound from entries,
+ * or null if there's none.
+*/
+struct NapTable* naps_take_cached_table(struct kshark_data_stream* stream,
+    const struct plugin_naps_context* ctx)
+{
+    NapStreamIdentity identity;
+    if (!NapStreamIdentity::of_stream(stream, ctx, identity)) return nullptr;
+
+    return NapTableCache::get_instance().take(identity);
+}
+
+/**
+ * @brief Moves the nap table of a context into the cache, if it can be
+ * reattached to entries later. Geometry computed from the table must
+ * already be freed.
+ *
+ * @param stream: KernelShark's data stream being deinitialized
+ * @param ctx: Plugin's context of the stream
+*/
+void naps_cache_nap_table(struct kshark_data_stream* stream,
+    struct plugin_naps_context* ctx)
+{
+    NapStreamIdentity identity;
+    if (!ctx || !ctx->nap_table
+        || !NapStreamIdentity::of_stream(stream, ctx, identity)
+        || !ctx->nap_table->unbind())
+    {
+        return;
+    }
+
+    NapTableCache::get_instance().put(identity, ctx->nap_table);
+    ctx->nap_table = nullptr;
+}
+
+/**
+ * @brief Gets bytes of memory used by nap tables in the session cache,
+ * which are shared by all streams rather than used by any of them.
+ *
+ * @returns Number of bytes used by the cached tables.
+*/
+size_t naps_cache_mem_usage(void) {
+    return NapTableCache::get_instance().mem_usage();
+}
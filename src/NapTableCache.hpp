@@ -0,0 +1,111 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapTableCache.hpp
+ * @brief   Declarations of the plugin's session cache of nap tables, which
+ *          keeps naps of a stream over deactivation and reactivation of the
+ *          plugin. Part of the Qt-free core of the plugin.
+ *
+ * @note    Definitions in `NapTableCache.cpp`.
+*/
+
+#ifndef _NR_NAP_TABLE_CACHE_HPP
+#define _NR_NAP_TABLE_CACHE_HPP
+
+// C
+#include <sys/types.h>
+
+// C++
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// KernelShark
+#include "libkshark.h"
+
+// Plugin
+#include "naps_core.h"
+#include "NapTable.hpp"
+
+/**
+ * @brief Identity of the data a nap table was built from. Tables are reused
+ * only for the same file, unchanged since, and collected with the same
+ * settings.
+*/
+struct NapStreamIdentity {
+    ///
+    /// @brief Path to the trace file.
+    std::string file;
+    ///
+    /// @brief Device of the trace file.
+    dev_t device{0};
+    ///
+    /// @brief Inode of the trace file.
+    ino_t inode{0};
+    ///
+    /// @brief Size of the trace file in bytes.
+    off_t size{0};
+    ///
+    /// @brief Last modification of the trace file, in nanoseconds.
+    int64_t mtime_ns{0};
+    ///
+    /// @brief Mask of prev_states excluded during loading.
+    uint16_t excluded_states{0};
+    ///
+    /// @brief Numerical id of `sched/sched_switch` event.
+    int switch_id{-1};
+    ///
+    /// @brief Numerical id of `sched/sched_waking` event.
+    int waking_id{-1};
+public:
+    static bool of_stream(const kshark_data_stream* stream,
+        const plugin_naps_context* ctx, NapStreamIdentity& identity);
+    bool operator==(const NapStreamIdentity&) const = default;
+};
+
+/**
+ * @brief Singleton cache of nap tables of deactivated streams. Updating a
+ * plugin deactivates and reactivates it, after which KernelShark reloads
+ * the data, so without the cache all naps would be paired again.
+ *
+ * Cached tables are unbound from entries, as these don't outlive the
+ * plugin's context. Only a few most recent tables are kept, at most one per
+ * trace file and at most `CAPACITY_BYTES` in total. Only the plugin caches
+ * tables, headless sessions don't (see `naps_core_deinit`).
+*/
+class NapTableCache {
+private: // Data members
+    ///
+    /// @brief Cached tables with their identities, most recent last.
+    std::deque<std::pair<NapStreamIdentity, std::unique_ptr<NapTable>>> _tables;
+    ///
+    /// @brief Bytes of memory used by the cached tables.
+    size_t _bytes{0};
+    ///
+    /// @brief Guards the cached tables.
+    std::mutex _mutex;
+public: // Data members
+    ///
+    /// @brief Maximum number of cached tables.
+    static constexpr size_t CAPACITY = 8;
+    ///
+    /// @brief Maximum number of bytes used by cached tables.
+    static constexpr size_t CAPACITY_BYTES = size_t(256) << 20;
+public: // Functions
+    static NapTableCache& get_instance();
+    void put(const NapStreamIdentity& identity, NapTable* table);
+    NapTable* take(const NapStreamIdentity& identity);
+    size_t mem_usage();
+
+    NapTableCache(const NapTableCache&) = delete;
+    NapTableCache& operator=(const NapTableCache&) = delete;
+private: // Functions
+    NapTableCache() = default;
+    static size_t _entry_mem_usage(const NapStreamIdentity& identity,
+        const NapTable& table);
+    void _pop_front();
+};
+
+#endif // _NR_NAP_TABLE_CACHE_HPP
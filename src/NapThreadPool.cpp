@@ -0,0 +1,179 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapThreadPool.cpp
+ * @brief   Definitions of the plugin's pool of worker threads.
+*/
+
+// C
+#include <cstdlib>
+
+// C++
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+// Plugin headers
+#include "NapThreadPool.hpp"
+
+// Static variables
+
+///
+/// @brief Index of the pool's worker running on this thread, `SIZE_MAX`
+/// on threads outside the pool.
+static thread_local size_t current_worker = SIZE_MAX;
+
+///
+/// @brief How long a thread waiting for a job sleeps when there's nothing
+/// to run meanwhile, before looking into the queues again.
+static constexpr std::chrono::microseconds WAIT_POLL{200};
+
+// Member functions
+
+/**
+ * @brief Gets the pool, starting its workers on first use. Utilizes Meyers
+ * singleton creation (static local variable). Number of workers can be
+ * overridden by the `NAPS_THREADS` environment variable.
+ *
+ * @returns Reference to the pool.
+*/
+NapThreadPool& NapThreadPool::get_instance() {
+    static NapThreadPool instance{[]() -> size_t {
+        const char* threads = std::getenv(NAPS_THREADS_ENV);
+        if (threads) return size_t(std::max(0, std::atoi(threads)));
+        return std::max(1u, std::thread::hardware_concurrency()) - 1;
+    }()};
+    return instance;
+}
+
+/**
+ * @brief Constructor of the pool, starts the workers.
+ *
+ * @param n_workers: Number of worker threads, may be zero, in which case
+ * jobs run right away on the submitting thread.
+*/
+NapThreadPool::NapThreadPool(size_t n_workers) {
+    _queues.reserve(n_workers);
+    for (size_t i = 0; i < n_workers; ++i) {
+        _queues.push_back(std::make_unique<Queue>());
+    }
+
+    _workers.reserve(n_workers);
+    for (size_t i = 0; i < n_workers; ++i) {
+        _workers.emplace_back(&NapThreadPool::_work, this, i);
+    }
+}
+
+/**
+ * @brief Destructor of the pool, lets workers finish queued jobs
+ * and joins them.
+*/
+NapThreadPool::~NapThreadPool() {
+    {
+        std::lock_guard lock{_mutex};
+        _stop = true;
+    }
+    _wake_up.notify_all();
+
+    for (std::thread& worker : _workers) {
+        worker.join();
+    }
+}
+
+/**
+ * @brief Queues a job for the workers. A worker queues it into its own
+ * queue, other threads into the queues in turn.
+ *
+ * @param job: The job to run
+ *
+ * @returns Future which becomes ready once the job has finished.
+*/
+std::future<void> NapThreadPool::submit(std::function<void()> job) {
+    std::packaged_task<void()> task{std::move(job)};
+    std::future<void> done = task.get_future();
+
+    if (_workers.empty()) {
+        task();
+        return done;
+    }
+
+    const size_t target = (current_worker < _queues.size())
+        ? current_worker : _next_queue++ % _queues.size();
+    {
+        std::lock_guard lock{_queues[target]->mutex};
+        _queues[target]->jobs.push_back(std::move(task));
+    }
+    ++_n_queued;
+
+    // Taking the lock orders the count before any worker's check of it
+    { std::lock_guard lock{_mutex}; }
+    _wake_up.notify_one();
+    return done;
+}
+
+/**
+ * @brief Waits for a job, running queued jobs meanwhile. Use instead of
+ * waiting on the future directly where the waiting thread may be a worker,
+ * e.g. in jobs which submit jobs of their own.
+ *
+ * @param done: Future of the job
+*/
+void NapThreadPool::wait(std::future<void>& done) {
+    const size_t self = current_worker;
+    while (done.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        if (!_run_one(self)) done.wait_for(WAIT_POLL);
+    }
+}
+
+/**
+ * @brief Runs one queued job - the newest of the thread's own queue, or
+ * else the oldest of another queue.
+ *
+ * @param self: Index of the calling worker, `SIZE_MAX` outside the pool
+ *
+ * @returns True if a job was run, false if all queues were empty.
+*/
+bool NapThreadPool::_run_one(size_t self) {
+    std::packaged_task<void()> task;
+    const size_t n_queues = _queues.size();
+
+    if (self < n_queues) {
+        Queue& own = *_queues[self];
+        std::lock_guard lock{own.mutex};
+        if (!own.jobs.empty()) {
+            task = std::move(own.jobs.back());
+            own.jobs.pop_back();
+        }
+    }
+
+    for (size_t i = 1; !task.valid() && i <= n_queues; ++i) {
+        Queue& other = *_queues[(self < n_queues ? self + i : i) % n_queues];
+        std::lock_guard lock{other.mutex};
+        if (!other.jobs.empty()) {
+            task = std::move(other.jobs.front());
+            other.jobs.pop_front();
+        }
+    }
+
+    if (!task.valid()) return false;
+    --_n_queued;
+    task();
+    return true;
+}
+
+/**
+ * @brief Loop of a worker thread, runs jobs of its own queue or stolen
+ * from others until the pool stops and all queues are empty.
+ *
+ * @param self: Index of the worker
+*/
+void NapThreadPool::_work(size_t self) {
+    current_worker = self;
+    while (true) {
+        if (_run_one(self)) continue;
+
+        std::unique_lock lock{_mutex};
+        _wake_up.wait(lock, [this]() { return _stop || _n_queued > 0; });
+        if (_stop && _n_queued <= 0) return;
+    }
+}
@@ -0,0 +1,99 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapThreadPool.hpp
+ * @brief   Declaration of the plugin's pool of worker threads, used to
+ *          spread work which would otherwise run on KernelShark's GUI
+ *          thread. Part of the Qt-free core.
+ *
+ * @note    Definitions in `NapThreadPool.cpp`.
+*/
+
+#ifndef _NR_NAP_THREAD_POOL_HPP
+#define _NR_NAP_THREAD_POOL_HPP
+
+// C++
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+///
+/// @brief Environment variable overriding the number of worker threads.
+#define NAPS_THREADS_ENV "NAPS_THREADS"
+
+/**
+ * @brief Singleton pool of worker threads with work stealing. There is one
+ * worker less than there are hardware threads, as the thread submitting
+ * jobs usually waits for them and works as well meanwhile.
+ *
+ * Every worker has its own queue of jobs. Jobs submitted by a worker go to
+ * its own queue, which it takes from the back, so nested jobs (e.g. chunks
+ * of a stream's build) run while their data is hot. Other jobs are spread
+ * over the queues in turn. A worker with an empty queue steals from the
+ * front of others' queues, i.e. the oldest, usually largest jobs. Threads
+ * waiting for a job through `wait` run queued jobs meanwhile, so waiting
+ * inside a job can't deadlock the pool.
+ *
+ * Workers are started on first use and joined when the plugin's library
+ * is unloaded.
+*/
+class NapThreadPool {
+private: // Types
+    /**
+     * @brief Queue of jobs of one worker.
+    */
+    struct Queue {
+        ///
+        /// @brief Jobs waiting to be run, the newest at the back.
+        std::deque<std::packaged_task<void()>> jobs;
+        ///
+        /// @brief Guards the jobs.
+        std::mutex mutex;
+    };
+private: // Data members
+    ///
+    /// @brief Worker threads.
+    std::vector<std::thread> _workers;
+    ///
+    /// @brief Queues of jobs, one per worker.
+    std::vector<std::unique_ptr<Queue>> _queues;
+    ///
+    /// @brief Number of jobs in all queues. Signed, as a thief may take
+    /// a job and count it off before its submitter counts it in.
+    std::atomic<ptrdiff_t> _n_queued{0};
+    ///
+    /// @brief Queue receiving the next job submitted from outside the pool.
+    std::atomic<size_t> _next_queue{0};
+    ///
+    /// @brief Guards sleeping of workers and the stop flag.
+    std::mutex _mutex;
+    ///
+    /// @brief Wakes workers up when there's a job or when stopping.
+    std::condition_variable _wake_up;
+    ///
+    /// @brief Whether workers should finish.
+    bool _stop{false};
+public: // Functions
+    static NapThreadPool& get_instance();
+    std::future<void> submit(std::function<void()> job);
+    void wait(std::future<void>& done);
+    /// @brief Returns the number of worker threads.
+    size_t size() const { return _workers.size(); }
+
+    NapThreadPool(const NapThreadPool&) = delete;
+    NapThreadPool& operator=(const NapThreadPool&) = delete;
+    ~NapThreadPool();
+private: // Functions
+    explicit NapThreadPool(size_t n_workers);
+    bool _run_one(size_t self);
+    void _work(size_t self);
+};
+
+#endif // _NR_NAP_THREAD_POOL_HPP
@@ -0,0 +1,202 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapTopIndex.cpp
+ * @brief   Definitions of the range-maximum index over durations of naps.
+*/
+
+// C++
+#include <algorithm>
+#include <bit>
+#include <queue>
+#include <tuple>
+
+// Plugin headers
+#include "NapTopIndex.hpp"
+
+// Static functions
+
+/**
+ * @brief Picks the longer of two naps, the earlier one on a tie.
+ *
+ * @param start: Starts of the task's naps
+ * @param end: Ends of the task's naps
+ * @param a: Index of a nap
+ * @param b: Index of a later nap
+ *
+ * @returns Index of the longer nap.
+*/
+static inline uint32_t _longer(const std::vector<int64_t>& start,
+    const std::vector<int64_t>& end, uint32_t a, uint32_t b)
+{
+    return (end[b] - start[b] > end[a] - start[a]) ? b : a;
+}
+
+/**
+ * @brief Finds the longest nap of a range by scanning it.
+ *
+ * @param start: Starts of the task's naps
+ * @param end: Ends of the task's naps
+ * @param first: Index of the first nap of the range
+ * @param last: Index past the last nap of the range, larger than `first`
+ *
+ * @returns Index of the longest nap.
+*/
+static uint32_t _scan(const std::vector<int64_t>& start,
+    const std::vector<int64_t>& end, size_t first, size_t last)
+{
+    uint32_t best = uint32_t(first);
+    for (size_t i = first + 1; i < last; ++i) {
+        best = _longer(start, end, best, uint32_t(i));
+    }
+    return best;
+}
+
+// Member functions
+
+/**
+ * @brief Brings the index up to date with the task's naps. Naps are only
+ * ever appended, so only entries covering the last block of the previous
+ * update and the new blocks are computed.
+ *
+ * @param start: Starts of the task's naps
+ * @param end: Ends of the task's naps
+*/
+void NapTopIndex::update(const std::vector<int64_t>& start,
+    const std::vector<int64_t>& end)
+{
+    const size_t n_naps = start.size();
+    if (n_naps == _n_naps) return;
+    if (n_naps < _n_naps) _levels.clear();
+
+    const size_t n_blocks = (n_naps + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    // Last block of the previous update may have grown
+    const size_t first_changed = _levels.empty() ? 0 : _n_naps / BLOCK_SIZE;
+    _n_naps = n_naps;
+
+    if (_levels.empty()) _levels.emplace_back();
+    std::vector<uint32_t>& blocks = _levels[0];
+    blocks.resize(n_blocks);
+    for (size_t b = first_changed; b < n_blocks; ++b) {
+        blocks[b] = _scan(start, end, b * BLOCK_SIZE,
+                          std::min(n_naps, (b + 1) * BLOCK_SIZE));
+    }
+
+    for (size_t k = 1; (size_t(1) << k) <= n_blocks; ++k) {
+        const size_t span = size_t(1) << k;
+        const size_t half = span >> 1;
+        if (_levels.size() == k) _levels.emplace_back();
+
+        std::vector<uint32_t>& level = _levels[k];
+        const std::vector<uint32_t>& below = _levels[k - 1];
+        const size_t n_entries = n_blocks - span + 1;
+        // Entries whose blocks reach the changed ones
+        const size_t from = (first_changed >= span - 1)
+            ? std::min(first_changed - (span - 1), level.size()) : 0;
+        level.resize(n_entries);
+        for (size_t b = from; b < n_entries; ++b) {
+            level[b] = _longer(start, end, below[b], below[b + half]);
+        }
+    }
+}
+
+/**
+ * @brief Finds the longest nap of a range of naps.
+ *
+ * @param start: Starts of the task's naps
+ * @param end: Ends of the task's naps
+ * @param first: Index of the first nap of the range
+ * @param last: Index past the last nap of the range
+ *
+ * @returns Index of the longest nap, `last` if the range is empty.
+*/
+size_t NapTopIndex::longest(const std::vector<int64_t>& start,
+    const std::vector<int64_t>& end, size_t first, size_t last) const
+{
+    last = std::min(last, _n_naps);
+    if (first >= last) return last;
+
+    // Whole blocks of the range
+    const size_t first_block = (first + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    const size_t last_block = last / BLOCK_SIZE;
+    if (first_block >= last_block) return _scan(start, end, first, last);
+
+    const size_t n_blocks = last_block - first_block;
+    const size_t k = size_t(std::bit_width(n_blocks)) - 1;
+    const std::vector<uint32_t>& level = _levels[k];
+    uint32_t best = _longer(start, end, level[first_block],
+                            level[last_block - (size_t(1) << k)]);
+
+    // Partial blocks at the ends, earlier naps win ties
+    const size_t head_end = first_block * BLOCK_SIZE;
+    if (first < head_end) {
+        const uint32_t head = _scan(start, end, first, head_end);
+        best = _longer(start, end, head, best);
+    }
+    const size_t tail_start = last_block * BLOCK_SIZE;
+    if (tail_start < last) {
+        best = _longer(start, end, best, _scan(start, end, tail_start, last));
+    }
+    return best;
+}
+
+/**
+ * @brief Finds the longest naps of a range of naps. The range is split at
+ * the longest nap of each found part, parts are kept in a heap ordered by
+ * their longest naps, so finding k naps takes k heap operations and range
+ * queries.
+ *
+ * @param start: Starts of the task's naps
+ * @param end: Ends of the task's naps
+ * @param first: Index of the first nap of the range
+ * @param last: Index past the last nap of the range
+ * @param count: Maximum number of naps to find
+ *
+ * @returns Indices of the longest naps, sorted by index (i.e. by time).
+*/
+std::vector<uint32_t> NapTopIndex::top(const std::vector<int64_t>& start,
+    const std::vector<int64_t>& end, size_t first, size_t last,
+    size_t count) const
+{
+    last = std::min(last, _n_naps);
+    std::vector<uint32_t> found;
+    if (first >= last || !count) return found;
+    found.reserve(std::min(count, last - first));
+
+    // Parts as (duration of the longest nap, -its index, first, last)
+    using part_t = std::tuple<int64_t, int64_t, size_t, size_t>;
+    std::priority_queue<part_t> parts;
+    auto push = [&](size_t part_first, size_t part_last) {
+        if (part_first >= part_last) return;
+        const size_t idx = longest(start, end, part_first, part_last);
+        parts.emplace(end[idx] - start[idx], -int64_t(idx), part_first,
+                      part_last);
+    };
+
+    push(first, last);
+    while (!parts.empty() && found.size() < count) {
+        auto [duration, neg_idx, part_first, part_last] = parts.top();
+        parts.pop();
+
+        const size_t idx = size_t(-neg_idx);
+        found.push_back(uint32_t(idx));
+        push(part_first, idx);
+        push(idx + 1, part_last);
+    }
+
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+/**
+ * @brief Gets bytes of memory used by the index.
+ *
+ * @returns Number of bytes of the index's levels, without the index object.
+*/
+size_t NapTopIndex::mem_usage() const {
+    size_t bytes = _levels.capacity() * sizeof(std::vector<uint32_t>);
+    for (const std::vector<uint32_t>& level : _levels) {
+        bytes += level.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
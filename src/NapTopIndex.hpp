@@ -0,0 +1,57 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapTopIndex.hpp
+ * @brief   Declaration of the range-maximum index over durations of naps
+ *          of a task, which finds the longest naps in a time range without
+ *          looking at all of them. Part of the Qt-free core of the plugin.
+ *
+ * @note    Definitions in `NapTopIndex.cpp`.
+*/
+
+#ifndef _NR_NAP_TOP_INDEX_HPP
+#define _NR_NAP_TOP_INDEX_HPP
+
+// C++
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Sparse table of the longest naps of a task over blocks of naps.
+ *
+ * Naps are split into blocks of `BLOCK_SIZE` consecutive naps. Level k of
+ * the table holds, for each block, the longest nap of the 2^k blocks
+ * starting there, so any run of whole blocks is covered by two overlapping
+ * entries of one level. Partial blocks at the ends of a range are scanned.
+ * The longest nap of a range is then found in constant time, while the
+ * table takes only a fraction of memory of the naps themselves.
+ *
+ * Durations are read from the task's arrays of starts and ends, which are
+ * passed to every function, so that the index stores just nap indices.
+ * Ties go to the earlier nap.
+*/
+class NapTopIndex {
+private: // Data members
+    ///
+    /// @brief Number of naps the index was built for.
+    size_t _n_naps{0};
+    ///
+    /// @brief Longest nap of 2^k blocks starting at each block, per level k.
+    std::vector<std::vector<uint32_t>> _levels;
+public: // Data members
+    ///
+    /// @brief Number of naps in a block.
+    static constexpr size_t BLOCK_SIZE = 32;
+public: // Functions
+    void update(const std::vector<int64_t>& start,
+        const std::vector<int64_t>& end);
+    size_t longest(const std::vector<int64_t>& start,
+        const std::vector<int64_t>& end, size_t first, size_t last) const;
+    std::vector<uint32_t> top(const std::vector<int64_t>& start,
+        const std::vector<int64_t>& end, size_t first, size_t last,
+        size_t count) const;
+    size_t mem_usage() const;
+};
+
+#endif // _NR_NAP_TOP_INDEX_HPP
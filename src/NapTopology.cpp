@@ -0,0 +1,181 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapTopology.cpp
+ * @brief   Definitions of the NUMA topology of a traced machine.
+*/
+
+// C
+#include <cstdlib>
+
+// C++
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+// Plugin headers
+#include "NapTopology.hpp"
+
+// Static variables
+
+///
+/// @brief Largest CPU number accepted, guards against malformed lists.
+static constexpr int MAX_CPU = 1 << 16;
+
+// Static functions
+
+/**
+ * @brief Parses a non-negative decimal number at the start of a text.
+ *
+ * @param text: Text starting with the number, advanced past it
+ * @param value: Output, the number
+ *
+ * @returns True if there was a number, false otherwise.
+*/
+static bool _parse_number(std::string_view& text, int& value) {
+    size_t digits = 0;
+    value = 0;
+    while (digits < text.size() && text[digits] >= '0' && text[digits] <= '9'
+           && value <= MAX_CPU) {
+        value = value * 10 + (text[digits] - '0');
+        ++digits;
+    }
+    text.remove_prefix(digits);
+    return digits > 0 && value <= MAX_CPU;
+}
+
+/**
+ * @brief Removes spaces and tabs from the start of a text.
+ *
+ * @param text: The text, advanced past the white space
+*/
+static void _skip_blanks(std::string_view& text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t'
+                             || text.front() == '\r' || text.front() == '\n')) {
+        text.remove_prefix(1);
+    }
+}
+
+// Member functions
+
+/**
+ * @brief Reads a topology file (see class description).
+ *
+ * @param path: Path to the file
+ *
+ * @returns The topology, empty if the file can't be read or is malformed.
+*/
+NapTopology NapTopology::from_file(const std::string& path) {
+    NapTopology topology;
+    std::ifstream file(path);
+    std::string line;
+
+    while (std::getline(file, line)) {
+        std::string_view text = line;
+        _skip_blanks(text);
+        if (text.empty() || text.front() == '#') continue;
+
+        int node;
+        if (!_parse_number(text, node)) return {};
+        _skip_blanks(text);
+        if (text.empty() || text.front() != ':') return {};
+        text.remove_prefix(1);
+
+        if (!topology.add_node(node, text)) return {};
+    }
+    return topology;
+}
+
+/**
+ * @brief Reads the topology of the machine KernelShark runs on from sysfs,
+ * useful when the trace was recorded on the same machine.
+ *
+ * @returns The topology, empty if sysfs has no nodes.
+*/
+NapTopology NapTopology::from_sysfs() {
+    namespace fs = std::filesystem;
+    NapTopology topology;
+    std::error_code error;
+
+    for (const fs::directory_entry& entry
+         : fs::directory_iterator("/sys/devices/system/node", error)) {
+        const std::string name = entry.path().filename().string();
+        std::string_view number = name;
+        if (number.substr(0, 4) != "node") continue;
+        number.remove_prefix(4);
+
+        int node;
+        if (!_parse_number(number, node) || !number.empty()) continue;
+
+        std::ifstream file(entry.path() / "cpulist");
+        std::stringstream cpus;
+        cpus << file.rdbuf();
+        topology.add_node(node, cpus.str());
+    }
+    return topology;
+}
+
+/**
+ * @brief Adds CPUs to a node.
+ *
+ * @param node: Number of the node
+ * @param cpu_list: CPUs in the kernel's list format, e.g. "0-3,8,10-11"
+ *
+ * @returns True if the list was valid, false otherwise, in which case
+ * the topology may be incomplete.
+*/
+bool NapTopology::add_node(int node, std::string_view cpu_list) {
+    if (node < 0 || node > MAX_CPU) return false;
+
+    _skip_blanks(cpu_list);
+    while (!cpu_list.empty()) {
+        int first, last;
+        if (!_parse_number(cpu_list, first)) return false;
+        last = first;
+        if (!cpu_list.empty() && cpu_list.front() == '-') {
+            cpu_list.remove_prefix(1);
+            if (!_parse_number(cpu_list, last) || last < first) return false;
+        }
+
+        if (size_t(last) >= _node_of_cpu.size()) {
+            _node_of_cpu.resize(size_t(last) + 1, -1);
+        }
+        std::fill(_node_of_cpu.begin() + first, _node_of_cpu.begin() + last + 1,
+                  node);
+        _n_nodes = std::max(_n_nodes, node + 1);
+
+        _skip_blanks(cpu_list);
+        if (!cpu_list.empty() && cpu_list.front() == ',') {
+            cpu_list.remove_prefix(1);
+            _skip_blanks(cpu_list);
+        } else if (!cpu_list.empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Gets the node of a CPU.
+ *
+ * @param cpu: CPU number
+ *
+ * @returns Number of the CPU's node, negative if it belongs to no node.
+*/
+int NapTopology::node_of(int cpu) const {
+    return (cpu >= 0 && size_t(cpu) < _node_of_cpu.size())
+        ? _node_of_cpu[size_t(cpu)] : -1;
+}
+
+/**
+ * @brief Gets the lowest numbered CPU of a node, whose plot shows the node.
+ *
+ * @param node: Number of the node
+ *
+ * @returns CPU number, negative if the node has no CPUs.
+*/
+int NapTopology::first_cpu(int node) const {
+    auto found = std::find(_node_of_cpu.begin(), _node_of_cpu.end(), node);
+    return (found != _node_of_cpu.end()) ? int(found - _node_of_cpu.begin()) : -1;
+}
@@ -0,0 +1,53 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapTopology.hpp
+ * @brief   Declaration of the NUMA topology of a traced machine, i.e. which
+ *          memory node each CPU belongs to. Part of the Qt-free core of
+ *          the plugin.
+ *
+ * @note    Definitions in `NapTopology.cpp`.
+*/
+
+#ifndef _NR_NAP_TOPOLOGY_HPP
+#define _NR_NAP_TOPOLOGY_HPP
+
+// C++
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Mapping of CPUs to NUMA nodes.
+ *
+ * Trace files don't record the topology, so it's read either from a file
+ * describing the traced machine or from sysfs of the machine KernelShark
+ * runs on. A topology file has a line per node - the node's number, a colon
+ * and the node's CPUs in the kernel's list format, the same as in sysfs'
+ * `cpulist` files, e.g. `1: 8-15,24-31`. Empty lines and lines starting
+ * with `#` are ignored.
+*/
+class NapTopology {
+private: // Data members
+    ///
+    /// @brief Node of each CPU, negative for CPUs of no node.
+    std::vector<int> _node_of_cpu;
+    ///
+    /// @brief Number of nodes, i.e. the largest node number plus one.
+    int _n_nodes{0};
+public: // Functions
+    static NapTopology from_file(const std::string& path);
+    static NapTopology from_sysfs();
+
+    bool add_node(int node, std::string_view cpu_list);
+    int node_of(int cpu) const;
+    int first_cpu(int node) const;
+    /// @brief Returns the number of nodes.
+    int n_nodes() const { return _n_nodes; }
+    /// @brief Returns whether no CPU belongs to any node.
+    bool empty() const { return _n_nodes == 0; }
+    /// @brief Returns whether both topologies map CPUs to the same nodes.
+    bool operator==(const NapTopology&) const = default;
+};
+
+#endif // _NR_NAP_TOPOLOGY_HPP
@@ -0,0 +1,247 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapView.cpp
+ * @brief   Definitions of the view of a drawn plot and of the query of
+ *          naps visible in it.
+*/
+
+// C++
+#include <algorithm>
+
+// Plugin headers
+#include "NapView.hpp"
+
+// View
+
+/**
+ * @brief Creates a view from KernelShark's histogram.
+ *
+ * @param histo: KernelShark's histogram of the drawn plot
+ *
+ * @returns View with the histogram's range and binning.
+*/
+NapView NapView::from_histo(const kshark_trace_histo* histo) {
+    return NapView{histo->min, histo->max, histo->bin_size, histo->n_bins};
+}
+
+/**
+ * @brief Gets the bin of a timestamp, clamped to the visible bins.
+ *
+ * @param ts: Timestamp whose bin to get
+ *
+ * @returns Index of the bin, always between `0` and number of bins minus one.
+*/
+int NapView::bin(int64_t ts) const {
+    if (ts <= min) return 0;
+
+    int64_t bin = (ts - min) / bin_size;
+    return (bin >= n_bins) ? n_bins - 1 : int(bin);
+}
+
+// Geometry
+
+/**
+ * @brief Removes all naps from the geometry, keeping allocated memory.
+*/
+void NapGeometry::clear() {
+    idx.clear();
+    start_bin.clear();
+    end_bin.clear();
+    x_start.clear();
+    x_end.clear();
+}
+
+// Global functions
+
+/**
+ * @brief Finds naps of a task visible in the view and the bins they
+ * start and end in.
+ *
+ * @param task: Naps of the task
+ * @param view: View of the drawn plot
+ *
+ * @returns Visible naps in the order of time.
+*/
+std::vector<NapInView> naps_in_view(const NapTaskTable& task,
+    const NapView& view)
+{
+    auto [first, last] = task.in_range(view.min, view.max);
+    std::vector<NapInView> visible;
+    visible.reserve(last - first);
+
+    for (size_t i = first; i < last; ++i) {
+        visible.push_back({i, view.bin(task.start[i]), view.bin(task.end[i])});
+    }
+
+    return visible;
+}
+
+/**
+ * @brief Computes pixel geometry of all naps of a task visible in the view
+ * in one pass over the task's arrays of timestamps. Timestamps are mapped
+ * to bins by a multiplication with the reciprocal bin size, corrected to
+ * match integer division exactly, then clamped to the view. The loop has
+ * no branches, so compilers can vectorize it. Naps narrower than a pixel
+ * are dropped afterwards.
+ *
+ * @param task: Naps of the task
+ * @param view: View of the drawn plot
+ * @param x_origin: Horizontal position of the first bin, in pixels
+ * @param bin_width: Width of a bin, in pixels
+ * @param geometry: Output, geometry of visible naps (cleared first)
+*/
+void naps_geometry(const NapTaskTable& task, const NapView& view,
+    int x_origin, int bin_width, NapGeometry& geometry)
+{
+    geometry.clear();
+    if (view.bin_size <= 0 || view.n_bins <= 0) return;
+
+    auto [first, last] = task.in_range(view.min, view.max);
+    const size_t count = last - first;
+    if (!count) return;
+
+    geometry.start_bin.resize(count);
+    geometry.end_bin.resize(count);
+    geometry.x_start.resize(count);
+    geometry.x_end.resize(count);
+
+    const int64_t* starts = task.start.data() + first;
+    const int64_t* ends = task.end.data() + first;
+    int32_t* start_bins = geometry.start_bin.data();
+    int32_t* end_bins = geometry.end_bin.data();
+    int32_t* x_starts = geometry.x_start.data();
+    int32_t* x_ends = geometry.x_end.data();
+
+    const int64_t min = view.min;
+    const int64_t bin_size = view.bin_size;
+    const int64_t last_bin = view.n_bins - 1;
+    const double inv_bin_size = 1.0 / double(bin_size);
+
+    auto to_bin = [=](int64_t ts) {
+        int64_t rel = std::max<int64_t>(ts - min, 0);
+        int64_t bin = int64_t(double(rel) * inv_bin_size);
+        // Rounding of the reciprocal may be off by one either way
+        bin -= (bin * bin_size > rel);
+        bin += ((bin + 1) * bin_size <= rel);
+        return std::min(bin, last_bin);
+    };
+
+    for (size_t i = 0; i < count; ++i) {
+        const int64_t start_bin = to_bin(starts[i]);
+        const int64_t end_bin = to_bin(ends[i]);
+        start_bins[i] = int32_t(start_bin);
+        end_bins[i] = int32_t(end_bin);
+        x_starts[i] = int32_t(x_origin + start_bin * bin_width + 1);
+        x_ends[i] = int32_t(x_origin + end_bin * bin_width - 1);
+    }
+
+    // Compact in place, dropping naps narrower than a pixel
+    geometry.idx.resize(count);
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (x_ends[i] - x_starts[i] < 1) continue;
+
+        geometry.idx[kept] = uint32_t(first + i);
+        start_bins[kept] = start_bins[i];
+        end_bins[kept] = end_bins[i];
+        x_starts[kept] = x_starts[i];
+        x_ends[kept] = x_ends[i];
+        ++kept;
+    }
+
+    geometry.idx.resize(kept);
+    geometry.start_bin.resize(kept);
+    geometry.end_bin.resize(kept);
+    geometry.x_start.resize(kept);
+    geometry.x_end.resize(kept);
+}
+
+/**
+ * @brief Computes pixel geometry of only the longest naps of a task visible
+ * in the view, when there are more of them than a plot may draw. Naps are
+ * found by the task's index in time logarithmic in the number of naps per
+ * found nap. Unlike in full geometry, naps narrower than a pixel are kept
+ * a pixel wide, so that the longest naps stay visible at any zoom level.
+ *
+ * @param task: Naps of the task
+ * @param view: View of the drawn plot
+ * @param x_origin: Horizontal position of the first bin, in pixels
+ * @param bin_width: Width of a bin, in pixels
+ * @param budget: Maximum number of naps in the geometry
+ * @param geometry: Output, geometry of the longest visible naps (cleared
+ * first), in the order of time
+*/
+void naps_top_geometry(const NapTaskTable& task, const NapView& view,
+    int x_origin, int bin_width, size_t budget, NapGeometry& geometry)
+{
+    geometry.clear();
+    if (view.bin_size <= 0 || view.n_bins <= 0) return;
+
+    auto [first, last] = task.in_range(view.min, view.max);
+    geometry.idx = task.top_index.top(task.start, task.end, first, last, budget);
+
+    const size_t count = geometry.size();
+    geometry.start_bin.resize(count);
+    geometry.end_bin.resize(count);
+    geometry.x_start.resize(count);
+    geometry.x_end.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t idx = geometry.idx[i];
+        const int start_bin = view.bin(task.start[idx]);
+        const int end_bin = view.bin(task.end[idx]);
+        const int x_start = x_origin + start_bin * bin_width + 1;
+
+        geometry.start_bin[i] = start_bin;
+        geometry.end_bin[i] = end_bin;
+        geometry.x_start[i] = x_start;
+        geometry.x_end[i] = std::max(x_origin + end_bin * bin_width - 1,
+                                     x_start + 1);
+    }
+}
+
+/**
+ * @brief Summarizes naps of a task visible in the view, which weren't drawn
+ * on their own. The view is split into segments of equal numbers of bins,
+ * each segment with any such nap is summarized by the prev_state of its
+ * longest nap and neighboring segments with the same prev_state are joined.
+ * Every segment costs two binary searches and a range-maximum query.
+ *
+ * @param task: Naps of the task
+ * @param view: View of the drawn plot
+ * @param drawn: Indices of naps drawn on their own, sorted
+ * @param n_segments: Number of segments, at most the number of bins
+ *
+ * @returns Summarized runs of bins, in the order of time.
+*/
+std::vector<NapSummaryRun> naps_rest_summary(const NapTaskTable& task,
+    const NapView& view, const std::vector<uint32_t>& drawn, int n_segments)
+{
+    std::vector<NapSummaryRun> runs;
+    n_segments = std::min(n_segments, view.n_bins);
+    if (view.bin_size <= 0 || n_segments <= 0) return runs;
+
+    for (int segment = 0; segment < n_segments; ++segment) {
+        const int start_bin = int(int64_t(segment) * view.n_bins / n_segments);
+        const int end_bin = int(int64_t(segment + 1) * view.n_bins / n_segments) - 1;
+        const int64_t min_ts = view.min + start_bin * view.bin_size;
+        const int64_t max_ts = view.min + (end_bin + 1) * view.bin_size - 1;
+
+        auto [first, last] = task.in_range(min_ts, max_ts);
+        const size_t n_drawn = size_t(
+            std::lower_bound(drawn.begin(), drawn.end(), uint32_t(last))
+            - std::lower_bound(drawn.begin(), drawn.end(), uint32_t(first)));
+        if (last - first <= n_drawn) continue;
+
+        const size_t longest = task.top_index.longest(task.start, task.end,
+                                                      first, last);
+        const char state = task.state[longest];
+        if (!runs.empty() && runs.back().end_bin + 1 == start_bin
+            && runs.back().state == state) {
+            runs.back().end_bin = end_bin;
+        } else {
+            runs.push_back({start_bin, end_bin, state});
+        }
+    }
+    return runs;
+}
@@ -0,0 +1,114 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapView.hpp
+ * @brief   Declarations of the view of a drawn plot and of the query of
+ *          naps visible in it. Shared by the plugin's drawing and headless
+ *          tools, part of the Qt-free core.
+ *
+ * @note    Definitions in `NapView.cpp`.
+*/
+
+#ifndef _NR_NAP_VIEW_HPP
+#define _NR_NAP_VIEW_HPP
+
+// C++
+#include <cstdint>
+#include <vector>
+
+// KernelShark
+#include "libkshark-model.h"
+
+// Plugin
+#include "NapTable.hpp"
+
+/**
+ * @brief Time range and binning of a drawn plot, same as in KernelShark's
+ * histogram, but without any of its data.
+*/
+struct NapView {
+    ///
+    /// @brief Start of the visible time range.
+    int64_t min;
+    ///
+    /// @brief End of the visible time range.
+    int64_t max;
+    ///
+    /// @brief Time span of one bin.
+    int64_t bin_size;
+    ///
+    /// @brief Number of bins.
+    int n_bins;
+public:
+    static NapView from_histo(const kshark_trace_histo* histo);
+    int bin(int64_t ts) const;
+};
+
+/**
+ * @brief Nap visible in a view.
+*/
+struct NapInView {
+    ///
+    /// @brief Index of the nap in its task's table.
+    size_t idx;
+    ///
+    /// @brief Bin in which the nap starts, clamped to the view.
+    int start_bin;
+    ///
+    /// @brief Bin in which the nap ends, clamped to the view.
+    int end_bin;
+};
+
+/**
+ * @brief Pixel geometry of naps visible in a view, as a structure of arrays
+ * in the order of time. Horizontal positions are already inset by a pixel
+ * on each side, as nap rectangles are drawn.
+*/
+struct NapGeometry {
+    ///
+    /// @brief Indices of the naps in their task's table.
+    std::vector<uint32_t> idx;
+    ///
+    /// @brief Bins in which the naps start, clamped to the view.
+    std::vector<int32_t> start_bin;
+    ///
+    /// @brief Bins in which the naps end, clamped to the view.
+    std::vector<int32_t> end_bin;
+    ///
+    /// @brief Left edges of the naps, in pixels.
+    std::vector<int32_t> x_start;
+    ///
+    /// @brief Right edges of the naps, in pixels.
+    std::vector<int32_t> x_end;
+public:
+    /// @brief Returns the number of naps in the geometry.
+    size_t size() const { return idx.size(); }
+    void clear();
+};
+
+/**
+ * @brief Run of bins of a view summarized by a single prev_state - that of
+ * the longest nap overlapping the run.
+*/
+struct NapSummaryRun {
+    ///
+    /// @brief First bin of the run.
+    int start_bin;
+    ///
+    /// @brief Last bin of the run.
+    int end_bin;
+    ///
+    /// @brief Abbreviated prev_state summarizing the run.
+    char state;
+};
+
+std::vector<NapInView> naps_in_view(const NapTaskTable& task,
+    const NapView& view);
+void naps_geometry(const NapTaskTable& task, const NapView& view,
+    int x_origin, int bin_width, NapGeometry& geometry);
+void naps_top_geometry(const NapTaskTable& task, const NapView& view,
+    int x_origin, int bin_width, size_t budget, NapGeometry& geometry);
+std::vector<NapSummaryRun> naps_rest_summary(const NapTaskTable& task,
+    const NapView& view, const std::vector<uint32_t>& drawn, int n_segments);
+
+#endif // _NR_NAP_VIEW_HPP
@@ -8,91 +8,196 @@
  *          to access C++ part's code.
 */
 
+// C
+#include <cstdio>
+#include <cstdlib>
+
 // C++
+#include <algorithm>
+#include <chrono>
 #include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
 
 // KernelShark
 #include "libkshark.h"
 #include "libkshark-plugin.h"
+#include "libkshark-model.h"
 #include "KsMainWindow.hpp"
 #include "KsGLWidget.hpp"
+#include "KsPlugins.hpp"
 
 // Plugin headers
 #include "naps.h"
+#include "NapAggregate.hpp"
+#include "NapBlockIo.hpp"
+#include "NapBuildScheduler.hpp"
 #include "NapConfig.hpp"
+#include "NapDiffWindow.hpp"
+#include "NapDrawPlan.hpp"
+#include "NapDrawRecord.hpp"
+#include "NapExport.hpp"
+#include "NapGeometryPass.hpp"
+#include "NapLabelAtlas.hpp"
+#include "NapNodeAggregate.hpp"
 #include "NapRectangle.hpp"
+#include "NapStatsWindow.hpp"
+#include "NapTable.hpp"
+#include "NapTopology.hpp"
+#include "NapView.hpp"
 
-// Usings
+// Static variables
 /**
- * @brief Type to be used by the PREV_STATE_TO_COLOR constant.
-*/
-using prev_state_colors_t = std::map<const char, KsPlot::Color>;
+ * @brief Static pointer to the configuration window.
+ */
+static NapConfigWindow* cfg_window;
 
-// Constants
 /**
- * @brief Constant map of assigned colors to prev_state abbreviations.
-*/
-static const prev_state_colors_t PREV_STATE_TO_COLOR {
-    {'D', {255, 0, 0}}, // Red
-    {'I', {255, 255, 0}}, // Yellow
-    {'P', {255, 165, 0}}, // Orange
-    {'R', {0, 255, 0}}, // Green
-    {'S', {0, 0, 255}}, // Blue
-    {'T', {0, 255, 255}}, // Cyan
-    {'t', {139, 69, 19}}, // Brown
-    {'X', {255, 0, 255}}, // Magenta
-    {'Z', {128, 0, 128}} // Purple
+ * @brief Static pointer to the window comparing streams.
+ */
+static NapDiffWindow* diff_window;
+
+/**
+ * @brief Static pointer to the window with statistics of naps.
+ */
+static NapStatsWindow* stats_window;
+
+/**
+ * @brief Bytes of nap rectangles drawn in the task plots of one stream
+ * during the last redraw.
+ */
+struct DrawnShapesAccount {
+    ///
+    /// @brief View of the last redraw, a new view means a new redraw.
+    NapView view{};
+    ///
+    /// @brief Bytes of nap rectangles per task plot, keyed by PID.
+    std::unordered_map<int, size_t> plot_bytes;
 };
 
+/**
+ * @brief Accounts of drawn nap rectangles, keyed by stream identifier.
+ */
+static std::map<int, DrawnShapesAccount> drawn_accounts;
 
-// Static variables
 /**
- * @brief Static pointer to the configuration window.
+ * @brief NUMA topology used for bands of nodes, along with the configured
+ * path it was read from (empty for this machine's topology).
  */
-static NapConfigWindow* cfg_window;
+static std::pair<std::string, NapTopology> numa_topology;
+
+/**
+ * @brief Whether `numa_topology` was read at least once.
+ */
+static bool numa_topology_read = false;
+
+/**
+ * @brief Identifier of the listener of finished builds, which shows them in
+ * the status bar, negative if there's none.
+ */
+static int build_listener = -1;
+
+/**
+ * @brief KernelShark's OpenGL widget, in whose context the label atlas is
+ * loaded, null if it wasn't given or was already destroyed.
+ */
+static QPointer<KsGLWidget> gl_widget;
 
 // Static functions
 
 /**
  * @brief Loads values into the configuration window from
  * the configuration object and shows the window afterwards.
+ * The window is created when it's first shown.
+ * 
+ * @param main_w: KernelShark's main window, owner of the window
  * 
  * @note Function depends on the file-global variable `cfg_window`.
 */
-static void config_show([[maybe_unused]] KsMainWindow*) {
+static void config_show(KsMainWindow* main_w) {
+    if (cfg_window == nullptr) {
+        cfg_window = new NapConfigWindow(main_w);
+    }
+
     cfg_window->load_cfg_values();
     cfg_window->show();
 }
 
 /**
- * @brief Returns either black if the background color's intensity is too great,
- * otherwise returns white. Limit to intensity is `128.0`.
+ * @brief Loads currently loaded streams into the comparison window and
+ * shows the window afterwards. The window is created when it's first shown.
  * 
- * @param bg_color_intensity: Computed intensity from an RGB color
+ * @param main_w: KernelShark's main window, owner of the window
  * 
- * @returns Black on high intensity, white otheriwse.
+ * @note Function depends on the file-global variable `diff_window`.
 */
-static KsPlot::Color _black_or_white_text(float bg_color_intensity) {
-    const static KsPlot::Color WHITE {0xFF, 0xFF, 0xFF};
-    const static KsPlot::Color BLACK {0, 0, 0};
-    constexpr float INTENSITY_LIMIT = 128.f;
+static void diff_show(KsMainWindow* main_w) {
+    if (diff_window == nullptr) {
+        diff_window = new NapDiffWindow(main_w);
+    }
 
-    return (bg_color_intensity > INTENSITY_LIMIT) ? BLACK : WHITE;
+    diff_window->load_streams();
+    diff_window->show();
 }
 
 /**
- * @brief Gets the color intensity using the formula
- * `(red * 0.299) + (green * 0.587) + (blue * 0.114)`.
+ * @brief Loads currently loaded streams into the statistics window and
+ * shows the window afterwards. The window is created when it's first shown.
  * 
- * @param c: RGB color value whose components will be checked
+ * @param main_w: KernelShark's main window, owner of the window
  * 
- * @returns Color intensity as floating-point value.
+ * @note Function depends on the file-global variable `stats_window`.
 */
-static float _get_color_intensity(const KsPlot::Color& c) {
-    // Color multipliers are chosen the way they are based on human
-    // eye's receptiveness to each color (green being the color human
-    // eyes focus on the most).
-    return (c.b() * 0.114f) + (c.g() * 0.587f) + (c.r() * 0.299f);
+static void stats_show(KsMainWindow* main_w) {
+    if (stats_window == nullptr) {
+        stats_window = new NapStatsWindow(main_w);
+    }
+
+    stats_window->load_streams();
+    stats_window->show();
+}
+
+/**
+ * @brief Asks for a file and exports naps of all streams with the plugin's
+ * context into it, as Chrome trace event JSON for Perfetto UI.
+*/
+static void export_show([[maybe_unused]] KsMainWindow*) {
+    QString file = QFileDialog::getSaveFileName(NapConfig::main_w_ptr,
+        "Export Naps", "naps.json", "Chrome trace event JSON (*.json)");
+    if (file.isEmpty()) return;
+
+    std::FILE* out = std::fopen(file.toStdString().c_str(), "w");
+    if (!out) {
+        QMessageBox::warning(NapConfig::main_w_ptr, "Export Naps",
+            "Couldn't open the file for writing.");
+        return;
+    }
+
+    // Tables of all streams are built at once, if they aren't yet
+    NapBuildScheduler::get_instance().schedule_all();
+
+    kshark_context* kshark_ctx = nullptr;
+    NapChromeExport exporter{out};
+    int* stream_ids = kshark_instance(&kshark_ctx)
+        ? kshark_all_streams(kshark_ctx) : nullptr;
+    const int n_streams = stream_ids ? kshark_ctx->n_streams : 0;
+    for (int i = 0; i < n_streams; ++i) {
+        const NapTable* table = NapTable::from_context(__get_context(stream_ids[i]));
+        if (!table) continue;
+
+        kshark_data_stream* stream = kshark_get_data_stream(kshark_ctx, stream_ids[i]);
+        exporter.add_stream(*table, stream_ids[i],
+            (stream && stream->file) ? stream->file : "");
+    }
+    free(stream_ids);
+
+    const bool written = exporter.finish();
+    std::fclose(out);
+    if (!written) {
+        QMessageBox::warning(NapConfig::main_w_ptr, "Export Naps",
+            "Couldn't write the whole file.");
+    }
 }
 
 /**
@@ -116,132 +221,430 @@ static bool _nap_rect_check_function_general(const kshark_entry* entry) {
 }
 
 /**
- * @brief Creates a nap rectangle to be displayed on the plot via
- * KernelShark's plot objects API.
+ * @brief Gets the horizontal layout of a plot's bins, which are spaced
+ * evenly, so their positions are a linear function.
+ * 
+ * @param graph: KernelShark's graph of the drawn plot, with some bins
+ * 
+ * @returns Pair of the first bin's position and the distance of bins,
+ * in pixels.
+ */
+static std::pair<int, int> _bin_layout(const KsPlot::Graph* graph) {
+    const int x_origin = graph->bin(0)._base.x();
+    const int bin_width = (graph->size() > 1)
+        ? graph->bin(1)._base.x() - x_origin : 1;
+    return {x_origin, bin_width};
+}
+
+/**
+ * @brief Records the draw request, if the debug mode of recording draw
+ * requests is enabled (see `NapDrawRecorder`).
+ * 
+ * @param argVCpp: The C++ arguments of the drawing function of the plugin
+ * @param sd: Stream identifier number
+ * @param val: Process ID or CPU ID value
+ * @param draw_action: Action to be performed
+ * @param settings: Current configuration of what plots show
+ */
+static void _record_draw_request(KsCppArgV* argVCpp, int sd, int val,
+    int draw_action, const NapDrawSettings& settings)
+{
+    NapDrawRecorder* recorder = NapDrawRecorder::get_instance();
+    if (!recorder) return;
+
+    kshark_context* kshark_ctx = nullptr;
+    const char* stream_file = nullptr;
+    if (kshark_instance(&kshark_ctx)) {
+        kshark_data_stream* stream = kshark_get_data_stream(kshark_ctx, sd);
+        stream_file = stream ? stream->file : nullptr;
+    }
+
+    const kshark_trace_histo* histo = argVCpp->_histo;
+    const auto [x_origin, bin_width] = (argVCpp->_graph->size() > 0)
+        ? _bin_layout(argVCpp->_graph) : std::pair<int, int>{0, 1};
+    recorder->record({sd, val, draw_action, NapView::from_histo(histo),
+        uint64_t(histo->tot_count), x_origin, bin_width, settings,
+        stream_file ? stream_file : ""});
+}
+
+/**
+ * @brief Accounts nap rectangles drawn into a task plot and updates the
+ * stream's total of drawn shapes in the plugin's context.
+ * 
+ * @param ctx: Plugin's context of the drawn stream
+ * @param sd: Stream identifier number
+ * @param histo: KernelShark's histogram of the drawn plot
+ * @param val: Process ID of the drawn task, or `-1 - CPU` for CPU plots,
+ * so that their keys don't collide
+ * @param bytes: Bytes of nap rectangles drawn into the plot
+ * 
+ * @note Function depends on the file-global variable `drawn_accounts`.
+ */
+static void _account_drawn_shapes(plugin_naps_context* ctx, int sd,
+    const kshark_trace_histo* histo, int val, size_t bytes)
+{
+    DrawnShapesAccount& account = drawn_accounts[sd];
+    const NapView view = NapView::from_histo(histo);
+
+    if (view.min != account.view.min || view.max != account.view.max
+        || view.n_bins != account.view.n_bins) {
+        account.view = view;
+        account.plot_bytes.clear();
+    }
+    account.plot_bytes[val] = bytes;
+
+    size_t total = 0;
+    for (const auto& [pid, plot_bytes] : account.plot_bytes) {
+        total += plot_bytes;
+    }
+    ctx->drawn_shapes_bytes = total;
+}
+
+/**
+ * @brief Shows a tooltip about a double clicked nap at the cursor - its
+ * state and duration and, for a nap in the `D` state, block I/O completed
+ * during it or at its wakeup, per device. Of each device, the last few
+ * requests are listed with their latencies, the one which likely woke the
+ * task is marked.
+ * 
+ * @param sd: Stream identifier number
+ * @param pid: Process ID of the napping task
+ * @param nap: Index of the nap in the task's table
+ */
+static void _show_nap_tooltip(int sd, int32_t pid, uint32_t nap) {
+    // Requests listed per device, the rest is only counted
+    constexpr size_t LISTED_REQUESTS = 4;
+
+    plugin_naps_context* ctx = __get_context(sd);
+    const NapTable* table = NapTable::from_context(ctx);
+    const NapTaskTable* task = table ? table->task(pid) : nullptr;
+    if (!task || nap >= task->size()) return;
+
+    QString text = QString("%1 nap of %2 us").arg(QChar(task->state[nap]))
+        .arg(double(task->end[nap] - task->start[nap]) / 1e3, 0, 'f', 3);
+
+    const NapBlockIo* block_io = (task->state[nap] == 'D'
+        && ctx->n_block_events) ? NapBlockIo::from_context(ctx) : nullptr;
+    if (block_io) {
+        const auto [first, last] = block_io->of_nap(pid, nap);
+        if (first == last) text += "\nNo block I/O completed";
+
+        for (size_t j = first; j < last; ++j) {
+            const NapIoJoin& join = block_io->joins()[j];
+            text += QString("\n%1: %2 I/Os, %3 KiB")
+                .arg(QString::fromStdString(naps_device_name(join.dev)))
+                .arg(qulonglong(join.size()))
+                .arg(double(block_io->sectors(join)) / 2, 0, 'f', 1);
+
+            const uint32_t listed = uint32_t(std::min(join.size(),
+                LISTED_REQUESTS));
+            for (uint32_t r = join.last - listed; r < join.last; ++r) {
+                const NapBlockRequest& request = block_io->requests()[r];
+                text += QString("\n  sector %1 +%2").arg(qulonglong(
+                    request.sector)).arg(request.nr_sector);
+                if (request.is_issued()) {
+                    text += QString(", %1 us").arg(double(request.complete_ts
+                        - request.issue_ts) / 1e3, 0, 'f', 1);
+                }
+                if (request.issue_pid == pid) text += ", own";
+                if (r == join.wakeup) text += ", woke";
+            }
+        }
+    }
+
+    QToolTip::showText(QCursor::pos(), text);
+}
+
+/**
+ * @brief Adds nap rectangles of a task's naps with computed geometry to
+ * a task plot as one batch. Only naps whose both entries are visible and
+ * which don't cross into other plots are drawn.
+ * 
+ * @param argVCpp: The C++ arguments of the drawing function of the plugin
+ * @param sd: Stream identifier number
+ * @param val: Process ID of the drawn task
+ * @param task: Naps of the drawn task
+ * @param geometry: Geometry of the naps to draw
  * 
- * @param graph KernelShark graph
- * @param bin KernelShark bins
- * @param data: Container of two entries between which to draw the nap
- * rectangle
+ * @returns Bytes of the drawn batch of nap rectangles.
+ */
+static size_t _draw_geometry(KsCppArgV* argVCpp, int sd, int val,
+    const NapTaskTable* task, const NapGeometry& geometry)
+{
+    const KsPlot::Graph* graph = argVCpp->_graph;
+    auto batch = new NapRectangleBatch();
+    batch->set_double_click([sd, val](uint32_t nap) {
+        _show_nap_tooltip(sd, val, nap);
+    });
+    batch->reserve(geometry.size());
+
+    for (size_t i = 0; i < geometry.size(); ++i) {
+        const uint32_t idx = geometry.idx[i];
+        if (!_nap_rect_check_function_general(task->switch_entry[idx])
+            || !_nap_rect_check_function_general(task->waking_entry[idx])) {
+            continue;
+        }
+
+        // Don't draw into other plots, i.e. check that the rectangle
+        // won't be angled up or down.
+        const int y_start = graph->bin(geometry.start_bin[i])._val.y();
+        const int y_end = graph->bin(geometry.end_bin[i])._val.y();
+        if (y_start != y_end) continue;
+
+        batch->add(geometry.x_start[i], geometry.x_end[i], y_start,
+            task->state[idx], idx);
+    }
+
+    if (!batch->size()) {
+        delete batch;
+        return 0;
+    }
+
+    argVCpp->_shapes->push_front(batch);
+    return batch->mem_usage();
+}
+
+/**
+ * @brief The actual drawing function of the plugin. It gets geometry of
+ * naps of the task visible in the histogram, likely precomputed in parallel
+ * with other plots of the redraw, and draws those whose both entries are
+ * visible as one batch of nap rectangles.
  * 
- * @returns Pointer to the heap-created nap rectangle.
+ * @param argVCpp: The C++ arguments of the drawing function of the plugin
+ * @param ctx: Plugin's context of the drawn stream
+ * @param table: Nap table of the drawn stream
+ * @param sd: Stream identifier number
+ * @param val: Process ID of the drawn task
+ * @param task: Naps of the drawn task
  * 
- * @note  Function also depends on the file-global variable
- * `PREV_STATE_TO_COLOR` and the configuration `NapConfig` singleton.
+ * @returns Bytes of the drawn batch of nap rectangles.
  */
-static NapRectangle* _make_nap_rect(std::vector<const KsPlot::Graph*> graph,
-    std::vector<int> bin,
-    std::vector<kshark_data_field_int64*> data,
-    KsPlot::Color, float)
+static size_t _draw_nap_rectangles(KsCppArgV* argVCpp,
+    plugin_naps_context* ctx, const NapTable* table, int sd, int val,
+    const NapTaskTable* task)
 {
-    // Positioning constants, relevant only here, hence defined here
-    constexpr int HEIGHT = 8;
-    constexpr int HEIGHT_OFFSET = -10;
-    // Looking into KernelShark's source doesn't immediately reveal
-    // why the graph is passed in a vector, but this is how it is
-    // done in makeLatencyBox function in `KsPlugins.hpp`, which
-    // works seemingly well, hence same approach was chosen here.
-    KsPlot::Point start_base_point = graph[0]->bin(bin[0])._val;
-    KsPlot::Point end_base_point = graph[0]->bin(bin[1])._val;
-
-    /* Rectangle:
-        0----------3
-        |          |
-        |          |
-        1----------2
-    */
-
-    auto point_0 = KsPlot::Point{start_base_point.x() + 1,
-        start_base_point.y() - HEIGHT_OFFSET - HEIGHT};
-    auto point_1 = KsPlot::Point{start_base_point.x() + 1,
-        start_base_point.y() - HEIGHT_OFFSET};
-    auto point_3 = KsPlot::Point{end_base_point.x() - 1,
-        end_base_point.y() - HEIGHT_OFFSET - HEIGHT};
-    auto point_2 = KsPlot::Point{end_base_point.x() - 1,
-        end_base_point.y() - HEIGHT_OFFSET};
-
-    // Put relevant entries into variables
-    kshark_entry* switch_entry = data[0]->entry;
-    kshark_entry* wakeup_entry = data[1]->entry;
-
-    // Create the rectangle and color it
-    KsPlot::Rectangle rect;
-    rect.setFill(true);
-    // Access to global variable here.
-    rect._color = PREV_STATE_TO_COLOR.at(get_switch_prev_state(switch_entry));
-
-    rect.setPoint(0, point_0);
-    rect.setPoint(1, point_1);
-    rect.setPoint(2, point_2);
-    rect.setPoint(3, point_3);
-
-    // Prepare outline color
-    KsPlot::Color outline_col = rect._color;
-
-    // Prepare text color
-    float bg_intensity = _get_color_intensity(rect._color);
-    const KsPlot::Color text_color = _black_or_white_text(bg_intensity);
-
-    // Create the final nap rectangle and return it
-    NapRectangle* nap_rect = new NapRectangle{switch_entry, wakeup_entry, rect,
-        outline_col, text_color};
-    return nap_rect;
+    const KsPlot::Graph* graph = argVCpp->_graph;
+    if (!task || graph->size() < 1) return 0;
+
+    const auto [x_origin, bin_width] = _bin_layout(graph);
+    NapGeometryPass* pass = NapGeometryPass::from_context(ctx);
+    const NapGeometry* found = pass->get(*table,
+        NapView::from_histo(argVCpp->_histo), x_origin, bin_width, val);
+    if (!found || !found->size()) return 0;
+
+    return _draw_geometry(argVCpp, sd, val, task, *found);
 }
 
 /**
- * @brief The actual drawing function of the plugin. It initializes check
- * functions for selecting naps-relevant entries and draws naps via
- * KernelShark's interval plotting API.
+ * @brief Draws only the longest naps of the task visible in the histogram,
+ * at most the budget of them, and summarizes the rest in a thin strip at
+ * the base of the plot, colored by the prev_state of the longest nap of
+ * each part of the strip. Used when the plot holds more naps than the
+ * budget, or when there are too many entries for all naps to be drawn.
  * 
- * @note Naps-relevant entries are: `sched/sched_switch`
- * `sched/sched_waking`.
+ * @param argVCpp: The C++ arguments of the drawing function of the plugin
+ * @param sd: Stream identifier number
+ * @param val: Process ID of the drawn task
+ * @param task: Naps of the drawn task
+ * @param budget: Maximum number of drawn naps
+ * 
+ * @returns Bytes of the drawn batch of nap rectangles and of the strip.
+ */
+static size_t _draw_top_naps(KsCppArgV* argVCpp, int sd, int val,
+    const NapTaskTable* task, int32_t budget)
+{
+    const KsPlot::Graph* graph = argVCpp->_graph;
+    if (!task || graph->size() < 1) return 0;
+
+    const auto [x_origin, bin_width] = _bin_layout(graph);
+    const NapView view = NapView::from_histo(argVCpp->_histo);
+
+    NapGeometry geometry;
+    naps_top_geometry(*task, view, x_origin, bin_width, size_t(budget),
+        geometry);
+    size_t bytes = _draw_geometry(argVCpp, sd, val, task, geometry);
+
+    // Strip has at most as many parts as there are drawn naps
+    const std::vector<NapSummaryRun> rest = naps_rest_summary(*task, view,
+        geometry.idx, std::min(budget, graph->size()));
+    if (rest.empty()) return bytes;
+
+    const int strip_height = std::max(2, graph->height() / 6);
+    auto strip = new NapStateBand();
+    for (const NapSummaryRun& run : rest) {
+        const int y_base = graph->bin(run.start_bin)._base.y();
+        if (graph->bin(run.end_bin)._base.y() != y_base) continue;
+
+        const int x = graph->bin(run.start_bin)._base.x();
+        const int width = (run.end_bin - run.start_bin + 1) * bin_width;
+        strip->add(x, width, y_base - strip_height, y_base, run.state);
+    }
+
+    if (!strip->size()) {
+        delete strip;
+        return bytes;
+    }
+
+    argVCpp->_shapes->push_front(strip);
+    return bytes + strip->mem_usage();
+}
+
+/**
+ * @brief Draws the aggregate band of the comm group of a task over its plot,
+ * in place of the task's own naps. Layers of each bin are stacked from the
+ * plot's base, scaled so that the most napping threads in the view fill the
+ * plot's height.
  * 
  * @param argVCpp: The C++ arguments of the drawing function of the plugin
- * @param plugin_data: Input location for the container of the event's data
- * @param ctx: Pointer to the plugin's context
- * @param val: Process or CPU ID value
+ * @param ctx: Plugin's context of the drawn stream
+ * @param table: Nap table of the drawn stream
+ * @param sd: Stream identifier number
+ * @param val: Process ID of the drawn task
+ * 
+ * @returns Bytes of the drawn band, zero if nothing was drawn.
  */
-static void _draw_nap_rectangles(KsCppArgV* argVCpp,
-    kshark_data_container* plugin_data,
-    const plugin_naps_context* ctx,
-    int val)
+static size_t _draw_comm_band(KsCppArgV* argVCpp, plugin_naps_context* ctx,
+    const NapTable* table, int sd, int val)
 {
-    IsApplicableFunc nap_rect_check_func_switch;
-    IsApplicableFunc nap_rect_check_func_waking;
-
-    nap_rect_check_func_switch = [=] (kshark_data_container* data_c, ssize_t t) {
-        kshark_entry* entry = data_c->data[t]->entry;
-
-        bool is_switch = (entry->event_id == ctx->sswitch_event_id);
-        bool correct_pid = (entry->pid == val);
-        return _nap_rect_check_function_general(entry) && is_switch && correct_pid;
-    };
-
-    nap_rect_check_func_waking = [=] (kshark_data_container* data_c, ssize_t i) {
-        kshark_entry* entry = data_c->data[i]->entry;
-        int64_t d_field = data_c->data[i]->field;
-
-        bool is_waking = (entry->event_id == ctx->waking_event_id);
-        bool correct_waking_pid = (d_field == val);
-        return _nap_rect_check_function_general(entry) && is_waking && correct_waking_pid;
-    };
-
-    // Noteworthy thing here is that KernelShark will automatically
-    // select a pair and NOT use members of it again - there won't be multiple
-    // nap rectangles from one entry.
-    // Hopefully this will never change.
-    eventFieldIntervalPlot(argVCpp, plugin_data, nap_rect_check_func_switch,
-                            plugin_data, nap_rect_check_func_waking,
-                            _make_nap_rect, {0, 0, 0}, -1);
+    NapCommAggregate* aggregate = NapCommAggregate::from_context(ctx);
+    const KsPlot::Graph* graph = argVCpp->_graph;
+    const NapBand* band = aggregate->band(*table, sd, val,
+        NapView::from_histo(argVCpp->_histo));
+    if (!band || !band->max_total || graph->size() < 1) return 0;
+
+    const int n_bins = std::min(graph->size(), band->view.n_bins);
+    const int bin_width = _bin_layout(graph).second;
+    const int height = graph->height();
+
+    auto drawn = new NapStateBand();
+    for (int bin = 0; bin < n_bins; ++bin) {
+        const int x = graph->bin(bin)._base.x();
+        const int y_base = graph->bin(bin)._base.y();
+
+        // Edges come from running sums, so rounding doesn't add up
+        uint32_t below = 0;
+        for (size_t s = 0; s < NAP_N_STATES; ++s) {
+            const uint32_t count = band->count(bin, s);
+            if (!count) continue;
+
+            const int y_bottom = y_base - int(below * height / band->max_total);
+            below += count;
+            const int y_top = y_base - int(below * height / band->max_total);
+            drawn->add(x, bin_width, y_top, y_bottom, NAP_STATES[s]);
+        }
+    }
+
+    if (!drawn->size()) {
+        delete drawn;
+        return 0;
+    }
+
+    argVCpp->_shapes->push_front(drawn);
+    return drawn->mem_usage();
+}
+
+/**
+ * @brief Gets the NUMA topology for bands of nodes, reading it again if
+ * the configured path changed.
+ * 
+ * @param path: Configured path to a topology file, empty for this machine
+ * 
+ * @returns The topology, empty if it couldn't be read.
+ * 
+ * @note Function depends on the file-global variables `numa_topology` and
+ * `numa_topology_read`.
+ */
+static const NapTopology& _get_numa_topology(const std::string& path) {
+    if (!numa_topology_read || numa_topology.first != path) {
+        numa_topology.first = path;
+        numa_topology.second = path.empty() ? NapTopology::from_sysfs()
+                                            : NapTopology::from_file(path);
+        numa_topology_read = true;
+    }
+    return numa_topology.second;
+}
+
+/**
+ * @brief Draws the band of a NUMA node into the plot of the node's first
+ * CPU - average numbers of threads napping on the node's CPUs in each bin,
+ * stacked by prev_state and scaled to the plot's height by the largest
+ * total in view.
+ * 
+ * @param argVCpp: The C++ arguments of the drawing function of the plugin
+ * @param ctx: Plugin's context of the drawn stream
+ * @param table: Nap table of the drawn stream
+ * @param topology: Mapping of CPUs to nodes
+ * @param node: Number of the node
+ * 
+ * @returns Bytes of the drawn band, zero if nothing was drawn.
+ */
+static size_t _draw_node_band(KsCppArgV* argVCpp, plugin_naps_context* ctx,
+    const NapTable* table, const NapTopology& topology, int node)
+{
+    const KsPlot::Graph* graph = argVCpp->_graph;
+    NapNodeAggregate* aggregate = NapNodeAggregate::from_context(ctx);
+    const NapNodeBand* band = aggregate->band(*table, topology, node,
+        NapView::from_histo(argVCpp->_histo));
+    if (!band || band->max_total <= 0 || graph->size() < 1) return 0;
+
+    const int n_bins = std::min(graph->size(), band->view.n_bins);
+    const int bin_width = _bin_layout(graph).second;
+    const float height = float(graph->height());
+
+    auto drawn = new NapStateBand();
+    for (int bin = 0; bin < n_bins; ++bin) {
+        const int x = graph->bin(bin)._base.x();
+        const int y_base = graph->bin(bin)._base.y();
+
+        // Edges come from running sums, so rounding doesn't add up
+        float below = 0;
+        for (size_t s = 0; s < NAP_N_STATES; ++s) {
+            const float load = band->load(bin, s);
+            if (load <= 0) continue;
+
+            const int y_bottom = y_base - int(below * height / band->max_total);
+            below += load;
+            const int y_top = y_base - int(below * height / band->max_total);
+            if (y_top == y_bottom) continue;
+            drawn->add(x, bin_width, y_top, y_bottom, NAP_STATES[s]);
+        }
+    }
+
+    if (!drawn->size()) {
+        delete drawn;
+        return 0;
+    }
+
+    argVCpp->_shapes->push_front(drawn);
+    return drawn->mem_usage();
+}
+
+/**
+ * @brief Gets the nap table of a drawn stream. If it has to be built, builds
+ * of all streams which need them are scheduled on the thread pool first,
+ * so that other streams' tables are ready by the time their plots are
+ * drawn, and only this stream's build is waited for.
+ * 
+ * @param ctx: Plugin's context of the drawn stream
+ * @param sd: Stream identifier number
+ * 
+ * @returns Pointer to the nap table or null if there are no collected events.
+ */
+static const NapTable* _get_table(plugin_naps_context* ctx, int sd) {
+    NapBuildScheduler& builds = NapBuildScheduler::get_instance();
+    if (builds.schedule(ctx, sd)) builds.schedule_all();
+    return NapTable::from_context(ctx);
 }
 
 // Functions defined in C header
 
 /**
- * @brief Callback function called by KernelShark to draw naps as rectangles,
- * if conditions for drawing are met. This function is actually just a wrapper
- * for its C++ implementation `_draw_nap_rectangles`, this one mostly just
- * checks pre-conditions and then calls the C++ function. 
+ * @brief Callback function called by KernelShark to draw naps of a plot.
+ * It records the draw request, gets the stream's nap table (scheduling
+ * builds of all streams if needed), lets the core pick what the plot shows
+ * (see `naps_plan_draw`) - a band of a NUMA node or of a comm group, the
+ * longest naps with a strip summarizing the rest or all visible naps - and
+ * draws it. Bytes of the drawn shapes are accounted to the stream afterwards.
  * 
  * @param argv_c Arguments for the plugin's drawing function (e.g. visible
  * bins in the histogram)
@@ -257,58 +660,132 @@ void draw_nap_rectangles(struct kshark_cpp_argv* argv_c, int sd,
 {
     KsCppArgV* argVCpp KS_ARGV_TO_CPP(argv_c);
     plugin_naps_context* ctx = __get_context(sd);
-    kshark_data_container* plugin_data;
 
     // Get config data
     const NapConfig& config = NapConfig::get_instance();
-    const int32_t HISTO_ENTRIES_LIMIT = config.get_histo_limit();
-
-    // Don't draw if not drawing tasks or
-    // if there are too many bins to draw.
-    bool is_task_draw = (draw_action == KSHARK_TASK_DRAW);
-    bool is_too_many_bins = (argVCpp->_histo->tot_count > HISTO_ENTRIES_LIMIT);
-    
-    if (!is_task_draw || is_too_many_bins) {
-        return;
-    }
+    const NapDrawSettings settings{config.get_histo_limit(),
+        config.get_nap_budget(), config.get_aggregate_min_threads(),
+        config.get_numa_bands(), config.get_numa_topology()};
+
+    _record_draw_request(argVCpp, sd, val, draw_action, settings);
+
+    if (!ctx || !naps_draws_plot(draw_action, settings)) return;
 
-    plugin_data = ctx->collected_events;
-    if (!plugin_data) {
+    const NapTable* table = _get_table(ctx, sd);
+    if (!table) {
         // Couldn't get the context container (any reason)
         return;
     }
 
-    _draw_nap_rectangles(argVCpp, plugin_data, ctx, val);
+    const NapTopology* topology = settings.numa_bands
+        ? &_get_numa_topology(settings.numa_topology) : nullptr;
+    const NapDrawPlan plan = naps_plan_draw(ctx, *table, topology, sd, val,
+        draw_action, NapView::from_histo(argVCpp->_histo), settings);
+
+    size_t drawn_bytes = 0;
+    switch (plan.path) {
+    case NapDrawPath::NODE_BAND:
+        drawn_bytes = _draw_node_band(argVCpp, ctx, table, *topology,
+            plan.node);
+        break;
+    case NapDrawPath::COMM_BAND:
+        drawn_bytes = _draw_comm_band(argVCpp, ctx, table, sd, val);
+        break;
+    case NapDrawPath::TOP_NAPS:
+        drawn_bytes = _draw_top_naps(argVCpp, sd, val, plan.task,
+            plan.budget);
+        break;
+    case NapDrawPath::ALL_NAPS:
+        drawn_bytes = _draw_nap_rectangles(argVCpp, ctx, table, sd, val,
+            plan.task);
+        break;
+    case NapDrawPath::NOTHING:
+        break;
+    }
+
+    // CPU plots are keyed apart from task plots
+    const int plot = (draw_action == KSHARK_CPU_DRAW) ? -1 - val : val;
+    _account_drawn_shapes(ctx, sd, argVCpp->_histo, plot, drawn_bytes);
 }
 
 /**
  * @brief Give the plugin a pointer to KernelShark's main window to allow
  * GUI manipulation and menu creation.
  * 
- * This is where plugin menu is made and initialized first. It's lifetime
- * is managed by KernelShark afterward.
+ * This is where plugin menus are made. The configuration, comparison and
+ * statistics windows are created only when their menus are first used,
+ * as children of the main window, which deletes them. Time this took is
+ * kept in the configuration.
  * 
  * @param gui_ptr: Pointer to the main KernelShark window.
  * 
- * @returns Pointer to the configuration menu window instance. Returned
- * window pointer is a void pointer (to interoperate with C, who doesn't
- * know these types).
+ * @returns Null pointer, as the plugin has no dialog for KernelShark to
+ * delete - KernelShark deletes a returned pointer when the main window is
+ * destroyed.
  * 
  * @note Function also depends on the configuration `NapConfig` singleton
- * & on the file-global variable `cfg_window`.
+ * & on the file-global variables `build_listener` and `gl_widget`.
 */
 __hidden void* plugin_set_gui_ptr(void* gui_ptr) {
+    auto start = std::chrono::steady_clock::now();
+
     KsMainWindow* main_w = static_cast<KsMainWindow*>(gui_ptr);
     // Configuration access here.
     NapConfig::main_w_ptr = main_w;
 
-    // File-global variable access here.
-    if (cfg_window == nullptr) {
-        cfg_window = new NapConfigWindow();
-    }
-
     QString menu("Tools/Naps Configuration");
     main_w->addPluginMenu(menu, config_show);
+    main_w->addPluginMenu("Tools/Naps Stream Comparison", diff_show);
+    main_w->addPluginMenu("Tools/Naps Statistics", stats_show);
+    main_w->addPluginMenu("Tools/Naps Export", export_show);
+
+    // Builds finish on worker threads, the message is shown by the GUI thread
+    // if the main window still exists by then. The listener is registered
+    // once and removed with the window, as the pool may outlive it.
+    if (build_listener < 0) {
+        QPointer<KsMainWindow> window{main_w};
+        build_listener = NapBuildScheduler::get_instance().add_listener(
+            [window](int sd, const NapTable* table, int64_t build_ns) {
+                const QString message = QString(
+                    "Naps of stream %1 ready: %2 naps in %3 ms").arg(sd)
+                    .arg(qulonglong(table ? table->size() : 0))
+                    .arg(double(build_ns) / 1e6, 0, 'f', 1);
+                QCoreApplication* app = QCoreApplication::instance();
+                if (!app) return;
+                QMetaObject::invokeMethod(app, [window, message]() {
+                    if (window) window->statusBar()->showMessage(message, 5000);
+                }, Qt::QueuedConnection);
+            });
+        QObject::connect(main_w, &QObject::destroyed, []() {
+            NapBuildScheduler::get_instance().remove_listener(build_listener);
+            build_listener = -1;
+        });
+    }
+
+    // The label atlas is freed before its OpenGL context dies with the widget.
+    if (!gl_widget) {
+        gl_widget = main_w->graphPtr()->glPtr();
+        QObject::connect(gl_widget, &QOpenGLWidget::aboutToBeDestroyed,
+            plugin_free_gl_resources);
+    }
+
+    NapConfig::menu_activation_ns = std::chrono::duration_cast<
+        std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+        .count();
+    return nullptr;
+}
+
+/**
+ * @brief Frees OpenGL resources of the plugin, i.e. the label atlas, with
+ * KernelShark's OpenGL context made current. If the OpenGL widget is already
+ * gone, the atlas died with its context and nothing is freed.
+ *
+ * @note Function also depends on the file-global variable `gl_widget`.
+*/
+__hidden void plugin_free_gl_resources() {
+    if (!gl_widget) return;
 
-    return cfg_window;
+    gl_widget->makeCurrent();
+    NapLabelAtlas::get_instance().unload();
+    gl_widget->doneCurrent();
 }
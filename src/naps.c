@@ -3,19 +3,26 @@
 /**
  * @file    naps.c
  * @brief   Contains definitions of functions used by the plugin
- *          upon plugin loading and deloading, as well as handler's
- *          (un)registriations and a few event-processing functions.
+ *          upon plugin loading and deloading, as well as draw handler's
+ *          (un)registriations. Context and event processing are left to
+ *          the plugin's core, see `naps_core.c`.
 */
 
 
 // C
+#include <limits.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 
 // KernelShark
 #include "libkshark.h"
 #include "libkshark-plot.h"
 #include "libkshark-plugin.h"
-#include "libkshark-tepdata.h"
 
 // Plugin header
 #include "naps.h"
@@ -38,140 +45,187 @@ static char* font_file = NULL;
 /// @brief Path to the bold font file.
 static char* bold_font_path = NULL;
 
-// Header file definitions
+///
+/// @brief Whether resolution of font paths was already attempted.
+static bool font_paths_tried = false;
+
+///
+/// @brief Name of the file caching resolved font paths across sessions.
+static const char FONT_CACHE_NAME[] = "kernelshark-naps.fonts";
+
+// Static functions
 
 /**
- * @brief Checks if the bold font is loaded. If it isn't loaded yet, it initializes it.
- * 
- * @note Font to be loaded is *FreeSansBold*. This shouldn't produce issues,
- * as KernelShark uses said font in regular form and bold should be included.
- * If it does produce an issue, change `bold_font_path` above to the font file you
- * wish to use.
+ * @brief Gets current time of a monotonic clock.
  * 
- * @returns True if font is loaded, false otherwise.
- */
-struct ksplot_font* get_bold_font_ptr() {
-    if (!ksplot_font_is_loaded(&bold_font)) {
-        ksplot_init_font(&bold_font, FONT_SIZE + 2, bold_font_path);
-    }
-    
-    return &bold_font;
+ * @returns Time in nanoseconds.
+*/
+static int64_t _now_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
 }
 
 /**
- * @brief Get pointer to the font. Initializes the font
- * if this hasn't happened yet.
+ * @brief Gets path of the file caching font paths, i.e. a file in
+ * `$XDG_CACHE_HOME` or in `~/.cache`.
+ * 
+ * @param path: Output buffer for the path
+ * @param size: Size of the buffer
  * 
- * @returns Pointer to the font
+ * @returns True if there is a cache directory to use, false otherwise.
 */
-struct ksplot_font* get_font_ptr() {
-    if (!ksplot_font_is_loaded(&font)) {
-        ksplot_init_font(&font, FONT_SIZE, font_file);
+static bool _font_cache_path(char* path, size_t size)
+{
+    const char* cache_dir = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+    int written;
+
+    if (cache_dir && *cache_dir) {
+        written = snprintf(path, size, "%s/%s", cache_dir, FONT_CACHE_NAME);
+    } else if (home && *home) {
+        written = snprintf(path, size, "%s/.cache/%s", home, FONT_CACHE_NAME);
+    } else {
+        return false;
     }
 
-    return &font;
+    return written > 0 && (size_t)written < size;
 }
 
-// Context & plugin loading
-
 /**
- * @brief Frees structures of the context and invalidates other number fields.
+ * @brief Reads font paths from the cache file. Paths are used only if
+ * both are still readable files.
  * 
- * @param nr_ctx: Pointer to plugin's context to be freed
-*/ 
-static void _nr_free_ctx(struct plugin_naps_context* nr_ctx)
+ * @returns True if both font paths were read, false otherwise.
+*/
+static bool _read_font_cache()
 {
-	if (!nr_ctx) {
-		return;
-    }
+    char cache[PATH_MAX], regular[PATH_MAX], bold[PATH_MAX];
+    if (!_font_cache_path(cache, sizeof(cache))) return false;
+
+    FILE* in = fopen(cache, "r");
+    if (!in) return false;
 
-	kshark_free_data_container(nr_ctx->collected_events);
+    bool ok = fgets(regular, sizeof(regular), in) && fgets(bold, sizeof(bold), in);
+    fclose(in);
+    if (!ok) return false;
 
-    nr_ctx->sswitch_event_id = nr_ctx->waking_event_id = -1;
+    regular[strcspn(regular, "\n")] = '\0';
+    bold[strcspn(bold, "\n")] = '\0';
+    if (access(regular, R_OK) || access(bold, R_OK)) return false;
+
+    font_file = strdup(regular);
+    bold_font_path = strdup(bold);
+    return font_file && bold_font_path;
 }
 
-/// @cond Doxygen_Suppress
-// KernelShark-provided magic that will define the most basic
-// plugin context functionality - init, freeing and getting context.
-KS_DEFINE_PLUGIN_CONTEXT(struct plugin_naps_context , _nr_free_ctx);
-/// @endcond
+/**
+ * @brief Writes resolved font paths into the cache file, creating its
+ * directory (only readable by the user) if there's none yet. The cache only
+ * saves time, so a failure is just reported; it is tried once per session,
+ * as font paths are resolved only once.
+*/
+static void _write_font_cache()
+{
+    char cache[PATH_MAX];
+    if (!_font_cache_path(cache, sizeof(cache))) return;
+
+    char* dir_end = strrchr(cache, '/');
+    if (dir_end && dir_end != cache) {
+        *dir_end = '\0';
+        mkdir(cache, 0700);
+        *dir_end = '/';
+    }
+
+    FILE* out = fopen(cache, "w");
+    if (!out) {
+        fprintf(stderr, "naps: font paths not cached, can't write %s\n", cache);
+        return;
+    }
+
+    fprintf(out, "%s\n%s\n", font_file, bold_font_path);
+    fclose(out);
+}
 
 /**
- * @brief Process sched_waking events as tep records during plugin loads,
- * adds PID of who is being awoken into the sched_waking entry's auxiliary
- * field - this pid will also become the owner of the event.
- * Else, it adds in invalid -1 (which isn't a valid PID).
- * 
- * @param ctx: Pointer to plugin context
- * @param stream: Pointer to the KernelShark stream with data
- * @param rec: Pointer to the tep record of the entry
- * @param entry: Pointer KernelShark event entry
+ * @brief Resolves paths of the plugin's fonts, only once. Paths are taken
+ * from the cache file if possible, as querying fontconfig is slow, else they
+ * are found by KernelShark and cached.
  * 
- * @warning Incompatiblity - this function may make some plugins
- * expecting certain values in entries to be incompatible with
- * this plugin, e.g. sched_events plugin.
+ * @returns True if both font paths are known, false otherwise.
 */
-static void waking_evt_tep_processing(struct plugin_naps_context* ctx, 
-   [[maybe_unused]] struct kshark_data_stream* stream,
-   void* rec, struct kshark_entry* entry)
+static bool _resolve_font_paths()
 {
-   struct tep_record* record = (struct tep_record*)rec;
-   unsigned long long val; int ret;
-   struct kshark_data_container* collected_events = ctx->collected_events;
-
-   ret = tep_read_number_field(ctx->sched_waking_pid_field, record->data, &val);
-
-   if (ret == 0) {
-       // This is a source of possible incompatibility with other plugins.
-       // Changing the PID also moves the event into another task's task plot,
-       // which is crucial for interval plots.
-       entry->pid = (int32_t)val;
-       entry->visible &= ~KS_PLUGIN_UNTOUCHED_MASK;
-       // If some events change the entry's PID further, this is a
-       // storage of the PID naps captured dring its load - it helps
-       // consistency of data for the plugin ever so slightly.
-       kshark_data_container_append(collected_events, entry, val);
-   } else {
-       // Couldn't read number field, move on. Minus one will also always
-       // produce a negative result in check functions.
-       kshark_data_container_append(collected_events, entry, (int64_t)-1);
-   }
+    if (!font_paths_tried) {
+        font_paths_tried = true;
+
+        if (!_read_font_cache()) {
+            free(font_file);
+            free(bold_font_path);
+            font_file = ksplot_find_font_file("FreeSans", "FreeSans");
+            bold_font_path = ksplot_find_font_file("FreeSans", "FreeSansBold");
+
+            if (font_file && bold_font_path) {
+                _write_font_cache();
+            }
+        }
+    }
+
+    return font_file && bold_font_path;
 }
 
+// Header file definitions
+
 /**
- * @brief Selects supported events from unsorted trace file data
- * during plugin and data loading.
+ * @brief Gets pointer to the bold font. Font paths are resolved and the font
+ * is loaded when this is first needed, i.e. when the first label is drawn.
  * 
- * @note Effective during KShark's get_records function.
+ * @note Font to be loaded is *FreeSansBold*. This shouldn't produce issues,
+ * as KernelShark uses said font in regular form and bold should be included.
+ * If it does produce an issue, change `bold_font_path` above to the font file you
+ * wish to use.
  * 
- * @param stream: KernelShark's data stream
- * @param rec: Tep record structure holding data collected by trace-cmd
- * @param entry: KernelShark entry to be processed
+ * @returns Pointer to the bold font or null if it couldn't be loaded.
+ */
+struct ksplot_font* get_bold_font_ptr() {
+    if (!ksplot_font_is_loaded(&bold_font) && _resolve_font_paths()) {
+        ksplot_init_font(&bold_font, BOLD_FONT_SIZE, bold_font_path);
+    }
+    
+    return ksplot_font_is_loaded(&bold_font) ? &bold_font : NULL;
+}
+
+/**
+ * @brief Gets path to the bold font's file, e.g. for rasterizing its glyphs
+ * elsewhere. Font paths are resolved when this is first needed.
  * 
- * @note Supported events are: `sched/sched_switch`,
- *                             `sched/sched_waking`.
+ * @returns Path to the bold font or null if it couldn't be found.
 */
-static void _select_events(struct kshark_data_stream* stream,
-    [[maybe_unused]] void* rec, struct kshark_entry* entry) {
-
-    struct plugin_naps_context *nr_ctx = __get_context(stream->stream_id);
-    if (!nr_ctx) return;
-    struct kshark_data_container* nr_ctx_collected_events = nr_ctx->collected_events;
-    if (!nr_ctx_collected_events) return;
-   
-    /** -1 is a nonsensical value, but necessary so that the container
-     * isn't considered empty.
-    */
-    if (entry->event_id == nr_ctx->sswitch_event_id) {
-        kshark_data_container_append(nr_ctx_collected_events, entry, (int64_t)-1);
-    } else if (entry->event_id == nr_ctx->waking_event_id) {
-        waking_evt_tep_processing(nr_ctx, stream, rec, entry);
+const char* get_bold_font_path() {
+    return _resolve_font_paths() ? bold_font_path : NULL;
+}
+
+/**
+ * @brief Get pointer to the font. Font paths are resolved and the font is
+ * loaded when this is first needed.
+ * 
+ * @returns Pointer to the font or null if it couldn't be loaded.
+*/
+struct ksplot_font* get_font_ptr() {
+    if (!ksplot_font_is_loaded(&font) && _resolve_font_paths()) {
+        ksplot_init_font(&font, FONT_SIZE, font_file);
     }
+
+    return ksplot_font_is_loaded(&font) ? &font : NULL;
 }
 
+// Plugin loading
+
 /** 
  * @brief Initializes the plugin's context and registers handlers of the
- * plugin. 
+ * plugin. Nothing else is done here - fonts are loaded when the first label
+ * is drawn. Time the activation took is kept in the context.
  * 
  * @param stream: KernelShark's data stream for which to initialize the
  * plugin
@@ -179,47 +233,22 @@ static void _select_events(struct kshark_data_stream* stream,
  * @returns `0` if any error happened. `1` if initialization was successful.
 */
 int KSHARK_PLOT_PLUGIN_INITIALIZER(struct kshark_data_stream* stream) {
-    if (!font_file || !bold_font_path) {
-        font_file = ksplot_find_font_file("FreeSans", "FreeSans");
-        bold_font_path = ksplot_find_font_file("FreeSans", "FreeSansBold");
-    }
-    if (!font_file || !bold_font_path) return 0;
-    
-    struct plugin_naps_context* nr_ctx = __init(stream->stream_id);
-
-    if (!nr_ctx) {
-		__close(stream->stream_id);
-		return 0;
-	}
-
-    if (!kshark_is_tep(stream)) {
-        __close(stream->stream_id);
-        return 0;
-    }
-
-    nr_ctx->tep = kshark_get_tep(stream);
-    bool waking_found = define_wakeup_event(nr_ctx->tep, &nr_ctx->tep_waking);
-
-    if (waking_found) {
-        nr_ctx->sched_waking_pid_field = tep_find_any_field(nr_ctx->tep_waking, "pid");
-    }
-
-    nr_ctx->collected_events = kshark_init_data_container();
+    int64_t start = _now_ns();
 
-    nr_ctx->sswitch_event_id = kshark_find_event_id(stream, "sched/sched_switch");
+    if (!naps_core_init(stream)) return 0;
 
-    nr_ctx->waking_event_id = kshark_find_event_id(stream, "sched/sched_waking");
-
-    kshark_register_event_handler(stream, nr_ctx->sswitch_event_id, _select_events);
-    kshark_register_event_handler(stream, nr_ctx->waking_event_id, _select_events);
     kshark_register_draw_handler(stream, draw_nap_rectangles);
 
+    struct plugin_naps_context* nr_ctx = __get_context(stream->stream_id);
+    nr_ctx->activation_ns = _now_ns() - start;
     return 1;
 }
 
 /**
  * @brief Deinitializes the plugin's context and unregisters handlers of the
- * plugin.
+ * plugin. The nap table is cached, as updating the plugin reinitializes it
+ * on the same data right away. The label atlas is freed and rasterized
+ * again by the next draw.
  * 
  * @param stream: KernelShark's data stream in which to deinitialize the
  * plugin.
@@ -227,26 +256,10 @@ int KSHARK_PLOT_PLUGIN_INITIALIZER(struct kshark_data_stream* stream) {
  * @returns `0` if any error happened. `1` if deinitialization was successful.
 */
 int KSHARK_PLOT_PLUGIN_DEINITIALIZER(struct kshark_data_stream* stream) {
-    struct plugin_naps_context* nr_ctx = __get_context(stream->stream_id);
-
-    int retval = 0;
-
-    if (nr_ctx) {
-        // Don't have dangling pointers
-        nr_ctx->tep = NULL;
-        nr_ctx->sched_waking_pid_field = NULL;
-        nr_ctx->sched_waking_pid_field = NULL;
-
-        kshark_unregister_event_handler(stream, nr_ctx->sswitch_event_id, _select_events);
-        kshark_unregister_event_handler(stream, nr_ctx->waking_event_id, _select_events);
-        kshark_unregister_draw_handler(stream, draw_nap_rectangles);
-        retval = 1;
-    }
-
-    if (stream->stream_id >= 0)
-        __close(stream->stream_id);
+    kshark_unregister_draw_handler(stream, draw_nap_rectangles);
+    plugin_free_gl_resources();
 
-    return retval;
+    return naps_core_deinit(stream, true);
 }
 
 /**
@@ -255,7 +268,7 @@ int KSHARK_PLOT_PLUGIN_DEINITIALIZER(struct kshark_data_stream* stream) {
  * 
  * @param gui_ptr: Pointer to KernelShark's GUI, its main window
  * 
- * @returns Pointer to KernelShark's main window.
+ * @returns Null pointer, the plugin's windows are owned by the main window.
 */
 void* KSHARK_MENU_PLUGIN_INITIALIZER(void* gui_ptr) {
 	return plugin_set_gui_ptr(gui_ptr);
@@ -2,9 +2,9 @@
 
 /**
  * @file    naps.h
- * @brief   For plugin integration with KernelShark. Includes plugin context
- *          and a few global functions either used in C++ or in C parts of the
- *          plugin.
+ * @brief   For plugin integration with KernelShark. Includes a few global
+ *          functions either used in C++ or in C parts of the plugin. Plugin
+ *          context comes from the plugin's core, see `naps_core.h`.
  * 
  * @note    Definitions in `Naps.cpp` and `naps.c`.
 */
@@ -12,13 +12,13 @@
 #ifndef _KS_PLUGIN_NAPS_H
 #define _KS_PLUGIN_NAPS_H
 
-// traceevent
-#include <traceevent/event-parse.h>
-
 // KernelShark
 #include "libkshark.h"
 #include "libkshark-plugin.h"
 
+// Plugin core
+#include "naps_core.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -27,61 +27,22 @@ extern "C" {
 /// @brief Chosen font size for plugin's font.
 #define FONT_SIZE 7
 
-/**
- * @brief Context for the plugin, basically structured
- * globally shared data.
-*/
-struct plugin_naps_context {
-    // Plugin-relevant events collection
-
-    /** 
-     * @brief Collected switch or wakeup events.
-    */
-    struct kshark_data_container* collected_events;
-
-    // Event IDs
-
-    /**
-     * @brief Numerical id of `sched/sched_switch` event.
-    */
-    int sswitch_event_id;
-
-    /**
-    * @brief Numerical id of `sched/sched_waking` event.
-    */
-    int waking_event_id;
-
-    // Tep processing.
-
-    /**
-     * @brief Page handle used to parse the trace event data.
-    */
-    struct tep_handle* tep;
-
-    /**
-    * @brief Pointer to the sched_waking_event object.
-    */
-    struct tep_event* tep_waking;
-
-    /**
-    * @brief Pointer to the sched_waking_pid_field format descriptor.
-    */
-    struct tep_format_field* sched_waking_pid_field;
-};
-
-// Macro'd declarations by KernelShark which it simpler to integrate the plugin.
-KS_DECLARE_PLUGIN_CONTEXT_METHODS(struct plugin_naps_context)
+///
+/// @brief Size of plugin's bold font, used for labels of nap rectangles.
+#define BOLD_FONT_SIZE (FONT_SIZE + 2)
 
 // Global functions, defined in C
 
 struct ksplot_font* get_font_ptr();
 struct ksplot_font* get_bold_font_ptr();
+const char* get_bold_font_path();
 
 // Global functions, defined in C++
 
 void draw_nap_rectangles(struct kshark_cpp_argv* argv_c, int sd,
     int val, int draw_action);
 void* plugin_set_gui_ptr(void* gui_ptr);
+void plugin_free_gl_resources();
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,888 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    naps_core.c
+ * @brief   Contains definitions of the plugin context's lifetime functions,
+ *          event handler's (un)registrations and event-processing functions
+ *          used during data loading. Nothing here touches the GUI.
+*/
+
+
+// C
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// KernelShark
+#include "libkshark.h"
+#include "libkshark-plugin.h"
+#include "libkshark-tepdata.h"
+
+// Plugin header
+#include "naps_core.h"
+
+// Static variables
+
+///
+/// @brief Abbreviations of prev_states, see `NAPS_STATE_LETTERS`.
+static const char STATE_LETTERS[] = NAPS_STATE_LETTERS;
+
+///
+/// @brief Colors of naps in each prev_state as 0xRRGGBB, in the order of
+/// `STATE_LETTERS`.
+static const uint32_t STATE_COLORS[NAPS_N_STATES] = {
+    0x00ff00, // R - Green
+    0x0000ff, // S - Blue
+    0xff0000, // D - Red
+    0x00ffff, // T - Cyan
+    0x8b4513, // t - Brown
+    0xff00ff, // X - Magenta
+    0x800080, // Z - Purple
+    0xffa500, // P - Orange
+    0xffff00  // I - Yellow
+};
+
+///
+/// @brief Full names of prev_states, in the order of `STATE_LETTERS`.
+static const char* const STATE_NAMES[NAPS_N_STATES] = {
+    "running",
+    "sleeping",
+    "uninterruptible (disk) sleep",
+    "stopped",
+    "tracing stop",
+    "dead",
+    "zombie",
+    "parked",
+    "idle"
+};
+
+///
+/// @brief Mask of prev_states excluded during loading, bit of each
+/// state is its index in `STATE_LETTERS`.
+static uint16_t excluded_states_mask = 0;
+
+// Context
+
+/**
+ * @brief Frees structures of the context and invalidates other number fields.
+ *
+ * @param nr_ctx: Pointer to plugin's context to be freed
+*/
+static void _nr_free_ctx(struct plugin_naps_context* nr_ctx)
+{
+    if (!nr_ctx) {
+        return;
+    }
+
+    // A build running on the thread pool uses all of the below
+    naps_wait_build(nr_ctx);
+
+    kshark_free_data_container(nr_ctx->collected_events);
+    nr_ctx->collected_events = NULL;
+
+    // Precomputation may still be using the nap table, free it first
+    naps_free_geometry_pass(nr_ctx->geometry_pass);
+    nr_ctx->geometry_pass = NULL;
+
+    naps_free_comm_aggregate(nr_ctx->comm_aggregate);
+    nr_ctx->comm_aggregate = NULL;
+
+    naps_free_node_aggregate(nr_ctx->node_aggregate);
+    nr_ctx->node_aggregate = NULL;
+
+    naps_free_block_io(nr_ctx->block_io);
+    nr_ctx->block_io = NULL;
+
+    naps_free_nap_table(nr_ctx->nap_table);
+    nr_ctx->nap_table = NULL;
+
+    naps_free_nap_table(nr_ctx->cached_table);
+    nr_ctx->cached_table = NULL;
+
+    free(nr_ctx->ingest_order);
+    nr_ctx->ingest_order = NULL;
+
+    free(nr_ctx->run_starts);
+    nr_ctx->run_starts = NULL;
+    nr_ctx->n_runs = nr_ctx->runs_capacity = 0;
+
+    free(nr_ctx->block_events);
+    nr_ctx->block_events = NULL;
+    nr_ctx->n_block_events = nr_ctx->block_events_capacity = 0;
+
+    free(nr_ctx->cpu_records);
+    nr_ctx->cpu_records = NULL;
+    nr_ctx->n_cpu_records = 0;
+
+    nr_ctx->sswitch_event_id = nr_ctx->waking_event_id = -1;
+    nr_ctx->block_issue_event_id = nr_ctx->block_complete_event_id = -1;
+    nr_ctx->drawn_shapes_bytes = 0;
+}
+
+/// @cond Doxygen_Suppress
+// KernelShark-provided magic that will define the most basic
+// plugin context functionality - init, freeing and getting context.
+KS_DEFINE_PLUGIN_CONTEXT(struct plugin_naps_context , _nr_free_ctx);
+/// @endcond
+
+// Event processing
+
+/**
+ * @brief Counts a record seen by an event handler and checks whether its
+ * CPU had it loaded already, by a previous load of a growing trace file.
+ * Each CPU's records are loaded in the order of its buffer, so the first
+ * ones are the previously loaded ones, however old or new the records of
+ * other CPUs are.
+ *
+ * @param ctx: Pointer to plugin context
+ * @param entry: KernelShark entry of the record
+ *
+ * @returns True if the record was loaded before and must be skipped.
+*/
+static bool _was_loaded(struct plugin_naps_context* ctx,
+    const struct kshark_entry* entry)
+{
+    if (entry->cpu < 0 || entry->cpu >= ctx->n_cpu_records) {
+        return false;
+    }
+
+    struct naps_cpu_records* records = &ctx->cpu_records[entry->cpu];
+    if (records->seen++ < records->loaded) {
+        return true;
+    }
+
+    records->loaded = records->seen;
+    records->last_ts = entry->ts;
+    return false;
+}
+
+/**
+ * @brief Notes where a new run of time-ordered events starts in the
+ * collected events, if the entry about to be collected starts one.
+ * Must be called right before the entry is appended.
+ *
+ * @param ctx: Pointer to plugin context
+ * @param entry: KernelShark entry about to be collected
+*/
+static void _track_event_runs(struct plugin_naps_context* ctx,
+    const struct kshark_entry* entry)
+{
+    ssize_t next_idx = ctx->collected_events->size;
+    bool is_run_start = (next_idx == 0 || entry->ts < ctx->last_collected_ts);
+    ctx->last_collected_ts = entry->ts;
+
+    if (!is_run_start || ctx->runs_lost) {
+        return;
+    }
+
+    if (ctx->n_runs == ctx->runs_capacity) {
+        size_t new_capacity = ctx->runs_capacity ? 2 * ctx->runs_capacity : 64;
+        ssize_t* new_starts = realloc(ctx->run_starts,
+            new_capacity * sizeof(*new_starts));
+
+        if (!new_starts) {
+            // Collected events will be sorted as a whole instead
+            ctx->runs_lost = true;
+            return;
+        }
+
+        ctx->run_starts = new_starts;
+        ctx->runs_capacity = new_capacity;
+    }
+
+    ctx->run_starts[ctx->n_runs++] = next_idx;
+}
+
+/**
+ * @brief Reads a numeric field of a tep record using its precomputed
+ * location, without searching the event's format. Fields are read directly
+ * if the trace file has the machine's endianness, else through libtraceevent.
+ *
+ * @param ctx: Pointer to plugin context
+ * @param reader: Precomputed location of the field
+ * @param record: Tep record to read from
+ * @param val: Output, sign-extended value of the field
+ *
+ * @returns `true` if the field was read, `false` otherwise.
+*/
+static inline bool _read_field(const struct plugin_naps_context* ctx,
+    const struct naps_field_reader* reader, const struct tep_record* record,
+    int64_t* val)
+{
+    if (reader->offset < 0 || reader->offset + reader->size > record->size) {
+        return false;
+    }
+
+    const unsigned char* data = (const unsigned char*)record->data + reader->offset;
+
+    if (!ctx->native_fields) {
+        *val = (int64_t)tep_read_number(ctx->tep, data, reader->size);
+        return true;
+    }
+
+    switch (reader->size) {
+    case 1: { int8_t v; memcpy(&v, data, sizeof(v)); *val = v; return true; }
+    case 2: { int16_t v; memcpy(&v, data, sizeof(v)); *val = v; return true; }
+    case 4: { int32_t v; memcpy(&v, data, sizeof(v)); *val = v; return true; }
+    case 8: { int64_t v; memcpy(&v, data, sizeof(v)); *val = v; return true; }
+    default: return false;
+    }
+}
+
+/**
+ * @brief Converts prev_state field of a sched_switch into the index of
+ * the abbreviation KernelShark shows for it in `STATE_LETTERS`, following
+ * the event's print format - lowest reported state bit or running if there
+ * is none. Preemption bit is ignored.
+ *
+ * @param prev_state: Raw value of the prev_state field
+ *
+ * @returns Index of the abbreviated previous state of the task.
+*/
+static inline int _prev_state_index(int64_t prev_state)
+{
+    uint64_t reported = (uint64_t)prev_state & 0xff;
+    return reported ? __builtin_ctzll(reported) + 1 : 0;
+}
+
+/**
+ * @brief Creates a location of a numeric field of an event.
+ *
+ * @param event: Format of the event, may be null
+ * @param name: Name of the field
+ *
+ * @returns Location of the field, with a negative offset if the event or
+ * its field doesn't exist.
+*/
+static struct naps_field_reader _find_field_reader(struct tep_event* event,
+    const char* name)
+{
+    struct naps_field_reader reader = {-1, 0};
+    struct tep_format_field* field = event ? tep_find_any_field(event, name) : NULL;
+
+    if (field) {
+        reader.offset = field->offset;
+        reader.size = field->size;
+    }
+
+    return reader;
+}
+
+/**
+ * @brief Event handler of sched_switch events during plugin loads. Collects
+ * the event along with its previous state and the PID of the next task,
+ * packed into the auxiliary field (see `NAPS_SWITCH_FIELD`). Events with
+ * excluded previous states are dropped.
+ *
+ * @note Effective during KShark's get_records function.
+ *
+ * @param stream: KernelShark's data stream
+ * @param rec: Tep record structure holding data collected by trace-cmd
+ * @param entry: KernelShark entry to be processed
+*/
+void naps_switch_handler(struct kshark_data_stream* stream, void* rec,
+    struct kshark_entry* entry)
+{
+    struct plugin_naps_context* ctx = __get_context(stream->stream_id);
+    if (!ctx || !ctx->collected_events) return;
+    // Collected by a previous load of a tailed file
+    if (_was_loaded(ctx, entry)) return;
+
+    const struct tep_record* record = (const struct tep_record*)rec;
+    int64_t prev_state, next_pid;
+    // -1 is a nonsensical value, fields are then read from the entry's info
+    int64_t field = -1;
+
+    if (_read_field(ctx, &ctx->switch_prev_state, record, &prev_state)
+        && _read_field(ctx, &ctx->switch_next_pid, record, &next_pid)) {
+        int state_idx = _prev_state_index(prev_state);
+
+        // Excluded states never take any memory
+        if (ctx->excluded_states & (1u << state_idx)) return;
+
+        field = NAPS_SWITCH_FIELD(STATE_LETTERS[state_idx], next_pid);
+    }
+
+    _track_event_runs(ctx, entry);
+    kshark_data_container_append(ctx->collected_events, entry, field);
+}
+
+/**
+ * @brief Event handler of sched_waking events during plugin loads. Makes
+ * the task being awoken the owner of the event and collects the event with
+ * PIDs of both the awoken task and the waker, packed into the auxiliary
+ * field (see `NAPS_WAKING_FIELD`). If the awoken task's PID can't be read,
+ * it collects an invalid -1 (which isn't a valid PID).
+ *
+ * @param stream: KernelShark's data stream
+ * @param rec: Tep record structure holding data collected by trace-cmd
+ * @param entry: KernelShark entry to be processed
+ *
+ * @warning Incompatiblity - this function may make some plugins
+ * expecting certain values in entries to be incompatible with
+ * this plugin, e.g. sched_events plugin.
+*/
+void naps_waking_handler(struct kshark_data_stream* stream, void* rec,
+    struct kshark_entry* entry)
+{
+    struct plugin_naps_context* ctx = __get_context(stream->stream_id);
+    if (!ctx || !ctx->collected_events) return;
+    // Collected by a previous load of a tailed file, owner already changed
+    if (_was_loaded(ctx, entry)) return;
+
+    const struct tep_record* record = (const struct tep_record*)rec;
+    int64_t wakee;
+
+    _track_event_runs(ctx, entry);
+
+    if (_read_field(ctx, &ctx->waking_pid, record, &wakee)) {
+        // Owner of the entry is still the waker here
+        int64_t field = NAPS_WAKING_FIELD(wakee, entry->pid);
+
+        // This is a source of possible incompatibility with other plugins.
+        // Changing the PID also moves the event into another task's task plot,
+        // which is crucial for interval plots.
+        entry->pid = (int32_t)wakee;
+        entry->visible &= ~KS_PLUGIN_UNTOUCHED_MASK;
+        // If some events change the entry's PID further, this is a
+        // storage of the PID naps captured dring its load - it helps
+        // consistency of data for the plugin ever so slightly.
+        kshark_data_container_append(ctx->collected_events, entry, field);
+    } else {
+        // Couldn't read number field, move on. Minus one will also always
+        // produce a negative result in check functions.
+        kshark_data_container_append(ctx->collected_events, entry, (int64_t)-1);
+    }
+}
+
+/**
+ * @brief Event handler of block_rq_issue and block_rq_complete events during
+ * plugin loads. Collects the request's device and sectors along with the
+ * event's time and task, so that requests can be paired and joined with
+ * naps in the `D` state once the nap table is built. Records whose fields
+ * can't be read are dropped, as the request couldn't be identified.
+ *
+ * @param stream: KernelShark's data stream
+ * @param rec: Tep record structure holding data collected by trace-cmd
+ * @param entry: KernelShark entry to be processed
+*/
+void naps_block_handler(struct kshark_data_stream* stream, void* rec,
+    struct kshark_entry* entry)
+{
+    struct plugin_naps_context* ctx = __get_context(stream->stream_id);
+    if (!ctx) return;
+    // Collected by a previous load of a tailed file
+    if (_was_loaded(ctx, entry)) return;
+
+    const bool is_complete = (entry->event_id == ctx->block_complete_event_id);
+    const struct naps_block_fields* fields = is_complete
+        ? &ctx->block_complete : &ctx->block_issue;
+    const struct tep_record* record = (const struct tep_record*)rec;
+    int64_t dev, sector, nr_sector;
+
+    if (!_read_field(ctx, &fields->dev, record, &dev)
+        || !_read_field(ctx, &fields->sector, record, &sector)
+        || !_read_field(ctx, &fields->nr_sector, record, &nr_sector)) {
+        return;
+    }
+
+    if (ctx->n_block_events == ctx->block_events_capacity) {
+        size_t new_capacity = ctx->block_events_capacity
+            ? 2 * ctx->block_events_capacity : 1024;
+        struct naps_block_event* new_events = realloc(ctx->block_events,
+            new_capacity * sizeof(*new_events));
+
+        // Block I/O is only an addition, naps are collected regardless
+        if (!new_events) return;
+
+        ctx->block_events = new_events;
+        ctx->block_events_capacity = new_capacity;
+    }
+
+    struct naps_block_event* event = &ctx->block_events[ctx->n_block_events++];
+    event->ts = entry->ts;
+    event->sector = (uint64_t)sector;
+    event->dev = (uint32_t)dev;
+    event->nr_sector = (uint32_t)nr_sector;
+    event->pid = entry->pid;
+    event->is_complete = is_complete;
+}
+
+/**
+ * @brief Finds locations of fields identifying block requests in a block
+ * request event.
+ *
+ * @param event: Format of the event, may be null
+ *
+ * @returns Locations of the fields, with negative offsets if the event or
+ * its fields don't exist.
+*/
+static struct naps_block_fields _find_block_fields(struct tep_event* event)
+{
+    struct naps_block_fields fields = {
+        _find_field_reader(event, "dev"),
+        _find_field_reader(event, "sector"),
+        _find_field_reader(event, "nr_sector")
+    };
+    return fields;
+}
+
+/**
+ * @brief Registers the plugin's event handlers of a stream. Handlers of block
+ * request events are registered only if the trace has the events.
+ *
+ * @param stream: KernelShark's data stream
+ * @param nr_ctx: Plugin's context of the stream
+*/
+static void _register_handlers(struct kshark_data_stream* stream,
+    struct plugin_naps_context* nr_ctx)
+{
+    kshark_register_event_handler(stream, nr_ctx->sswitch_event_id,
+        naps_switch_handler);
+    kshark_register_event_handler(stream, nr_ctx->waking_event_id,
+        naps_waking_handler);
+
+    if (nr_ctx->block_issue_event_id >= 0) {
+        kshark_register_event_handler(stream, nr_ctx->block_issue_event_id,
+            naps_block_handler);
+    }
+    if (nr_ctx->block_complete_event_id >= 0) {
+        kshark_register_event_handler(stream, nr_ctx->block_complete_event_id,
+            naps_block_handler);
+    }
+}
+
+/**
+ * @brief Unregisters the plugin's event handlers of a stream.
+ *
+ * @param stream: KernelShark's data stream
+ * @param nr_ctx: Plugin's context of the stream
+*/
+static void _unregister_handlers(struct kshark_data_stream* stream,
+    struct plugin_naps_context* nr_ctx)
+{
+    kshark_unregister_event_handler(stream, nr_ctx->sswitch_event_id,
+        naps_switch_handler);
+    kshark_unregister_event_handler(stream, nr_ctx->waking_event_id,
+        naps_waking_handler);
+
+    if (nr_ctx->block_issue_event_id >= 0) {
+        kshark_unregister_event_handler(stream, nr_ctx->block_issue_event_id,
+            naps_block_handler);
+    }
+    if (nr_ctx->block_complete_event_id >= 0) {
+        kshark_unregister_event_handler(stream, nr_ctx->block_complete_event_id,
+            naps_block_handler);
+    }
+}
+
+// Context & plugin loading
+
+/**
+ * @brief Finds the stream's tep handle, locations of fields and event ids
+ * and registers the plugin's event handlers.
+ *
+ * @param stream: KernelShark's data stream
+ * @param nr_ctx: Plugin's context of the stream
+*/
+static void _attach(struct kshark_data_stream* stream,
+    struct plugin_naps_context* nr_ctx)
+{
+    nr_ctx->tep = kshark_get_tep(stream);
+    nr_ctx->native_fields = (tep_is_file_bigendian(nr_ctx->tep)
+                             == tep_is_local_bigendian(nr_ctx->tep));
+
+    // Locations of fields are found once, handlers then read them directly
+    struct tep_event* tep_switch = tep_find_event_by_name(nr_ctx->tep,
+        "sched", "sched_switch");
+    nr_ctx->switch_prev_state = _find_field_reader(tep_switch, "prev_state");
+    nr_ctx->switch_next_pid = _find_field_reader(tep_switch, "next_pid");
+
+    struct tep_event* tep_waking = tep_find_event_by_name(nr_ctx->tep,
+        "sched", "sched_waking");
+    nr_ctx->waking_pid = _find_field_reader(tep_waking, "pid");
+
+    nr_ctx->sswitch_event_id = kshark_find_event_id(stream, "sched/sched_switch");
+
+    nr_ctx->waking_event_id = kshark_find_event_id(stream, "sched/sched_waking");
+
+    // Block requests, for joining naps in the D state with I/O
+    nr_ctx->block_issue = _find_block_fields(tep_find_event_by_name(nr_ctx->tep,
+        "block", "block_rq_issue"));
+    nr_ctx->block_complete = _find_block_fields(tep_find_event_by_name(
+        nr_ctx->tep, "block", "block_rq_complete"));
+    nr_ctx->block_issue_event_id = kshark_find_event_id(stream,
+        "block/block_rq_issue");
+    nr_ctx->block_complete_event_id = kshark_find_event_id(stream,
+        "block/block_rq_complete");
+
+    _register_handlers(stream, nr_ctx);
+}
+
+/**
+ * @brief Initializes the plugin's context for a stream and registers
+ * the plugin's event handlers.
+ *
+ * @param stream: KernelShark's data stream for which to initialize the
+ * context
+ *
+ * @returns `0` if any error happened. `1` if initialization was successful.
+*/
+int naps_core_init(struct kshark_data_stream* stream) {
+    struct plugin_naps_context* nr_ctx = __init(stream->stream_id);
+
+    if (!nr_ctx) {
+        __close(stream->stream_id);
+        return 0;
+    }
+
+    if (!kshark_is_tep(stream)) {
+        __close(stream->stream_id);
+        return 0;
+    }
+
+    nr_ctx->collected_events = kshark_init_data_container();
+    nr_ctx->excluded_states = excluded_states_mask;
+    if (stream->n_cpus > 0) {
+        nr_ctx->cpu_records = calloc(stream->n_cpus,
+            sizeof(*nr_ctx->cpu_records));
+        nr_ctx->n_cpu_records = nr_ctx->cpu_records ? stream->n_cpus : 0;
+    }
+
+    _attach(stream, nr_ctx);
+
+    // Naps of the same data from the previous activation, if any
+    nr_ctx->cached_table = naps_take_cached_table(stream, nr_ctx);
+
+    return 1;
+}
+
+/**
+ * @brief Unregisters the plugin's event handlers of a stream, but keeps its
+ * context with everything collected so far, so that a growing trace file
+ * can be closed and opened again (see `naps_core_reattach`).
+ *
+ * @param stream: KernelShark's data stream to detach from
+ *
+ * @returns `0` if the stream has no context. `1` if it was detached.
+*/
+int naps_core_detach(struct kshark_data_stream* stream) {
+    struct plugin_naps_context* nr_ctx = __get_context(stream->stream_id);
+    if (!nr_ctx) return 0;
+
+    naps_wait_build(nr_ctx);
+    nr_ctx->tep = NULL;
+    _unregister_handlers(stream, nr_ctx);
+    return 1;
+}
+
+/**
+ * @brief Attaches a detached context to a stream of the same, but grown,
+ * trace file. Records each CPU had loaded from the file before are skipped
+ * by the event handlers, the rest is appended to the collected events,
+ * after which the nap table is extended in place. Only the headless
+ * session tails files (see `NapSession::tail`), the GUI never reattaches.
+ *
+ * @param stream: KernelShark's data stream of the reopened trace file, must
+ * have the same identifier as the detached one
+ *
+ * @returns `0` if any error happened. `1` if the context was reattached.
+*/
+int naps_core_reattach(struct kshark_data_stream* stream) {
+    struct plugin_naps_context* nr_ctx = __get_context(stream->stream_id);
+    if (!nr_ctx || !nr_ctx->collected_events || !kshark_is_tep(stream)) {
+        return 0;
+    }
+
+    int switch_id = nr_ctx->sswitch_event_id;
+    int waking_id = nr_ctx->waking_event_id;
+    int block_issue_id = nr_ctx->block_issue_event_id;
+    int block_complete_id = nr_ctx->block_complete_event_id;
+    _attach(stream, nr_ctx);
+
+    if (nr_ctx->sswitch_event_id != switch_id || nr_ctx->waking_event_id != waking_id
+        || nr_ctx->block_issue_event_id != block_issue_id
+        || nr_ctx->block_complete_event_id != block_complete_id
+        || stream->n_cpus != nr_ctx->n_cpu_records) {
+        // Not the same trace file, collected events would be mixed up
+        naps_core_detach(stream);
+        return 0;
+    }
+
+    for (int cpu = 0; cpu < nr_ctx->n_cpu_records; ++cpu) {
+        nr_ctx->cpu_records[cpu].seen = 0;
+    }
+
+    // Reattached contexts follow the file from now on
+    nr_ctx->follows_file = true;
+
+    // A lagging CPU's new events can be older than the last collected one,
+    // so they always start a new run
+    nr_ctx->last_collected_ts = INT64_MAX;
+    nr_ctx->collected_events->sorted = false;
+    return 1;
+}
+
+/**
+ * @brief Gets the time up to which collected events of a context can be
+ * paired into naps. All events of a finished trace file can. When the file
+ * is followed, a lagging CPU's appended records can be older than the last
+ * loaded records of other CPUs, but never than its own, so only events older
+ * than every CPU's last loaded record are final. CPUs which haven't loaded
+ * any handled record yet don't hold pairing back, as idle CPUs would hold it
+ * back forever - if their records turn out to be older, the nap table is
+ * built anew.
+ *
+ * @param ctx: Pointer to plugin context
+ *
+ * @returns Timestamp before which events can be paired, `INT64_MAX` if
+ * all can.
+*/
+int64_t naps_pairing_limit(const struct plugin_naps_context* ctx)
+{
+    int64_t limit = INT64_MAX;
+    if (!ctx->follows_file) {
+        return limit;
+    }
+
+    for (int cpu = 0; cpu < ctx->n_cpu_records; ++cpu) {
+        const struct naps_cpu_records* records = &ctx->cpu_records[cpu];
+        if (records->loaded && records->last_ts < limit) {
+            limit = records->last_ts;
+        }
+    }
+    return limit;
+}
+
+// Prev_states
+
+/**
+ * @brief Gets the position of a prev_state in `NAPS_STATE_LETTERS`, which
+ * indexes all tables of prev_states.
+ *
+ * @param prev_state: Abbreviation of the prev_state
+ *
+ * @returns Index of the prev_state or -1 for an unknown one.
+*/
+int naps_state_index(char prev_state)
+{
+    const char* found = prev_state
+        ? memchr(STATE_LETTERS, prev_state, NAPS_N_STATES) : NULL;
+    return found ? (int)(found - STATE_LETTERS) : -1;
+}
+
+/**
+ * @brief Gets the fill color of naps in a prev_state, shared by nap
+ * rectangles, bands and rendered timelines.
+ *
+ * @param prev_state: Abbreviation of the prev_state
+ *
+ * @returns Color as 0xRRGGBB, gray for an unknown prev_state.
+*/
+uint32_t naps_state_color(char prev_state)
+{
+    int idx = naps_state_index(prev_state);
+    return (idx >= 0) ? STATE_COLORS[idx] : 0x808080;
+}
+
+/**
+ * @brief Gets the full name of a prev_state.
+ *
+ * @param prev_state: Abbreviation of the prev_state
+ *
+ * @returns Name of the prev_state in lowercase, "unknown" for an unknown
+ * prev_state.
+*/
+const char* naps_state_name(char prev_state)
+{
+    int idx = naps_state_index(prev_state);
+    return (idx >= 0) ? STATE_NAMES[idx] : "unknown";
+}
+
+// Excluded states
+
+/**
+ * @brief Sets prev_states whose sched_switch events will be dropped during
+ * loading of data streams initialized from now on. Such states will never
+ * start a nap, so following sched_switch events of the same task may start
+ * it instead.
+ *
+ * @param states: Abbreviations of the excluded states, e.g. "R". Characters
+ * which don't abbreviate a known state are ignored.
+*/
+void naps_set_excluded_states(const char* states)
+{
+    uint16_t mask = 0;
+
+    for (; states && *states; ++states) {
+        int idx = naps_state_index(*states);
+        if (idx >= 0) {
+            mask |= (uint16_t)(1u << idx);
+        }
+    }
+
+    excluded_states_mask = mask;
+}
+
+/**
+ * @brief Gets prev_states currently excluded during loading.
+ *
+ * @param states: Output buffer for abbreviations of the excluded states,
+ * always null-terminated if its size isn't zero
+ * @param size: Size of the buffer
+ *
+ * @returns Number of excluded states.
+*/
+size_t naps_get_excluded_states(char* states, size_t size)
+{
+    size_t n_states = 0;
+
+    for (size_t i = 0; STATE_LETTERS[i]; ++i) {
+        if (!(excluded_states_mask & (1u << i))) continue;
+
+        if (n_states + 1 < size) {
+            states[n_states] = STATE_LETTERS[i];
+        }
+        ++n_states;
+    }
+
+    if (size) {
+        states[n_states < size ? n_states : size - 1] = '\0';
+    }
+    return n_states;
+}
+
+// Memory accounting
+
+/**
+ * @brief Gets bytes of memory used by the collected events container,
+ * i.e. the container itself, its array of pointers (whole capacity)
+ * and the data fields of the collected events.
+ *
+ * @param events: Pointer to the container (may be null)
+ *
+ * @returns Number of bytes used by the container.
+*/
+static size_t _collected_events_mem_usage(
+    const struct kshark_data_container* events)
+{
+    if (!events) {
+        return 0;
+    }
+
+    return sizeof(*events)
+        + (size_t)events->capacity * sizeof(*events->data)
+        + (size_t)events->size * sizeof(**events->data);
+}
+
+/**
+ * @brief Fills memory usage of the plugin for a data stream, broken down
+ * by structure. Nap tables in the session cache belong to no stream, their
+ * memory is reported by `naps_cache_mem_usage`.
+ *
+ * @param sd: Data stream identifier
+ * @param usage: Output, memory usage of the plugin for the stream
+ *
+ * @returns `true` if the stream has the plugin's context, `false` otherwise
+ * (usage is zeroed then).
+*/
+bool naps_get_mem_usage(int sd, struct naps_mem_usage* usage)
+{
+    struct plugin_naps_context* nr_ctx = __get_context(sd);
+
+    usage->context = usage->collected_events = 0;
+    usage->ingest_order = usage->cpu_records = 0;
+    usage->nap_table = usage->geometry = usage->drawn_shapes = 0;
+    usage->aggregates = usage->block_io = 0;
+
+    if (!nr_ctx) {
+        return false;
+    }
+
+    // Sizes are only stable once a pending build is done
+    naps_wait_build(nr_ctx);
+
+    usage->context = sizeof(*nr_ctx);
+    usage->collected_events =
+        _collected_events_mem_usage(nr_ctx->collected_events)
+        + nr_ctx->runs_capacity * sizeof(*nr_ctx->run_starts);
+    if (nr_ctx->ingest_order && nr_ctx->collected_events) {
+        usage->ingest_order = (size_t)nr_ctx->collected_events->size
+            * sizeof(*nr_ctx->ingest_order);
+    }
+    usage->cpu_records = (size_t)nr_ctx->n_cpu_records
+        * sizeof(*nr_ctx->cpu_records);
+    usage->nap_table = naps_nap_table_mem_usage(nr_ctx->nap_table)
+        + naps_nap_table_mem_usage(nr_ctx->cached_table);
+    usage->geometry = naps_geometry_pass_mem_usage(nr_ctx->geometry_pass);
+    usage->aggregates = naps_comm_aggregate_mem_usage(nr_ctx->comm_aggregate)
+        + naps_node_aggregate_mem_usage(nr_ctx->node_aggregate);
+    usage->block_io =
+        nr_ctx->block_events_capacity * sizeof(*nr_ctx->block_events)
+        + naps_block_io_mem_usage(nr_ctx->block_io);
+    usage->drawn_shapes = nr_ctx->drawn_shapes_bytes;
+    return true;
+}
+
+/**
+ * @brief Sums up all parts of the plugin's memory usage.
+ *
+ * @param usage: Memory usage of the plugin for a stream
+ *
+ * @returns Total number of bytes.
+*/
+size_t naps_mem_usage_total(const struct naps_mem_usage* usage)
+{
+    return usage->context + usage->collected_events
+        + usage->ingest_order + usage->cpu_records
+        + usage->nap_table + usage->geometry
+        + usage->aggregates + usage->block_io
+        + usage->drawn_shapes;
+}
+
+/**
+ * @brief Unregisters the plugin's event handlers and closes the plugin's
+ * context of a stream.
+ *
+ * @param stream: KernelShark's data stream in which to deinitialize the
+ * context.
+ * @param cache_naps: Whether the nap table is kept in the session cache,
+ * which only pays off when the plugin is reinitialized on the same data
+ * (see `NapTableCache`). Headless sessions don't cache.
+ *
+ * @returns `0` if any error happened. `1` if deinitialization was successful.
+*/
+int naps_core_deinit(struct kshark_data_stream* stream, bool cache_naps) {
+    struct plugin_naps_context* nr_ctx = __get_context(stream->stream_id);
+
+    int retval = 0;
+
+    if (nr_ctx) {
+        naps_wait_build(nr_ctx);
+
+        // Don't have dangling pointers
+        nr_ctx->tep = NULL;
+
+        _unregister_handlers(stream, nr_ctx);
+
+        // Precomputation may still be using the nap table, which may be kept
+        naps_free_geometry_pass(nr_ctx->geometry_pass);
+        nr_ctx->geometry_pass = NULL;
+        naps_free_comm_aggregate(nr_ctx->comm_aggregate);
+        nr_ctx->comm_aggregate = NULL;
+        naps_free_node_aggregate(nr_ctx->node_aggregate);
+        nr_ctx->node_aggregate = NULL;
+        naps_free_block_io(nr_ctx->block_io);
+        nr_ctx->block_io = NULL;
+        if (cache_naps) {
+            naps_cache_nap_table(stream, nr_ctx);
+        }
+        retval = 1;
+    }
+
+    if (stream->stream_id >= 0)
+        __close(stream->stream_id);
+
+    return retval;
+}
@@ -0,0 +1,554 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    naps_core.h
+ * @brief   Qt-free core of the plugin. Includes the plugin context and
+ *          functions which set up event ingestion for a data stream.
+ *          Depends only on libkshark and libtraceevent, so that tools,
+ *          benchmarks and tests can link it without KernelShark's GUI.
+ *
+ * @note    Definitions in `naps_core.c`, `NapTable.cpp`,
+ *          `NapTableCache.cpp`, `NapAggregate.cpp`,
+ *          `NapNodeAggregate.cpp`, `NapGeometryPass.cpp`,
+ *          `NapBuildScheduler.cpp` and `NapBlockIo.cpp`.
+*/
+
+#ifndef _KS_PLUGIN_NAPS_CORE_H
+#define _KS_PLUGIN_NAPS_CORE_H
+
+// C
+#include <stdbool.h>
+#include <stddef.h>
+
+// traceevent
+#include <traceevent/event-parse.h>
+
+// KernelShark
+#include "libkshark.h"
+#include "libkshark-plugin.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Table of naps paired from the collected events, defined in C++.
+ *
+ * @note Definition in `NapTable.hpp`.
+*/
+struct NapTable;
+
+/**
+ * @brief Geometry of naps precomputed for drawn plots, defined in C++.
+ *
+ * @note Definition in `NapGeometryPass.hpp`.
+*/
+struct NapGeometryPass;
+
+/**
+ * @brief Aggregates of naps of task groups, defined in C++.
+ *
+ * @note Definition in `NapAggregate.hpp`.
+*/
+struct NapCommAggregate;
+
+/**
+ * @brief Naps indexed per CPU with bands of NUMA nodes, defined in C++.
+ *
+ * @note Definition in `NapNodeAggregate.hpp`.
+*/
+struct NapNodeAggregate;
+
+/**
+ * @brief Build of a nap table running on the thread pool, defined in C++.
+ *
+ * @note Definition in `NapBuildScheduler.hpp`.
+*/
+struct NapBuild;
+
+/**
+ * @brief Block I/O requests joined with naps of the nap table, defined
+ * in C++.
+ *
+ * @note Definition in `NapBlockIo.hpp`.
+*/
+struct NapBlockIo;
+
+/**
+ * @brief Location of a numeric field in the raw data of an event's records,
+ * precomputed from the event's format, so that records can be read without
+ * searching for the field.
+*/
+struct naps_field_reader {
+    /**
+     * @brief Offset of the field in the data, negative if there's no field.
+    */
+    int offset;
+
+    /**
+     * @brief Size of the field in bytes.
+    */
+    int size;
+};
+
+/**
+ * @brief Locations of fields of a block request event identifying the
+ * request, i.e. its device and sectors.
+*/
+struct naps_block_fields {
+    /**
+     * @brief Location of the `dev` field, the kernel's device number.
+    */
+    struct naps_field_reader dev;
+
+    /**
+     * @brief Location of the `sector` field, the request's first sector.
+    */
+    struct naps_field_reader sector;
+
+    /**
+     * @brief Location of the `nr_sector` field, the request's length.
+    */
+    struct naps_field_reader nr_sector;
+};
+
+/**
+ * @brief Numbers of records of a CPU handled by the event handlers. Buffers
+ * of CPUs are written independently, so records appended to a growing trace
+ * file can be older than the last loaded record of another CPU, but never
+ * than those of their own CPU.
+*/
+struct naps_cpu_records {
+    /**
+     * @brief Records loaded from the trace file before, by any load.
+    */
+    uint64_t loaded;
+
+    /**
+     * @brief Records seen by the current load.
+    */
+    uint64_t seen;
+
+    /**
+     * @brief Timestamp of the CPU's last loaded record. Records appended
+     * later to the CPU's buffer are never older.
+    */
+    int64_t last_ts;
+};
+
+/**
+ * @brief Issue or completion of a block I/O request collected during
+ * loading. Requests are told apart by their device and first sector.
+*/
+struct naps_block_event {
+    /**
+     * @brief Timestamp of the event.
+    */
+    int64_t ts;
+
+    /**
+     * @brief First sector of the request.
+    */
+    uint64_t sector;
+
+    /**
+     * @brief Kernel's device number of the request's device.
+    */
+    uint32_t dev;
+
+    /**
+     * @brief Number of sectors of the request.
+    */
+    uint32_t nr_sector;
+
+    /**
+     * @brief PID of the task the event happened in, for issues usually the
+     * task doing synchronous I/O.
+    */
+    int32_t pid;
+
+    /**
+     * @brief Whether the event is a completion, else it's an issue.
+    */
+    bool is_complete;
+};
+
+// Prev_states
+
+/**
+ * @brief Abbreviations of prev_states in order of their bits in the
+ * prev_state field of sched_switch, preceded by running (no bit). Every
+ * table of prev_states in the plugin (colors, names, layers of bands)
+ * follows this order.
+*/
+#define NAPS_STATE_LETTERS "RSDTtXZPI"
+
+/**
+ * @brief Number of prev_states in `NAPS_STATE_LETTERS`.
+*/
+#define NAPS_N_STATES (sizeof(NAPS_STATE_LETTERS) - 1)
+
+// Auxiliary fields of collected events
+
+/**
+ * @brief Packs prev_state abbreviation and PID of the next task
+ * of a sched_switch into the auxiliary field of a collected event.
+*/
+#define NAPS_SWITCH_FIELD(prev_state, next_pid) \
+    ((int64_t)(unsigned char)(prev_state) << 32 | (uint32_t)(next_pid))
+
+/**
+ * @brief Gets prev_state abbreviation of a collected sched_switch,
+ * valid only if the field isn't negative.
+*/
+#define NAPS_SWITCH_PREV_STATE(field) ((char)(((field) >> 32) & 0xff))
+
+/**
+ * @brief Gets PID of the next task of a collected sched_switch,
+ * valid only if the field isn't negative.
+*/
+#define NAPS_SWITCH_NEXT_PID(field) ((int32_t)((field) & 0xffffffff))
+
+/**
+ * @brief Packs PIDs of the awoken task and the waker of a sched_waking
+ * into the auxiliary field of a collected event.
+*/
+#define NAPS_WAKING_FIELD(wakee, waker) \
+    ((int64_t)(uint32_t)(waker) << 32 | (uint32_t)(wakee))
+
+/**
+ * @brief Gets PID of the awoken task of a collected sched_waking,
+ * negative if it couldn't be read.
+*/
+#define NAPS_WAKING_WAKEE(field) ((int32_t)((field) & 0xffffffff))
+
+/**
+ * @brief Gets PID of the waker of a collected sched_waking,
+ * valid only if the field isn't negative.
+*/
+#define NAPS_WAKING_WAKER(field) ((int32_t)((field) >> 32))
+
+/**
+ * @brief Context for the plugin, basically structured
+ * globally shared data.
+*/
+struct plugin_naps_context {
+    // Plugin-relevant events collection
+
+    /**
+     * @brief Collected switch or wakeup events.
+    */
+    struct kshark_data_container* collected_events;
+
+    /**
+     * @brief Naps paired from collected events. Built lazily, once loading
+     * is done and the naps are first needed.
+    */
+    struct NapTable* nap_table;
+
+    /**
+     * @brief Build of the nap table running on the thread pool, null if
+     * there's none pending. Nothing else may use the context's collected
+     * events and nap table until it's waited for (see `naps_wait_build`).
+    */
+    struct NapBuild* build;
+
+    /**
+     * @brief Geometry of naps precomputed for plots drawn with the same
+     * view. Created on the first draw.
+    */
+    struct NapGeometryPass* geometry_pass;
+
+    /**
+     * @brief Groups of tasks by comm with bands of their naps kept for
+     * recent views. Created on the first draw of a group.
+    */
+    struct NapCommAggregate* comm_aggregate;
+
+    /**
+     * @brief Naps indexed per CPU with bands of NUMA nodes kept for recent
+     * views. Created on the first draw of a node.
+    */
+    struct NapNodeAggregate* node_aggregate;
+
+    /**
+     * @brief Collected issues and completions of block I/O requests, in the
+     * order of loading. Empty if the trace has no block request events.
+    */
+    struct naps_block_event* block_events;
+
+    /**
+     * @brief Number of events in `block_events`.
+    */
+    size_t n_block_events;
+
+    /**
+     * @brief Allocated capacity of `block_events`.
+    */
+    size_t block_events_capacity;
+
+    /**
+     * @brief Block I/O requests indexed per device and joined with naps
+     * in the `D` state. Created when first needed.
+    */
+    struct NapBlockIo* block_io;
+
+    /**
+     * @brief Nap table kept from the previous activation of the plugin on
+     * the same data, reattached to the reloaded events instead of pairing
+     * them again. Taken from the session cache on initialization.
+    */
+    struct NapTable* cached_table;
+
+    /**
+     * @brief Positions of merged events in the order of ingestion, indexed
+     * by position in the merged `collected_events`. Kept only until the nap
+     * table is built, null if the events were sorted otherwise.
+    */
+    uint32_t* ingest_order;
+
+    /**
+     * @brief Indices in `collected_events` where runs of events ordered
+     * by time start. Records of each CPU arrive in time order, so the
+     * collected events are a concatenation of a few sorted runs, which
+     * are merged once loading is done.
+    */
+    ssize_t* run_starts;
+
+    /**
+     * @brief Number of runs in `run_starts`.
+    */
+    size_t n_runs;
+
+    /**
+     * @brief Allocated capacity of `run_starts`.
+    */
+    size_t runs_capacity;
+
+    /**
+     * @brief Timestamp of the last collected event, detects starts of runs.
+    */
+    int64_t last_collected_ts;
+
+    /**
+     * @brief Whether runs couldn't be tracked (allocation failed), in which
+     * case the collected events have to be fully sorted instead of merged.
+    */
+    bool runs_lost;
+
+    /**
+     * @brief Records of handled events per CPU, as counted by previous loads
+     * of a growing trace file and by the current one, so that a load of the
+     * grown file skips records each CPU had before (see `naps_core_reattach`).
+     * Null if the stream has no CPUs.
+    */
+    struct naps_cpu_records* cpu_records;
+
+    /**
+     * @brief Number of CPUs in `cpu_records`.
+    */
+    int n_cpu_records;
+
+    /**
+     * @brief Whether the trace file is followed while it grows (see
+     * `NapSession::tail`). Naps are then paired only from events older than
+     * every CPU's last loaded record (see `naps_pairing_limit`), later ones
+     * wait until all CPUs have caught up with them.
+    */
+    bool follows_file;
+
+    /**
+     * @brief Prev_states whose sched_switch events are dropped during
+     * loading, as a mask (see `naps_set_excluded_states`). Copied from
+     * the global setting when the context is initialized.
+    */
+    uint16_t excluded_states;
+
+    // Event IDs
+
+    /**
+     * @brief Numerical id of `sched/sched_switch` event.
+    */
+    int sswitch_event_id;
+
+    /**
+    * @brief Numerical id of `sched/sched_waking` event.
+    */
+    int waking_event_id;
+
+    /**
+     * @brief Numerical id of `block/block_rq_issue` event, negative if the
+     * trace doesn't have it.
+    */
+    int block_issue_event_id;
+
+    /**
+     * @brief Numerical id of `block/block_rq_complete` event, negative if
+     * the trace doesn't have it.
+    */
+    int block_complete_event_id;
+
+    // Tep processing.
+
+    /**
+     * @brief Page handle used to parse the trace event data.
+    */
+    struct tep_handle* tep;
+
+    /**
+     * @brief Whether the trace file has the machine's endianness, so that
+     * fields of records can be read directly.
+    */
+    bool native_fields;
+
+    /**
+     * @brief Location of the `prev_state` field of sched_switch records.
+    */
+    struct naps_field_reader switch_prev_state;
+
+    /**
+     * @brief Location of the `next_pid` field of sched_switch records.
+    */
+    struct naps_field_reader switch_next_pid;
+
+    /**
+     * @brief Location of the `pid` field of sched_waking records.
+    */
+    struct naps_field_reader waking_pid;
+
+    /**
+     * @brief Locations of fields of block_rq_issue records.
+    */
+    struct naps_block_fields block_issue;
+
+    /**
+     * @brief Locations of fields of block_rq_complete records.
+    */
+    struct naps_block_fields block_complete;
+
+    // Memory accounting
+
+    /**
+     * @brief Bytes of nap rectangles handed over to KernelShark during the
+     * last redraw of the stream's plots. Maintained by the GUI part.
+    */
+    size_t drawn_shapes_bytes;
+
+    // Diagnostics
+
+    /**
+     * @brief Time activation of the plugin for the stream took, in
+     * nanoseconds. Measured by the plugin, zero in headless use.
+    */
+    int64_t activation_ns;
+};
+
+/**
+ * @brief Bytes of memory used by the plugin for one data stream,
+ * broken down by structure. Sizes of heap-allocated structures are
+ * computed from their capacities, not just from the used parts.
+*/
+struct naps_mem_usage {
+    /**
+     * @brief The plugin's context itself.
+    */
+    size_t context;
+
+    /**
+     * @brief Container of collected events, including its data fields.
+    */
+    size_t collected_events;
+
+    /**
+     * @brief Positions of merged events in the order of ingestion, while
+     * they are kept for the nap table's build.
+    */
+    size_t ingest_order;
+
+    /**
+     * @brief Records loaded and seen per CPU, which tell reloaded records
+     * from the ones appended to the trace file.
+    */
+    size_t cpu_records;
+
+    /**
+     * @brief Nap table with its per-task arrays, statistics and index.
+    */
+    size_t nap_table;
+
+    /**
+     * @brief Geometry of naps precomputed for drawn plots.
+    */
+    size_t geometry;
+
+    /**
+     * @brief Groups of tasks by comm, naps per CPU and their kept bands.
+    */
+    size_t aggregates;
+
+    /**
+     * @brief Collected block I/O events, requests and their joins with naps.
+    */
+    size_t block_io;
+
+    /**
+     * @brief Nap rectangles created during the last redraw.
+    */
+    size_t drawn_shapes;
+};
+
+// Macro'd declarations by KernelShark which it simpler to integrate the plugin.
+KS_DECLARE_PLUGIN_CONTEXT_METHODS(struct plugin_naps_context)
+
+// Global functions, defined in C
+
+int naps_core_init(struct kshark_data_stream* stream);
+int naps_core_deinit(struct kshark_data_stream* stream, bool cache_naps);
+int naps_core_detach(struct kshark_data_stream* stream);
+int naps_core_reattach(struct kshark_data_stream* stream);
+
+int naps_state_index(char prev_state);
+uint32_t naps_state_color(char prev_state);
+const char* naps_state_name(char prev_state);
+
+void naps_set_excluded_states(const char* states);
+size_t naps_get_excluded_states(char* states, size_t size);
+
+int64_t naps_pairing_limit(const struct plugin_naps_context* ctx);
+
+bool naps_get_mem_usage(int sd, struct naps_mem_usage* usage);
+size_t naps_mem_usage_total(const struct naps_mem_usage* usage);
+
+// Event processing, registered as event handlers (exposed for benchmarks)
+
+void naps_switch_handler(struct kshark_data_stream* stream, void* rec,
+    struct kshark_entry* entry);
+void naps_waking_handler(struct kshark_data_stream* stream, void* rec,
+    struct kshark_entry* entry);
+void naps_block_handler(struct kshark_data_stream* stream, void* rec,
+    struct kshark_entry* entry);
+
+// Global functions, defined in C++
+
+void naps_merge_collected_events(struct plugin_naps_context* ctx);
+void naps_wait_build(struct plugin_naps_context* ctx);
+void naps_free_nap_table(struct NapTable* table);
+size_t naps_nap_table_mem_usage(const struct NapTable* table);
+struct NapTable* naps_take_cached_table(struct kshark_data_stream* stream,
+    const struct plugin_naps_context* ctx);
+void naps_cache_nap_table(struct kshark_data_stream* stream,
+    struct plugin_naps_context* ctx);
+size_t naps_cache_mem_usage(void);
+void naps_free_geometry_pass(struct NapGeometryPass* pass);
+size_t naps_geometry_pass_mem_usage(const struct NapGeometryPass* pass);
+void naps_free_comm_aggregate(struct NapCommAggregate* aggregate);
+size_t naps_comm_aggregate_mem_usage(const struct NapCommAggregate* aggregate);
+void naps_free_node_aggregate(struct NapNodeAggregate* aggregate);
+size_t naps_node_aggregate_mem_usage(const struct NapNodeAggregate* aggregate);
+void naps_free_block_io(struct NapBlockIo* block_io);
+size_t naps_block_io_mem_usage(const struct NapBlockIo* block_io);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+#endif // _KS_PLUGIN_NAPS_CORE_H
@@ -0,0 +1,789 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapsTests.cpp
+ * @brief   Checks of the plugin's core against brute-force references, run
+ *          by CTest on small trace files from `naps-tracegen`. Each check
+ *          loads a trace file with a headless session and compares what the
+ *          core computed with a simple, obviously correct computation:
+ *
+ *          - `merge` - merged runs of collected events against a full sort,
+ *          and positions in the order of ingestion,
+ *
+ *          - `top-index` - longest naps of ranges against a linear scan,
+ *          while the index grows,
+ *
+ *          - `histogram` - percentiles of durations against exact values,
+ *
+ *          - `extend` - a table extended with later events against a table
+ *          built from all of them at once,
+ *
+ *          - `extend-lagging` - the same, but with CPUs whose appended
+ *          events are older than events of other CPUs paired before,
+ *
+ *          - `critical-path` - wake chains of random naps against walks
+ *          with linear scans, and partitions of the naps into segments,
+ *
+ *          - `diff` - comparisons of nap profiles against a map of both,
+ *
+ *          - `block-io` - joins of naps in the `D` state with block I/O
+ *          against a scan of all requests of each device for each nap.
+*/
+
+// C
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// C++
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// KernelShark
+#include "libkshark.h"
+
+// Plugin
+#include "NapBlockIo.hpp"
+#include "NapCriticalPath.hpp"
+#include "NapDiff.hpp"
+#include "NapHistogram.hpp"
+#include "NapSession.hpp"
+#include "NapTable.hpp"
+#include "NapTopIndex.hpp"
+
+// Static variables
+
+///
+/// @brief Number of failed comparisons of the running check.
+static uint64_t n_failures = 0;
+
+// Static functions
+
+/**
+ * @brief Counts and reports a failed comparison, if it failed.
+ *
+ * @param ok: Result of the comparison
+ * @param what: Description of the comparison
+ *
+ * @returns The result of the comparison.
+*/
+static bool _expect(bool ok, const std::string& what) {
+    if (!ok) {
+        // Only the first few are printed, the count tells the rest
+        if (n_failures < 20) std::fprintf(stderr, "FAILED: %s\n", what.c_str());
+        ++n_failures;
+    }
+    return ok;
+}
+
+/**
+ * @brief Prints usage of the tests.
+*/
+static void _usage(const char* prog) {
+    std::fprintf(stderr,
+        "Usage: %s CHECK TRACE\n"
+        "  CHECK is one of merge, top-index, histogram, extend,\n"
+        "  extend-lagging, critical-path, diff, block-io\n",
+        prog);
+}
+
+/**
+ * @brief Checks the merge of runs of collected events done at the end of
+ * loading. The merged events must equal a stable sort of the events in the
+ * order of ingestion, which is restored from the kept positions - those
+ * must be a permutation, under which each CPU's events keep their order.
+ *
+ * @param ctx: Context of the loaded stream, with no nap table built yet
+*/
+static void _check_merge(plugin_naps_context* ctx) {
+    const kshark_data_container* events = ctx->collected_events;
+    if (!_expect(events->sorted, "collected events are merged")
+        || !_expect(ctx->ingest_order != nullptr, "positions are kept")) {
+        return;
+    }
+
+    const size_t size = size_t(events->size);
+    std::vector<kshark_data_field_int64*> ingested(size, nullptr);
+    for (size_t i = 0; i < size; ++i) {
+        const uint32_t pos = ctx->ingest_order[i];
+        if (!_expect(pos < size && !ingested[pos],
+                "position " + std::to_string(pos) + " is unique")) return;
+        ingested[pos] = events->data[i];
+    }
+
+    // Each CPU's buffer is ordered, so must be its events in ingestion
+    std::vector<int64_t> last_of_cpu;
+    for (const kshark_data_field_int64* event : ingested) {
+        const int16_t cpu = event->entry->cpu;
+        if (size_t(cpu) >= last_of_cpu.size()) {
+            last_of_cpu.resize(cpu + 1, INT64_MIN);
+        }
+        _expect(event->entry->ts >= last_of_cpu[cpu],
+            "CPU " + std::to_string(cpu) + " is ordered in ingestion");
+        last_of_cpu[cpu] = event->entry->ts;
+    }
+
+    std::vector<kshark_data_field_int64*> sorted = ingested;
+    std::stable_sort(sorted.begin(), sorted.end(),
+        [](const kshark_data_field_int64* a, const kshark_data_field_int64* b) {
+            return a->entry->ts < b->entry->ts;
+        });
+    for (size_t i = 0; i < size; ++i) {
+        _expect(sorted[i] == events->data[i],
+            "merged event " + std::to_string(i) + " equals the sorted one");
+    }
+}
+
+/**
+ * @brief Checks the index of the longest naps of each task against a linear
+ * scan. The index is grown the way extending the table grows it, in chunks
+ * of naps of varying size, and queried on random ranges after each chunk.
+ *
+ * @param table: Nap table of the loaded stream
+*/
+static void _check_top_index(const NapTable& table) {
+    std::mt19937 random{1};
+
+    for (const auto& [pid, task] : table.tasks()) {
+        const auto duration = [&task](size_t i) {
+            return task.end[i] - task.start[i];
+        };
+
+        NapTopIndex index;
+        std::vector<int64_t> start, end;
+        while (start.size() < task.size()) {
+            const size_t chunk = std::min(task.size() - start.size(),
+                size_t(1 + random() % (3 * NapTopIndex::BLOCK_SIZE)));
+            start.insert(start.end(), task.start.begin() + start.size(),
+                task.start.begin() + start.size() + chunk);
+            end.insert(end.end(), task.end.begin() + end.size(),
+                task.end.begin() + end.size() + chunk);
+            index.update(start, end);
+
+            for (int query = 0; query < 16; ++query) {
+                size_t first = random() % (start.size() + 1);
+                size_t last = random() % (start.size() + 1);
+                if (first > last) std::swap(first, last);
+                const size_t count = random() % 8;
+                const std::string range = "task " + std::to_string(pid)
+                    + " naps [" + std::to_string(first) + ", "
+                    + std::to_string(last) + ")";
+
+                // Ties go to the earlier nap
+                size_t longest = last;
+                for (size_t i = first; i < last; ++i) {
+                    if (longest == last || duration(i) > duration(longest)) {
+                        longest = i;
+                    }
+                }
+                _expect(index.longest(start, end, first, last) == longest,
+                    "longest of " + range);
+
+                // Naps of equal durations may be picked in any order
+                std::vector<int64_t> want;
+                for (size_t i = first; i < last; ++i) want.push_back(duration(i));
+                std::sort(want.begin(), want.end(), std::greater<int64_t>());
+                want.resize(std::min(want.size(), count));
+
+                const std::vector<uint32_t> top = index.top(start, end, first,
+                    last, count);
+                std::vector<int64_t> got;
+                for (uint32_t i : top) {
+                    if (!_expect(i >= first && i < last, "top of " + range
+                            + " is in range")) return;
+                    got.push_back(duration(i));
+                }
+                _expect(std::is_sorted(top.begin(), top.end()),
+                    "top of " + range + " is ordered by time");
+                std::sort(got.begin(), got.end(), std::greater<int64_t>());
+                _expect(got == want, "top " + std::to_string(count)
+                    + " of " + range);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Checks histograms of durations of each task's naps in each
+ * prev_state against the exact durations. A percentile must be the largest
+ * value of the bucket holding the exact value at its rank, within the
+ * recorded range.
+ *
+ * @param table: Nap table of the loaded stream
+*/
+static void _check_histogram(const NapTable& table) {
+    static const double PERCENTS[] = {0, 1, 10, 25, 50, 75, 90, 99, 99.9, 100};
+
+    for (const auto& [pid, task] : table.tasks()) {
+        for (const auto& [state, stats] : task.stats) {
+            std::vector<int64_t> exact;
+            for (size_t i = 0; i < task.size(); ++i) {
+                if (task.state[i] == state) {
+                    exact.push_back(task.end[i] - task.start[i]);
+                }
+            }
+            std::sort(exact.begin(), exact.end());
+
+            const NapHistogram& durations = stats.durations;
+            const std::string of = "task " + std::to_string(pid) + " state "
+                + std::string(1, state);
+            if (!_expect(durations.count() == exact.size(), "count of " + of)
+                || exact.empty()) continue;
+            _expect(durations.min() == exact.front(), "min of " + of);
+            _expect(durations.max() == exact.back(), "max of " + of);
+
+            for (double percent : PERCENTS) {
+                const uint64_t rank = std::max<uint64_t>(1,
+                    uint64_t(std::ceil(percent / 100.0 * double(exact.size()))));
+                const int64_t value = exact[rank - 1];
+                const int64_t want = std::clamp(NapHistogram::bucket_max(
+                    NapHistogram::bucket_of(value)), exact.front(), exact.back());
+                _expect(durations.percentile(percent) == want,
+                    std::to_string(percent) + "th percentile of " + of);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Compares naps of a table with those of a reference table built
+ * from all events at once.
+ *
+ * @param table: The checked table
+ * @param whole: The reference table
+*/
+static void _compare_tables(const NapTable& table, const NapTable& whole) {
+    _expect(table.size() == whole.size(), "number of naps");
+    _expect(table.tasks().size() == whole.tasks().size(), "number of tasks");
+    for (const auto& [pid, want] : whole.tasks()) {
+        const NapTaskTable* got = table.task(pid);
+        const std::string of = "task " + std::to_string(pid);
+        if (!_expect(got != nullptr, of + " is extended")) continue;
+
+        _expect(got->start == want.start && got->end == want.end,
+            "times of naps of " + of);
+        _expect(got->state == want.state, "prev_states of " + of);
+        _expect(got->waker == want.waker, "wakers of " + of);
+        _expect(got->switch_entry == want.switch_entry
+            && got->waking_entry == want.waking_entry, "entries of " + of);
+        for (const auto& [state, stats] : want.stats) {
+            auto found = got->stats.find(state);
+            _expect(found != got->stats.end()
+                && found->second.count == stats.count
+                && found->second.total_ns == stats.total_ns
+                && found->second.durations.percentile(50)
+                    == stats.durations.percentile(50),
+                "statistics of " + of + " state " + std::string(1, state));
+        }
+    }
+}
+
+/**
+ * @brief Checks that extending a table pairs the same naps as building it
+ * at once. A table is built from the first half of the collected events and
+ * extended with the rest in a few steps, then compared with a table built
+ * from all of them.
+ *
+ * @param ctx: Context of the loaded stream
+*/
+static void _check_extend(plugin_naps_context* ctx) {
+    kshark_data_container* all = ctx->collected_events;
+    if (!_expect(all->sorted, "collected events are merged")) return;
+
+    const NapTable whole{all, ctx->sswitch_event_id, ctx->waking_event_id};
+
+    kshark_data_container* grown = kshark_init_data_container();
+    const ssize_t half = all->size / 2;
+    for (ssize_t i = 0; i < half; ++i) {
+        kshark_data_container_append(grown, all->data[i]->entry,
+            all->data[i]->field);
+    }
+    grown->sorted = true;
+    NapTable extended{grown, ctx->sswitch_event_id, ctx->waking_event_id};
+
+    // Steps end at distinct times, as tailing a file would
+    const ssize_t steps[] = {half + (all->size - half) / 3,
+        half + 2 * (all->size - half) / 3, all->size};
+    for (ssize_t step : steps) {
+        for (ssize_t i = grown->size; i < step; ++i) {
+            kshark_data_container_append(grown, all->data[i]->entry,
+                all->data[i]->field);
+        }
+        // Appended events are in order already
+        grown->sorted = true;
+        _expect(extended.extend(grown),
+            "extension up to event " + std::to_string(step));
+    }
+
+    _compare_tables(extended, whole);
+    kshark_free_data_container(grown);
+}
+
+/**
+ * @brief Checks that extending a table of a followed file pairs the same naps
+ * as building it at once, when CPUs flush their buffers on their own
+ * schedules. In each step, every CPU has events up to its own time, lagging
+ * behind by up to two steps, so appended events of a lagging CPU are older
+ * than paired events of others. Events are paired up to the limit the core
+ * computes from each CPU's last event, the last step pairs all of them, as
+ * if the file was finished.
+ *
+ * @param ctx: Context of the loaded stream
+*/
+static void _check_extend_lagging(plugin_naps_context* ctx) {
+    kshark_data_container* all = ctx->collected_events;
+    if (!_expect(all->sorted, "collected events are merged")
+        || !_expect(all->size > 0, "events were collected")) return;
+
+    const NapTable whole{all, ctx->sswitch_event_id, ctx->waking_event_id};
+
+    int16_t max_cpu = 0;
+    for (ssize_t i = 0; i < all->size; ++i) {
+        max_cpu = std::max(max_cpu, all->data[i]->entry->cpu);
+    }
+    const int64_t first_ts = all->data[0]->entry->ts;
+    const int64_t span = all->data[all->size - 1]->entry->ts - first_ts;
+
+    // Every CPU has some events from the first step on, CPUs which have
+    // none don't hold pairing back
+    constexpr int N_STEPS = 8;
+    const auto flushed_until = [&](int step, int16_t cpu) {
+        const int64_t done = step + 3 - cpu % 3;
+        return (step + 1 == N_STEPS) ? INT64_MAX
+                                     : first_ts + span * done / (N_STEPS + 2);
+    };
+
+    std::unique_ptr<NapTable> extended;
+    kshark_data_container* grown = nullptr;
+    uint64_t n_late = 0;
+    for (int step = 0; step < N_STEPS; ++step) {
+        // Events keep the merged order, as merging the appended runs would
+        const int64_t last_grown_ts = (grown && grown->size)
+            ? grown->data[grown->size - 1]->entry->ts : INT64_MIN;
+        kshark_data_container* next = kshark_init_data_container();
+        std::vector<int64_t> last_of_cpu(max_cpu + 1, INT64_MIN);
+        for (ssize_t i = 0; i < all->size; ++i) {
+            const kshark_entry* entry = all->data[i]->entry;
+            if (entry->ts > flushed_until(step, entry->cpu)) continue;
+
+            kshark_data_container_append(next, all->data[i]->entry,
+                all->data[i]->field);
+            last_of_cpu[entry->cpu] = entry->ts;
+            const bool is_new = step
+                && entry->ts > flushed_until(step - 1, entry->cpu);
+            if (is_new && entry->ts < last_grown_ts) ++n_late;
+        }
+        next->sorted = true;
+
+        // Same as `naps_pairing_limit`, except that the last step is final
+        int64_t until = INT64_MAX;
+        for (int64_t last_ts : last_of_cpu) {
+            if (last_ts != INT64_MIN) until = std::min(until, last_ts);
+        }
+        if (step + 1 == N_STEPS) until = INT64_MAX;
+
+        if (!extended) {
+            extended = std::make_unique<NapTable>(next, ctx->sswitch_event_id,
+                ctx->waking_event_id, nullptr, until);
+        } else {
+            _expect(extended->extend(next, until),
+                "lagging extension in step " + std::to_string(step));
+        }
+        _expect(extended->n_events() <= next->size && (extended->n_events()
+                == next->size || next->data[extended->n_events()]->entry->ts
+                    >= until),
+            "events from the limit on are pending in step "
+                + std::to_string(step));
+
+        if (grown) kshark_free_data_container(grown);
+        grown = next;
+    }
+
+    _expect(n_late > 0, "some appended events are older than paired ones");
+    _expect(extended->n_events() == all->size, "all events are paired");
+    _compare_tables(*extended, whole);
+
+    kshark_free_data_container(grown);
+}
+
+/**
+ * @brief Compares two nap profiles the obvious way - sums up entries of both
+ * in a map keyed by comm and prev_state, then sorts them as `naps_diff` does.
+ *
+ * @param base: Profile of the baseline stream
+ * @param other: Profile of the compared stream
+ *
+ * @returns Compared entries, in the order `naps_diff` returns them.
+*/
+static std::vector<NapDiffEntry> _diff_reference(
+    const std::vector<NapProfileEntry>& base,
+    const std::vector<NapProfileEntry>& other)
+{
+    std::map<std::pair<std::string, char>, NapDiffEntry> joined;
+    const std::vector<NapProfileEntry>* sides[] = {&base, &other};
+    for (int side = 0; side < 2; ++side) {
+        for (const NapProfileEntry& e : *sides[side]) {
+            NapDiffEntry& entry = joined[{e.comm, e.state}];
+            entry.comm = e.comm;
+            entry.state = e.state;
+            entry.count[side] = e.count;
+            entry.total_ns[side] = e.total_ns;
+        }
+    }
+
+    std::vector<NapDiffEntry> diff;
+    for (const auto& [key, entry] : joined) diff.push_back(entry);
+    std::stable_sort(diff.begin(), diff.end(),
+        [](const NapDiffEntry& a, const NapDiffEntry& b) {
+            if (a.delta_ns() != b.delta_ns()) return a.delta_ns() > b.delta_ns();
+            return a.delta_count() > b.delta_count();
+        });
+    return diff;
+}
+
+/**
+ * @brief Compares a diff of two profiles with the reference, entry by entry.
+ *
+ * @param base: Profile of the baseline stream
+ * @param other: Profile of the compared stream
+ * @param what: Description of the compared profiles
+*/
+static void _compare_diff(const std::vector<NapProfileEntry>& base,
+    const std::vector<NapProfileEntry>& other, const std::string& what)
+{
+    const std::vector<NapDiffEntry> got = naps_diff(base, other);
+    const std::vector<NapDiffEntry> want = _diff_reference(base, other);
+    if (!_expect(got.size() == want.size(), "number of entries of " + what)) {
+        return;
+    }
+
+    for (size_t i = 0; i < got.size(); ++i) {
+        _expect(got[i].comm == want[i].comm && got[i].state == want[i].state
+            && got[i].count[0] == want[i].count[0]
+            && got[i].count[1] == want[i].count[1]
+            && got[i].total_ns[0] == want[i].total_ns[0]
+            && got[i].total_ns[1] == want[i].total_ns[1],
+            "entry " + std::to_string(i) + " of " + what);
+    }
+}
+
+/**
+ * @brief Checks comparison of nap profiles against a map-based reference,
+ * on a few fixed cases and on the stream's profile compared with itself and
+ * with altered copies of itself.
+ *
+ * @param ctx: Context of the loaded stream
+ * @param sd: Stream identifier number
+*/
+static void _check_diff(plugin_naps_context* ctx, int sd) {
+    using profile_t = std::vector<NapProfileEntry>;
+    const profile_t ab = {{"a", 'D', 2, 30}, {"a", 'S', 1, 10},
+        {"b", 'S', 4, 40}};
+    const profile_t cd = {{"c", 'S', 3, 20}, {"d", 'I', 1, 5}};
+    const profile_t bc = {{"a", 'S', 1, 15}, {"b", 'R', 2, 10},
+        {"b", 'S', 2, 40}, {"c", 'S', 5, 20}};
+
+    // Name, baseline and compared profile of each case
+    const std::tuple<const char*, profile_t, profile_t> cases[] = {
+        {"empty profiles", {}, {}},
+        {"empty baseline", {}, ab},
+        {"empty compared profile", ab, {}},
+        {"identical profiles", ab, ab},
+        {"disjoint profiles", ab, cd},
+        {"disjoint profiles swapped", cd, ab},
+        {"overlapping profiles", ab, bc},
+        {"overlapping profiles swapped", bc, ab},
+    };
+    for (const auto& [what, base, other] : cases) {
+        _compare_diff(base, other, what);
+    }
+
+    const profile_t profile = naps_comm_profile(ctx, sd);
+    if (!_expect(!profile.empty(), "the stream has a profile")) return;
+
+    // Every third entry dropped, every other one changed
+    profile_t altered;
+    for (size_t i = 0; i < profile.size(); ++i) {
+        if (i % 3 == 2) continue;
+        NapProfileEntry e = profile[i];
+        if (i % 2) {
+            e.count += i;
+            e.total_ns -= int64_t(i) * 1000;
+        }
+        altered.push_back(e);
+    }
+
+    _compare_diff(profile, profile, "the profile with itself");
+    _compare_diff(profile, altered, "the profile with an altered copy");
+    _compare_diff(altered, profile, "an altered copy with the profile");
+    _compare_diff(profile, {}, "the profile with an empty one");
+}
+
+/**
+ * @brief Finds the last nap of a task ending strictly before a time by a
+ * linear scan.
+ *
+ * @param task: Naps of the task
+ * @param ts: The time
+ *
+ * @returns Index of the nap or `size()` if no nap ended before the time.
+*/
+static size_t _last_ending_before(const NapTaskTable& task, int64_t ts) {
+    size_t found = task.size();
+    for (size_t i = 0; i < task.size(); ++i) {
+        if (task.end[i] < ts) found = i;
+    }
+    return found;
+}
+
+/**
+ * @brief Checks the critical path of a nap - its wake chain against a walk
+ * with linear scans, the reason the chain ended and the partition of the
+ * nap into segments.
+ *
+ * @param table: Nap table of the loaded stream
+ * @param pid: PID of the task of the analyzed nap
+ * @param nap: Index of the analyzed nap
+ * @param max_depth: Maximum number of links
+ * @param ends: Counts of reasons chains ended, incremented
+*/
+static void _check_path_of(const NapTable& table, int32_t pid, size_t nap,
+    size_t max_depth, std::map<NapChainEnd, uint64_t>& ends)
+{
+    const NapCriticalPath path = naps_critical_path(table, pid, nap,
+        max_depth);
+    const NapTaskTable& task = *table.task(pid);
+    const std::string of = "nap " + std::to_string(nap) + " of task "
+        + std::to_string(pid) + " with depth " + std::to_string(max_depth);
+    if (!_expect(!path.links.empty() && path.links[0].pid == pid
+            && path.links[0].nap == nap, "first link of " + of)) return;
+
+    // Walk the chain again, with a linear scan per link
+    const int64_t window_start = task.start[nap];
+    NapChainEnd end = NapChainEnd::DEPTH_LIMIT;
+    size_t n_links = 1;
+    int32_t waker = task.waker[nap];
+    int64_t wakeup = task.end[nap];
+    while (true) {
+        if (waker <= 0) {
+            end = NapChainEnd::NO_WAKER;
+            break;
+        }
+        const NapTaskTable* naps = table.task(waker);
+        const size_t prev = naps ? _last_ending_before(*naps, wakeup) : 0;
+        if (!naps || prev == naps->size()) {
+            end = NapChainEnd::WAKER_NOT_NAPPING;
+            break;
+        }
+        if (naps->end[prev] <= window_start) {
+            end = NapChainEnd::WAKER_RUNNING;
+            break;
+        }
+        if (n_links == max_depth) break;
+
+        const std::string link = "link " + std::to_string(n_links) + " of "
+            + of;
+        if (!_expect(n_links < path.links.size(), link + " exists")) return;
+        _expect(path.links[n_links].pid == waker
+            && path.links[n_links].nap == prev
+            && path.links[n_links].end == naps->end[prev], link);
+        ++n_links;
+        waker = naps->waker[prev];
+        wakeup = naps->end[prev];
+    }
+    _expect(path.links.size() == n_links, "number of links of " + of);
+    _expect(path.end == end, "end of the chain of " + of);
+    ++ends[path.end];
+
+    // Segments go back in time from the nap's end to its start
+    int64_t covered = task.end[nap];
+    for (const NapPathSegment& segment : path.segments) {
+        if (!_expect(segment.end == covered && segment.start <= segment.end,
+            "segments of " + of + " are adjacent")) return;
+        covered = segment.start;
+    }
+    _expect(covered == window_start, "segments of " + of + " cover it");
+}
+
+/**
+ * @brief Checks critical paths of random naps, with the default maximum
+ * depth and with a depth of two, so that chains hit the limit too. How
+ * the chains ended is printed.
+ *
+ * @param table: Nap table of the loaded stream
+*/
+static void _check_critical_path(const NapTable& table) {
+    std::vector<std::pair<int32_t, size_t>> naps;
+    for (const auto& [pid, task] : table.tasks()) {
+        for (size_t i = 0; i < task.size(); ++i) naps.push_back({pid, i});
+    }
+    if (!_expect(!naps.empty(), "the stream has naps")) return;
+
+    std::mt19937 random{1};
+    std::map<NapChainEnd, uint64_t> ends;
+    for (int i = 0; i < 2000; ++i) {
+        const auto [pid, nap] = naps[random() % naps.size()];
+        _check_path_of(table, pid, nap, NAPS_CHAIN_MAX_DEPTH, ends);
+        _check_path_of(table, pid, nap, 2, ends);
+    }
+
+    // Wakers in a trace with a task per CPU are all idle, chains are short
+    std::printf("chains ended: no waker %" PRIu64 ", waker not napping %"
+        PRIu64 ", waker running %" PRIu64 ", depth limit %" PRIu64 "\n",
+        ends[NapChainEnd::NO_WAKER], ends[NapChainEnd::WAKER_NOT_NAPPING],
+        ends[NapChainEnd::WAKER_RUNNING], ends[NapChainEnd::DEPTH_LIMIT]);
+}
+
+/**
+ * @brief Checks joins of one nap in the `D` state with block I/O against
+ * a scan of every request of every device. The joined requests are those
+ * completed from the nap's start to the end of the wakeup window, the
+ * wakeup is the closest of them to the nap's end, the earlier one of two
+ * equally close, if it is within the window. Timestamps of wakeups are
+ * compared, not indices, as requests completed at once are in no order.
+ *
+ * @param io: Block I/O of the loaded stream
+ * @param task: Table of the napping task
+ * @param pid: PID of the napping task
+ * @param nap: Index of the nap in the task's table
+ * @param n_after: Incremented for each joined request completed after the
+ * nap's end
+ * @param n_wakeups: Incremented if the nap has a wakeup of any device
+*/
+static void _check_joins_of(const NapBlockIo& io, const NapTaskTable& task,
+    int32_t pid, uint32_t nap, uint64_t& n_after, uint64_t& n_wakeups)
+{
+    const std::string of = "nap " + std::to_string(nap) + " of "
+        + std::to_string(pid);
+    const int64_t start = task.start[nap];
+    const int64_t end = task.end[nap];
+    const auto& requests = io.requests();
+    const auto [first_join, last_join] = io.of_nap(pid, nap);
+
+    size_t join = first_join;
+    bool has_wakeup = false;
+    for (const auto& [dev, range] : io.devices()) {
+        size_t first = range.second, last = range.first;
+        int64_t best = NapBlockIo::WAKEUP_WINDOW + 1;
+        int64_t wakeup_ts = INT64_MIN;
+        uint64_t sectors = 0;
+        for (size_t i = range.first; i < range.second; ++i) {
+            const int64_t ts = requests[i].complete_ts;
+            if (ts < start || ts > end + NapBlockIo::WAKEUP_WINDOW) continue;
+
+            first = std::min(first, i);
+            last = i + 1;
+            sectors += requests[i].nr_sector;
+            if (ts > end) ++n_after;
+            if (std::abs(ts - end) < best) {
+                best = std::abs(ts - end);
+                wakeup_ts = ts;
+            }
+        }
+        if (first >= last) continue;
+
+        const std::string with = of + " with device " + std::to_string(dev);
+        if (!_expect(join < last_join && io.joins()[join].dev == dev,
+            with + " is joined")) return;
+        const NapIoJoin& found = io.joins()[join++];
+        _expect(found.first == first && found.last == last,
+            "requests of " + with + " match");
+        _expect(io.sectors(found) == sectors, "sectors of " + with + " match");
+        if (wakeup_ts == INT64_MIN) {
+            _expect(found.wakeup == NapIoJoin::NO_REQUEST,
+                with + " has no wakeup");
+        } else if (_expect(found.wakeup != NapIoJoin::NO_REQUEST,
+            with + " has a wakeup")) {
+            _expect(requests[found.wakeup].complete_ts == wakeup_ts
+                && found.wakeup >= first && found.wakeup < last,
+                "wakeup of " + with + " matches");
+            has_wakeup = true;
+        }
+    }
+    _expect(join == last_join, of + " has no other joins");
+    if (has_wakeup) ++n_wakeups;
+}
+
+/**
+ * @brief Checks joins of all naps in the `D` state with block I/O, and
+ * that no other naps are joined. How many requests completed after the
+ * nap's end and how many naps have a wakeup is printed.
+ *
+ * @param ctx: Context of the loaded stream
+*/
+static void _check_block_io(plugin_naps_context* ctx) {
+    const NapBlockIo* io = NapBlockIo::from_context(ctx);
+    if (!_expect(io && !io->requests().empty(), "the stream has requests"))
+        return;
+
+    uint64_t n_naps = 0, n_after = 0, n_wakeups = 0;
+    for (const auto& [pid, task] : NapTable::from_context(ctx)->tasks()) {
+        for (uint32_t i = 0; i < task.size(); ++i) {
+            if (task.state[i] == 'D') {
+                _check_joins_of(*io, task, pid, i, n_after, n_wakeups);
+                ++n_naps;
+            } else {
+                const auto [first, last] = io->of_nap(pid, i);
+                _expect(first == last, "nap " + std::to_string(i) + " of "
+                    + std::to_string(pid) + " isn't joined");
+            }
+        }
+    }
+
+    std::printf("D naps %" PRIu64 ", with a wakeup %" PRIu64
+        ", requests joined after wakeups %" PRIu64 "\n",
+        n_naps, n_wakeups, n_after);
+}
+
+/**
+ * @brief Entry point, loads the trace file and runs one check on it.
+*/
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        _usage(argv[0]);
+        return 2;
+    }
+
+    const std::string check = argv[1];
+    NapSession session;
+    if (!session.open(argv[2])) {
+        std::fprintf(stderr, "Couldn't load %s\n", argv[2]);
+        return 2;
+    }
+
+    plugin_naps_context* ctx = session.context();
+    if (check == "merge") {
+        // Positions are dropped once the table is built, check them first
+        _check_merge(ctx);
+    } else if (check == "top-index") {
+        _check_top_index(*session.table());
+    } else if (check == "histogram") {
+        _check_histogram(*session.table());
+    } else if (check == "extend") {
+        _check_extend(ctx);
+    } else if (check == "extend-lagging") {
+        _check_extend_lagging(ctx);
+    } else if (check == "critical-path") {
+        _check_critical_path(*session.table());
+    } else if (check == "diff") {
+        _check_diff(ctx, session.stream()->stream_id);
+    } else if (check == "block-io") {
+        _check_block_io(ctx);
+    } else {
+        _usage(argv[0]);
+        return 2;
+    }
+
+    std::printf("%s: %" PRIu64 " failures, %zd events, %zu naps\n",
+        check.c_str(), n_failures, ctx->collected_events->size,
+        session.table()->size());
+    return n_failures ? 1 : 0;
+}
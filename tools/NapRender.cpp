@@ -0,0 +1,321 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapRender.cpp
+ * @brief   Definitions of the software rendering of nap timelines.
+*/
+
+// C++
+#include <algorithm>
+#include <array>
+#include <utility>
+
+// Plugin headers
+#include "NapRender.hpp"
+
+// Static variables
+
+///
+/// @brief Colors of rows of tasks, alternating.
+static constexpr uint32_t ROW_COLORS[] = {0xffffff, 0xf0f0f0};
+
+///
+/// @brief Color of the base line of a row.
+static constexpr uint32_t BASE_COLOR = 0xa0a0a0;
+
+///
+/// @brief Height of the strip summarizing naps over the budget, in pixels.
+static constexpr int SUMMARY_HEIGHT = 3;
+
+///
+/// @brief Largest amount of data in a stored deflate block.
+static constexpr size_t STORED_BLOCK_SIZE = 65535;
+
+// Static functions
+
+/**
+ * @brief Computes the CRC-32 of PNG chunks, continuing from a previous one.
+ *
+ * @param crc: CRC of the preceding data, zero at the start
+ * @param data: Data to add
+ * @param size: Number of bytes of the data
+ *
+ * @returns CRC of all data so far.
+*/
+static uint32_t _crc32(uint32_t crc, const uint8_t* data, size_t size) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> entries{};
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[n] = c;
+        }
+        return entries;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/**
+ * @brief Appends a 32-bit number in big-endian byte order.
+ *
+ * @param bytes: Where to append
+ * @param value: The number
+*/
+static void _put_u32(std::vector<uint8_t>& bytes, uint32_t value) {
+    bytes.push_back(uint8_t(value >> 24));
+    bytes.push_back(uint8_t(value >> 16));
+    bytes.push_back(uint8_t(value >> 8));
+    bytes.push_back(uint8_t(value));
+}
+
+/**
+ * @brief Writes a PNG chunk with its length and CRC.
+ *
+ * @param out: Output file
+ * @param type: Four letters of the chunk's type
+ * @param data: Contents of the chunk
+*/
+static void _write_chunk(std::FILE* out, const char* type,
+    const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> head;
+    _put_u32(head, uint32_t(data.size()));
+    head.insert(head.end(), type, type + 4);
+
+    uint32_t crc = _crc32(0, head.data() + 4, 4);
+    crc = _crc32(crc, data.data(), data.size());
+    std::vector<uint8_t> tail;
+    _put_u32(tail, crc);
+
+    std::fwrite(head.data(), 1, head.size(), out);
+    if (!data.empty()) std::fwrite(data.data(), 1, data.size(), out);
+    std::fwrite(tail.data(), 1, tail.size(), out);
+}
+
+/**
+ * @brief Gets a darker shade of a color, used for outlines of naps.
+ *
+ * @param color: Color as 0xRRGGBB
+ *
+ * @returns The color with all channels halved.
+*/
+static uint32_t _darker(uint32_t color) {
+    return (color >> 1) & 0x7f7f7f;
+}
+
+// Member functions
+
+/**
+ * @brief Constructor of an image filled with one color.
+ *
+ * @param width: Width of the image, in pixels
+ * @param height: Height of the image, in pixels
+ * @param background: Color of all pixels, as 0xRRGGBB
+*/
+NapImage::NapImage(int width, int height, uint32_t background)
+    : width(std::max(width, 0)), height(std::max(height, 0)),
+    rgb(size_t(this->width) * size_t(this->height) * 3)
+{
+    fill_rect(0, 0, this->width - 1, this->height - 1, background);
+}
+
+/**
+ * @brief Fills a rectangle, clipped to the image.
+ *
+ * @param x_start: Left edge, inclusive
+ * @param y_top: Top edge, inclusive
+ * @param x_end: Right edge, inclusive
+ * @param y_bottom: Bottom edge, inclusive
+ * @param color: Color as 0xRRGGBB
+*/
+void NapImage::fill_rect(int x_start, int y_top, int x_end, int y_bottom,
+    uint32_t color)
+{
+    x_start = std::max(x_start, 0);
+    y_top = std::max(y_top, 0);
+    x_end = std::min(x_end, width - 1);
+    y_bottom = std::min(y_bottom, height - 1);
+    if (x_start > x_end || y_top > y_bottom) return;
+
+    const uint8_t r = uint8_t(color >> 16), g = uint8_t(color >> 8),
+        b = uint8_t(color);
+    for (int y = y_top; y <= y_bottom; ++y) {
+        uint8_t* pixel = &rgb[(size_t(y) * size_t(width) + size_t(x_start)) * 3];
+        for (int x = x_start; x <= x_end; ++x) {
+            *pixel++ = r;
+            *pixel++ = g;
+            *pixel++ = b;
+        }
+    }
+}
+
+/**
+ * @brief Writes the image as a PNG file. Pixel data aren't compressed -
+ * they're put into stored deflate blocks - which needs no compression
+ * library and is fast, while images of timelines stay small enough.
+ *
+ * @param out: Output file
+ *
+ * @returns True if everything was written, false otherwise.
+*/
+bool NapImage::write_png(std::FILE* out) const {
+    static constexpr uint8_t SIGNATURE[] = {0x89, 'P', 'N', 'G', '\r', '\n',
+                                            0x1a, '\n'};
+    std::fwrite(SIGNATURE, 1, sizeof(SIGNATURE), out);
+
+    // 8 bits per channel, truecolor, no interlacing
+    std::vector<uint8_t> header;
+    _put_u32(header, uint32_t(width));
+    _put_u32(header, uint32_t(height));
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+    _write_chunk(out, "IHDR", header);
+
+    // Scanlines, each after a byte of no filtering
+    const size_t row_bytes = size_t(width) * 3;
+    std::vector<uint8_t> raw;
+    raw.reserve((row_bytes + 1) * size_t(height));
+    for (int y = 0; y < height; ++y) {
+        raw.push_back(0);
+        raw.insert(raw.end(), rgb.begin() + ptrdiff_t(size_t(y) * row_bytes),
+                   rgb.begin() + ptrdiff_t(size_t(y + 1) * row_bytes));
+    }
+
+    // Zlib stream of stored blocks
+    std::vector<uint8_t> data{0x78, 0x01};
+    data.reserve(raw.size() + raw.size() / STORED_BLOCK_SIZE * 5 + 16);
+    uint32_t adler_a = 1, adler_b = 0;
+    size_t done = 0;
+    do {
+        const size_t size = std::min(raw.size() - done, STORED_BLOCK_SIZE);
+        const bool final = (done + size == raw.size());
+        data.push_back(final ? 1 : 0);
+        data.push_back(uint8_t(size));
+        data.push_back(uint8_t(size >> 8));
+        data.push_back(uint8_t(~size));
+        data.push_back(uint8_t(~size >> 8));
+        data.insert(data.end(), raw.begin() + ptrdiff_t(done),
+                    raw.begin() + ptrdiff_t(done + size));
+
+        for (size_t i = done; i < done + size; ++i) {
+            adler_a = (adler_a + raw[i]) % 65521;
+            adler_b = (adler_b + adler_a) % 65521;
+        }
+        done += size;
+    } while (done < raw.size());
+    _put_u32(data, (adler_b << 16) | adler_a);
+    _write_chunk(out, "IDAT", data);
+
+    _write_chunk(out, "IEND", {});
+    return !std::ferror(out);
+}
+
+// Global functions
+
+/**
+ * @brief Finds tasks which napped the longest in total.
+ *
+ * @param table: Nap table of the stream
+ * @param count: Maximum number of tasks
+ *
+ * @returns PIDs of the tasks, the longest napping first, ties by PID.
+*/
+std::vector<int32_t> naps_top_tasks(const NapTable& table, size_t count) {
+    std::vector<std::pair<int64_t, int32_t>> totals;
+    totals.reserve(table.tasks().size());
+    for (const auto& [pid, task] : table.tasks()) {
+        int64_t total = 0;
+        for (const auto& [state, stats] : task.stats) total += stats.total_ns;
+        totals.emplace_back(-total, pid);
+    }
+
+    count = std::min(count, totals.size());
+    std::partial_sort(totals.begin(), totals.begin() + ptrdiff_t(count),
+                      totals.end());
+
+    std::vector<int32_t> pids;
+    pids.reserve(count);
+    for (size_t i = 0; i < count; ++i) pids.push_back(totals[i].second);
+    return pids;
+}
+
+/**
+ * @brief Renders naps of tasks as a timeline, a row per task, spanning all
+ * of the tasks' naps. Rows are drawn by the same geometry code as task
+ * plots, with a bin per pixel - when a row has more naps than the budget,
+ * only the longest are drawn and the rest summarized by a strip at the
+ * row's bottom. Naps have outlines of a darker shade, there are no labels.
+ *
+ * @param table: Nap table of the stream
+ * @param pids: PIDs of the tasks, in the order of rows
+ * @param options: Layout of the timeline
+ *
+ * @returns Rendered image.
+*/
+NapImage naps_render_timeline(const NapTable& table,
+    const std::vector<int32_t>& pids, const NapRenderOptions& options)
+{
+    const int width = std::max(options.width, 1);
+    const int row_height = std::max(options.row_height, SUMMARY_HEIGHT + 4);
+    NapImage image{width, row_height * int(pids.size()), ROW_COLORS[0]};
+
+    int64_t min_ts = INT64_MAX, max_ts = INT64_MIN;
+    for (int32_t pid : pids) {
+        const NapTaskTable* task = table.task(pid);
+        if (!task || !task->size()) continue;
+        min_ts = std::min(min_ts, task->start.front());
+        max_ts = std::max(max_ts, task->end.back());
+    }
+    if (min_ts > max_ts) return image;
+
+    const int64_t span = max_ts - min_ts + 1;
+    const NapView view{min_ts, max_ts, (span + width - 1) / width, width};
+
+    NapGeometry geometry;
+    for (size_t row = 0; row < pids.size(); ++row) {
+        const int y_top = int(row) * row_height;
+        const int y_bottom = y_top + row_height - 1;
+        image.fill_rect(0, y_top, width - 1, y_bottom, ROW_COLORS[row % 2]);
+        image.fill_rect(0, y_bottom, width - 1, y_bottom, BASE_COLOR);
+
+        const NapTaskTable* task = table.task(pids[row]);
+        if (!task) continue;
+
+        auto [first, last] = task->in_range(view.min, view.max);
+        const bool is_over_budget = (options.budget
+                                     && last - first > options.budget);
+        if (is_over_budget) {
+            naps_top_geometry(*task, view, 0, 1, options.budget, geometry);
+        } else {
+            naps_geometry(*task, view, 0, 1, geometry);
+        }
+
+        const int nap_top = y_top + 2;
+        const int nap_bottom = y_bottom - SUMMARY_HEIGHT - 2;
+        for (size_t i = 0; i < geometry.size(); ++i) {
+            const uint32_t color = naps_state_color(task->state[geometry.idx[i]]);
+            const int x_start = geometry.x_start[i], x_end = geometry.x_end[i];
+
+            image.fill_rect(x_start, nap_top, x_end, nap_bottom, _darker(color));
+            if (x_end - x_start >= 2) {
+                image.fill_rect(x_start + 1, nap_top + 1, x_end - 1,
+                                nap_bottom - 1, color);
+            }
+        }
+
+        if (!is_over_budget) continue;
+        for (const NapSummaryRun& run : naps_rest_summary(*task, view,
+                                                          geometry.idx, width)) {
+            image.fill_rect(run.start_bin, y_bottom - SUMMARY_HEIGHT,
+                            run.end_bin, y_bottom - 1,
+                            naps_state_color(run.state));
+        }
+    }
+    return image;
+}
@@ -0,0 +1,66 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    NapRender.hpp
+ * @brief   Declarations of the software rendering of nap timelines into
+ *          PNG images, for headless use without a display or GL. Part of
+ *          the `naps-render` tool, on top of the plugin's core.
+ *
+ * @note    Definitions in `NapRender.cpp`.
+*/
+
+#ifndef _NR_NAP_RENDER_HPP
+#define _NR_NAP_RENDER_HPP
+
+// C
+#include <cstdint>
+#include <cstdio>
+
+// C++
+#include <vector>
+
+// Plugin
+#include "NapTable.hpp"
+#include "NapView.hpp"
+
+/**
+ * @brief RGB image in memory, filled with axis-aligned rectangles only.
+*/
+struct NapImage {
+    ///
+    /// @brief Width of the image, in pixels.
+    int width{0};
+    ///
+    /// @brief Height of the image, in pixels.
+    int height{0};
+    ///
+    /// @brief Pixels row by row, three bytes each.
+    std::vector<uint8_t> rgb;
+public:
+    NapImage(int width, int height, uint32_t background);
+    void fill_rect(int x_start, int y_top, int x_end, int y_bottom,
+        uint32_t color);
+    bool write_png(std::FILE* out) const;
+};
+
+/**
+ * @brief Layout of a rendered timeline.
+*/
+struct NapRenderOptions {
+    ///
+    /// @brief Width of the timeline, in pixels, one bin each.
+    int width{1600};
+    ///
+    /// @brief Height of a task's row, in pixels.
+    int row_height{24};
+    ///
+    /// @brief Maximum number of naps drawn per row, the longest are drawn
+    /// and the rest summarized, as in task plots. Zero draws all.
+    size_t budget{500};
+};
+
+std::vector<int32_t> naps_top_tasks(const NapTable& table, size_t count);
+NapImage naps_render_timeline(const NapTable& table,
+    const std::vector<int32_t>& pids, const NapRenderOptions& options);
+
+#endif // _NR_NAP_RENDER_HPP
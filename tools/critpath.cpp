@@ -0,0 +1,113 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    critpath.cpp
+ * @brief   Headless wake-chain analysis of a nap of a trace file. Prints
+ *          the chain of naps which led to the nap's wakeup and the nap's
+ *          critical path.
+*/
+
+// C
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+
+// C++
+#include <algorithm>
+#include <string>
+
+// Plugin
+#include "NapCriticalPath.hpp"
+#include "NapSession.hpp"
+
+// Static variables
+
+///
+/// @brief Descriptions of reasons why a chain ended.
+static const char* const CHAIN_END_NAMES[] = {
+    "waker unknown or an interrupt",
+    "waker didn't nap before the wakeup",
+    "waker was running during the whole nap",
+    "maximum depth reached"
+};
+
+// Static functions
+
+/**
+ * @brief Prints usage of the analysis.
+*/
+static void _usage(const char* prog) {
+    std::fprintf(stderr,
+        "Usage: %s TRACE PID TIME [options]\n"
+        "  TIME is a timestamp in nanoseconds in the nap, or after it\n"
+        "  -d, --depth N        follow at most N naps (default %zu)\n"
+        "  -x, --exclude STATES drop switches with these prev_states on load\n",
+        prog, NAPS_CHAIN_MAX_DEPTH);
+}
+
+/**
+ * @brief Entry point, loads the trace file and prints the nap's analysis.
+*/
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        _usage(argv[0]);
+        return 1;
+    }
+
+    const int32_t pid = std::atoi(argv[2]);
+    const int64_t ts = std::strtoll(argv[3], nullptr, 10);
+    size_t depth = NAPS_CHAIN_MAX_DEPTH;
+    for (int i = 4; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-d" || arg == "--depth") && i + 1 < argc) {
+            depth = size_t(std::max(1, std::atoi(argv[++i])));
+        } else if ((arg == "-x" || arg == "--exclude") && i + 1 < argc) {
+            naps_set_excluded_states(argv[++i]);
+        } else {
+            _usage(argv[0]);
+            return 1;
+        }
+    }
+
+    NapSession session;
+    if (!session.open(argv[1])) {
+        std::fprintf(stderr, "Couldn't load %s\n", argv[1]);
+        return 1;
+    }
+
+    const NapTable* table = session.table();
+    const NapTaskTable* task = table ? table->task(pid) : nullptr;
+    if (!task || !task->size()) {
+        std::fprintf(stderr, "Task %d has no naps\n", pid);
+        return 1;
+    }
+
+    // Nap in progress at the time, or the last one before it
+    size_t nap = task->at(ts);
+    if (nap == task->size()) nap = task->last_ending_before(ts);
+    if (nap == task->size()) {
+        std::fprintf(stderr, "Task %d has no nap at or before %" PRId64 "\n",
+            pid, ts);
+        return 1;
+    }
+
+    const NapCriticalPath path = naps_critical_path(*table, pid, nap, depth);
+
+    std::printf("Wake chain:\n");
+    for (const NapChainLink& link : path.links) {
+        std::printf("  pid %-8d %c nap %" PRId64 " - %" PRId64
+            " (%.3f ms), woken by %d\n", link.pid, link.state, link.start,
+            link.end, (link.end - link.start) / 1e6, link.waker);
+    }
+    std::printf("Chain ended: %s\n", CHAIN_END_NAMES[int(path.end)]);
+
+    std::printf("Critical path:\n");
+    for (const NapPathSegment& segment : path.segments) {
+        std::printf("  pid %-8d %-8s %c %" PRId64 " - %" PRId64 " (%.3f ms)\n",
+            segment.pid, segment.state ? "napping" : "running",
+            segment.state ? segment.state : '-', segment.start, segment.end,
+            (segment.end - segment.start) / 1e6);
+    }
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    diff.cpp
+ * @brief   Headless comparison of nap profiles of two trace files, e.g.
+ *          taken before and after a deploy. Prints nap time and count per
+ *          comm and prev_state, largest regression first.
+*/
+
+// C
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+
+// C++
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Plugin
+#include "NapBuildScheduler.hpp"
+#include "NapDiff.hpp"
+#include "NapSession.hpp"
+
+// Static functions
+
+/**
+ * @brief Prints usage of the comparison.
+*/
+static void _usage(const char* prog) {
+    std::fprintf(stderr,
+        "Usage: %s BASELINE COMPARED [options]\n"
+        "  -n, --top N          print only the first N rows (default all)\n"
+        "  -x, --exclude STATES drop switches with these prev_states on load\n",
+        prog);
+}
+
+/**
+ * @brief Loads a trace file and schedules the build of its nap table.
+ *
+ * @param session: Session to load the file into
+ * @param file: Path to the trace file
+ *
+ * @returns True on success, false if the file couldn't be loaded.
+*/
+static bool _load(NapSession& session, const char* file) {
+    if (!session.open(file)) {
+        std::fprintf(stderr, "Couldn't load %s\n", file);
+        return false;
+    }
+
+    NapBuildScheduler::get_instance().schedule(session.context(),
+        session.stream()->stream_id);
+    return true;
+}
+
+/**
+ * @brief Gets the nap profile of a loaded trace file, waiting for its
+ * nap table if it's still being built.
+*/
+static std::vector<NapProfileEntry> _profile(const NapSession& session) {
+    return naps_comm_profile(session.context(), session.stream()->stream_id);
+}
+
+/**
+ * @brief Entry point, loads both trace files and prints the comparison.
+*/
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        _usage(argv[0]);
+        return 1;
+    }
+
+    size_t top = SIZE_MAX;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-n" || arg == "--top") && i + 1 < argc) {
+            top = size_t(std::max(0, std::atoi(argv[++i])));
+        } else if ((arg == "-x" || arg == "--exclude") && i + 1 < argc) {
+            naps_set_excluded_states(argv[++i]);
+        } else {
+            _usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Sessions are opened one at a time, both stay loaded. The first nap
+    // table is built while the second file loads and both are built at once.
+    NapSession base_session, other_session;
+    if (!_load(base_session, argv[1]) || !_load(other_session, argv[2])) {
+        return 1;
+    }
+
+    const std::vector<NapDiffEntry> diff = naps_diff(_profile(base_session),
+        _profile(other_session));
+
+    std::printf("%-24s %5s %10s %10s %11s %14s %14s %14s\n", "comm", "state",
+        "count A", "count B", "count diff", "time A [ms]", "time B [ms]",
+        "time diff [ms]");
+    for (size_t i = 0; i < std::min(top, diff.size()); ++i) {
+        const NapDiffEntry& entry = diff[i];
+        std::printf("%-24s %5c %10" PRIu64 " %10" PRIu64 " %+11" PRId64
+            " %14.3f %14.3f %+14.3f\n",
+            entry.comm.c_str(), entry.state, entry.count[0], entry.count[1],
+            entry.delta_count(), entry.total_ns[0] / 1e6,
+            entry.total_ns[1] / 1e6, entry.delta_ns() / 1e6);
+    }
+
+    return 0;
+}
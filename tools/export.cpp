@@ -0,0 +1,82 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    export.cpp
+ * @brief   Headless export of naps of a trace file into Chrome trace event
+ *          JSON, which can be opened in Perfetto UI or chrome://tracing.
+*/
+
+// C
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+
+// C++
+#include <string>
+
+// Plugin
+#include "NapExport.hpp"
+#include "NapSession.hpp"
+
+// Static functions
+
+/**
+ * @brief Prints usage of the export.
+*/
+static void _usage(const char* prog) {
+    std::fprintf(stderr,
+        "Usage: %s TRACE OUTPUT [options]\n"
+        "  OUTPUT is a JSON file to write, '-' for the standard output\n"
+        "  --no-flows           don't draw wakeups as flow arrows\n"
+        "  -x, --exclude STATES drop switches with these prev_states on load\n",
+        prog);
+}
+
+/**
+ * @brief Entry point, loads the trace file and exports its naps.
+*/
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        _usage(argv[0]);
+        return 1;
+    }
+
+    bool flows = true;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--no-flows") {
+            flows = false;
+        } else if ((arg == "-x" || arg == "--exclude") && i + 1 < argc) {
+            naps_set_excluded_states(argv[++i]);
+        } else {
+            _usage(argv[0]);
+            return 1;
+        }
+    }
+
+    NapSession session;
+    if (!session.open(argv[1]) || !session.table()) {
+        std::fprintf(stderr, "Couldn't load %s\n", argv[1]);
+        return 1;
+    }
+
+    const std::string output = argv[2];
+    std::FILE* out = (output == "-") ? stdout : std::fopen(argv[2], "w");
+    if (!out) {
+        std::fprintf(stderr, "Couldn't open %s for writing\n", argv[2]);
+        return 1;
+    }
+
+    NapChromeExport exporter{out, flows};
+    exporter.add_stream(*session.table(), session.stream()->stream_id, argv[1]);
+    const bool written = exporter.finish();
+    if (out != stdout) std::fclose(out);
+
+    if (!written) {
+        std::fprintf(stderr, "Couldn't write %s\n", argv[2]);
+        return 1;
+    }
+    std::fprintf(stderr, "Exported %" PRIu64 " naps and %" PRIu64
+        " wakeup arrows\n", exporter.n_naps(), exporter.n_flows());
+    return 0;
+}
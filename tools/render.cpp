@@ -0,0 +1,204 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    render.cpp
+ * @brief   Headless batch rendering of nap timelines of trace files into
+ *          PNG images, e.g. for incident reports generated on servers
+ *          without a display. Each trace file gets an image with a row per
+ *          task which napped the longest and a text file naming the rows.
+*/
+
+// C
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// C++
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+// KernelShark
+#include "libkshark.h"
+
+// Plugin
+#include "NapRender.hpp"
+#include "NapSession.hpp"
+
+// Static functions
+
+/**
+ * @brief Prints usage of the renderer.
+*/
+static void _usage(const char* prog) {
+    std::fprintf(stderr,
+        "Usage: %s OUTDIR TRACE... [options]\n"
+        "  -n, --tasks N        render N tasks which napped the longest (default 20)\n"
+        "  -w, --width PX       width of the timelines (default 1600)\n"
+        "  -b, --budget N       naps drawn per row, longest first (default 500, 0 = all)\n"
+        "  -j, --jobs N         render N trace files at once (default 1)\n"
+        "  -x, --exclude STATES drop switches with these prev_states on load\n",
+        prog);
+}
+
+/**
+ * @brief Gets the name of a trace file without directories and extension.
+*/
+static std::string _stem(const std::string& path) {
+    const size_t slash = path.find_last_of('/');
+    std::string name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+    const size_t dot = name.find_last_of('.');
+    return (dot == std::string::npos || dot == 0) ? name : name.substr(0, dot);
+}
+
+/**
+ * @brief Renders one trace file into `BASE.png`, with names of the rows'
+ * tasks and their total nap times in `BASE.txt`.
+ *
+ * @param trace: Path to the trace file
+ * @param base: Path of the outputs without extension
+ * @param n_tasks: Number of rendered tasks
+ * @param options: Layout of the timeline
+ *
+ * @returns Exit code, zero on success.
+*/
+static int _render(const std::string& trace, const std::string& base,
+    size_t n_tasks, const NapRenderOptions& options)
+{
+    NapSession session;
+    if (!session.open(trace.c_str()) || !session.table()) {
+        std::fprintf(stderr, "Couldn't load %s\n", trace.c_str());
+        return 1;
+    }
+
+    const NapTable& table = *session.table();
+    const std::vector<int32_t> pids = naps_top_tasks(table, n_tasks);
+    const NapImage image = naps_render_timeline(table, pids, options);
+
+    const std::string png = base + ".png";
+    std::FILE* out = std::fopen(png.c_str(), "wb");
+    const bool written = out && image.write_png(out);
+    if (out) std::fclose(out);
+    if (!written) {
+        std::fprintf(stderr, "Couldn't write %s\n", png.c_str());
+        return 1;
+    }
+
+    const std::string txt = base + ".txt";
+    std::FILE* rows = std::fopen(txt.c_str(), "w");
+    if (!rows) {
+        std::fprintf(stderr, "Couldn't write %s\n", txt.c_str());
+        return 1;
+    }
+    std::fprintf(rows, "# %s\n# row pid comm naps nap_ms\n", trace.c_str());
+    for (size_t row = 0; row < pids.size(); ++row) {
+        const NapTaskTable* task = table.task(pids[row]);
+        int64_t total = 0;
+        for (const auto& [state, stats] : task->stats) total += stats.total_ns;
+
+        char* comm = kshark_comm_from_pid(session.stream()->stream_id, pids[row]);
+        std::fprintf(rows, "%zu %" PRId32 " %s %zu %.3f\n", row, pids[row],
+            comm ? comm : "?", task->size(), double(total) / 1e6);
+        std::free(comm);
+    }
+    std::fclose(rows);
+
+    std::printf("%s: %zu tasks -> %s\n", trace.c_str(), pids.size(), png.c_str());
+    std::fflush(stdout);
+    return 0;
+}
+
+/**
+ * @brief Entry point, renders trace files in child processes. KernelShark's
+ * loading isn't thread-safe, so trace files are rendered in parallel by
+ * separate processes, each with its own KernelShark context.
+*/
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        _usage(argv[0]);
+        return 1;
+    }
+
+    const std::string out_dir = argv[1];
+    std::vector<std::string> traces;
+    size_t n_tasks = 20;
+    int n_jobs = 1;
+    NapRenderOptions options;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-n" || arg == "--tasks") && i + 1 < argc) {
+            n_tasks = std::strtoul(argv[++i], nullptr, 10);
+        } else if ((arg == "-w" || arg == "--width") && i + 1 < argc) {
+            options.width = std::atoi(argv[++i]);
+        } else if ((arg == "-b" || arg == "--budget") && i + 1 < argc) {
+            options.budget = std::strtoul(argv[++i], nullptr, 10);
+        } else if ((arg == "-j" || arg == "--jobs") && i + 1 < argc) {
+            n_jobs = std::max(std::atoi(argv[++i]), 1);
+        } else if ((arg == "-x" || arg == "--exclude") && i + 1 < argc) {
+            naps_set_excluded_states(argv[++i]);
+        } else if (!arg.empty() && arg[0] == '-') {
+            _usage(argv[0]);
+            return 1;
+        } else {
+            traces.push_back(arg);
+        }
+    }
+    if (traces.empty() || options.width <= 0) {
+        _usage(argv[0]);
+        return 1;
+    }
+
+    // Outputs named after trace files, numbered if the names repeat
+    std::vector<std::string> bases;
+    std::map<std::string, int> seen;
+    for (const std::string& trace : traces) {
+        const std::string stem = _stem(trace);
+        const int repeats = seen[stem]++;
+        bases.push_back(out_dir + "/" + stem
+            + (repeats ? "-" + std::to_string(repeats) : ""));
+    }
+
+    int failed = 0;
+    int running = 0;
+    auto reap = [&]() {
+        int status = 0;
+        pid_t child;
+        while ((child = wait(&status)) < 0 && errno == EINTR) {}
+        --running;
+        if (child < 0) {
+            ++failed;
+            return;
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status)) ++failed;
+    };
+
+    for (size_t i = 0; i < traces.size(); ++i) {
+        if (n_jobs == 1) {
+            failed += (_render(traces[i], bases[i], n_tasks, options) != 0);
+            continue;
+        }
+
+        if (running >= n_jobs) reap();
+        const pid_t child = fork();
+        if (child == 0) {
+            std::_Exit(_render(traces[i], bases[i], n_tasks, options));
+        } else if (child < 0) {
+            std::fprintf(stderr, "Couldn't start rendering %s\n",
+                traces[i].c_str());
+            ++failed;
+        } else {
+            ++running;
+        }
+    }
+    while (running > 0) reap();
+
+    if (failed) {
+        std::fprintf(stderr, "%d of %zu trace files failed\n", failed,
+            traces.size());
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,290 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    replay.cpp
+ * @brief   Headless replayer of draw requests recorded during a GUI session
+ *          (see `NapDrawRecorder`). Loads the recorded streams with the
+ *          plugin's core and runs the same sequence of requests against it,
+ *          which turns interactive sessions into repeatable workloads.
+*/
+
+// C
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// KernelShark
+#include "libkshark-plugin.h"
+
+// Plugin
+#include "NapAggregate.hpp"
+#include "NapBuildScheduler.hpp"
+#include "NapDrawPlan.hpp"
+#include "NapDrawRecord.hpp"
+#include "NapGeometryPass.hpp"
+#include "NapNodeAggregate.hpp"
+#include "NapSession.hpp"
+#include "NapTable.hpp"
+#include "NapTopology.hpp"
+#include "NapView.hpp"
+
+// Usings
+
+///
+/// @brief Clock used for all measurements.
+using replay_clock_t = std::chrono::steady_clock;
+
+// Static variables
+
+///
+/// @brief Names of draw paths, in the order of `NapDrawPath`.
+static const char* const PATH_NAMES[] = {
+    "nothing", "node bands", "comm bands", "top naps", "all naps"
+};
+
+// Static functions
+
+/**
+ * @brief Nanoseconds elapsed since a time point.
+*/
+static int64_t _ns_since(replay_clock_t::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        replay_clock_t::now() - start).count();
+}
+
+/**
+ * @brief Prints usage of the replayer.
+*/
+static void _usage(const char* prog) {
+    std::fprintf(stderr,
+        "Usage: %s RECORD [options]\n"
+        "  -r, --repeat N      replay the whole record N times (default 1)\n"
+        "  -t, --trace SD=FILE use FILE for recorded stream SD\n"
+        "  -x, --exclude STATES drop switches with these prev_states on load\n",
+        prog);
+}
+
+/**
+ * @brief Gets the NUMA topology of a recorded request, read once per path.
+ *
+ * @param path: Recorded path to a topology file, empty for this machine
+ * @param topologies: Topologies read so far, keyed by path
+ *
+ * @returns The topology, empty if it couldn't be read.
+*/
+static const NapTopology& _get_topology(const std::string& path,
+    std::map<std::string, NapTopology>& topologies)
+{
+    auto found = topologies.find(path);
+    if (found == topologies.end()) {
+        found = topologies.emplace(path, path.empty()
+            ? NapTopology::from_sysfs() : NapTopology::from_file(path)).first;
+    }
+    return found->second;
+}
+
+/**
+ * @brief Replays what the plugin draws for a planned plot, without drawing
+ * - computes the same band or geometry of naps.
+ *
+ * @param session: Session of the plot's stream
+ * @param table: Nap table of the stream
+ * @param topology: Mapping of CPUs to nodes, null if bands aren't recorded
+ * @param req: Recorded draw request
+ * @param plan: Contents of the plot
+ *
+ * @returns Number of naps the plot shows, zero for bands.
+*/
+static size_t _replay_plan(const NapSession& session, const NapTable& table,
+    const NapTopology* topology, const NapDrawRequest& req,
+    const NapDrawPlan& plan)
+{
+    plugin_naps_context* ctx = session.context();
+    const int sd = session.stream()->stream_id;
+
+    switch (plan.path) {
+    case NapDrawPath::NODE_BAND:
+        NapNodeAggregate::from_context(ctx)->band(table, *topology, plan.node,
+            req.view);
+        return 0;
+    case NapDrawPath::COMM_BAND:
+        NapCommAggregate::from_context(ctx)->band(table, sd, req.val,
+            req.view);
+        return 0;
+    case NapDrawPath::TOP_NAPS: {
+        NapGeometry geometry;
+        naps_top_geometry(*plan.task, req.view, req.x_origin, req.bin_width,
+            size_t(plan.budget), geometry);
+        naps_rest_summary(*plan.task, req.view, geometry.idx,
+            std::min(plan.budget, req.view.n_bins));
+        return geometry.size();
+    }
+    case NapDrawPath::ALL_NAPS: {
+        const NapGeometry* geometry = NapGeometryPass::from_context(ctx)->get(
+            table, req.view, req.x_origin, req.bin_width, req.val);
+        return geometry ? geometry->size() : 0;
+    }
+    case NapDrawPath::NOTHING:
+        break;
+    }
+    return 0;
+}
+
+/**
+ * @brief Entry point, loads recorded streams and replays the requests.
+*/
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        _usage(argv[0]);
+        return 1;
+    }
+
+    NapDrawRecord record;
+    if (!record.read(argv[1])) {
+        std::fprintf(stderr, "Couldn't read draw record %s\n", argv[1]);
+        return 1;
+    }
+
+    int repeat = 1;
+    std::map<int, std::string> traces;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-r" || arg == "--repeat") && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if ((arg == "-t" || arg == "--trace") && i + 1 < argc) {
+            const char* spec = argv[++i];
+            const char* eq = std::strchr(spec, '=');
+            if (!eq) {
+                _usage(argv[0]);
+                return 1;
+            }
+            traces[std::atoi(spec)] = eq + 1;
+        } else if ((arg == "-x" || arg == "--exclude") && i + 1 < argc) {
+            naps_set_excluded_states(argv[++i]);
+        } else {
+            _usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // A recorded stream is a stream identifier with one of its trace files,
+    // KernelShark reuses identifiers of closed streams
+    using stream_key_t = std::pair<int, std::string>;
+    for (NapDrawRequest& req : record.requests) {
+        const auto trace = traces.find(req.sd);
+        if (trace != traces.end()) req.file = trace->second;
+    }
+
+    // Load every recorded stream first, KernelShark's loading isn't
+    // thread-safe, then build nap tables of all of them at once
+    std::map<stream_key_t, std::unique_ptr<NapSession>> sessions;
+    std::map<stream_key_t, int64_t> load_ns;
+    for (const NapDrawRequest& req : record.requests) {
+        const stream_key_t key{req.sd, req.file};
+        if (sessions.count(key)) continue;
+
+        auto session = std::make_unique<NapSession>();
+        auto start = replay_clock_t::now();
+        if (!session->open(req.file.c_str())) {
+            std::fprintf(stderr, "Couldn't load stream %d from %s\n",
+                req.sd, req.file.c_str());
+            return 1;
+        }
+        load_ns[key] = _ns_since(start);
+        sessions[key] = std::move(session);
+    }
+
+    // Builds report their own times, keyed by the loaded stream identifiers
+    NapBuildScheduler& builds = NapBuildScheduler::get_instance();
+    std::mutex build_mutex;
+    std::map<int, int64_t> build_ns;
+    const int listener = builds.add_listener(
+        [&](int sd, const NapTable*, int64_t ns) {
+            std::lock_guard lock{build_mutex};
+            build_ns[sd] = ns;
+        });
+
+    auto start = replay_clock_t::now();
+    for (const auto& [key, session] : sessions) {
+        builds.schedule(session->context(), session->stream()->stream_id);
+    }
+    for (const auto& [key, session] : sessions) session->table();
+    const int64_t all_build_ns = _ns_since(start);
+    builds.remove_listener(listener);
+
+    for (const auto& [key, session] : sessions) {
+        const NapTable* table = session->table();
+        const auto built = build_ns.find(session->stream()->stream_id);
+        std::printf("stream %d: %s, %zd entries, %zu naps,"
+            " load %.3f ms, table build %.3f ms\n",
+            key.first, key.second.c_str(), session->n_entries(),
+            table ? table->size() : 0, load_ns[key] / 1e6,
+            (built != build_ns.end() ? built->second : 0) / 1e6);
+    }
+    std::printf("table builds of %zu streams: %.3f ms\n", sessions.size(),
+        all_build_ns / 1e6);
+
+    // Requests taking each path, in the order of `NapDrawPath`
+    uint64_t paths[std::size(PATH_NAMES)] = {};
+    uint64_t skipped = 0, naps = 0;
+    int64_t total_ns = 0, max_ns = 0;
+    std::map<std::string, NapTopology> topologies;
+
+    for (int r = 0; r < repeat; ++r) {
+        for (const NapDrawRequest& req : record.requests) {
+            auto start = replay_clock_t::now();
+
+            // Same pre-conditions and choice of contents as the plugin's
+            // drawing function
+            auto session = sessions.find(stream_key_t{req.sd, req.file});
+            if (session == sessions.end()) {
+                ++skipped;
+                continue;
+            }
+
+            NapDrawPlan plan;
+            const NapTable* table = naps_draws_plot(req.draw_action,
+                req.settings) ? session->second->table() : nullptr;
+            if (table) {
+                const NapTopology* topology = req.settings.numa_bands
+                    ? &_get_topology(req.settings.numa_topology, topologies)
+                    : nullptr;
+                plan = naps_plan_draw(session->second->context(), *table,
+                    topology, session->second->stream()->stream_id, req.val,
+                    req.draw_action, req.view, req.settings);
+                naps += _replay_plan(*session->second, *table, topology, req,
+                    plan);
+            }
+
+            int64_t request_ns = _ns_since(start);
+            total_ns += request_ns;
+            max_ns = std::max(max_ns, request_ns);
+            ++paths[size_t(plan.path)];
+        }
+    }
+
+    const uint64_t replayed = record.requests.size() * uint64_t(repeat)
+        - skipped;
+    std::printf("requests: %zu x %d, replayed %" PRIu64 ", skipped %" PRIu64
+        "\n", record.requests.size(), repeat, replayed, skipped);
+    for (size_t p = 0; p < std::size(PATH_NAMES); ++p) {
+        std::printf("  %s: %" PRIu64 "\n", PATH_NAMES[p], paths[p]);
+    }
+    std::printf("naps in view: %" PRIu64 "\n", naps);
+    std::printf("draw time: total %.3f ms, mean %.3f us, max %.3f us\n",
+        total_ns / 1e6, replayed ? total_ns / 1e3 / double(replayed) : 0.,
+        max_ns / 1e3);
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    tail.cpp
+ * @brief   Headless live tail of a growing trace file. Loads the file, then
+ *          follows it - whenever it grows, only the appended records are
+ *          ingested and the nap table is extended with them. Prints what
+ *          each refresh cost.
+*/
+
+// C
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
+
+// C++
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <utility>
+
+// Plugin
+#include "NapSession.hpp"
+
+// Static functions
+
+/**
+ * @brief Prints usage of the tail.
+*/
+static void _usage(const char* prog) {
+    std::fprintf(stderr,
+        "Usage: %s TRACE [options]\n"
+        "  -i, --interval MS    check the file for growth every MS ms (default 500)\n"
+        "  -n, --refreshes N    stop after N refreshes (default never)\n"
+        "  -x, --exclude STATES drop switches with these prev_states on load\n",
+        prog);
+}
+
+/**
+ * @brief Gets size and modification time of a file, which change together
+ * whenever the file grows.
+ *
+ * @param file: Path to the file
+ *
+ * @returns Pair of the size and the modification time in nanoseconds, both
+ * negative if the file can't be accessed.
+*/
+static std::pair<int64_t, int64_t> _file_version(const char* file) {
+    struct stat st;
+    if (stat(file, &st) != 0) return {-1, -1};
+    return {int64_t(st.st_size),
+            int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec};
+}
+
+/**
+ * @brief Gets nanoseconds elapsed since a time point.
+*/
+static int64_t _ns_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Entry point, loads the trace file and follows it.
+*/
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        _usage(argv[0]);
+        return 1;
+    }
+
+    int interval_ms = 500;
+    long refreshes = -1;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-i" || arg == "--interval") && i + 1 < argc) {
+            interval_ms = std::max(1, std::atoi(argv[++i]));
+        } else if ((arg == "-n" || arg == "--refreshes") && i + 1 < argc) {
+            refreshes = std::atol(argv[++i]);
+        } else if ((arg == "-x" || arg == "--exclude") && i + 1 < argc) {
+            naps_set_excluded_states(argv[++i]);
+        } else {
+            _usage(argv[0]);
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto version = _file_version(argv[1]);
+    NapSession session;
+    if (!session.open(argv[1], true) || !session.table()) {
+        std::fprintf(stderr, "Couldn't load %s\n", argv[1]);
+        return 1;
+    }
+    std::printf("loaded %zd entries, %zu naps in %.3f ms\n",
+        session.n_entries(), session.table()->size(), _ns_since(start) / 1e6);
+
+    for (long done = 0; refreshes < 0 || done < refreshes;) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+
+        auto current = _file_version(argv[1]);
+        if (current == version) continue;
+        version = current;
+
+        start = std::chrono::steady_clock::now();
+        const size_t naps_before = session.table()->size();
+        const ssize_t n_new = session.tail();
+        if (n_new < 0) {
+            std::fprintf(stderr, "Couldn't load %s again\n", argv[1]);
+            return 1;
+        }
+        const int64_t load_ns = _ns_since(start);
+
+        start = std::chrono::steady_clock::now();
+        const NapTable* table = session.table();
+        const int64_t extend_ns = _ns_since(start);
+
+        std::printf("+%zd entries, +%zu naps (%zu total), load %.3f ms,"
+            " extend %.3f ms\n", n_new, table->size() - naps_before,
+            table->size(), load_ns / 1e6, extend_ns / 1e6);
+        std::fflush(stdout);
+        ++done;
+    }
+
+    return 0;
+}
@@ -0,0 +1,798 @@
+/** Copyright (C) 2025, David Jaromír Šebánek <djsebofficial@gmail.com> **/
+
+/**
+ * @file    tracegen.cpp
+ * @brief   Standalone generator of synthetic trace-cmd (`trace.dat`, version 6)
+ *          files containing only scheduler events relevant to the plugin,
+ *          i.e. `sched/sched_switch`, `sched/sched_waking` and optionally
+ *          `sched/sched_wakeup`, `block/block_rq_issue` and
+ *          `block/block_rq_complete`.
+ *
+ * @note    Generator simulates each CPU independently - tasks are pinned to
+ *          CPUs (task `i` lives on CPU `i % cpus`), which lets every CPU buffer
+ *          be streamed into the file one after another, with bounded memory,
+ *          no matter how many events are requested.
+*/
+
+// C
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++
+#include <algorithm>
+#include <deque>
+#include <queue>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Constants
+
+///
+/// @brief Size of a ring buffer page, same as on x86-64 machines.
+constexpr uint32_t PAGE_SIZE = 4096;
+
+///
+/// @brief Size of a ring buffer page header (timestamp + commit).
+constexpr uint32_t PAGE_HEADER_SIZE = 16;
+
+///
+/// @brief Largest time delta representable in an event header.
+constexpr uint64_t MAX_TIME_DELTA = (1ULL << 27) - 1;
+
+///
+/// @brief Event header type for extended time deltas.
+constexpr uint32_t TYPE_TIME_EXTEND = 30;
+
+///
+/// @brief First timestamp of the generated trace, in nanoseconds.
+constexpr uint64_t TRACE_START_TS = 1000ULL * 1000 * 1000 * 1000;
+
+/// @brief Numerical IDs of the generated events, same as on a commonly
+/// found kernel (they only have to match the formats written below).
+constexpr uint16_t SWITCH_ID = 316;
+/// @brief See `SWITCH_ID`.
+constexpr uint16_t WAKEUP_ID = 317;
+/// @brief See `SWITCH_ID`.
+constexpr uint16_t WAKING_ID = 318;
+/// @brief See `SWITCH_ID`.
+constexpr uint16_t BLOCK_ISSUE_ID = 1130;
+/// @brief See `SWITCH_ID`.
+constexpr uint16_t BLOCK_COMPLETE_ID = 1132;
+
+///
+/// @brief Contents of the `events/header_page` file.
+static const char HEADER_PAGE[] =
+    "\tfield: u64 timestamp;\toffset:0;\tsize:8;\tsigned:0;\n"
+    "\tfield: local_t commit;\toffset:8;\tsize:8;\tsigned:1;\n"
+    "\tfield: int overwrite;\toffset:8;\tsize:1;\tsigned:1;\n"
+    "\tfield: char data;\toffset:16;\tsize:4080;\tsigned:1;\n";
+
+///
+/// @brief Contents of the `events/header_event` file.
+static const char HEADER_EVENT[] =
+    "# compressed entry header\n"
+    "\ttype_len    :    5 bits\n"
+    "\ttime_delta  :   27 bits\n"
+    "\tarray       :   32 bits\n"
+    "\n"
+    "\tpadding     : type == 29\n"
+    "\ttime_extend : type == 30\n"
+    "\ttime_stamp : type == 31\n"
+    "\tdata max type_len  == 28\n";
+
+///
+/// @brief Common part of every event format.
+static const char COMMON_FIELDS[] =
+    "format:\n"
+    "\tfield:unsigned short common_type;\toffset:0;\tsize:2;\tsigned:0;\n"
+    "\tfield:unsigned char common_flags;\toffset:2;\tsize:1;\tsigned:0;\n"
+    "\tfield:unsigned char common_preempt_count;\toffset:3;\tsize:1;\tsigned:0;\n"
+    "\tfield:int common_pid;\toffset:4;\tsize:4;\tsigned:1;\n"
+    "\n";
+
+///
+/// @brief Event-specific part of the `sched_switch` format.
+static const char SWITCH_FIELDS[] =
+    "\tfield:char prev_comm[16];\toffset:8;\tsize:16;\tsigned:0;\n"
+    "\tfield:pid_t prev_pid;\toffset:24;\tsize:4;\tsigned:1;\n"
+    "\tfield:int prev_prio;\toffset:28;\tsize:4;\tsigned:1;\n"
+    "\tfield:long prev_state;\toffset:32;\tsize:8;\tsigned:1;\n"
+    "\tfield:char next_comm[16];\toffset:40;\tsize:16;\tsigned:0;\n"
+    "\tfield:pid_t next_pid;\toffset:56;\tsize:4;\tsigned:1;\n"
+    "\tfield:int next_prio;\toffset:60;\tsize:4;\tsigned:1;\n"
+    "\n"
+    "print fmt: \"prev_comm=%s prev_pid=%d prev_prio=%d prev_state=%s%s"
+    " ==> next_comm=%s next_pid=%d next_prio=%d\", REC->prev_comm,"
+    " REC->prev_pid, REC->prev_prio, (REC->prev_state & 0xff) ?"
+    " __print_flags(REC->prev_state & 0xff, \"|\", { 0x01, \"S\" },"
+    " { 0x02, \"D\" }, { 0x04, \"T\" }, { 0x08, \"t\" }, { 0x10, \"X\" },"
+    " { 0x20, \"Z\" }, { 0x40, \"P\" }, { 0x80, \"I\" }) : \"R\","
+    " REC->prev_state & 0x100 ? \"+\" : \"\", REC->next_comm, REC->next_pid,"
+    " REC->next_prio\n";
+
+///
+/// @brief Event-specific part of `sched_waking` and `sched_wakeup` formats.
+static const char WAKE_FIELDS[] =
+    "\tfield:char comm[16];\toffset:8;\tsize:16;\tsigned:0;\n"
+    "\tfield:pid_t pid;\toffset:24;\tsize:4;\tsigned:1;\n"
+    "\tfield:int prio;\toffset:28;\tsize:4;\tsigned:1;\n"
+    "\tfield:int target_cpu;\toffset:32;\tsize:4;\tsigned:1;\n"
+    "\n"
+    "print fmt: \"comm=%s pid=%d prio=%d target_cpu=%03d\", REC->comm,"
+    " REC->pid, REC->prio, REC->target_cpu\n";
+
+///
+/// @brief Event-specific part of the `block_rq_issue` format.
+static const char BLOCK_ISSUE_FIELDS[] =
+    "\tfield:dev_t dev;\toffset:8;\tsize:4;\tsigned:0;\n"
+    "\tfield:sector_t sector;\toffset:16;\tsize:8;\tsigned:0;\n"
+    "\tfield:unsigned int nr_sector;\toffset:24;\tsize:4;\tsigned:0;\n"
+    "\tfield:char rwbs[8];\toffset:28;\tsize:8;\tsigned:0;\n"
+    "\n"
+    "print fmt: \"dev=%u sector=%llu nr_sector=%u rwbs=%s\", REC->dev,"
+    " (unsigned long long)REC->sector, REC->nr_sector, REC->rwbs\n";
+
+///
+/// @brief Event-specific part of the `block_rq_complete` format.
+static const char BLOCK_COMPLETE_FIELDS[] =
+    "\tfield:dev_t dev;\toffset:8;\tsize:4;\tsigned:0;\n"
+    "\tfield:sector_t sector;\toffset:16;\tsize:8;\tsigned:0;\n"
+    "\tfield:unsigned int nr_sector;\toffset:24;\tsize:4;\tsigned:0;\n"
+    "\tfield:int error;\toffset:28;\tsize:4;\tsigned:1;\n"
+    "\tfield:char rwbs[8];\toffset:32;\tsize:8;\tsigned:0;\n"
+    "\n"
+    "print fmt: \"dev=%u sector=%llu nr_sector=%u error=%d rwbs=%s\","
+    " REC->dev, (unsigned long long)REC->sector, REC->nr_sector, REC->error,"
+    " REC->rwbs\n";
+
+///
+/// @brief Payload sizes of the generated events.
+constexpr uint32_t SWITCH_SIZE = 64;
+/// @brief See `SWITCH_SIZE`.
+constexpr uint32_t WAKE_SIZE = 36;
+/// @brief See `SWITCH_SIZE`.
+constexpr uint32_t BLOCK_ISSUE_SIZE = 36;
+/// @brief See `SWITCH_SIZE`.
+constexpr uint32_t BLOCK_COMPLETE_SIZE = 40;
+
+///
+/// @brief Kernel's device numbers of simulated block devices, `8:0` and
+/// `8:16`.
+static const uint32_t BLOCK_DEVICES[] = {8u << 20, (8u << 20) | 16};
+
+///
+/// @brief Largest distance of a completion from a wakeup for the plugin to
+/// see them coincide, in nanoseconds. Some completions are put right at
+/// its edge.
+constexpr uint64_t BLOCK_WAKEUP_WINDOW = 50'000;
+
+///
+/// @brief Priority written into every generated event.
+constexpr int32_t TASK_PRIO = 120;
+
+///
+/// @brief Prev_state letters in the order of their kernel bits (`R` is 0).
+static const char STATE_LETTERS[] = "SDTtXZPI";
+
+// Structures
+
+/**
+ * @brief User-configurable parameters of the generator.
+*/
+struct GenOptions {
+    ///
+    /// @brief Path of the output file.
+    std::string output{"trace.dat"};
+    ///
+    /// @brief Number of CPU buffers.
+    uint32_t cpus{4};
+    ///
+    /// @brief Number of simulated tasks (excluding idle tasks).
+    uint32_t tasks{64};
+    ///
+    /// @brief Total number of events to generate.
+    uint64_t events{1000000};
+    ///
+    /// @brief Average number of events per second on a single CPU.
+    uint64_t rate{100000};
+    ///
+    /// @brief Whether to emit `sched_wakeup` after every `sched_waking`.
+    bool wakeup{false};
+    ///
+    /// @brief Whether tasks switched out in the `D` state issue block
+    /// requests, completed around their wakeups.
+    bool block{false};
+    ///
+    /// @brief Seed of the pseudo-random generator.
+    uint64_t seed{1};
+    /// @brief Relative weights of prev_states of switched-out tasks,
+    /// as pairs of state letter and weight.
+    std::vector<std::pair<char, double>> states{
+        {'S', 60.}, {'R', 25.}, {'D', 10.}, {'I', 5.}
+    };
+};
+
+/**
+ * @brief Writes events of a single CPU into ring buffer pages and
+ * streams full pages into the output file.
+*/
+class PageWriter {
+private:
+    ///
+    /// @brief Output file.
+    std::FILE* _out;
+    ///
+    /// @brief Page currently being filled.
+    std::vector<uint8_t> _page;
+    ///
+    /// @brief Write position inside the current page.
+    uint32_t _pos{PAGE_HEADER_SIZE};
+    ///
+    /// @brief Timestamp of the last written event.
+    uint64_t _last_ts{0};
+    ///
+    /// @brief Whether the current page already has its timestamp.
+    bool _page_open{false};
+public:
+    ///
+    /// @brief Number of pages streamed into the file.
+    uint64_t pages_written{0};
+public:
+    explicit PageWriter(std::FILE* out) : _out(out), _page(PAGE_SIZE, 0) {}
+
+    /**
+     * @brief Appends an event into the current page, starting a new page
+     * if it doesn't fit.
+     *
+     * @param ts: Absolute timestamp of the event
+     * @param payload: Raw event data (size must be a multiple of 4)
+     * @param size: Size of the raw event data
+    */
+    void append(uint64_t ts, const uint8_t* payload, uint32_t size) {
+        uint64_t delta = _page_open ? ts - _last_ts : 0;
+        uint32_t needed = 4 + size + ((delta > MAX_TIME_DELTA) ? 8 : 0);
+
+        if (_pos + needed > PAGE_SIZE) {
+            flush();
+            delta = 0;
+        }
+
+        if (!_page_open) {
+            _put64(0, ts);
+            _page_open = true;
+        }
+
+        if (delta > MAX_TIME_DELTA) {
+            _put32(_pos, TYPE_TIME_EXTEND | uint32_t((delta & MAX_TIME_DELTA) << 5));
+            _put32(_pos + 4, uint32_t(delta >> 27));
+            _pos += 8;
+            delta = 0;
+        }
+
+        _put32(_pos, (size / 4) | uint32_t(delta << 5));
+        std::memcpy(&_page[_pos + 4], payload, size);
+        _pos += 4 + size;
+        _last_ts = ts;
+    }
+
+    /**
+     * @brief Writes out the current page (if it holds any event) and
+     * resets the writer for the next page.
+    */
+    void flush() {
+        if (!_page_open) return;
+
+        _put64(8, _pos - PAGE_HEADER_SIZE);
+        std::fwrite(_page.data(), 1, PAGE_SIZE, _out);
+        ++pages_written;
+
+        std::fill(_page.begin(), _page.end(), 0);
+        _pos = PAGE_HEADER_SIZE;
+        _page_open = false;
+    }
+private:
+    /// @brief Stores a little-endian 32-bit value into the page.
+    void _put32(uint32_t at, uint32_t val)
+    { for (int i = 0; i < 4; ++i) _page[at + i] = uint8_t(val >> (8 * i)); }
+
+    /// @brief Stores a little-endian 64-bit value into the page.
+    void _put64(uint32_t at, uint64_t val)
+    { for (int i = 0; i < 8; ++i) _page[at + i] = uint8_t(val >> (8 * i)); }
+};
+
+/**
+ * @brief Simulated task.
+*/
+struct SimTask {
+    ///
+    /// @brief PID of the task.
+    int32_t pid;
+    ///
+    /// @brief Command name of the task, padded to 16 bytes.
+    char comm[16];
+};
+
+// Static functions
+
+/**
+ * @brief Writes a value in little endian into the output file.
+*/
+template<typename T>
+static void _write_le(std::FILE* out, T val) {
+    uint8_t bytes[sizeof(T)];
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        bytes[i] = uint8_t(uint64_t(val) >> (8 * i));
+    }
+    std::fwrite(bytes, 1, sizeof(T), out);
+}
+
+/**
+ * @brief Writes a length-prefixed block (64-bit length) into the output file.
+*/
+static void _write_block(std::FILE* out, const std::string& data) {
+    _write_le<uint64_t>(out, data.size());
+    std::fwrite(data.data(), 1, data.size(), out);
+}
+
+/**
+ * @brief Builds the full format file of an event.
+*/
+static std::string _event_format(const char* name, uint16_t id,
+    const char* fields)
+{
+    return std::string("name: ") + name + "\nID: " + std::to_string(id)
+        + "\n" + COMMON_FIELDS + fields;
+}
+
+/**
+ * @brief Stores a value in little endian into a raw event buffer.
+*/
+template<typename T>
+static void _put(uint8_t* buf, uint32_t at, T val) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        buf[at + i] = uint8_t(uint64_t(val) >> (8 * i));
+    }
+}
+
+/**
+ * @brief Converts a prev_state letter into the kernel's bit representation.
+*/
+static int64_t _state_bits(char state) {
+    const char* found = std::strchr(STATE_LETTERS, state);
+    return (state == 'R' || !found) ? 0 : (1LL << (found - STATE_LETTERS));
+}
+
+/**
+ * @brief Writes all file headers up to (and including) the `flyrecord`
+ * section marker.
+ *
+ * @returns File offset of the per-CPU offset/size table.
+*/
+static long _write_headers(std::FILE* out, const GenOptions& opts,
+    const std::vector<SimTask>& tasks)
+{
+    static const char MAGIC[] = {0x17, 0x08, 0x44, 't', 'r', 'a', 'c', 'i', 'n', 'g'};
+    std::fwrite(MAGIC, 1, sizeof(MAGIC), out);
+    std::fwrite("6", 1, 2, out);
+    _write_le<uint8_t>(out, 0);  // little endian
+    _write_le<uint8_t>(out, 8);  // sizeof(long)
+    _write_le<uint32_t>(out, PAGE_SIZE);
+
+    std::fwrite("header_page", 1, 12, out);
+    _write_block(out, HEADER_PAGE);
+    std::fwrite("header_event", 1, 13, out);
+    _write_block(out, HEADER_EVENT);
+
+    // No ftrace internal events
+    _write_le<uint32_t>(out, 0);
+
+    // One or two event systems
+    _write_le<uint32_t>(out, opts.block ? 2 : 1);
+    std::fwrite("sched", 1, 6, out);
+    _write_le<uint32_t>(out, opts.wakeup ? 3 : 2);
+    _write_block(out, _event_format("sched_switch", SWITCH_ID, SWITCH_FIELDS));
+    _write_block(out, _event_format("sched_waking", WAKING_ID, WAKE_FIELDS));
+    if (opts.wakeup) {
+        _write_block(out, _event_format("sched_wakeup", WAKEUP_ID, WAKE_FIELDS));
+    }
+    if (opts.block) {
+        std::fwrite("block", 1, 6, out);
+        _write_le<uint32_t>(out, 2);
+        _write_block(out, _event_format("block_rq_issue", BLOCK_ISSUE_ID,
+            BLOCK_ISSUE_FIELDS));
+        _write_block(out, _event_format("block_rq_complete",
+            BLOCK_COMPLETE_ID, BLOCK_COMPLETE_FIELDS));
+    }
+
+    // No kallsyms, no printk formats
+    _write_le<uint32_t>(out, 0);
+    _write_le<uint32_t>(out, 0);
+
+    std::string cmdlines;
+    for (const SimTask& task : tasks) {
+        cmdlines += std::to_string(task.pid) + " " + task.comm + "\n";
+    }
+    _write_block(out, cmdlines);
+
+    _write_le<uint32_t>(out, opts.cpus);
+    std::fwrite("flyrecord", 1, 10, out);
+
+    long table_offset = std::ftell(out);
+    for (uint32_t cpu = 0; cpu < opts.cpus; ++cpu) {
+        _write_le<uint64_t>(out, 0);
+        _write_le<uint64_t>(out, 0);
+    }
+    return table_offset;
+}
+
+/**
+ * @brief Simulates a single CPU and writes its events.
+ *
+ * @param writer: Page writer of the CPU's buffer
+ * @param opts: Generator options
+ * @param tasks: Tasks pinned to this CPU
+ * @param cpu: Simulated CPU
+ * @param quota: Number of events to generate on this CPU
+*/
+static void _simulate_cpu(PageWriter& writer, const GenOptions& opts,
+    const std::vector<const SimTask*>& tasks, uint32_t cpu, uint64_t quota)
+{
+    using sleeper_t = std::pair<uint64_t, const SimTask*>;
+    // Completion time, device, first sector and number of sectors
+    using completion_t = std::tuple<uint64_t, uint32_t, uint64_t, uint32_t>;
+
+    std::mt19937_64 rng{opts.seed * 0x9E3779B97F4A7C15ULL + cpu};
+    std::vector<double> weights, sleep_weights;
+    for (const auto& st : opts.states) {
+        weights.push_back(st.second);
+        // Non-running states only, used if nobody else is runnable
+        sleep_weights.push_back(st.first == 'R' ? 0. : st.second);
+    }
+    std::discrete_distribution<size_t> pick_state{weights.begin(), weights.end()};
+    std::discrete_distribution<size_t> pick_sleep_state{sleep_weights.begin(),
+        sleep_weights.end()};
+    bool has_sleep_state = std::any_of(opts.states.begin(), opts.states.end(),
+        [](const auto& st) { return st.first != 'R' && st.second > 0.; });
+
+    // Roughly two events per time slice, sleeps last as long as
+    // everyone else on the CPU takes to run once.
+    const double mean_slice = 2e9 / double(opts.rate);
+    std::exponential_distribution<double> slice_len{1. / mean_slice};
+    std::exponential_distribution<double> sleep_len{
+        1. / (mean_slice * double(std::max<size_t>(tasks.size(), 1)))};
+
+    SimTask idle{0, {}};
+    std::snprintf(idle.comm, sizeof(idle.comm), "swapper/%u", cpu);
+
+    std::deque<const SimTask*> runqueue(tasks.begin(), tasks.end());
+    std::priority_queue<sleeper_t, std::vector<sleeper_t>,
+        std::greater<sleeper_t>> sleepers;
+    std::priority_queue<completion_t, std::vector<completion_t>,
+        std::greater<completion_t>> completions;
+    // Sectors of each CPU's requests are disjoint, so requests are unique
+    uint64_t next_sector = uint64_t(cpu) << 32;
+    const SimTask* current = &idle;
+    uint64_t now = TRACE_START_TS;
+    uint64_t emitted = 0;
+
+    uint8_t buf[SWITCH_SIZE];
+
+    auto emit_block = [&](uint16_t id, uint64_t ts, uint32_t dev,
+        uint64_t sector, uint32_t nr_sector)
+    {
+        const bool is_complete = (id == BLOCK_COMPLETE_ID);
+        uint8_t block_buf[BLOCK_COMPLETE_SIZE]{};
+        _put<uint16_t>(block_buf, 0, id);
+        _put<int32_t>(block_buf, 4, current->pid);
+        _put<uint32_t>(block_buf, 8, dev);
+        _put<uint64_t>(block_buf, 16, sector);
+        _put<uint32_t>(block_buf, 24, nr_sector);
+        std::memcpy(block_buf + (is_complete ? 32 : 28), "R", 2);
+        writer.append(ts, block_buf,
+            is_complete ? BLOCK_COMPLETE_SIZE : BLOCK_ISSUE_SIZE);
+        ++emitted;
+    };
+
+    // Completions are written once the simulation gets to them, so that
+    // the CPU's events stay ordered by time
+    auto emit_completions = [&](uint64_t until) {
+        while (!completions.empty() && std::get<0>(completions.top()) <= until) {
+            const auto [ts, dev, sector, nr_sector] = completions.top();
+            completions.pop();
+            emit_block(BLOCK_COMPLETE_ID, ts, dev, sector, nr_sector);
+        }
+    };
+
+    // A task going to sleep in the `D` state waits on a few requests. The
+    // first one completes around its wakeup - before it, after it or at
+    // the edge of the plugin's window - and the second one sometimes as
+    // far after the wakeup as the first one before it. Others complete any
+    // time until the wakeup or a little later.
+    auto issue_requests = [&](uint64_t wake_at) {
+        const uint64_t n_requests = 1 + rng() % 3;
+        uint32_t first_dev = 0;
+        uint64_t before = 0;
+        for (uint64_t i = 0; i < n_requests; ++i) {
+            const uint64_t kind = (i == 0) ? rng() % 4
+                : (i == 1 && before) ? 4 + rng() % 2 : 5;
+            const uint32_t dev = (kind == 4) ? first_dev
+                : BLOCK_DEVICES[rng() % std::size(BLOCK_DEVICES)];
+            const uint32_t nr_sector = 8 * uint32_t(1 + rng() % 16);
+            emit_block(BLOCK_ISSUE_ID, now, dev, next_sector, nr_sector);
+
+            uint64_t complete_at;
+            if (kind == 0) {
+                before = std::min(wake_at - now, 1 + rng() % 20000);
+                complete_at = wake_at - before;
+            } else if (kind == 1) {
+                complete_at = wake_at + rng() % (2 * BLOCK_WAKEUP_WINDOW);
+            } else if (kind == 2) {
+                complete_at = wake_at + BLOCK_WAKEUP_WINDOW + rng() % 2;
+            } else if (kind == 4) {
+                complete_at = wake_at + before;
+            } else {
+                complete_at = now + rng() % (wake_at - now
+                    + 2 * BLOCK_WAKEUP_WINDOW);
+            }
+            completions.push({complete_at, dev, next_sector, nr_sector});
+            first_dev = dev;
+            next_sector += nr_sector;
+        }
+    };
+
+    auto emit_wake = [&](uint16_t id, const SimTask* wakee) {
+        emit_completions(now);
+        std::memset(buf, 0, WAKE_SIZE);
+        _put<uint16_t>(buf, 0, id);
+        _put<int32_t>(buf, 4, current->pid);
+        std::memcpy(buf + 8, wakee->comm, 16);
+        _put<int32_t>(buf, 24, wakee->pid);
+        _put<int32_t>(buf, 28, TASK_PRIO);
+        _put<int32_t>(buf, 32, int32_t(cpu));
+        writer.append(now, buf, WAKE_SIZE);
+        ++emitted;
+    };
+
+    auto emit_switch = [&](char prev_state, const SimTask* next) {
+        emit_completions(now);
+        std::memset(buf, 0, SWITCH_SIZE);
+        _put<uint16_t>(buf, 0, SWITCH_ID);
+        _put<int32_t>(buf, 4, current->pid);
+        std::memcpy(buf + 8, current->comm, 16);
+        _put<int32_t>(buf, 24, current->pid);
+        _put<int32_t>(buf, 28, TASK_PRIO);
+        _put<int64_t>(buf, 32, _state_bits(prev_state));
+        std::memcpy(buf + 40, next->comm, 16);
+        _put<int32_t>(buf, 56, next->pid);
+        _put<int32_t>(buf, 60, TASK_PRIO);
+        writer.append(now, buf, SWITCH_SIZE);
+        ++emitted;
+        current = next;
+    };
+
+    if (tasks.empty()) return;
+
+    while (emitted < quota) {
+        uint64_t switch_at = now + uint64_t(slice_len(rng)) + 1;
+        bool wake_first = !sleepers.empty()
+            && (current == &idle || sleepers.top().first <= switch_at);
+
+        if (wake_first) {
+            now = std::max(now, sleepers.top().first);
+            const SimTask* wakee = sleepers.top().second;
+            sleepers.pop();
+
+            emit_wake(WAKING_ID, wakee);
+            if (opts.wakeup) emit_wake(WAKEUP_ID, wakee);
+            runqueue.push_back(wakee);
+
+            if (current == &idle) {
+                emit_switch('R', runqueue.front());
+                runqueue.pop_front();
+            }
+            continue;
+        }
+
+        now = switch_at;
+        if (current == &idle) {
+            // Nothing sleeps and idle runs - only possible at the start
+            emit_switch('R', runqueue.front());
+            runqueue.pop_front();
+            continue;
+        }
+
+        char state = opts.states[pick_state(rng)].first;
+        if (state == 'R' && runqueue.empty()) {
+            // Can't be preempted by nobody
+            if (!has_sleep_state) continue;
+            state = opts.states[pick_sleep_state(rng)].first;
+        }
+
+        const SimTask* prev = current;
+        const SimTask* next = &idle;
+        if (!runqueue.empty()) {
+            next = runqueue.front();
+            runqueue.pop_front();
+        }
+
+        if (state == 'R') {
+            emit_switch(state, next);
+            runqueue.push_back(prev);
+            continue;
+        }
+
+        const uint64_t wake_at = now + uint64_t(sleep_len(rng)) + 1;
+        if (opts.block && state == 'D') {
+            emit_completions(now);
+            issue_requests(wake_at);
+        }
+        emit_switch(state, next);
+        sleepers.push({wake_at, prev});
+    }
+
+    emit_completions(UINT64_MAX);
+    writer.flush();
+}
+
+/**
+ * @brief Parses the `--states` option, e.g. `S:60,R:25,D:10,I:5`.
+ *
+ * @returns True on success, false on malformed input.
+*/
+static bool _parse_states(const char* arg, GenOptions& opts) {
+    opts.states.clear();
+    std::string spec{arg};
+    size_t pos = 0;
+
+    while (pos < spec.size()) {
+        size_t end = spec.find(',', pos);
+        if (end == std::string::npos) end = spec.size();
+        std::string item = spec.substr(pos, end - pos);
+
+        if (item.size() < 3 || item[1] != ':'
+            || (item[0] != 'R' && !std::strchr(STATE_LETTERS, item[0]))) {
+            return false;
+        }
+        double weight = std::atof(item.c_str() + 2);
+        if (weight < 0.) return false;
+        opts.states.push_back({item[0], weight});
+        pos = end + 1;
+    }
+
+    return std::any_of(opts.states.begin(), opts.states.end(),
+        [](const auto& st) { return st.second > 0.; });
+}
+
+/**
+ * @brief Prints usage of the generator.
+*/
+static void _usage(const char* prog) {
+    std::fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  -o, --output FILE   output trace file (default trace.dat)\n"
+        "  -c, --cpus N        number of CPUs (default 4)\n"
+        "  -t, --tasks N       number of tasks (default 64)\n"
+        "  -n, --events N      total number of events (default 1000000)\n"
+        "  -r, --rate N        events per second per CPU (default 100000)\n"
+        "  -s, --states SPEC   prev_state mix (default S:60,R:25,D:10,I:5)\n"
+        "  -w, --wakeup        also emit sched_wakeup events\n"
+        "  -b, --block         emit block requests of tasks sleeping in D\n"
+        "      --seed N        random seed (default 1)\n", prog);
+}
+
+/**
+ * @brief Entry point, parses options, writes headers and then streams
+ * each CPU's buffer into the file.
+*/
+int main(int argc, char** argv) {
+    GenOptions opts;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = (i + 1 < argc);
+        auto is = [&](const char* s, const char* l) { return arg == s || arg == l; };
+
+        if (is("-w", "--wakeup")) {
+            opts.wakeup = true;
+        } else if (is("-b", "--block")) {
+            opts.block = true;
+        } else if (is("-h", "--help")) {
+            _usage(argv[0]);
+            return 0;
+        } else if (!has_value) {
+            _usage(argv[0]);
+            return 1;
+        } else if (is("-o", "--output")) {
+            opts.output = argv[++i];
+        } else if (is("-c", "--cpus")) {
+            opts.cpus = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+        } else if (is("-t", "--tasks")) {
+            opts.tasks = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+        } else if (is("-n", "--events")) {
+            opts.events = std::strtoull(argv[++i], nullptr, 10);
+        } else if (is("-r", "--rate")) {
+            opts.rate = std::strtoull(argv[++i], nullptr, 10);
+        } else if (is("-s", "--states")) {
+            if (!_parse_states(argv[++i], opts)) {
+                std::fprintf(stderr, "Invalid state mix: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (arg == "--seed") {
+            opts.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            _usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (opts.cpus == 0 || opts.tasks == 0 || opts.rate == 0) {
+        std::fprintf(stderr, "CPUs, tasks and rate must be positive.\n");
+        return 1;
+    }
+
+    bool only_running = std::none_of(opts.states.begin(), opts.states.end(),
+        [](const auto& st) { return st.first != 'R' && st.second > 0.; });
+    if (only_running && opts.tasks < 2 * opts.cpus) {
+        // Somebody has to be there to preempt the running task
+        std::fprintf(stderr, "Running-only mix needs two tasks per CPU.\n");
+        return 1;
+    }
+
+    std::vector<SimTask> tasks(opts.tasks);
+    for (uint32_t t = 0; t < opts.tasks; ++t) {
+        tasks[t].pid = int32_t(1000 + t);
+        std::snprintf(tasks[t].comm, sizeof(tasks[t].comm), "gen-%u", t);
+    }
+
+    std::FILE* out = std::fopen(opts.output.c_str(), "wb");
+    if (!out) {
+        std::perror(opts.output.c_str());
+        return 1;
+    }
+    // Generous buffering, the file is written strictly sequentially
+    static char out_buf[1 << 20];
+    std::setvbuf(out, out_buf, _IOFBF, sizeof(out_buf));
+
+    long table_offset = _write_headers(out, opts, tasks);
+    std::vector<std::pair<uint64_t, uint64_t>> cpu_sections;
+
+    for (uint32_t cpu = 0; cpu < opts.cpus; ++cpu) {
+        // CPU buffers start on page boundaries
+        long pos = std::ftell(out);
+        long aligned = (pos + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+        for (; pos < aligned; ++pos) std::fputc(0, out);
+
+        std::vector<const SimTask*> cpu_tasks;
+        for (uint32_t t = cpu; t < opts.tasks; t += opts.cpus) {
+            cpu_tasks.push_back(&tasks[t]);
+        }
+
+        // With fewer tasks than CPUs, only CPUs with tasks get events
+        const uint32_t busy_cpus = std::min(opts.cpus, opts.tasks);
+        const uint64_t quota = (cpu < busy_cpus) ? opts.events / busy_cpus
+            + ((cpu < opts.events % busy_cpus) ? 1 : 0) : 0;
+        PageWriter writer{out};
+        _simulate_cpu(writer, opts, cpu_tasks, cpu, quota);
+
+        cpu_sections.push_back({uint64_t(aligned),
+            writer.pages_written * PAGE_SIZE});
+    }
+
+    std::fseek(out, table_offset, SEEK_SET);
+    for (const auto& section : cpu_sections) {
+        _write_le<uint64_t>(out, section.first);
+        _write_le<uint64_t>(out, section.second);
+    }
+
+    if (std::fclose(out) != 0) {
+        std::perror(opts.output.c_str());
+        return 1;
+    }
+
+    return 0;
+}